@@ -1,10 +1,15 @@
 #include "xtensor/xrandom.hpp"
 #include "xtensor/xlayout.hpp"
+#include "xtensor/xmath.hpp"
 #include "simdhelpers.h"
 #include "biot_savart_impl.h"
 #include "biot_savart_vjp_c.h"
+#include "biot_savart_tree.h"
+#include "distance.h"
+#include "curvexyzfourier.h"
 
 #include <chrono>
+#include <memory>
 #include <iostream>
 #include <iomanip>
 #include <cstdlib>
@@ -144,6 +149,317 @@ void profile_biot_savart_vjp(int nsources, int ntargets, int nderivatives){
         << std::endl;
 }
 
+template<int nderivatives>
+void profile_biot_savart_tree(int ncoils, int nquadpoints, int ntargets, double theta, int order){
+    // ncoils circular coils of radius 0.3 arranged around a torus with major radius 1
+    vector<xt::xarray<double>> gammas, dgammas;
+    vector<double> positions, elements;
+    for (int c = 0; c < ncoils; ++c) {
+        double phi = 2*M_PI*c/ncoils;
+        xt::xarray<double> gamma = xt::zeros<double>({nquadpoints, 3});
+        xt::xarray<double> dgamma = xt::zeros<double>({nquadpoints, 3});
+        for (int j = 0; j < nquadpoints; ++j) {
+            double t = 2*M_PI*j/nquadpoints;
+            double R = 1 + 0.3*cos(t);
+            gamma(j, 0) = R*cos(phi);
+            gamma(j, 1) = R*sin(phi);
+            gamma(j, 2) = 0.3*sin(t);
+            dgamma(j, 0) = -0.3*2*M_PI*sin(t)*cos(phi);
+            dgamma(j, 1) = -0.3*2*M_PI*sin(t)*sin(phi);
+            dgamma(j, 2) = 0.3*2*M_PI*cos(t);
+            for (int l = 0; l < 3; ++l) {
+                positions.push_back(gamma(j, l));
+                elements.push_back(1e-7*dgamma(j, l)/nquadpoints);
+            }
+        }
+        gammas.push_back(gamma);
+        dgammas.push_back(dgamma);
+    }
+    xt::xarray<double> points = 0.3*xt::random::randn<double>({ntargets, 3});
+    auto pointsx = AlignedPaddedVec(ntargets, 0);
+    auto pointsy = AlignedPaddedVec(ntargets, 0);
+    auto pointsz = AlignedPaddedVec(ntargets, 0);
+    for (int j = 0; j < ntargets; ++j) {
+        double phi = 2*M_PI*j/ntargets;
+        pointsx[j] = (1+points(j, 0))*cos(phi);
+        pointsy[j] = (1+points(j, 0))*sin(phi);
+        pointsz[j] = points(j, 2);
+    }
+
+    xt::xarray<double> B = xt::zeros<double>({ntargets, 3});
+    xt::xarray<double> dB_by_dX = xt::zeros<double>({ntargets, 3, 3});
+    xt::xarray<double> d2B_by_dXdX = xt::zeros<double>({ntargets, 3, 3, 3});
+    xt::xarray<double> Bc = xt::zeros<double>({ntargets, 3});
+    xt::xarray<double> dBc_by_dX = xt::zeros<double>({ntargets, 3, 3});
+    xt::xarray<double> d2Bc_by_dXdX = xt::zeros<double>({ntargets, 3, 3, 3});
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int c = 0; c < ncoils; ++c) {
+        biot_savart_kernel<xt::xarray<double>, nderivatives>(pointsx, pointsy, pointsz, gammas[c], dgammas[c], Bc, dBc_by_dX, d2Bc_by_dXdX);
+        B += Bc;
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    double directtime = std::chrono::duration_cast<std::chrono::milliseconds>( t2 - t1 ).count();
+
+    xt::xarray<double> Btree = xt::zeros<double>({ntargets, 3});
+    t1 = std::chrono::high_resolution_clock::now();
+    auto tree = BiotSavartTree(positions, elements, theta, order);
+    tree.B<nderivatives>(pointsx, pointsy, pointsz, Btree, dBc_by_dX, d2Bc_by_dXdX);
+    t2 = std::chrono::high_resolution_clock::now();
+    double treetime = std::chrono::duration_cast<std::chrono::milliseconds>( t2 - t1 ).count();
+    double err = 0., norm = 0.;
+    for (int j = 0; j < ntargets; ++j) {
+        for (int l = 0; l < 3; ++l) {
+            err += (B(j, l)-Btree(j, l))*(B(j, l)-Btree(j, l));
+            norm += B(j, l)*B(j, l);
+        }
+    }
+    err = std::sqrt(err/norm);
+    std::cout << std::setw (10) << ntargets
+        << std::setw (8) << theta
+        << std::setw (7) << order
+        << std::setw (17) << directtime
+        << std::setw (15) << treetime
+        << std::setw (19) << std::setprecision(5) << err
+        << std::endl;
+}
+
+// Gradient of the squared flux 0.5 * \int (B.n)^2 dS with respect to the
+// Fourier coefficients of ncoils CurveXYZFourier coils. Reports the time for
+// the Biot-Savart vector Jacobian product, and for contracting its result
+// with the derivatives of gamma and gammadash with respect to the
+// coefficients, once using the dense (nquadpoints, 3, ndofs) tensors (as in
+// Curve::dgamma_by_dcoeff_vjp_impl) and once matrix-free (as in
+// CurveXYZFourier::dgamma_by_dcoeff_vjp_impl).
+void profile_squared_flux_gradient(int ncoils, int order, int nquadpoints, int nphi, int ntheta){
+    int ndofs = 3*(2*order+1);
+    // circular coils of radius 0.5 around a torus with major radius 1, with
+    // small random higher harmonics
+    vector<std::unique_ptr<CurveXYZFourier<xt::xarray<double>>>> curves;
+    vector<xt::xarray<double>> gammas, dgammas;
+    for (int c = 0; c < ncoils; ++c) {
+        double phic = 2*M_PI*(c+0.5)/ncoils;
+        xt::xarray<double> random = 1e-3*xt::random::randn<double>({ndofs});
+        vector<double> dofs(random.begin(), random.end());
+        dofs[0] = cos(phic);
+        dofs[2*order+1] = sin(phic);
+        dofs[2] += 0.5*cos(phic);
+        dofs[2*order+1+2] += 0.5*sin(phic);
+        dofs[2*(2*order+1)+1] += 0.5;
+        curves.push_back(std::make_unique<CurveXYZFourier<xt::xarray<double>>>(nquadpoints, order));
+        curves[c]->set_dofs(dofs);
+        gammas.push_back(curves[c]->gamma());
+        dgammas.push_back(curves[c]->gammadash());
+        // the dense derivatives are cached, only the contraction is timed below
+        curves[c]->dgamma_by_dcoeff();
+        curves[c]->dgammadash_by_dcoeff();
+    }
+
+    // points and unit normals on a torus with major radius 1 and minor radius 0.2
+    int npoints = nphi*ntheta;
+    auto pointsx = AlignedPaddedVec(npoints, 0);
+    auto pointsy = AlignedPaddedVec(npoints, 0);
+    auto pointsz = AlignedPaddedVec(npoints, 0);
+    xt::xarray<double> normals = xt::zeros<double>({npoints, 3});
+    for (int i = 0; i < nphi; ++i) {
+        for (int j = 0; j < ntheta; ++j) {
+            double phi = 2*M_PI*i/nphi, theta = 2*M_PI*j/ntheta;
+            int p = i*ntheta + j;
+            double R = 1 + 0.2*cos(theta);
+            pointsx[p] = R*cos(phi);
+            pointsy[p] = R*sin(phi);
+            pointsz[p] = 0.2*sin(theta);
+            normals(p, 0) = cos(theta)*cos(phi);
+            normals(p, 1) = cos(theta)*sin(phi);
+            normals(p, 2) = sin(theta);
+        }
+    }
+
+    // v = (B.n) n dS, the derivative of the objective with respect to B
+    xt::xarray<double> B = xt::zeros<double>({npoints, 3});
+    xt::xarray<double> Bc = xt::zeros<double>({npoints, 3});
+    xt::xarray<double> dummy = xt::zeros<double>({1, 3, 3, 3});
+    for (int c = 0; c < ncoils; ++c) {
+        biot_savart_kernel<xt::xarray<double>, 0>(pointsx, pointsy, pointsz, gammas[c], dgammas[c], Bc, dummy, dummy);
+        B += 1e5*Bc;
+    }
+    xt::xarray<double> v = xt::zeros<double>({npoints, 3});
+    for (int p = 0; p < npoints; ++p) {
+        double Bn = B(p, 0)*normals(p, 0) + B(p, 1)*normals(p, 1) + B(p, 2)*normals(p, 2);
+        for (int l = 0; l < 3; ++l)
+            v(p, l) = Bn * normals(p, l) / npoints;
+    }
+
+    xt::xarray<double> res_gamma = xt::zeros<double>({nquadpoints, 3});
+    xt::xarray<double> res_dgamma = xt::zeros<double>({nquadpoints, 3});
+    vector<xt::xarray<double>> res_gammas, res_dgammas;
+    auto t1 = std::chrono::high_resolution_clock::now();
+    for (int c = 0; c < ncoils; ++c) {
+        res_gamma.fill(0.);
+        res_dgamma.fill(0.);
+        biot_savart_vjp_kernel<xt::xarray<double>, 0>(pointsx, pointsy, pointsz, gammas[c], dgammas[c], v, res_gamma, res_dgamma, dummy, dummy, dummy);
+        res_gammas.push_back(xt::xarray<double>(res_gamma * (1e5*1e-7/nquadpoints)));
+        res_dgammas.push_back(xt::xarray<double>(res_dgamma * (1e5*1e-7/nquadpoints)));
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    double kerneltime = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count()/1000.;
+
+    vector<xt::xarray<double>> grad_dense(ncoils, xt::xarray<double>(xt::zeros<double>({ndofs})));
+    t1 = std::chrono::high_resolution_clock::now();
+    for (int c = 0; c < ncoils; ++c) {
+        grad_dense[c] = curve_vjp_contraction<xt::xarray<double>>(curves[c]->dgamma_by_dcoeff(), res_gammas[c])
+            + curve_vjp_contraction<xt::xarray<double>>(curves[c]->dgammadash_by_dcoeff(), res_dgammas[c]);
+    }
+    t2 = std::chrono::high_resolution_clock::now();
+    double densetime = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count()/1000.;
+
+    vector<xt::xarray<double>> grad(ncoils, xt::xarray<double>(xt::zeros<double>({ndofs})));
+    t1 = std::chrono::high_resolution_clock::now();
+    for (int c = 0; c < ncoils; ++c) {
+        grad[c] = curves[c]->dgamma_by_dcoeff_vjp_impl(res_gammas[c]) + curves[c]->dgammadash_by_dcoeff_vjp_impl(res_dgammas[c]);
+    }
+    t2 = std::chrono::high_resolution_clock::now();
+    double matfreetime = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count()/1000.;
+    double err = 0., norm = 0.;
+    for (int c = 0; c < ncoils; ++c) {
+        err += xt::sum(xt::square(grad[c]-grad_dense[c]))();
+        norm += xt::sum(xt::square(grad_dense[c]))();
+    }
+
+    std::cout << std::setw (6) << order
+        << std::setw (12) << nquadpoints
+        << std::setw (10) << npoints
+        << std::setw (12) << kerneltime
+        << std::setw (19) << densetime
+        << std::setw (25) << matfreetime
+        << std::setw (14) << std::setprecision(5) << std::sqrt(err/norm)
+        << std::endl;
+}
+
+template<int nderivatives>
+void profile_biot_savart_precision(int nquadpoints, int ntargets){
+    // a circular coil of radius 0.3 around the point (1, 0, 0), evaluated at
+    // points in a box of size 0.4 around the same point.
+    xt::xarray<double> gamma = xt::zeros<double>({nquadpoints, 3});
+    xt::xarray<double> dgamma = xt::zeros<double>({nquadpoints, 3});
+    for (int j = 0; j < nquadpoints; ++j) {
+        double t = 2*M_PI*j/nquadpoints;
+        gamma(j, 0) = 1 + 0.3*cos(t);
+        gamma(j, 2) = 0.3*sin(t);
+        dgamma(j, 0) = -0.3*2*M_PI*sin(t);
+        dgamma(j, 2) = 0.3*2*M_PI*cos(t);
+    }
+    xt::xarray<double> points = 0.2*xt::random::rand<double>({ntargets, 3}, -1., 1.);
+    auto pointsx = AlignedPaddedVec(ntargets, 0);
+    auto pointsy = AlignedPaddedVec(ntargets, 0);
+    auto pointsz = AlignedPaddedVec(ntargets, 0);
+    for (int j = 0; j < ntargets; ++j) {
+        pointsx[j] = 1 + points(j, 0);
+        pointsy[j] = points(j, 1);
+        pointsz[j] = points(j, 2);
+    }
+
+    xt::xarray<double> Bref = xt::zeros<double>({ntargets, 3});
+    xt::xarray<double> dBref = xt::zeros<double>({ntargets, 3, 3});
+    xt::xarray<double> d2B_by_dXdX = xt::zeros<double>({1, 3, 3, 3});
+    int n = std::max(1, int(1e8/(nquadpoints*ntargets)));
+    for(auto precision : {BiotSavartPrecision::Double, BiotSavartPrecision::Mixed, BiotSavartPrecision::Single}) {
+        xt::xarray<double> B = xt::zeros<double>({ntargets, 3});
+        xt::xarray<double> dB_by_dX = xt::zeros<double>({ntargets, 3, 3});
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < n; ++i)
+            biot_savart_kernel_precision<xt::xarray<double>, nderivatives>(precision, pointsx, pointsy, pointsz, gamma, dgamma, B, dB_by_dX, d2B_by_dXdX);
+        auto t2 = std::chrono::high_resolution_clock::now();
+        double time = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count()/1000.;
+        if(precision == BiotSavartPrecision::Double) {
+            Bref = B;
+            dBref = dB_by_dX;
+        }
+        double err = xt::amax(xt::abs(B-Bref))()/xt::amax(xt::abs(Bref))();
+        double derr = nderivatives > 0 ? xt::amax(xt::abs(dB_by_dX-dBref))()/xt::amax(xt::abs(dBref))() : 0.;
+        std::cout << std::setw (10) << nquadpoints*ntargets
+            << std::setw (10) << biot_savart_precision_to_string(precision)
+            << std::setw (13) << time/n
+            << std::setw (17) << std::setprecision(5) << err
+            << std::setw (18) << std::setprecision(5) << derr
+            << std::endl;
+    }
+}
+
+// CurveCurveDistance penalty and its gradient for ncoils circular coils evenly
+// spaced around the torus, once by comparing all pairs of quadrature points and
+// once using curve_curve_distance_penalty.
+void profile_curve_curve_distance(int ncoils, int nquadpoints, double minimum_distance){
+    vector<xt::xarray<double>> gammas, gammadashs, dJ_by_dgammas, dJ_by_dgammadashs;
+    for (int i = 0; i < ncoils; ++i) {
+        double phi = 2*M_PI*i/ncoils;
+        xt::xarray<double> gamma = xt::zeros<double>({nquadpoints, 3});
+        xt::xarray<double> gammadash = xt::zeros<double>({nquadpoints, 3});
+        for (int k = 0; k < nquadpoints; ++k) {
+            double t = 2*M_PI*k/nquadpoints;
+            gamma(k, 0) = (1 + 0.5*cos(t))*cos(phi);
+            gamma(k, 1) = (1 + 0.5*cos(t))*sin(phi);
+            gamma(k, 2) = 0.5*sin(t);
+            gammadash(k, 0) = -0.5*2*M_PI*sin(t)*cos(phi);
+            gammadash(k, 1) = -0.5*2*M_PI*sin(t)*sin(phi);
+            gammadash(k, 2) = 0.5*2*M_PI*cos(t);
+        }
+        gammas.push_back(gamma);
+        gammadashs.push_back(gammadash);
+        dJ_by_dgammas.push_back(xt::zeros<double>({nquadpoints, 3}));
+        dJ_by_dgammadashs.push_back(xt::zeros<double>({nquadpoints, 3}));
+    }
+
+    auto t1 = std::chrono::high_resolution_clock::now();
+    double Jref = 0.;
+    vector<xt::xarray<double>> dJ_by_dgammas_ref = dJ_by_dgammas;
+    vector<xt::xarray<double>> dJ_by_dgammadashs_ref = dJ_by_dgammadashs;
+    double w = 1./(nquadpoints*nquadpoints);
+    for (int i = 0; i < ncoils; ++i) {
+        for (int j = 0; j < i; ++j) {
+            for (int k = 0; k < nquadpoints; ++k) {
+                double lk = std::sqrt(gammadashs[i](k, 0)*gammadashs[i](k, 0) + gammadashs[i](k, 1)*gammadashs[i](k, 1) + gammadashs[i](k, 2)*gammadashs[i](k, 2));
+                for (int l = 0; l < nquadpoints; ++l) {
+                    double diff[3] = {gammas[i](k, 0) - gammas[j](l, 0), gammas[i](k, 1) - gammas[j](l, 1), gammas[i](k, 2) - gammas[j](l, 2)};
+                    double d = std::sqrt(diff[0]*diff[0] + diff[1]*diff[1] + diff[2]*diff[2]);
+                    double pen = std::max(minimum_distance - d, 0.);
+                    if(pen == 0.)
+                        continue;
+                    double ll = std::sqrt(gammadashs[j](l, 0)*gammadashs[j](l, 0) + gammadashs[j](l, 1)*gammadashs[j](l, 1) + gammadashs[j](l, 2)*gammadashs[j](l, 2));
+                    Jref += w*lk*ll*pen*pen;
+                    for (int dd = 0; dd < 3; ++dd) {
+                        double c = -2*w*lk*ll*pen*diff[dd]/d;
+                        dJ_by_dgammas_ref[i](k, dd) += c;
+                        dJ_by_dgammas_ref[j](l, dd) -= c;
+                        dJ_by_dgammadashs_ref[i](k, dd) += w*ll*pen*pen*gammadashs[i](k, dd)/lk;
+                        dJ_by_dgammadashs_ref[j](l, dd) += w*lk*pen*pen*gammadashs[j](l, dd)/ll;
+                    }
+                }
+            }
+        }
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    double directtime = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count()/1000.;
+
+    t1 = std::chrono::high_resolution_clock::now();
+    double J = curve_curve_distance_penalty<xt::xarray<double>>(gammas, gammadashs, minimum_distance, ncoils, dJ_by_dgammas, dJ_by_dgammadashs);
+    t2 = std::chrono::high_resolution_clock::now();
+    double gridtime = std::chrono::duration_cast<std::chrono::microseconds>( t2 - t1 ).count()/1000.;
+
+    double err = 0., norm = 0.;
+    for (int i = 0; i < ncoils; ++i) {
+        err += xt::sum(xt::square(dJ_by_dgammas[i]-dJ_by_dgammas_ref[i]) + xt::square(dJ_by_dgammadashs[i]-dJ_by_dgammadashs_ref[i]))();
+        norm += xt::sum(xt::square(dJ_by_dgammas_ref[i]) + xt::square(dJ_by_dgammadashs_ref[i]))();
+    }
+
+    std::cout << std::setw (12) << nquadpoints
+        << std::setw (6) << minimum_distance
+        << std::setw (19) << directtime
+        << std::setw (17) << gridtime
+        << std::setw (14) << std::setprecision(5) << std::abs(J-Jref)/Jref
+        << std::setw (17) << std::setprecision(5) << std::sqrt(err/norm)
+        << std::endl;
+}
+
 /*
 #include <functional>
 #include "regular_grid_interpolant_3d.h"
@@ -244,6 +560,40 @@ int main() {
             profile_biot_savart_vjp<AlignedPaddedVec>(nst, nst, nd);
     }
 
+#if defined(USE_XSIMD)
+    cout << "BiotSavart tree code vs direct summation with XSIMD (50 coils with 500 quadrature points):\n";
+#else
+    cout << "BiotSavart tree code vs direct summation with No-XSIMD (50 coils with 500 quadrature points):\n";
+#endif
+    std::cout << "  Ntargets" << "   theta" << "  order" << " Direct (in ms)" << "  Tree (in ms)" << " Relative error B" << std::endl;
+    for(int ntargets=1000; ntargets<=100000; ntargets*=10) {
+        profile_biot_savart_tree<0>(50, 500, ntargets, 0.5, 4);
+        profile_biot_savart_tree<0>(50, 500, ntargets, 0.3, 6);
+    }
+
+#if defined(USE_XSIMD)
+    cout << "BiotSavart in double, mixed and single precision with XSIMD:\n";
+#else
+    cout << "BiotSavart in double, mixed and single precision with No-XSIMD:\n";
+#endif
+    std::cout << "         N" << " precision" << " Time (in ms)" << " Relative error B" << " Relative error dB" << std::endl;
+    for(int nst=100; nst<=10000; nst*=10) {
+        profile_biot_savart_precision<0>(nst, nst);
+        profile_biot_savart_precision<1>(nst, nst);
+    }
+
+    cout << "SquaredFlux gradient for 16 coils on a 64x64 surface grid:\n";
+    std::cout << " order" << " nquadpoints" << "   npoints" << " VJP (in ms)" << " Dense dofs (in ms)" << " Matrix-free dofs (in ms)" << " Relative diff" << std::endl;
+    for(int order=4; order<=32; order*=2)
+        profile_squared_flux_gradient(16, order, 15*order, 64, 64);
+
+    cout << "CurveCurveDistance penalty and gradient for 50 coils, all pairs vs spatial grid:\n";
+    std::cout << " nquadpoints" << "  dmin" << " All pairs (in ms)" << " Grid (in ms)" << " Relative diff" << " Relative diff dJ" << std::endl;
+    for(int nquadpoints=64; nquadpoints<=512; nquadpoints*=2) {
+        profile_curve_curve_distance(50, nquadpoints, 0.1);
+        profile_curve_curve_distance(50, nquadpoints, 0.2);
+    }
+
     /*
     for (int deg = 1; deg <= 6; ++deg) {
         for (int n = 1; n*deg <= 128; n*=2) {
@@ -3,6 +3,7 @@ import numpy as np
 import simsoptpp as sopp
 from .magneticfield import MagneticField
 from .._core.json import GSONDecoder
+from ..geo.curve import RotatedCurve
 
 __all__ = ['BiotSavart']
 
@@ -18,6 +19,39 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
 
     where :math:`\mu_0=4\pi 10^{-7}` is the magnetic constant.
 
+    By default the integral is evaluated by direct summation over all quadrature
+    points of all coils. For large numbers of evaluation points, e.g. when
+    computing the field on fine mgrid or free-boundary grids, the field can
+    instead be evaluated using a Barnes-Hut tree code by calling
+    ``set_tree_evaluation(theta, order)``. Clusters of quadrature points whose
+    radius is smaller than ``theta`` times their distance to the evaluation
+    point are then replaced by a multipole expansion of order ``order``, and
+    the relative error decays approximately like ``theta**(order+1)``.
+    Calling ``set_tree_evaluation(0.)`` switches back to direct summation.
+    The derivatives with respect to the coil degrees of freedom are always
+    computed by direct summation.
+
+    If the coils were generated from a few base curves by rotations and flips
+    (e.g. by :obj:`~simsopt.field.coil.coils_via_symmetries`), calling
+    ``set_symmetry_evaluation(True)`` computes the field of each coil from its
+    base curve, and accumulates the vector Jacobian products directly onto the
+    base curves. If the evaluation points are invariant under the symmetries,
+    e.g. quadrature points on a full torus, the field of each base curve is
+    only evaluated once for all of its ``2*nfp`` copies.
+
+    ``set_precision("mixed")`` or ``set_precision("single")`` evaluates
+    :math:`B` and its first derivative with single precision arithmetic, which
+    processes twice as many points per SIMD instruction. In mixed precision the
+    contributions of the quadrature points are summed in double precision. Both
+    typically give relative errors of around ``1e-6``, so they are useful e.g.
+    when building interpolants or for Poincare plots, but not for optimization.
+
+    By default the field of every coil is stored separately, so that only coils
+    whose shape changed need to be recomputed and the derivatives with respect
+    to the currents are readily available. For many evaluation points this
+    needs a lot of memory; ``set_fused_evaluation(True)`` instead computes the
+    total field directly, distributing tiles of points over the threads.
+
     Args:
         coils: A list of :obj:`simsopt.field.coil.Coil` objects.
     """
@@ -26,6 +60,62 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         self._coils = coils
         sopp.BiotSavart.__init__(self, coils)
         MagneticField.__init__(self, depends_on=coils)
+        self._symmetry = None
+
+    def set_symmetry_evaluation(self, enabled=True):
+        """
+        Enable or disable the evaluation of the field (and of the vector
+        Jacobian products) via the base curves of the coils. The base curve of
+        each coil is found by following :obj:`~simsopt.geo.curve.RotatedCurve`
+        objects; coils that are not rotated copies are their own base curve.
+        """
+        if not enabled:
+            sopp.BiotSavart.clear_symmetry(self)
+            self._symmetry = None
+            return
+        base_curves = []
+        base_idx = []
+        matrices = []
+        for coil in self._coils:
+            curve = coil.curve
+            M = np.eye(3)
+            while isinstance(curve, RotatedCurve):
+                M = M @ curve.rotmatT
+                curve = curve.curve
+            idx = next((j for j, c in enumerate(base_curves) if c is curve), None)
+            if idx is None:
+                base_curves.append(curve)
+                idx = len(base_curves) - 1
+            base_idx.append(idx)
+            matrices.append(np.ascontiguousarray(M))
+        sopp.BiotSavart.set_symmetry(self, base_curves, base_idx, matrices)
+        self._symmetry = (base_curves, base_idx, matrices)
+
+    def _symmetric_vjp_graph(self, vjp_graph_symmetric, v, vgrad=None):
+        """
+        Returns the derivatives of ``v`` (and ``vgrad``) contracted with the
+        field (and its gradient) with respect to the dofs of the base curves.
+        """
+        base_curves, base_idx, matrices = self._symmetry
+        gammas = [curve.gamma() for curve in base_curves]
+        gammadashs = [curve.gammadash() for curve in base_curves]
+        currents = [coil.current.get_value() for coil in self._coils]
+        res_gamma = [np.zeros_like(gamma) for gamma in gammas]
+        res_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs]
+        res_grad_gamma = [np.zeros_like(gamma) for gamma in gammas] if vgrad is not None else []
+        res_grad_gammadash = [np.zeros_like(gammadash) for gammadash in gammadashs] if vgrad is not None else []
+
+        points = self.get_points_cart_ref()
+        vjp_graph_symmetric(points, gammas, gammadashs, base_idx, matrices, currents, v,
+                            res_gamma, res_gammadash, vgrad if vgrad is not None else [],
+                            res_grad_gamma, res_grad_gammadash)
+        res = sum([curve.dgamma_by_dcoeff_vjp(res_gamma[i]) + curve.dgammadash_by_dcoeff_vjp(res_gammadash[i])
+                   for i, curve in enumerate(base_curves)])
+        if vgrad is None:
+            return res
+        res_grad = sum([curve.dgamma_by_dcoeff_vjp(res_grad_gamma[i]) + curve.dgammadash_by_dcoeff_vjp(res_grad_gammadash[i])
+                        for i, curve in enumerate(base_curves)])
+        return res, res_grad
 
     def dB_by_dcoilcurrents(self, compute_derivatives=0):
         points = self.get_points_cart_ref()
@@ -67,6 +157,15 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
+        if self._symmetry is not None:
+            res_curves, res_grad_curves = self._symmetric_vjp_graph(sopp.biot_savart_vjp_graph_symmetric, v, vgrad)
+            dB_by_dcoilcurrents = self.dB_by_dcoilcurrents()
+            d2B_by_dXdcoilcurrents = self.d2B_by_dXdcoilcurrents()
+            return (
+                res_curves + sum([coils[i].current.vjp(np.asarray([np.sum(v * dB_by_dcoilcurrents[i])])) for i in range(len(coils))]),
+                res_grad_curves + sum([coils[i].current.vjp(np.asarray([np.sum(vgrad * d2B_by_dXdcoilcurrents[i])])) for i in range(len(coils))])
+            )
+
         gammas = [coil.curve.gamma() for coil in coils]
         gammadashs = [coil.curve.gammadash() for coil in coils]
         currents = [coil.current.get_value() for coil in coils]
@@ -105,6 +204,11 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
+        if self._symmetry is not None:
+            res_curves = self._symmetric_vjp_graph(sopp.biot_savart_vjp_graph_symmetric, v)
+            dB_by_dcoilcurrents = self.dB_by_dcoilcurrents()
+            return res_curves + sum([coils[i].current.vjp(np.asarray([np.sum(v * dB_by_dcoilcurrents[i])])) for i in range(len(coils))])
+
         gammas = [coil.curve.gamma() for coil in coils]
         gammadashs = [coil.curve.gammadash() for coil in coils]
         currents = [coil.current.get_value() for coil in coils]
@@ -158,6 +262,15 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
+        if self._symmetry is not None:
+            res_curves, res_grad_curves = self._symmetric_vjp_graph(sopp.biot_savart_vector_potential_vjp_graph_symmetric, v, vgrad)
+            dA_by_dcoilcurrents = self.dA_by_dcoilcurrents()
+            d2A_by_dXdcoilcurrents = self.d2A_by_dXdcoilcurrents()
+            return (
+                res_curves + sum([coils[i].current.vjp(np.asarray([np.sum(v * dA_by_dcoilcurrents[i])])) for i in range(len(coils))]),
+                res_grad_curves + sum([coils[i].current.vjp(np.asarray([np.sum(vgrad * d2A_by_dXdcoilcurrents[i])])) for i in range(len(coils))])
+            )
+
         gammas = [coil.curve.gamma() for coil in coils]
         gammadashs = [coil.curve.gammadash() for coil in coils]
         currents = [coil.current.get_value() for coil in coils]
@@ -196,6 +309,11 @@ class BiotSavart(sopp.BiotSavart, MagneticField):
         """
 
         coils = self._coils
+        if self._symmetry is not None:
+            res_curves = self._symmetric_vjp_graph(sopp.biot_savart_vector_potential_vjp_graph_symmetric, v)
+            dA_by_dcoilcurrents = self.dA_by_dcoilcurrents()
+            return res_curves + sum([coils[i].current.vjp(np.asarray([np.sum(v * dA_by_dcoilcurrents[i])])) for i in range(len(coils))])
+
         gammas = [coil.curve.gamma() for coil in coils]
         gammadashs = [coil.curve.gammadash() for coil in coils]
         currents = [coil.current.get_value() for coil in coils]
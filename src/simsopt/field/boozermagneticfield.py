@@ -1,4 +1,5 @@
 import simsoptpp as sopp
+from .magneticfieldclasses import dof_hash_of
 from scipy.interpolate import InterpolatedUnivariateSpline
 import numpy as np
 import logging
@@ -1091,7 +1092,7 @@ class InterpolatedBoozerField(sopp.InterpolatedBoozerField, BoozerMagneticField)
     be evaluated very quickly. This is modeled after :class:`InterpolatedField`.
     """
 
-    def __init__(self, field, degree, srange, thetarange, zetarange, extrapolate=True, nfp=1, stellsym=True):
+    def __init__(self, field, degree, srange, thetarange, zetarange, extrapolate=True, nfp=1, stellsym=True, lazy=False, fused=False):
         r"""
         Args:
             field: the underlying :class:`simsopt.field.boozermagneticfield.BoozerMagneticField` to be interpolated.
@@ -1111,6 +1112,20 @@ class InterpolatedBoozerField(sopp.InterpolatedBoozerField, BoozerMagneticField)
             stellsym: Whether to exploit stellarator symmetry. In this case
                       ``theta`` is always mapped to the interval :math:`[0, \pi]`,
                       hence it makes sense to use ``thetamin=0`` and ``thetamax=np.pi``.
+            lazy: if True, the interpolants are not built on the whole grid at
+                  once. Instead, the values on each cell are computed from
+                  ``field`` the first time the interpolant is evaluated in
+                  that cell, so that the setup time and memory scale with the
+                  part of the domain that is actually visited, e.g. by
+                  well-confined particles. Use :meth:`cells_filled` and
+                  :meth:`cells_total` to see how many cells have been computed,
+                  and :meth:`dofs_stored` for the number of interpolation
+                  nodes at which the values of ``field`` are kept.
+            fused: if True, all quantities needed by the guiding center
+                   equations (see ``gc_quantities``) are interpolated with a
+                   single interpolant, so that the guiding center tracing
+                   only needs one interpolant lookup per step. This requires
+                   the underlying field to implement ``K``.
         """
         BoozerMagneticField.__init__(self, field.psi0)
         if (np.any(np.asarray(thetarange[0:2]) < 0) or np.any(np.asarray(thetarange[0:2]) > 2*np.pi)):
@@ -1122,5 +1137,38 @@ class InterpolatedBoozerField(sopp.InterpolatedBoozerField, BoozerMagneticField)
         if nfp > 1 and (np.any(np.asarray(zetarange[0:2]) < 0) or np.any(np.asarray(zetarange[0:2]) > 2*np.pi/nfp)):
             logger.warning(fr"Sure about zetarange=[{zetarange[0]},{zetarange[1]}]? When exploiting rotational symmetry, the interpolant is only evaluated for zeta in [0,2\pi/nfp].")
 
-        sopp.InterpolatedBoozerField.__init__(self, field, degree, srange, thetarange, zetarange, extrapolate, nfp, stellsym)
+        sopp.InterpolatedBoozerField.__init__(self, field, degree, srange, thetarange, zetarange, extrapolate, nfp, stellsym, lazy, fused)
+        self.__field = field
+
+    def save_interpolants(self, filename, dof_hash=None):
+        """
+        Save all interpolants that have been built so far to a binary file, so
+        that they can be loaded with :meth:`load_interpolants` instead of being
+        recomputed.
+
+        Args:
+            filename: the file to write to.
+            dof_hash: an integer identifying the underlying field. Defaults to
+                      a hash of the dofs of the underlying field (0 if it has none).
+        """
+        if dof_hash is None:
+            dof_hash = dof_hash_of(self.__field)
+        sopp.InterpolatedBoozerField.save_interpolants(self, filename, dof_hash)
+
+    def load_interpolants(self, filename, dof_hash=None, mmap=True):
+        """
+        Load the interpolants written by :meth:`save_interpolants`. This field
+        has to be constructed with the same degree and ranges as the field
+        that was saved.
+
+        Args:
+            filename: the file to read from.
+            dof_hash: an integer identifying the underlying field. Defaults to
+                      a hash of the dofs of the underlying field (0 if it has none).
+            mmap: whether to map the file into memory (read-only) instead of
+                  reading it.
+        """
+        if dof_hash is None:
+            dof_hash = dof_hash_of(self.__field)
+        sopp.InterpolatedBoozerField.load_interpolants(self, filename, dof_hash, mmap)
 
@@ -1,3 +1,4 @@
+import hashlib
 import logging
 
 import numpy as np
@@ -790,6 +791,19 @@ class ChebyshevInterpolationRule(sopp.ChebyshevInterpolationRule):
     pass
 
 
+def dof_hash_of(obj):
+    """
+    Returns a 64 bit integer that identifies the current values of the dofs
+    of ``obj``, or 0 if ``obj`` has no dofs. This is used to check that an
+    interpolant loaded from file was computed for the same field.
+    """
+    x = getattr(obj, "full_x", None)
+    if x is None or len(x) == 0:
+        return 0
+    digest = hashlib.sha256(np.ascontiguousarray(x, dtype=np.float64).tobytes()).digest()
+    return int.from_bytes(digest[:8], "little")
+
+
 class InterpolatedField(sopp.InterpolatedField, MagneticField):
     r"""
     This field takes an existing field and interpolates it on a regular grid in :math:`r,\phi,z`.
@@ -841,6 +855,40 @@ class InterpolatedField(sopp.InterpolatedField, MagneticField):
         sopp.InterpolatedField.__init__(self, field, degree, rrange, phirange, zrange, extrapolate, nfp, stellsym, skip)
         self.__field = field
 
+    def save_interpolants(self, filename, dof_hash=None):
+        """
+        Save the interpolants of ``B`` and ``GradAbsB`` to a binary file, so
+        that they can be loaded with :meth:`load_interpolants` (e.g. in a later
+        run, or on other MPI ranks) instead of being recomputed.
+
+        Args:
+            filename: the file to write to.
+            dof_hash: an integer identifying the underlying field. Defaults to
+                      a hash of the dofs of the underlying field.
+        """
+        if dof_hash is None:
+            dof_hash = dof_hash_of(self.__field)
+        sopp.InterpolatedField.save_interpolants(self, filename, dof_hash)
+
+    def load_interpolants(self, filename, dof_hash=None, mmap=True):
+        """
+        Load the interpolants written by :meth:`save_interpolants`. This field
+        has to be constructed with the same degree, ranges and skip function
+        as the field that was saved. An error is raised if the dofs of the
+        underlying field changed since the file was written.
+
+        Args:
+            filename: the file to read from.
+            dof_hash: an integer identifying the underlying field. Defaults to
+                      a hash of the dofs of the underlying field.
+            mmap: whether to map the file into memory (read-only) instead of
+                  reading it. All processes on a node that map the same file
+                  share the memory.
+        """
+        if dof_hash is None:
+            dof_hash = dof_hash_of(self.__field)
+        sopp.InterpolatedField.load_interpolants(self, filename, dof_hash, mmap)
+
     def to_vtk(self, filename):
         """Export the field evaluated on a regular grid for visualisation with e.g. Paraview."""
         degree = self.rule.degree
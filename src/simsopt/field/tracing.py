@@ -23,6 +23,7 @@ __all__ = ['SurfaceClassifier', 'LevelsetStoppingCriterion',
            'trace_particles', 'trace_particles_boozer',
            'trace_particles_starting_on_curve',
            'trace_particles_starting_on_surface',
+           'BinaryFileTrajectorySink', 'CallbackTrajectorySink', 'load_trajectories',
            'particles_to_vtk', 'plot_poincare_data']
 
 
@@ -75,7 +76,8 @@ def trace_particles_boozer(field: BoozerMagneticField,
                            parallel_speeds: RealArray,
                            tmax=1e-4,
                            mass=ALPHA_PARTICLE_MASS, charge=ALPHA_PARTICLE_CHARGE, Ekin=FUSION_ALPHA_PARTICLE_ENERGY,
-                           tol=1e-9, comm=None, zetas=[], stopping_criteria=[], mode='gc_vac', forget_exact_path=False):
+                           tol=1e-9, comm=None, zetas=[], stopping_criteria=[], mode='gc_vac', forget_exact_path=False,
+                           save_every=1, sink=None):
     r"""
     Follow particles in a :class:`BoozerMagneticField`. This is modeled after
     :func:`trace_particles`.
@@ -143,6 +145,13 @@ def trace_particles_boozer(field: BoozerMagneticField,
         forget_exact_path: return only the first and last position of each
             particle for the ``res_tys``. To be used when only res_zeta_hits is of
             interest or one wants to reduce memory usage.
+        save_every: only store every ``save_every``-th time step (and the last one)
+            of the trajectories. ``save_every=0`` only stores the first and last one.
+        sink: a :obj:`BinaryFileTrajectorySink` or :obj:`CallbackTrajectorySink`.
+            If given, the stored time steps are passed to the sink in chunks,
+            with the particle index as id, and ``res_tys`` only contains the
+            first and last position of each particle. The memory used is then
+            independent of the length of the trajectories.
 
     Returns: 2 element tuple containing
         - ``res_tys``:
@@ -178,7 +187,8 @@ def trace_particles_boozer(field: BoozerMagneticField,
         res_ty, res_zeta_hit = sopp.particle_guiding_center_boozer_tracing(
             field, stz_inits[i, :],
             m, charge, speed_total, speed_par[i], tmax, tol, vacuum=(mode == 'gc_vac'),
-            noK=(mode == 'gc_nok'), zetas=zetas, stopping_criteria=stopping_criteria)
+            noK=(mode == 'gc_nok'), zetas=zetas, stopping_criteria=stopping_criteria,
+            save_every=0 if (forget_exact_path and sink is None) else save_every, sink=sink, sink_id=i)
         if not forget_exact_path:
             res_tys.append(np.asarray(res_ty))
         else:
@@ -203,7 +213,7 @@ def trace_particles(field: MagneticField,
                     tmax=1e-4,
                     mass=ALPHA_PARTICLE_MASS, charge=ALPHA_PARTICLE_CHARGE, Ekin=FUSION_ALPHA_PARTICLE_ENERGY,
                     tol=1e-9, comm=None, phis=[], stopping_criteria=[], mode='gc_vac', forget_exact_path=False,
-                    phase_angle=0):
+                    phase_angle=0, batched=False, nthreads=1, field_factory=None, save_every=1, sink=None):
     r"""
     Follow particles in a magnetic field.
 
@@ -248,6 +258,28 @@ def trace_particles(field: MagneticField,
                            particle for the ``res_tys``. To be used when only res_phi_hits is of
                            interest or one wants to reduce memory usage.
         phase_angle: the phase angle to use in the case of full orbit calculations
+        batched: only for ``mode='gc_vac'``. If ``True``, all particles (on this
+                 MPI rank) are advanced simultaneously, so that the magnetic field
+                 is evaluated for the whole batch of particles at once. Each particle
+                 keeps its own adaptive time step. Stateful stopping criteria such as
+                 :obj:`ToroidalTransitStoppingCriterion` are not supported in this case.
+        nthreads: only for ``mode='gc_vac'``. Number of threads used to trace the particles
+                  (on this MPI rank). Each thread requires its own copy of the field,
+                  these are obtained from ``field_factory`` if given, and via ``field.clone()``
+                  otherwise (e.g. an :obj:`InterpolatedField` can be cloned cheaply, as the clones
+                  share the interpolant). Stateful stopping criteria such as
+                  :obj:`ToroidalTransitStoppingCriterion` are not supported in this case.
+        field_factory: a function without arguments that returns a new copy of the field,
+                       see ``nthreads``.
+        save_every: only store every ``save_every``-th time step (and the last one)
+                    of the trajectories. ``save_every=0`` only stores the first and last one.
+                    Not supported together with ``batched`` or ``nthreads > 1``.
+        sink: a :obj:`BinaryFileTrajectorySink` or :obj:`CallbackTrajectorySink`.
+              If given, the stored time steps are passed to the sink in chunks,
+              with the particle index as id, and ``res_tys`` only contains the
+              first and last position of each particle. The memory used is then
+              independent of the length of the trajectories.
+              Not supported together with ``batched`` or ``nthreads > 1``.
 
     Returns: 2 element tuple containing
         - ``res_tys``:
@@ -283,16 +315,44 @@ def trace_particles(field: MagneticField,
     res_phi_hits = []
     loss_ctr = 0
     first, last = parallel_loop_bounds(comm, nparticles)
+    if batched and nthreads > 1:
+        raise ValueError("Batched tracing and multithreaded tracing cannot be combined.")
+    if (batched or nthreads > 1) and (save_every != 1 or sink is not None):
+        raise ValueError("save_every and sink are not supported for batched or multithreaded tracing.")
+    if forget_exact_path and sink is None:
+        save_every = 0
+    if batched:
+        if mode != 'gc_vac':
+            raise ValueError("Batched tracing is only available for mode='gc_vac'.")
+        batch_res_tys, batch_res_phi_hits = sopp.particle_guiding_center_tracing_batch(
+            field, xyz_inits[first:last, :],
+            m, charge, speed_total, speed_par[first:last], tmax, tol,
+            vacuum=True, phis=phis, stopping_criteria=stopping_criteria)
+    elif nthreads > 1:
+        if mode != 'gc_vac':
+            raise ValueError("Multithreaded tracing is only available for mode='gc_vac'.")
+        if field_factory is not None:
+            fields = [field_factory() for _ in range(nthreads)]
+        else:
+            fields = [field.clone() for _ in range(nthreads)]
+        batch_res_tys, batch_res_phi_hits = sopp.particle_guiding_center_tracing_parallel(
+            fields, xyz_inits[first:last, :],
+            m, charge, speed_total, speed_par[first:last], tmax, tol,
+            vacuum=True, phis=phis, stopping_criteria=stopping_criteria)
     for i in range(first, last):
-        if 'gc' in mode:
+        if batched or nthreads > 1:
+            res_ty, res_phi_hit = batch_res_tys[i-first], batch_res_phi_hits[i-first]
+        elif 'gc' in mode:
             res_ty, res_phi_hit = sopp.particle_guiding_center_tracing(
                 field, xyz_inits[i, :],
                 m, charge, speed_total, speed_par[i], tmax, tol,
-                vacuum=(mode == 'gc_vac'), phis=phis, stopping_criteria=stopping_criteria)
+                vacuum=(mode == 'gc_vac'), phis=phis, stopping_criteria=stopping_criteria,
+                save_every=save_every, sink=sink, sink_id=i)
         else:
             res_ty, res_phi_hit = sopp.particle_fullorbit_tracing(
                 field, xyz_inits[i, :], v_inits[i, :],
-                m, charge, tmax, tol, phis=phis, stopping_criteria=stopping_criteria)
+                m, charge, tmax, tol, phis=phis, stopping_criteria=stopping_criteria,
+                save_every=save_every, sink=sink, sink_id=i)
         if not forget_exact_path:
             res_tys.append(np.asarray(res_ty))
         else:
@@ -653,7 +713,8 @@ def compute_poloidal_transits(res_tys, ma=None, flux=True):
     return ntransits
 
 
-def compute_fieldlines(field, R0, Z0, tmax=200, tol=1e-7, phis=[], stopping_criteria=[], comm=None):
+def compute_fieldlines(field, R0, Z0, tmax=200, tol=1e-7, phis=[], stopping_criteria=[], comm=None, poincare=False,
+                       save_every=1, sink=None):
     r"""
     Compute magnetic field lines by solving
 
@@ -672,6 +733,17 @@ def compute_fieldlines(field, R0, Z0, tmax=200, tol=1e-7, phis=[], stopping_crit
         stopping_criteria: list of stopping criteria, mostly used in
                            combination with the ``LevelsetStoppingCriterion``
                            accessed via :obj:`simsopt.field.tracing.SurfaceClassifier`.
+        poincare: if ``True``, only the plane and stopping criteria hits are
+                  computed, which is considerably cheaper for Poincare plots
+                  with many planes and long field lines. ``res_tys`` then
+                  only contains the initial and final position of each line,
+                  and ``save_every`` and ``sink`` cannot be used.
+        save_every: only store every ``save_every``-th time step (and the last one)
+                    of the field lines. ``save_every=0`` only stores the first and last one.
+        sink: a :obj:`BinaryFileTrajectorySink` or :obj:`CallbackTrajectorySink`.
+              If given, the stored time steps are passed to the sink in chunks,
+              with the index of the line as id, and ``res_tys`` only contains the
+              first and last position of each line.
 
     Returns: 2 element tuple containing
         - ``res_tys``:
@@ -698,7 +770,8 @@ def compute_fieldlines(field, R0, Z0, tmax=200, tol=1e-7, phis=[], stopping_crit
     for i in range(first, last):
         res_ty, res_phi_hit = sopp.fieldline_tracing(
             field, xyz_inits[i, :],
-            tmax, tol, phis=phis, stopping_criteria=stopping_criteria)
+            tmax, tol, phis=phis, stopping_criteria=stopping_criteria, poincare=poincare,
+            save_every=save_every, sink=sink, sink_id=i)
         res_tys.append(np.asarray(res_ty))
         res_phi_hits.append(np.asarray(res_phi_hit))
         dtavg = res_ty[-1][0]/len(res_ty)
@@ -799,6 +872,54 @@ class IterationStoppingCriterion(sopp.IterationStoppingCriterion):
     pass
 
 
+class BinaryFileTrajectorySink(sopp.BinaryFileTrajectorySink):
+    """
+    Streams the trajectories computed by :func:`trace_particles`,
+    :func:`trace_particles_boozer` or :func:`compute_fieldlines` to a binary
+    file, see the ``sink`` argument of these functions. The file can be read
+    with :func:`load_trajectories`. If ``append=True``, an existing file is
+    appended to rather than overwritten. When using MPI, each rank should write
+    to its own file.
+    """
+
+    def __init__(self, filename, append=False):
+        sopp.BinaryFileTrajectorySink.__init__(self, filename, append)
+
+
+class CallbackTrajectorySink(sopp.CallbackTrajectorySink):
+    """
+    Passes the trajectories computed by :func:`trace_particles`,
+    :func:`trace_particles_boozer` or :func:`compute_fieldlines` to a python
+    function as they are computed, see the ``sink`` argument of these
+    functions. The function is called as ``callback(id, chunk)``, where ``id``
+    is the index of the particle and ``chunk`` a numpy array containing
+    consecutive rows ``[t, state]`` of its trajectory.
+    """
+
+    def __init__(self, callback):
+        sopp.CallbackTrajectorySink.__init__(self, callback)
+
+
+def load_trajectories(filename):
+    """
+    Read the trajectories written by a :obj:`BinaryFileTrajectorySink`.
+
+    Returns:
+        A dictionary mapping the particle index to a numpy array with rows
+        ``[t, state]``.
+    """
+    data = np.fromfile(filename, dtype=np.uint8)
+    chunks = {}
+    pos = 0
+    while pos < len(data):
+        idx, nrows, ncols = data[pos:pos+24].view(np.int64)
+        pos += 24
+        chunks.setdefault(int(idx), []).append(
+            data[pos:pos+8*nrows*ncols].view(np.float64).reshape((nrows, ncols)))
+        pos += 8*nrows*ncols
+    return {idx: np.concatenate(c) for idx, c in chunks.items()}
+
+
 def plot_poincare_data(fieldlines_phi_hits, phis, filename, mark_lost=False, aspect='equal', dpi=300, xlims=None, ylims=None, surf=None):
     """
     Create a poincare plot. Usage:
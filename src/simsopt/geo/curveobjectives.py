@@ -182,11 +182,6 @@ class CurveCurveDistance(Optimizable):
         self.curves = curves
         self.minimum_distance = minimum_distance
 
-        self.J_jax = jit(lambda gamma1, l1, gamma2, l2: cc_distance_pure(gamma1, l1, gamma2, l2, minimum_distance))
-        self.thisgrad0 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=0)(gamma1, l1, gamma2, l2))
-        self.thisgrad1 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=1)(gamma1, l1, gamma2, l2))
-        self.thisgrad2 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=2)(gamma1, l1, gamma2, l2))
-        self.thisgrad3 = jit(lambda gamma1, l1, gamma2, l2: grad(self.J_jax, argnums=3)(gamma1, l1, gamma2, l2))
         self.candidates = None
         self.num_basecurves = num_basecurves or len(curves)
         super().__init__(depends_on=curves)
@@ -196,55 +191,47 @@ class CurveCurveDistance(Optimizable):
 
     def compute_candidates(self):
         if self.candidates is None:
-            candidates = sopp.get_pointclouds_closer_than_threshold_within_collection(
+            self.closest = sopp.get_closest_points_within_collection(
                 [c.gamma() for c in self.curves], self.minimum_distance, self.num_basecurves)
-            self.candidates = candidates
+            self.candidates = [(i, j) for i, j, _, _, _ in self.closest]
 
     def shortest_distance_among_candidates(self):
         self.compute_candidates()
-        from scipy.spatial.distance import cdist
-        return min([self.minimum_distance] + [np.min(cdist(self.curves[i].gamma(), self.curves[j].gamma())) for i, j in self.candidates])
+        return min([self.minimum_distance] + [d for _, _, d, _, _ in self.closest])
 
     def shortest_distance(self):
         self.compute_candidates()
         if len(self.candidates) > 0:
             return self.shortest_distance_among_candidates()
-        from scipy.spatial.distance import cdist
-        return min([np.min(cdist(self.curves[i].gamma(), self.curves[j].gamma())) for i in range(len(self.curves)) for j in range(i)])
+        # No two curves are closer than minimum_distance, so keep doubling the
+        # threshold until some are.
+        gammas = [c.gamma() for c in self.curves]
+        threshold = self.minimum_distance if self.minimum_distance > 0 else 1.
+        closest = []
+        while len(closest) == 0 and len(gammas) > 1:
+            threshold *= 2
+            closest = sopp.get_closest_points_within_collection(gammas, threshold, len(gammas))
+        return min(d for _, _, d, _, _ in closest)
 
     def J(self):
         """
         This returns the value of the quantity.
         """
-        self.compute_candidates()
-        res = 0
-        for i, j in self.candidates:
-            gamma1 = self.curves[i].gamma()
-            l1 = self.curves[i].gammadash()
-            gamma2 = self.curves[j].gamma()
-            l2 = self.curves[j].gammadash()
-            res += self.J_jax(gamma1, l1, gamma2, l2)
-
-        return res
+        return sopp.curve_curve_distance_penalty(
+            [c.gamma() for c in self.curves], [c.gammadash() for c in self.curves],
+            self.minimum_distance, self.num_basecurves, [], [])
 
     @derivative_dec
     def dJ(self):
         """
         This returns the derivative of the quantity with respect to the curve dofs.
         """
-        self.compute_candidates()
         dgamma_by_dcoeff_vjp_vecs = [np.zeros_like(c.gamma()) for c in self.curves]
         dgammadash_by_dcoeff_vjp_vecs = [np.zeros_like(c.gammadash()) for c in self.curves]
-
-        for i, j in self.candidates:
-            gamma1 = self.curves[i].gamma()
-            l1 = self.curves[i].gammadash()
-            gamma2 = self.curves[j].gamma()
-            l2 = self.curves[j].gammadash()
-            dgamma_by_dcoeff_vjp_vecs[i] += self.thisgrad0(gamma1, l1, gamma2, l2)
-            dgammadash_by_dcoeff_vjp_vecs[i] += self.thisgrad1(gamma1, l1, gamma2, l2)
-            dgamma_by_dcoeff_vjp_vecs[j] += self.thisgrad2(gamma1, l1, gamma2, l2)
-            dgammadash_by_dcoeff_vjp_vecs[j] += self.thisgrad3(gamma1, l1, gamma2, l2)
+        sopp.curve_curve_distance_penalty(
+            [c.gamma() for c in self.curves], [c.gammadash() for c in self.curves],
+            self.minimum_distance, self.num_basecurves,
+            dgamma_by_dcoeff_vjp_vecs, dgammadash_by_dcoeff_vjp_vecs)
 
         res = [self.curves[i].dgamma_by_dcoeff_vjp(dgamma_by_dcoeff_vjp_vecs[i]) + self.curves[i].dgammadash_by_dcoeff_vjp(dgammadash_by_dcoeff_vjp_vecs[i]) for i in range(len(self.curves))]
         return sum(res)
@@ -300,23 +287,28 @@ class CurveSurfaceDistance(Optimizable):
 
     def compute_candidates(self):
         if self.candidates is None:
-            candidates = sopp.get_pointclouds_closer_than_threshold_between_two_collections(
+            self.closest = sopp.get_closest_points_between_two_collections(
                 [c.gamma() for c in self.curves], [self.surface.gamma().reshape((-1, 3))], self.minimum_distance)
-            self.candidates = candidates
+            self.candidates = [(i, j) for i, j, _, _, _ in self.closest]
 
     def shortest_distance_among_candidates(self):
         self.compute_candidates()
-        from scipy.spatial.distance import cdist
-        xyz_surf = self.surface.gamma().reshape((-1, 3))
-        return min([self.minimum_distance] + [np.min(cdist(self.curves[i].gamma(), xyz_surf)) for i, _ in self.candidates])
+        return min([self.minimum_distance] + [d for _, _, d, _, _ in self.closest])
 
     def shortest_distance(self):
         self.compute_candidates()
         if len(self.candidates) > 0:
             return self.shortest_distance_among_candidates()
-        from scipy.spatial.distance import cdist
-        xyz_surf = self.surface.gamma().reshape((-1, 3))
-        return min([np.min(cdist(self.curves[i].gamma(), xyz_surf)) for i in range(len(self.curves))])
+        # No curve is closer than minimum_distance to the surface, so keep
+        # doubling the threshold until one is.
+        gammas = [c.gamma() for c in self.curves]
+        xyz_surf = [self.surface.gamma().reshape((-1, 3))]
+        threshold = self.minimum_distance if self.minimum_distance > 0 else 1.
+        closest = []
+        while len(closest) == 0 and len(gammas) > 0:
+            threshold *= 2
+            closest = sopp.get_closest_points_between_two_collections(gammas, xyz_surf, threshold)
+        return min(d for _, _, d, _, _ in closest)
 
     def J(self):
         """
@@ -65,6 +65,8 @@ class PermanentMagnetGrid:
         self.R0 = self.plasma_boundary.get_rc(0, 0)
         self.nphi = len(self.plasma_boundary.quadpoints_phi)
         self.ntheta = len(self.plasma_boundary.quadpoints_theta)
+        self.matrix_free = False
+        self.compression_tol = None
 
     def _setup_uniform_grid(self):
         """
@@ -179,6 +181,17 @@ class PermanentMagnetGrid:
                 Optional set of local coordinate systems for each dipole, 
                 which specifies which directions should be considered grid-aligned.
                 Ncoords can be > 3, as in the PM4Stell design.
+            matrix_free: bool
+                If True, the dense A matrix is never formed. Instead, A and A^T
+                are applied on the fly by a ``sopp.DipoleFieldOperator``, stored
+                as ``A_operator``, and the Gram matrix A^T A is cached when it is
+                smaller than A. Supported by relax_and_split and by the
+                baseline and backtracking variants of GPMO.
+            compression_tol: float
+                If given, implies matrix_free = True, and ``A_operator`` is a
+                ``sopp.DipoleFieldHMatrix``, a hierarchical low rank
+                approximation of A with relative accuracy compression_tol
+                that takes much less memory than A for large grids.
             coordinate_flag: string
                 Flag to specify the coordinate system used for the grid and optimization.
                 This is primarily used to tell the optimizer which coordinate directions
@@ -198,6 +211,8 @@ class PermanentMagnetGrid:
 
         """
         coordinate_flag = kwargs.pop("coordinate_flag", "cartesian")
+        matrix_free = kwargs.pop("matrix_free", False)
+        compression_tol = kwargs.pop("compression_tol", None)
         downsample = kwargs.pop("downsample", 1)
         pol_vectors = kwargs.pop("pol_vectors", None)
         m_maxima = kwargs.pop("m_maxima", None)
@@ -205,6 +220,8 @@ class PermanentMagnetGrid:
             raise ValueError('Famus filename must end in .focus')
 
         pm_grid = cls(plasma_boundary, Bn, coordinate_flag)
+        pm_grid.matrix_free = matrix_free or compression_tol is not None
+        pm_grid.compression_tol = compression_tol
         pm_grid.famus_filename = famus_filename
         ox, oy, oz, Ic, M0s = np.loadtxt(famus_filename, skiprows=3, usecols=[3, 4, 5, 6, 7],
                                          delimiter=',', unpack=True)
@@ -323,6 +340,17 @@ class PermanentMagnetGrid:
                 inner and outer toroidal surfaces. Used only if the
                 coordinate_flag = cartesian, then Nz is the z-size of the
                 rectangular cubes in the grid.
+            matrix_free: bool
+                If True, the dense A matrix is never formed. Instead, A and A^T
+                are applied on the fly by a ``sopp.DipoleFieldOperator``, stored
+                as ``A_operator``, and the Gram matrix A^T A is cached when it is
+                smaller than A. Supported by relax_and_split and by the
+                baseline and backtracking variants of GPMO.
+            compression_tol: float
+                If given, implies matrix_free = True, and ``A_operator`` is a
+                ``sopp.DipoleFieldHMatrix``, a hierarchical low rank
+                approximation of A with relative accuracy compression_tol
+                that takes much less memory than A for large grids.
             coordinate_flag: string
                 Flag to specify the coordinate system used for the grid and optimization.
                 This is primarily used to tell the optimizer which coordinate directions
@@ -338,9 +366,13 @@ class PermanentMagnetGrid:
 
         """
         coordinate_flag = kwargs.pop("coordinate_flag", "cartesian")
+        matrix_free = kwargs.pop("matrix_free", False)
+        compression_tol = kwargs.pop("compression_tol", None)
         pol_vectors = kwargs.pop("pol_vectors", None)
         m_maxima = kwargs.pop("m_maxima", None)
         pm_grid = cls(plasma_boundary, Bn, coordinate_flag) 
+        pm_grid.matrix_free = matrix_free or compression_tol is not None
+        pm_grid.compression_tol = compression_tol
         Nx = kwargs.pop("Nx", 10)
         Ny = kwargs.pop("Ny", 10)
         Nz = kwargs.pop("Nz", 10)
@@ -424,31 +456,34 @@ class PermanentMagnetGrid:
         # term is integral(B_P + B_C + B_M)^2
         self.b_obj = - self.Bn.reshape(self.nphi * self.ntheta)
 
-        # Compute geometric factor with the C++ routine
-        self.A_obj = sopp.dipole_field_Bn(
-            np.ascontiguousarray(self.plasma_boundary.gamma().reshape(-1, 3)),
-            np.ascontiguousarray(self.dipole_grid_xyz),
-            np.ascontiguousarray(self.plasma_boundary.unitnormal().reshape(-1, 3)),
-            self.plasma_boundary.nfp, int(self.plasma_boundary.stellsym),
-            np.ascontiguousarray(self.b_obj),
-            self.coordinate_flag,  # cartesian, cylindrical, or simple toroidal
-            self.R0
-        )
-
         # Rescale the A matrix so that 0.5 * ||Am - b||^2 = f_b,
         # where f_b is the metric for Bnormal on the plasma surface
         Ngrid = self.nphi * self.ntheta
-        self.A_obj = self.A_obj.reshape(self.nphi * self.ntheta, self.ndipoles * 3)
         Nnorms = np.ravel(np.sqrt(np.sum(self.plasma_boundary.normal() ** 2, axis=-1)))
-        for i in range(self.A_obj.shape[0]):
-            self.A_obj[i, :] = self.A_obj[i, :] * np.sqrt(Nnorms[i] / Ngrid)
-        self.b_obj = self.b_obj * np.sqrt(Nnorms / Ngrid)
-        self.ATb = self.A_obj.T @ self.b_obj
 
-        # Compute singular values of A, use this to determine optimal step size
-        # for the MwPGP algorithm, with alpha ~ 2 / ATA_scale
-        S = np.linalg.svd(self.A_obj, full_matrices=False, compute_uv=False)
-        self.ATA_scale = S[0] ** 2
+        if self.matrix_free:
+            self._operator_setup(Nnorms, Ngrid)
+        else:
+            # Compute geometric factor with the C++ routine
+            self.A_obj = sopp.dipole_field_Bn(
+                np.ascontiguousarray(self.plasma_boundary.gamma().reshape(-1, 3)),
+                np.ascontiguousarray(self.dipole_grid_xyz),
+                np.ascontiguousarray(self.plasma_boundary.unitnormal().reshape(-1, 3)),
+                self.plasma_boundary.nfp, int(self.plasma_boundary.stellsym),
+                np.ascontiguousarray(self.b_obj),
+                self.coordinate_flag,  # cartesian, cylindrical, or simple toroidal
+                self.R0
+            )
+            self.A_obj = self.A_obj.reshape(self.nphi * self.ntheta, self.ndipoles * 3)
+            for i in range(self.A_obj.shape[0]):
+                self.A_obj[i, :] = self.A_obj[i, :] * np.sqrt(Nnorms[i] / Ngrid)
+            self.b_obj = self.b_obj * np.sqrt(Nnorms / Ngrid)
+            self.ATb = self.A_obj.T @ self.b_obj
+
+            # Compute singular values of A, use this to determine optimal step size
+            # for the MwPGP algorithm, with alpha ~ 2 / ATA_scale
+            S = np.linalg.svd(self.A_obj, full_matrices=False, compute_uv=False)
+            self.ATA_scale = S[0] ** 2
 
         # Set initial condition for the dipoles to default IC
         self.m0 = np.zeros(self.ndipoles * 3)
@@ -457,9 +492,56 @@ class PermanentMagnetGrid:
         self.m = self.m0
 
         # Print initial f_B metric using the initial guess
-        total_error = np.linalg.norm((self.A_obj.dot(self.m0) - self.b_obj), ord=2) ** 2 / 2.0
+        total_error = np.linalg.norm((self.A_dot(self.m0) - self.b_obj), ord=2) ** 2 / 2.0
         print('f_B (total with initial SIMSOPT guess) = ', total_error)
 
+    def _operator_setup(self, Nnorms, Ngrid):
+        """
+        Matrix-free counterpart of the setup of A_obj, ATb and ATA_scale,
+        used when matrix_free = True.
+        """
+        from scipy.sparse.linalg import LinearOperator, eigsh
+
+        contig = np.ascontiguousarray
+        args = (
+            contig(self.plasma_boundary.gamma().reshape(-1, 3)),
+            contig(self.dipole_grid_xyz),
+            contig(self.plasma_boundary.unitnormal().reshape(-1, 3)),
+            self.plasma_boundary.nfp, int(self.plasma_boundary.stellsym),
+            contig(np.sqrt(Nnorms / Ngrid)),
+            self.coordinate_flag,
+            self.R0
+        )
+        if self.compression_tol is not None:
+            self.A_operator = sopp.DipoleFieldHMatrix(*args, tol=self.compression_tol)
+            print('A compressed to {:.1f}% of its dense size, maximal rank {}'.format(
+                100 * self.A_operator.compression_ratio, self.A_operator.max_rank))
+        else:
+            self.A_operator = sopp.DipoleFieldOperator(*args)
+            # A^T A takes less memory than A in this case, and is cheaper to apply
+            if 3 * self.ndipoles < Ngrid:
+                self.A_operator.cache_gram()
+        self.b_obj = self.b_obj * np.sqrt(Nnorms / Ngrid)
+        self.ATb = self.A_operator.rmatvec(contig(self.b_obj))
+
+        # Largest eigenvalue of A^T A, equal to the square of the
+        # largest singular value of A
+        n = 3 * self.ndipoles
+        ATA = LinearOperator((n, n), dtype=float,
+                             matvec=lambda v: self.A_operator.normal_matvec(contig(np.ravel(v))))
+        self.ATA_scale = eigsh(ATA, k=1, which='LA', return_eigenvectors=False)[0]
+
+    def A_dot(self, m):
+        """
+        Computes A m, for both the dense and the matrix-free setup.
+
+        Args:
+            m: 1D numpy array of dipole moments, shape (3 * ndipoles).
+        """
+        if self.matrix_free:
+            return self.A_operator.matvec(np.ascontiguousarray(np.ravel(m)))
+        return self.A_obj.dot(m)
+
     def _print_initial_opt(self):
         """
         Print out initial errors and the bulk optimization parameters
@@ -467,8 +549,8 @@ class PermanentMagnetGrid:
         """
         ave_Bn = np.mean(np.abs(self.b_obj))
         total_Bn = np.sum(np.abs(self.b_obj) ** 2)
-        dipole_error = np.linalg.norm(self.A_obj.dot(self.m0), ord=2) ** 2
-        total_error = np.linalg.norm(self.A_obj.dot(self.m0) - self.b_obj, ord=2) ** 2
+        dipole_error = np.linalg.norm(self.A_dot(self.m0), ord=2) ** 2
+        total_error = np.linalg.norm(self.A_dot(self.m0) - self.b_obj, ord=2) ** 2
         print('Number of phi quadrature points on plasma surface = ', self.nphi)
         print('Number of theta quadrature points on plasma surface = ', self.ntheta)
         print('<B * n> without the permanent magnets = {0:.4e}'.format(ave_Bn))
@@ -476,7 +558,7 @@ class PermanentMagnetGrid:
         print(r'Initial $|Am_0|_2^2 = |B_M * n|_2^2$ without the coils/plasma = {0:.4e}'.format(dipole_error))
         print('Number of dipoles = ', self.ndipoles)
         print('Maximum dipole moment = ', np.max(self.m_maxima))
-        print('Shape of A matrix = ', self.A_obj.shape)
+        print('Shape of A matrix = ', (self.nphi * self.ntheta, self.ndipoles * 3))
         print('Shape of b vector = ', self.b_obj.shape)
         print('Initial error on plasma surface = {0:.4e}'.format(total_error))
 
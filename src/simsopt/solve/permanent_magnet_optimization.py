@@ -182,7 +182,6 @@ def relax_and_split(pm_opt, m0=None, **kwargs):
 
     """
     # change to row-major order for the C++ code
-    A_obj = np.ascontiguousarray(pm_opt.A_obj)
     ATb = np.ascontiguousarray(np.reshape(pm_opt.ATb, (pm_opt.ndipoles, 3)))
 
     # print initial errors and values before optimization
@@ -196,7 +195,14 @@ def relax_and_split(pm_opt, m0=None, **kwargs):
     # get optimal alpha value for the MwPGP algorithm
     alpha_max = 2.0 / pm_opt.ATA_scale
     alpha_max = alpha_max * (1 - 1e-5)
-    convex_step = sopp.MwPGP_algorithm
+    # with matrix_free = True, A^T A is applied by pm_opt.A_operator instead
+    # of a dense A_obj
+    if pm_opt.matrix_free:
+        A_kwargs = {'A_op': pm_opt.A_operator}
+        convex_step = sopp.MwPGP_algorithm_matrix_free
+    else:
+        A_kwargs = {'A_obj': np.ascontiguousarray(pm_opt.A_obj)}
+        convex_step = sopp.MwPGP_algorithm
 
     # set the nonconvex step in the algorithm
     reg_rs = 0.0
@@ -233,7 +239,7 @@ def relax_and_split(pm_opt, m0=None, **kwargs):
         for i in range(max_iter_RS):
             # update m with the CONVEX part of the algorithm
             algorithm_history, _, _, m = convex_step(
-                A_obj=pm_opt.A_obj,
+                **A_kwargs,
                 b_obj=pm_opt.b_obj,
                 ATb=ATb,
                 m_proxy=np.ascontiguousarray(m_proxy.reshape(pm_opt.ndipoles, 3)),
@@ -257,7 +263,7 @@ def relax_and_split(pm_opt, m0=None, **kwargs):
         # no nonconvex terms being used, so just need one round of the
         # convex algorithm called MwPGP
         algorithm_history, _, m_history, m = convex_step(
-            A_obj=pm_opt.A_obj,
+            **A_kwargs,
             b_obj=pm_opt.b_obj,
             ATb=ATb,
             m_proxy=m0,
@@ -361,7 +367,11 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
             iterations.
 
     """
-    if not hasattr(pm_opt, "A_obj"):
+    if pm_opt.matrix_free:
+        if algorithm not in ('baseline', 'backtracking'):
+            raise ValueError("Only the baseline and backtracking GPMO variants can be "
+                             "used with a PermanentMagnetGrid set up with matrix_free=True.")
+    elif not hasattr(pm_opt, "A_obj"):
         raise ValueError("The PermanentMagnetClass needs to use geo_setup() or "
                          "geo_setup_from_famus() before calling optimization routines.")
 
@@ -374,7 +384,14 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
     mmax = pm_opt.m_maxima
     contig = np.ascontiguousarray
     mmax_vec = contig(np.array([mmax, mmax, mmax]).T.reshape(pm_opt.ndipoles * 3))
-    A_obj = pm_opt.A_obj * mmax_vec
+    if pm_opt.matrix_free:
+        A_kwargs = {'A_op': pm_opt.A_operator, 'column_scaling': mmax_vec}
+        GPMO_baseline = sopp.GPMO_baseline_matrix_free
+        GPMO_backtracking = sopp.GPMO_backtracking_matrix_free
+    else:
+        A_kwargs = {'A_obj': contig((pm_opt.A_obj * mmax_vec).T)}
+        GPMO_baseline = sopp.GPMO_baseline
+        GPMO_backtracking = sopp.GPMO_backtracking
 
     if (algorithm != 'baseline' and algorithm != 'mutual_coherence' and algorithm != 'ArbVec') and 'dipole_grid_xyz' not in kwargs:
         raise ValueError('GPMO variants require dipole_grid_xyz to be defined.')
@@ -399,8 +416,8 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
 
     # Note, only baseline method has the f_m loss term implemented! 
     if algorithm == 'baseline':  # GPMO
-        algorithm_history, Bn_history, m_history, m = sopp.GPMO_baseline(
-            A_obj=contig(A_obj.T),
+        algorithm_history, Bn_history, m_history, m = GPMO_baseline(
+            **A_kwargs,
             b_obj=contig(pm_opt.b_obj),
             mmax=np.sqrt(reg_l2)*mmax_vec,
             normal_norms=Nnorms,
@@ -408,7 +425,7 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
         )
     elif algorithm == 'ArbVec':  # GPMO with arbitrary polarization vectors
         algorithm_history, Bn_history, m_history, m = sopp.GPMO_ArbVec(
-            A_obj=contig(A_obj.T),
+            **A_kwargs,
             b_obj=contig(pm_opt.b_obj),
             mmax=np.sqrt(reg_l2)*mmax_vec,
             normal_norms=Nnorms,
@@ -416,8 +433,8 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
             **kwargs
         )
     elif algorithm == 'backtracking':  # GPMOb
-        algorithm_history, Bn_history, m_history, num_nonzeros, m = sopp.GPMO_backtracking(
-            A_obj=contig(A_obj.T),
+        algorithm_history, Bn_history, m_history, num_nonzeros, m = GPMO_backtracking(
+            **A_kwargs,
             b_obj=contig(pm_opt.b_obj),
             mmax=np.sqrt(reg_l2)*mmax_vec,
             normal_norms=Nnorms,
@@ -430,7 +447,7 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
                              'only supports dipole grids with \n'
                              'moment vectors in the Cartesian basis.')
         algorithm_history, Bn_history, m_history, num_nonzeros, m = sopp.GPMO_ArbVec_backtracking(
-            A_obj=contig(A_obj.T),
+            **A_kwargs,
             b_obj=contig(pm_opt.b_obj),
             mmax=np.sqrt(reg_l2)*mmax_vec,
             normal_norms=Nnorms,
@@ -439,7 +456,7 @@ def GPMO(pm_opt, algorithm='baseline', **kwargs):
         )
     elif algorithm == 'multi':  # GPMOm
         algorithm_history, Bn_history, m_history, m = sopp.GPMO_multi(
-            A_obj=contig(A_obj.T),
+            **A_kwargs,
             b_obj=contig(pm_opt.b_obj),
             mmax=np.sqrt(reg_l2)*mmax_vec,
             normal_norms=Nnorms,
@@ -1,6 +1,9 @@
+#pragma once
+
 #include "simdhelpers.h"
 #include "vec3dsimd.h"
 #include <stdexcept>
+#include <string>
 #include "xtensor/xlayout.hpp"
 
 using namespace std;
@@ -289,6 +292,162 @@ void biot_savart_kernel(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, Al
 }
 #endif
 
+// Floating point precision used to evaluate the Biot-Savart law:
+//  - Double: everything is done in double precision (biot_savart_kernel).
+//  - Mixed:  the distances, inverse cubes and the contributions of the
+//            individual quadrature points are computed in single precision,
+//            but summed up in double precision (in blocks of
+//            biot_savart_mixed_block quadrature points).
+//  - Single: everything is done in single precision.
+// Single precision vectors hold twice as many entries as double precision
+// ones, so the reduced precision kernels process twice as many points at once.
+enum class BiotSavartPrecision { Double, Mixed, Single };
+constexpr int biot_savart_mixed_block = 32;
+
+inline BiotSavartPrecision biot_savart_precision_from_string(const string& precision) {
+    if(precision == "double")
+        return BiotSavartPrecision::Double;
+    else if(precision == "mixed")
+        return BiotSavartPrecision::Mixed;
+    else if(precision == "single")
+        return BiotSavartPrecision::Single;
+    throw std::runtime_error("Unknown precision '" + precision + "', expected 'double', 'mixed' or 'single'.");
+}
+
+inline string biot_savart_precision_to_string(BiotSavartPrecision precision) {
+    if(precision == BiotSavartPrecision::Mixed)
+        return "mixed";
+    else if(precision == BiotSavartPrecision::Single)
+        return "single";
+    return "double";
+}
+
+// Same as biot_savart_kernel, but using single (mixed = false) or mixed
+// (mixed = true) precision, see BiotSavartPrecision. Only B and its first
+// derivative are implemented.
+template<class T, int derivs, bool mixed>
+void biot_savart_kernel_float(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz,
+            T& gamma, T& dgamma_by_dphi, T& B, T& dB_by_dX, T& d2B_by_dXdX) {
+    static_assert(derivs < 2, "The reduced precision Biot-Savart kernel only computes B and its first derivative.");
+    if(gamma.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("gamma needs to be in row-major storage order");
+    if(dgamma_by_dphi.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("dgamma_by_dphi needs to be in row-major storage order");
+    int num_points         = pointsx.size();
+    int num_quad_points    = gamma.shape(0);
+    constexpr int simd_size = simd_float_size;
+    constexpr int ncomp = derivs > 0 ? 12 : 3;
+    double fak = (1e-7/num_quad_points);
+    int block = mixed ? biot_savart_mixed_block : num_quad_points;
+
+    // shift the points and the curve by the centre of the curve before
+    // rounding to single precision, this reduces the error in the differences
+    // for coils that are not centred at the origin.
+    double centre[3] = {0., 0., 0.};
+    for (int j = 0; j < num_quad_points; ++j)
+        for (int l = 0; l < 3; ++l)
+            centre[l] += gamma(j, l)/num_quad_points;
+    auto px = AlignedPaddedFloatVec(num_points, 0.f);
+    auto py = AlignedPaddedFloatVec(num_points, 0.f);
+    auto pz = AlignedPaddedFloatVec(num_points, 0.f);
+    for (int i = 0; i < num_points; ++i) {
+        px[i] = float(pointsx[i]-centre[0]);
+        py[i] = float(pointsy[i]-centre[1]);
+        pz[i] = float(pointsz[i]-centre[2]);
+    }
+    auto g = vector<float>(3*num_quad_points);
+    auto gd = vector<float>(3*num_quad_points);
+    for (int j = 0; j < num_quad_points; ++j) {
+        for (int l = 0; l < 3; ++l) {
+            g[3*j+l] = float(gamma(j, l)-centre[l]);
+            gd[3*j+l] = float(dgamma_by_dphi(j, l));
+        }
+    }
+
+    alignas(64) float tmp[simd_size];
+    double acc[ncomp][simd_size];
+    simd_float_t F[ncomp];
+    for(int i = 0; i < num_points; i += simd_size) {
+        simd_float_t x = load_float(&px[i]);
+        simd_float_t y = load_float(&py[i]);
+        simd_float_t z = load_float(&pz[i]);
+        for (int c = 0; c < ncomp; ++c)
+            for (int l = 0; l < simd_size; ++l)
+                acc[c][l] = 0.;
+        for (int j0 = 0; j0 < num_quad_points; j0 += block) {
+            int jend = std::min(j0 + block, num_quad_points);
+            for (int c = 0; c < ncomp; ++c)
+                F[c] = simd_float_t(0.f);
+            for (int j = j0; j < jend; ++j) {
+                simd_float_t dx = x - g[3*j+0];
+                simd_float_t dy = y - g[3*j+1];
+                simd_float_t dz = z - g[3*j+2];
+                simd_float_t norm_diff_2 = fma_float(dx, dx, fma_float(dy, dy, dz*dz));
+                simd_float_t norm_diff_inv = rsqrt_float(norm_diff_2);
+                simd_float_t norm_diff_3_inv = norm_diff_inv*norm_diff_inv*norm_diff_inv;
+
+                float tx = gd[3*j+0], ty = gd[3*j+1], tz = gd[3*j+2];
+                simd_float_t cx = ty*dz - tz*dy;
+                simd_float_t cy = tz*dx - tx*dz;
+                simd_float_t cz = tx*dy - ty*dx;
+                F[0] = fma_float(cx, norm_diff_3_inv, F[0]);
+                F[1] = fma_float(cy, norm_diff_3_inv, F[1]);
+                F[2] = fma_float(cz, norm_diff_3_inv, F[2]);
+
+                MYIF(derivs > 0) {
+                    simd_float_t norm_diff_4_inv = norm_diff_3_inv*norm_diff_inv;
+                    simd_float_t three_norm_diff_inv = 3.f*norm_diff_inv;
+                    simd_float_t norm_diff = norm_diff_2*norm_diff_inv;
+                    simd_float_t ax = tx*norm_diff, ay = ty*norm_diff, az = tz*norm_diff;
+                    simd_float_t diff[3] = {dx, dy, dz};
+                    // cross(a, e_k), with a = dgamma_by_dphi * |diff|
+                    simd_float_t numerator1[3][3] = {
+                        {simd_float_t(0.f), az, -ay},
+                        {-az, simd_float_t(0.f), ax},
+                        {ay, -ax, simd_float_t(0.f)}
+                    };
+                    for(int k=0; k<3; k++) {
+                        simd_float_t fk = three_norm_diff_inv*diff[k];
+                        F[3+3*k+0] = fma_float(numerator1[k][0] - cx*fk, norm_diff_4_inv, F[3+3*k+0]);
+                        F[3+3*k+1] = fma_float(numerator1[k][1] - cy*fk, norm_diff_4_inv, F[3+3*k+1]);
+                        F[3+3*k+2] = fma_float(numerator1[k][2] - cz*fk, norm_diff_4_inv, F[3+3*k+2]);
+                    }
+                }
+            }
+            for (int c = 0; c < ncomp; ++c) {
+                store_float(tmp, F[c]);
+                for (int l = 0; l < simd_size; ++l)
+                    acc[c][l] += tmp[l];
+            }
+        }
+        int jlimit = std::min(simd_size, num_points-i);
+        for(int j=0; j<jlimit; j++){
+            for (int l = 0; l < 3; ++l)
+                B(i+j, l) = fak * acc[l][j];
+            MYIF(derivs > 0) {
+                for(int k=0; k<3; k++)
+                    for (int l = 0; l < 3; ++l)
+                        dB_by_dX(i+j, k, l) = fak * acc[3+3*k+l][j];
+            }
+        }
+    }
+}
+
+// Dispatches to biot_savart_kernel or biot_savart_kernel_float depending on
+// the requested precision. Second derivatives are always computed in double
+// precision.
+template<class T, int derivs>
+void biot_savart_kernel_precision(BiotSavartPrecision precision, AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz,
+            T& gamma, T& dgamma_by_dphi, T& B, T& dB_by_dX, T& d2B_by_dXdX) {
+    MYIF(derivs < 2) {
+        if(precision == BiotSavartPrecision::Mixed)
+            return biot_savart_kernel_float<T, derivs, true>(pointsx, pointsy, pointsz, gamma, dgamma_by_dphi, B, dB_by_dX, d2B_by_dXdX);
+        else if(precision == BiotSavartPrecision::Single)
+            return biot_savart_kernel_float<T, derivs, false>(pointsx, pointsy, pointsz, gamma, dgamma_by_dphi, B, dB_by_dX, d2B_by_dXdX);
+    }
+    biot_savart_kernel<T, derivs>(pointsx, pointsy, pointsz, gamma, dgamma_by_dphi, B, dB_by_dX, d2B_by_dXdX);
+}
+
 #if defined(USE_XSIMD)
 
 template<class T, int derivs>
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Helpers for coil sets that are generated from a few base coils by rotations
+// and flips (e.g. by coils_via_symmetries). Coil k is then given by
+// gamma_k = M_k gamma_b for a base curve gamma_b and an orthogonal 3x3 matrix
+// M_k (stored row major), and its field satisfies
+//
+//     B_k(x) = det(M_k) M_k B_b(M_k^T x),   A_k(x) = M_k A_b(M_k^T x).
+//
+// If the set of target points is itself invariant under M_k (e.g. the
+// quadrature points on a full torus), then M_k^T x is again one of the target
+// points and the field of the base coil only needs to be evaluated once for
+// all its copies.
+
+using SymmetryMatrix = std::array<double, 9>;
+
+inline double symmetry_det(const SymmetryMatrix& M) {
+    return M[0]*(M[4]*M[8]-M[5]*M[7]) - M[1]*(M[3]*M[8]-M[5]*M[6]) + M[2]*(M[3]*M[7]-M[4]*M[6]);
+}
+
+// y = M^T x
+inline void symmetry_apply_transpose(const SymmetryMatrix& M, const double* x, double* y) {
+    for (int c = 0; c < 3; ++c)
+        y[c] = M[c]*x[0] + M[3+c]*x[1] + M[6+c]*x[2];
+}
+
+// Returns perm so that points[perm[i]] = M^T points[i] (up to a small
+// tolerance), or an empty vector if the points are not invariant under M.
+// `points` is a row major (npoints, 3) array.
+inline std::vector<int> symmetry_permutation(const double* points, int npoints, const SymmetryMatrix& M) {
+    double scale = 0.;
+    for (int i = 0; i < 3*npoints; ++i)
+        scale = std::max(scale, std::abs(points[i]));
+    double tol = 1e-10 * std::max(scale, 1.);
+    double h = 4*tol;
+
+    // bucket the points on a grid with spacing h, and then search the
+    // neighbouring buckets of each transformed point.
+    auto key = [](int64_t i, int64_t j, int64_t k) {
+        return uint64_t(i)*73856093ull ^ uint64_t(j)*19349663ull ^ uint64_t(k)*83492791ull;
+    };
+    std::unordered_multimap<uint64_t, int> buckets;
+    buckets.reserve(npoints);
+    for (int i = 0; i < npoints; ++i) {
+        const double* x = points + 3*i;
+        buckets.emplace(key(std::llround(x[0]/h), std::llround(x[1]/h), std::llround(x[2]/h)), i);
+    }
+
+    std::vector<int> perm(npoints, -1);
+    double y[3];
+    for (int i = 0; i < npoints; ++i) {
+        symmetry_apply_transpose(M, points + 3*i, y);
+        int64_t bi = std::llround(y[0]/h), bj = std::llround(y[1]/h), bk = std::llround(y[2]/h);
+        for (int di = -1; di <= 1 && perm[i] < 0; ++di) {
+            for (int dj = -1; dj <= 1 && perm[i] < 0; ++dj) {
+                for (int dk = -1; dk <= 1 && perm[i] < 0; ++dk) {
+                    auto range = buckets.equal_range(key(bi+di, bj+dj, bk+dk));
+                    for (auto it = range.first; it != range.second; ++it) {
+                        const double* x = points + 3*it->second;
+                        if(std::abs(x[0]-y[0]) < tol && std::abs(x[1]-y[1]) < tol && std::abs(x[2]-y[2]) < tol) {
+                            perm[i] = it->second;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if(perm[i] < 0)
+            return std::vector<int>();
+    }
+    return perm;
+}
+
+// Maps a vector, or a tensor of rank 2 or 3 with respect to a base coil to the
+// corresponding quantity of the rotated coil, i.e. computes
+//     res_a = s M_ac f_c,
+//     res_ja = s M_jb M_ac f_bc,
+//     res_jla = s M_jb M_ld M_ac f_bdc.
+inline void symmetry_rotate_vector(const SymmetryMatrix& M, double s, const double* f, double* res) {
+    for (int a = 0; a < 3; ++a)
+        res[a] = s * (M[3*a]*f[0] + M[3*a+1]*f[1] + M[3*a+2]*f[2]);
+}
+
+inline void symmetry_rotate_rank2(const SymmetryMatrix& M, double s, const double* f, double* res) {
+    double tmp[9];
+    for (int b = 0; b < 3; ++b)
+        symmetry_rotate_vector(M, 1., f + 3*b, tmp + 3*b);
+    for (int j = 0; j < 3; ++j)
+        for (int a = 0; a < 3; ++a)
+            res[3*j+a] = s * (M[3*j]*tmp[a] + M[3*j+1]*tmp[3+a] + M[3*j+2]*tmp[6+a]);
+}
+
+inline void symmetry_rotate_rank3(const SymmetryMatrix& M, double s, const double* f, double* res) {
+    double tmp[27];
+    for (int b = 0; b < 3; ++b)
+        symmetry_rotate_rank2(M, 1., f + 9*b, tmp + 9*b);
+    for (int j = 0; j < 3; ++j)
+        for (int la = 0; la < 9; ++la)
+            res[9*j+la] = s * (M[3*j]*tmp[la] + M[3*j+1]*tmp[9+la] + M[3*j+2]*tmp[18+la]);
+}
+
+// The transposes of the maps above, used to pull back the vectors in vector
+// Jacobian products: res_c = s M_ac v_a, res_bc = s M_jb M_ac v_ja.
+inline void symmetry_rotate_vector_transpose(const SymmetryMatrix& M, double s, const double* v, double* res) {
+    for (int c = 0; c < 3; ++c)
+        res[c] = s * (M[c]*v[0] + M[3+c]*v[1] + M[6+c]*v[2]);
+}
+
+inline void symmetry_rotate_rank2_transpose(const SymmetryMatrix& M, double s, const double* v, double* res) {
+    double tmp[9];
+    for (int j = 0; j < 3; ++j)
+        symmetry_rotate_vector_transpose(M, 1., v + 3*j, tmp + 3*j);
+    for (int b = 0; b < 3; ++b)
+        for (int c = 0; c < 3; ++c)
+            res[3*b+c] = s * (M[b]*tmp[c] + M[3+b]*tmp[3+c] + M[6+b]*tmp[6+c]);
+}
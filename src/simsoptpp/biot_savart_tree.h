@@ -0,0 +1,398 @@
+#pragma once
+
+#include <vector>
+#include <array>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "simdhelpers.h"
+
+using std::vector;
+using std::array;
+
+// Barnes-Hut type evaluation of the Biot-Savart law.
+//
+// The quadrature points of all coils are treated as a single cloud of current
+// elements J_j = 1e-7 * I * gamma'_j / nquad located at y_j, so that the
+// vector potential is A(x) = \sum_j J_j / |x - y_j| and B = curl(A). The
+// sources are sorted into an octree and for every cell we store the Cartesian
+// multipole moments
+//
+//     M_c^\alpha = (-1)^|\alpha| / \alpha! \sum_j J_{j,c} (y_j - center)^\alpha
+//
+// for all multi indices |\alpha| <= order. For a target point x that is far
+// away from a cell (cell radius < theta * distance), the contribution of the
+// cell to any derivative \partial^\beta A_c is approximated by
+//
+//     \sum_\alpha M_c^\alpha \partial^{\alpha+\beta} (1/|d|),   d = x - center,
+//
+// whose truncation error decays like theta^(order+1). Cells that are too
+// close are opened, and leaves are summed directly. The derivatives of 1/|d|
+// are computed using the McMurchie-Davidson recurrence
+//
+//     R^{(n)}_{000} = (-1)^n (2n-1)!! / |d|^{2n+1}
+//     R^{(n)}_{t+1,u,v} = t R^{(n+1)}_{t-1,u,v} + d_x R^{(n+1)}_{t,u,v}
+//
+// (and analogously for u, v), so that \partial^{(t,u,v)} (1/|d|) = R^{(0)}_{tuv}.
+//
+// Both far and near interactions accumulate the derivatives \partial^\beta
+// A_c for |\beta| <= nderivs, from which A, B and their derivatives are then
+// assembled.
+class BiotSavartTree {
+    private:
+        struct Node {
+            array<double, 3> center;
+            double halfwidth;
+            double radius;
+            int begin, end;
+            array<int, 8> children;
+            bool leaf;
+        };
+
+        int order;
+        double theta;
+        int leaf_size;
+        int max_order; // largest total derivative order of 1/|d| we may need
+        int nmoments;
+
+        // sources, stored in tree order
+        vector<double> src_pos;
+        vector<double> src_J;
+
+        vector<Node> nodes;
+        vector<double> moments;
+
+        // multi index bookkeeping
+        vector<array<int, 3>> multi_indices;
+        vector<int> lookup;
+
+        inline int idx(int t, int u, int v) const {
+            return lookup[(t*(max_order+1) + u)*(max_order+1) + v];
+        }
+
+        static int num_multi_indices(int p) {
+            return (p+1)*(p+2)*(p+3)/6;
+        }
+
+        void build_multi_indices() {
+            lookup = vector<int>((max_order+1)*(max_order+1)*(max_order+1), -1);
+            multi_indices.clear();
+            for (int L = 0; L <= max_order; ++L) {
+                for (int t = L; t >= 0; --t) {
+                    for (int u = L-t; u >= 0; --u) {
+                        int v = L - t - u;
+                        lookup[(t*(max_order+1) + u)*(max_order+1) + v] = multi_indices.size();
+                        multi_indices.push_back({t, u, v});
+                    }
+                }
+            }
+        }
+
+        int build_node(vector<int>& perm, int begin, int end, const array<double, 3>& center, double halfwidth, int depth,
+                const vector<double>& pos) {
+            int id = nodes.size();
+            nodes.push_back(Node());
+            nodes[id].center = center;
+            nodes[id].halfwidth = halfwidth;
+            nodes[id].begin = begin;
+            nodes[id].end = end;
+            nodes[id].children.fill(-1);
+            nodes[id].leaf = (end - begin <= leaf_size) || depth >= 32;
+            if(nodes[id].leaf)
+                return id;
+            // sort the points in [begin, end) into the eight octants
+            array<vector<int>, 8> buckets;
+            for (int k = begin; k < end; ++k) {
+                int j = perm[k];
+                int oct = (pos[3*j+0] > center[0] ? 1 : 0) + (pos[3*j+1] > center[1] ? 2 : 0) + (pos[3*j+2] > center[2] ? 4 : 0);
+                buckets[oct].push_back(j);
+            }
+            int start = begin;
+            array<int, 9> offsets;
+            for (int oct = 0; oct < 8; ++oct) {
+                offsets[oct] = start;
+                std::copy(buckets[oct].begin(), buckets[oct].end(), perm.begin() + start);
+                start += buckets[oct].size();
+            }
+            offsets[8] = end;
+            for (int oct = 0; oct < 8; ++oct) {
+                if(offsets[oct+1] == offsets[oct])
+                    continue;
+                double h = 0.5*halfwidth;
+                array<double, 3> c = {
+                    center[0] + ((oct & 1) ? h : -h),
+                    center[1] + ((oct & 2) ? h : -h),
+                    center[2] + ((oct & 4) ? h : -h)
+                };
+                int child = build_node(perm, offsets[oct], offsets[oct+1], c, h, depth+1, pos);
+                nodes[id].children[oct] = child;
+            }
+            return id;
+        }
+
+        void compute_moments() {
+            int nnodes = nodes.size();
+            moments = vector<double>(nnodes*3*nmoments, 0.);
+#pragma omp parallel for schedule(dynamic)
+            for (int n = 0; n < nnodes; ++n) {
+                const Node& node = nodes[n];
+                double radius = 0.;
+                vector<double> powx(order+1), powy(order+1), powz(order+1);
+                double* M = &(moments[n*3*nmoments]);
+                for (int j = node.begin; j < node.end; ++j) {
+                    double sx = src_pos[3*j+0] - node.center[0];
+                    double sy = src_pos[3*j+1] - node.center[1];
+                    double sz = src_pos[3*j+2] - node.center[2];
+                    radius = std::max(radius, std::sqrt(sx*sx + sy*sy + sz*sz));
+                    powx[0] = 1.; powy[0] = 1.; powz[0] = 1.;
+                    for (int k = 1; k <= order; ++k) {
+                        powx[k] = -sx*powx[k-1]*(1./k);
+                        powy[k] = -sy*powy[k-1]*(1./k);
+                        powz[k] = -sz*powz[k-1]*(1./k);
+                    }
+                    for (int a = 0; a < nmoments; ++a) {
+                        auto& m = multi_indices[a];
+                        double sa = powx[m[0]]*powy[m[1]]*powz[m[2]];
+                        M[0*nmoments + a] += src_J[3*j+0] * sa;
+                        M[1*nmoments + a] += src_J[3*j+1] * sa;
+                        M[2*nmoments + a] += src_J[3*j+2] * sa;
+                    }
+                }
+                nodes[n].radius = radius;
+            }
+        }
+
+        // Computes \partial^{(t,u,v)} (1/|d|) for all t+u+v <= p using the
+        // McMurchie-Davidson recurrence. `R` needs to have space for
+        // (p+1)*num_multi_indices(max_order) entries.
+        inline void derivatives_of_inverse_distance(double dx, double dy, double dz, int p, double* R) const {
+            int nmi = num_multi_indices(p);
+            double r2 = dx*dx + dy*dy + dz*dz;
+            double rinv = 1./std::sqrt(r2);
+            double r2inv = rinv*rinv;
+            double fak = rinv;
+            for (int n = 0; n <= p; ++n) {
+                R[n*nmi + 0] = fak;
+                fak *= -(2*n+1)*r2inv;
+            }
+            for (int a = 1; a < nmi; ++a) {
+                int t = multi_indices[a][0], u = multi_indices[a][1], v = multi_indices[a][2];
+                int L = t + u + v;
+                for (int n = 0; n <= p - L; ++n) {
+                    double val;
+                    if(t > 0) {
+                        val = dx * R[(n+1)*nmi + idx(t-1, u, v)];
+                        if(t > 1)
+                            val += (t-1) * R[(n+1)*nmi + idx(t-2, u, v)];
+                    } else if(u > 0) {
+                        val = dy * R[(n+1)*nmi + idx(t, u-1, v)];
+                        if(u > 1)
+                            val += (u-1) * R[(n+1)*nmi + idx(t, u-2, v)];
+                    } else {
+                        val = dz * R[(n+1)*nmi + idx(t, u, v-1)];
+                        if(v > 1)
+                            val += (v-1) * R[(n+1)*nmi + idx(t, u, v-2)];
+                    }
+                    R[n*nmi + a] = val;
+                }
+            }
+        }
+
+        // Accumulates \partial^\beta A_c(x) for |\beta| <= nderivs into dA[c*nbeta + beta].
+        void accumulate(double x, double y, double z, int nderivs, double* dA, vector<int>& stack, vector<double>& R) const {
+            int nbeta = num_multi_indices(nderivs);
+            int pfar = order + nderivs;
+            int nnear = num_multi_indices(nderivs);
+            stack.clear();
+            stack.push_back(0);
+            while(!stack.empty()) {
+                int n = stack.back();
+                stack.pop_back();
+                const Node& node = nodes[n];
+                double dx = x - node.center[0];
+                double dy = y - node.center[1];
+                double dz = z - node.center[2];
+                double dist = std::sqrt(dx*dx + dy*dy + dz*dz);
+                if(node.radius < theta * dist) {
+                    derivatives_of_inverse_distance(dx, dy, dz, pfar, R.data());
+                    const double* M = &(moments[n*3*nmoments]);
+                    for (int b = 0; b < nbeta; ++b) {
+                        auto& mb = multi_indices[b];
+                        double acc0 = 0., acc1 = 0., acc2 = 0.;
+                        for (int a = 0; a < nmoments; ++a) {
+                            auto& ma = multi_indices[a];
+                            double D = R[idx(ma[0]+mb[0], ma[1]+mb[1], ma[2]+mb[2])];
+                            acc0 += M[0*nmoments + a] * D;
+                            acc1 += M[1*nmoments + a] * D;
+                            acc2 += M[2*nmoments + a] * D;
+                        }
+                        dA[0*nbeta + b] += acc0;
+                        dA[1*nbeta + b] += acc1;
+                        dA[2*nbeta + b] += acc2;
+                    }
+                } else if(node.leaf) {
+                    for (int j = node.begin; j < node.end; ++j) {
+                        derivatives_of_inverse_distance(x - src_pos[3*j+0], y - src_pos[3*j+1], z - src_pos[3*j+2], nderivs, R.data());
+                        for (int b = 0; b < nnear; ++b) {
+                            dA[0*nbeta + b] += src_J[3*j+0] * R[b];
+                            dA[1*nbeta + b] += src_J[3*j+1] * R[b];
+                            dA[2*nbeta + b] += src_J[3*j+2] * R[b];
+                        }
+                    }
+                } else {
+                    for (int oct = 0; oct < 8; ++oct) {
+                        if(node.children[oct] >= 0)
+                            stack.push_back(node.children[oct]);
+                    }
+                }
+            }
+        }
+
+    public:
+        /*
+         * Build the tree for the current elements given in `positions` and
+         * `elements` (both flat arrays of length 3*nsources). The elements
+         * are expected to already contain the factor 1e-7 * current / nquad.
+         * `theta` is the opening angle that controls the accuracy (smaller is
+         * more accurate, theta -> 0 recovers direct summation) and `order`
+         * is the order of the multipole expansion.
+         */
+        BiotSavartTree(const vector<double>& positions, const vector<double>& elements, double theta, int order, int leaf_size=32) :
+            order(order), theta(theta), leaf_size(leaf_size) {
+            if(theta <= 0. || theta >= 1.)
+                throw std::runtime_error("The opening angle theta has to be in (0, 1).");
+            if(order < 0)
+                throw std::runtime_error("The expansion order has to be non-negative.");
+            if(positions.size() != elements.size() || positions.size() % 3 != 0)
+                throw std::runtime_error("positions and elements need to be of shape (nsources, 3).");
+            max_order = order + 3;
+            nmoments = num_multi_indices(order);
+            build_multi_indices();
+
+            int nsources = positions.size()/3;
+            src_pos = vector<double>(3*nsources);
+            src_J = vector<double>(3*nsources);
+            if(nsources == 0)
+                return;
+            array<double, 3> lo = {positions[0], positions[1], positions[2]};
+            array<double, 3> hi = lo;
+            for (int j = 0; j < nsources; ++j) {
+                for (int l = 0; l < 3; ++l) {
+                    lo[l] = std::min(lo[l], positions[3*j+l]);
+                    hi[l] = std::max(hi[l], positions[3*j+l]);
+                }
+            }
+            array<double, 3> center = {0.5*(lo[0]+hi[0]), 0.5*(lo[1]+hi[1]), 0.5*(lo[2]+hi[2])};
+            double halfwidth = 0.5*std::max({hi[0]-lo[0], hi[1]-lo[1], hi[2]-lo[2]}) * (1+1e-10) + 1e-300;
+
+            vector<int> perm(nsources);
+            for (int j = 0; j < nsources; ++j)
+                perm[j] = j;
+            build_node(perm, 0, nsources, center, halfwidth, 0, positions);
+            for (int k = 0; k < nsources; ++k) {
+                for (int l = 0; l < 3; ++l) {
+                    src_pos[3*k+l] = positions[3*perm[k]+l];
+                    src_J[3*k+l] = elements[3*perm[k]+l];
+                }
+            }
+            compute_moments();
+        }
+
+        int num_nodes() const { return nodes.size(); }
+
+        /*
+         * Evaluate B and, depending on `derivs`, its first and second
+         * derivatives. The layout of the outputs matches `biot_savart_kernel`.
+         */
+        template<int derivs, class T2, class T3, class T4>
+        void B(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz, T2& B, T3& dB_by_dX, T4& d2B_by_dXdX) const {
+            int num_points = pointsx.size();
+            constexpr int nderivs = derivs + 1;
+            const int nbeta = num_multi_indices(nderivs);
+#pragma omp parallel
+            {
+                vector<int> stack;
+                vector<double> R((max_order+1)*num_multi_indices(max_order), 0.);
+                vector<double> dA(3*nbeta, 0.);
+#pragma omp for schedule(dynamic, 64)
+                for (int i = 0; i < num_points; ++i) {
+                    std::fill(dA.begin(), dA.end(), 0.);
+                    if(!nodes.empty())
+                        accumulate(pointsx[i], pointsy[i], pointsz[i], nderivs, dA.data(), stack, R);
+                    // \partial^{(t,u,v)} B_l = \partial^{(t,u,v)} (\partial_b A_c - \partial_c A_b)
+                    // for (l, b, c) a cyclic permutation of (0, 1, 2).
+                    auto curl = [&](int l, int t, int u, int v) {
+                        int b = (l+1)%3, c = (l+2)%3;
+                        int eb[3] = {t, u, v};
+                        int ec[3] = {t, u, v};
+                        eb[b] += 1;
+                        ec[c] += 1;
+                        return dA[c*nbeta + idx(eb[0], eb[1], eb[2])] - dA[b*nbeta + idx(ec[0], ec[1], ec[2])];
+                    };
+                    for (int l = 0; l < 3; ++l) {
+                        B(i, l) = curl(l, 0, 0, 0);
+                        if constexpr(derivs > 0) {
+                            for (int k = 0; k < 3; ++k) {
+                                int e[3] = {0, 0, 0};
+                                e[k] = 1;
+                                dB_by_dX(i, k, l) = curl(l, e[0], e[1], e[2]);
+                            }
+                        }
+                        if constexpr(derivs > 1) {
+                            for (int k1 = 0; k1 < 3; ++k1) {
+                                for (int k2 = 0; k2 < 3; ++k2) {
+                                    int e[3] = {0, 0, 0};
+                                    e[k1] += 1;
+                                    e[k2] += 1;
+                                    d2B_by_dXdX(i, k1, k2, l) = curl(l, e[0], e[1], e[2]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /*
+         * Evaluate A and, depending on `derivs`, its first and second
+         * derivatives. The layout of the outputs matches `biot_savart_kernel_A`.
+         */
+        template<int derivs, class T2, class T3, class T4>
+        void A(AlignedPaddedVec& pointsx, AlignedPaddedVec& pointsy, AlignedPaddedVec& pointsz, T2& A, T3& dA_by_dX, T4& d2A_by_dXdX) const {
+            int num_points = pointsx.size();
+            constexpr int nderivs = derivs;
+            const int nbeta = num_multi_indices(nderivs);
+#pragma omp parallel
+            {
+                vector<int> stack;
+                vector<double> R((max_order+1)*num_multi_indices(max_order), 0.);
+                vector<double> dA(3*nbeta, 0.);
+#pragma omp for schedule(dynamic, 64)
+                for (int i = 0; i < num_points; ++i) {
+                    std::fill(dA.begin(), dA.end(), 0.);
+                    if(!nodes.empty())
+                        accumulate(pointsx[i], pointsy[i], pointsz[i], nderivs, dA.data(), stack, R);
+                    for (int l = 0; l < 3; ++l) {
+                        A(i, l) = dA[l*nbeta + 0];
+                        if constexpr(derivs > 0) {
+                            for (int k = 0; k < 3; ++k) {
+                                int e[3] = {0, 0, 0};
+                                e[k] = 1;
+                                dA_by_dX(i, k, l) = dA[l*nbeta + idx(e[0], e[1], e[2])];
+                            }
+                        }
+                        if constexpr(derivs > 1) {
+                            for (int k1 = 0; k1 < 3; ++k1) {
+                                for (int k2 = 0; k2 < 3; ++k2) {
+                                    int e[3] = {0, 0, 0};
+                                    e[k1] += 1;
+                                    e[k2] += 1;
+                                    d2A_by_dXdX(i, k1, k2, l) = dA[l*nbeta + idx(e[0], e[1], e[2])];
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+};
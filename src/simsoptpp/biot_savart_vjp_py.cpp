@@ -1,7 +1,8 @@
 #include "biot_savart_vjp_impl.h"
 #include "biot_savart_vjp_py.h"
+#include "biot_savart_symmetry.h"
 
-void biot_savart_vjp(Array& points, vector<Array>& gammas, vector<Array>& dgamma_by_dphis, vector<double>& currents, Array& v, Array& vgrad, vector<Array>& dgamma_by_dcoeffs, vector<Array>& d2gamma_by_dphidcoeffs, vector<Array>& res_B, vector<Array>& res_dB){
+void biot_savart_vjp(Array& points, vector<shared_ptr<Curve<Array>>>& curves, vector<double>& currents, Array& v, Array& vgrad, vector<Array>& res_B, vector<Array>& res_dB){
     auto pointsx = AlignedPaddedVec(points.shape(0), 0);
     auto pointsy = AlignedPaddedVec(points.shape(0), 0);
     auto pointsz = AlignedPaddedVec(points.shape(0), 0);
@@ -11,55 +12,64 @@ void biot_savart_vjp(Array& points, vector<Array>& gammas, vector<Array>& dgamma
         pointsz[i] = points(i, 2);
     }
 
-    int num_coils  = gammas.size();
+    int num_coils  = curves.size();
+    bool compute_dB = res_dB.size() > 0;
 
-    auto res_gamma = std::vector<Array>(num_coils, Array());
-    auto res_dgamma_by_dphi = std::vector<Array>(num_coils, Array());
-    auto res_grad_gamma = std::vector<Array>(num_coils, Array());
-    auto res_grad_dgamma_by_dphi = std::vector<Array>(num_coils, Array());
+    // The curves may be implemented in python, so we evaluate them in serial.
+    // Everything that is touched inside the parallel region below is stored
+    // in xt::xarray, which (unlike the numpy backed Array) can safely be
+    // allocated from openmp threads.
+    using XArray = xt::xarray<double>;
+    auto gammas = vector<XArray>(num_coils);
+    auto dgamma_by_dphis = vector<XArray>(num_coils);
+    for (int i = 0; i < num_coils; ++i) {
+        gammas[i] = curves[i]->gamma();
+        dgamma_by_dphis[i] = curves[i]->gammadash();
+    }
+    XArray v_ = v;
+    XArray vgrad_ = compute_dB ? XArray(vgrad) : XArray();
+    XArray dummy = XArray();
 
-    bool compute_dB = res_dB.size() > 0;
-    // Don't understand why, but in parallel this loop segfaults...
+    auto res_gamma = vector<XArray>(num_coils);
+    auto res_dgamma_by_dphi = vector<XArray>(num_coils);
+    auto res_grad_gamma = vector<XArray>(num_coils);
+    auto res_grad_dgamma_by_dphi = vector<XArray>(num_coils);
+    #pragma omp parallel for schedule(dynamic, 1)
     for(int i=0; i<num_coils; i++) {
-        int num_points = gammas[i].shape(0);
-        res_gamma[i] = xt::zeros<double>({num_points, 3});
-        res_dgamma_by_dphi[i] = xt::zeros<double>({num_points, 3});
+        int num_quad_points = gammas[i].shape(0);
+        res_gamma[i] = xt::zeros<double>({num_quad_points, 3});
+        res_dgamma_by_dphi[i] = xt::zeros<double>({num_quad_points, 3});
         if(compute_dB) {
-            res_grad_gamma[i] = xt::zeros<double>({num_points, 3});
-            res_grad_dgamma_by_dphi[i] = xt::zeros<double>({num_points, 3});
+            res_grad_gamma[i] = xt::zeros<double>({num_quad_points, 3});
+            res_grad_dgamma_by_dphi[i] = xt::zeros<double>({num_quad_points, 3});
+            biot_savart_vjp_kernel<XArray, 1>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i],
+                    v_, res_gamma[i], res_dgamma_by_dphi[i],
+                    vgrad_, res_grad_gamma[i], res_grad_dgamma_by_dphi[i]);
+        } else {
+            biot_savart_vjp_kernel<XArray, 0>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i],
+                    v_, res_gamma[i], res_dgamma_by_dphi[i], dummy, dummy, dummy);
+        }
+        double fak = (currents[i] * 1e-7/num_quad_points);
+        res_gamma[i] *= fak;
+        res_dgamma_by_dphi[i] *= fak;
+        if(compute_dB) {
+            res_grad_gamma[i] *= fak;
+            res_grad_dgamma_by_dphi[i] *= fak;
         }
     }
-    Array dummy = Array();
 
-    #pragma omp parallel for
+    // Contract with the derivatives of gamma and gammadash with respect to the
+    // curve dofs. This goes through the vector Jacobian products of the
+    // curves, which avoid forming dgamma_by_dcoeff where possible.
     for(int i=0; i<num_coils; i++) {
-        if(compute_dB)
-            biot_savart_vjp_kernel<Array, 1>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i],
-                    v, res_gamma[i], res_dgamma_by_dphi[i],
-                    vgrad, res_grad_gamma[i], res_grad_dgamma_by_dphi[i]);
-        else
-            biot_savart_vjp_kernel<Array, 0>(pointsx, pointsy, pointsz, gammas[i], dgamma_by_dphis[i],
-                    v, res_gamma[i], res_dgamma_by_dphi[i], dummy, dummy, dummy);
-        int numcoeff = dgamma_by_dcoeffs[i].shape(2);
-        for (int j = 0; j < dgamma_by_dcoeffs[i].shape(0); ++j) {
-            for (int l = 0; l < 3; ++l) {
-                auto t1 = res_gamma[i](j, l);
-                auto t2 = res_dgamma_by_dphi[i](j, l);
-                for (int k = 0; k < numcoeff; ++k)
-                    res_B[i](k) += dgamma_by_dcoeffs[i](j, l, k) * t1 + d2gamma_by_dphidcoeffs[i](j, l, k) * t2;
-
-                if(compute_dB) {
-                    auto t3 = res_grad_gamma[i](j, l);
-                    auto t4 = res_grad_dgamma_by_dphi[i](j, l);
-                    for (int k = 0; k < numcoeff; ++k)
-                        res_dB[i](k) += dgamma_by_dcoeffs[i](j, l, k) * t3 + d2gamma_by_dphidcoeffs[i](j, l, k) * t4;
-                }
-            }
+        Array r_gamma = res_gamma[i];
+        Array r_dgamma_by_dphi = res_dgamma_by_dphi[i];
+        res_B[i] += curves[i]->dgamma_by_dcoeff_vjp_impl(r_gamma) + curves[i]->dgammadash_by_dcoeff_vjp_impl(r_dgamma_by_dphi);
+        if(compute_dB) {
+            Array r_grad_gamma = res_grad_gamma[i];
+            Array r_grad_dgamma_by_dphi = res_grad_dgamma_by_dphi[i];
+            res_dB[i] += curves[i]->dgamma_by_dcoeff_vjp_impl(r_grad_gamma) + curves[i]->dgammadash_by_dcoeff_vjp_impl(r_grad_dgamma_by_dphi);
         }
-        double fak = (currents[i] * 1e-7/gammas[i].shape(0));
-        res_B[i] *= fak;
-        if(compute_dB)
-            res_dB[i] *= fak;
     }
 }
 
@@ -132,3 +142,125 @@ void biot_savart_vector_potential_vjp_graph(Array& points, vector<Array>& gammas
         }
     }
 }
+
+// Computes the same quantities as biot_savart_vjp_graph (or
+// biot_savart_vector_potential_vjp_graph), but for a coil set in which coil i
+// is given by matrices[i] applied to the curve with index base_idx[i] (see
+// BiotSavart::set_symmetry). The derivatives are accumulated directly onto the
+// base curves, i.e. res_gamma etc. have one entry per base curve. Copies that
+// map the evaluation points onto themselves only add to the vectors v and
+// vgrad, so that the kernel is called once per base curve on the original
+// points; for all other copies the transformed points are appended.
+template<bool vector_potential>
+void biot_savart_vjp_graph_symmetric_impl(Array& points, vector<Array>& base_gammas, vector<Array>& base_dgamma_by_dphis, vector<int>& base_idx, vector<Array>& matrices, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi) {
+    int num_points = points.shape(0);
+    int num_coils = base_idx.size();
+    int num_base = base_gammas.size();
+    bool compute_grad = res_grad_gamma.size() > 0;
+    if(matrices.size() != num_coils || currents.size() != num_coils)
+        throw std::runtime_error("base_idx, matrices and currents need to have one entry per coil.");
+
+    vector<SymmetryMatrix> mats(num_coils);
+    vector<vector<int>> perms(num_coils);
+    for (int i = 0; i < num_coils; ++i) {
+        if(base_idx[i] < 0 || base_idx[i] >= num_base)
+            throw std::runtime_error("base_idx contains an invalid index.");
+        for (int j = 0; j < 3; ++j)
+            for (int k = 0; k < 3; ++k)
+                mats[i][3*j+k] = matrices[i](j, k);
+        perms[i] = symmetry_permutation(&(points(0, 0)), num_points, mats[i]);
+    }
+
+    // for each base curve, collect the points at which its kernel is
+    // evaluated and the (rotated and scaled) vectors at those points.
+    vector<int> num_base_points(num_base, num_points);
+    for (int i = 0; i < num_coils; ++i)
+        if(perms[i].size() == 0)
+            num_base_points[base_idx[i]] += num_points;
+    vector<Array> base_v(num_base), base_vgrad(num_base);
+    vector<AlignedPaddedVec> base_px(num_base), base_py(num_base), base_pz(num_base);
+    for (int b = 0; b < num_base; ++b) {
+        int n = num_base_points[b];
+        base_v[b] = xt::zeros<double>({n, 3});
+        base_vgrad[b] = compute_grad ? xt::zeros<double>({n, 3, 3}) : xt::zeros<double>({1, 3, 3});
+        base_px[b] = AlignedPaddedVec(n, 0.);
+        base_py[b] = AlignedPaddedVec(n, 0.);
+        base_pz[b] = AlignedPaddedVec(n, 0.);
+        for (int j = 0; j < num_points; ++j) {
+            base_px[b][j] = points(j, 0);
+            base_py[b][j] = points(j, 1);
+            base_pz[b][j] = points(j, 2);
+        }
+    }
+    vector<int> offset(num_base, num_points);
+    for (int i = 0; i < num_coils; ++i) {
+        int b = base_idx[i];
+        const SymmetryMatrix& M = mats[i];
+        // the magnetic field is a pseudovector, the vector potential is not
+        double s = currents[i] * (vector_potential ? 1. : symmetry_det(M));
+        double tmp[9];
+        for (int j = 0; j < num_points; ++j) {
+            int k;
+            if(perms[i].size() > 0) {
+                k = perms[i][j];
+            } else {
+                k = offset[b]++;
+                double y[3];
+                symmetry_apply_transpose(M, &(points(j, 0)), y);
+                base_px[b][k] = y[0];
+                base_py[b][k] = y[1];
+                base_pz[b][k] = y[2];
+            }
+            symmetry_rotate_vector_transpose(M, s, &(v(j, 0)), tmp);
+            for (int l = 0; l < 3; ++l)
+                base_v[b](k, l) += tmp[l];
+            if(compute_grad) {
+                symmetry_rotate_rank2_transpose(M, s, &(vgrad(j, 0, 0)), tmp);
+                for (int l = 0; l < 3; ++l)
+                    for (int m = 0; m < 3; ++m)
+                        base_vgrad[b](k, l, m) += tmp[3*l+m];
+            }
+        }
+    }
+
+    Array dummy = Array();
+    #pragma omp parallel for
+    for(int b=0; b<num_base; b++) {
+        MYIF(vector_potential) {
+            if(compute_grad)
+                biot_savart_vector_potential_vjp_kernel<Array, 1>(base_px[b], base_py[b], base_pz[b], base_gammas[b], base_dgamma_by_dphis[b],
+                        base_v[b], res_gamma[b], res_dgamma_by_dphi[b],
+                        base_vgrad[b], res_grad_gamma[b], res_grad_dgamma_by_dphi[b]);
+            else
+                biot_savart_vector_potential_vjp_kernel<Array, 0>(base_px[b], base_py[b], base_pz[b], base_gammas[b], base_dgamma_by_dphis[b],
+                        base_v[b], res_gamma[b], res_dgamma_by_dphi[b],
+                        dummy, dummy, dummy);
+        } else {
+            if(compute_grad)
+                biot_savart_vjp_kernel<Array, 1>(base_px[b], base_py[b], base_pz[b], base_gammas[b], base_dgamma_by_dphis[b],
+                        base_v[b], res_gamma[b], res_dgamma_by_dphi[b],
+                        base_vgrad[b], res_grad_gamma[b], res_grad_dgamma_by_dphi[b]);
+            else
+                biot_savart_vjp_kernel<Array, 0>(base_px[b], base_py[b], base_pz[b], base_gammas[b], base_dgamma_by_dphis[b],
+                        base_v[b], res_gamma[b], res_dgamma_by_dphi[b],
+                        dummy, dummy, dummy);
+        }
+
+        // the currents are already contained in base_v and base_vgrad
+        double fak = (1e-7/base_gammas[b].shape(0));
+        res_gamma[b] *= fak;
+        res_dgamma_by_dphi[b] *= fak;
+        if(compute_grad) {
+            res_grad_gamma[b] *= fak;
+            res_grad_dgamma_by_dphi[b] *= fak;
+        }
+    }
+}
+
+void biot_savart_vjp_graph_symmetric(Array& points, vector<Array>& base_gammas, vector<Array>& base_dgamma_by_dphis, vector<int>& base_idx, vector<Array>& matrices, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi) {
+    biot_savart_vjp_graph_symmetric_impl<false>(points, base_gammas, base_dgamma_by_dphis, base_idx, matrices, currents, v, res_gamma, res_dgamma_by_dphi, vgrad, res_grad_gamma, res_grad_dgamma_by_dphi);
+}
+
+void biot_savart_vector_potential_vjp_graph_symmetric(Array& points, vector<Array>& base_gammas, vector<Array>& base_dgamma_by_dphis, vector<int>& base_idx, vector<Array>& matrices, vector<double>& currents, Array& v, vector<Array>& res_gamma, vector<Array>& res_dgamma_by_dphi, Array& vgrad, vector<Array>& res_grad_gamma, vector<Array>& res_grad_dgamma_by_dphi) {
+    biot_savart_vjp_graph_symmetric_impl<true>(points, base_gammas, base_dgamma_by_dphis, base_idx, matrices, currents, v, res_gamma, res_dgamma_by_dphi, vgrad, res_grad_gamma, res_grad_dgamma_by_dphi);
+}
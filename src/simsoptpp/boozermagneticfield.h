@@ -16,6 +16,19 @@ using std::vector;
 using std::shared_ptr;
 using std::make_shared;
 
+// Columns of BoozerMagneticField::gc_quantities, i.e. all quantities needed
+// by the guiding center equations in Boozer coordinates. The vacuum equations
+// only need the first GC_SIZE_VACUUM columns, the equations without K the
+// first GC_SIZE_NOK columns.
+enum BoozerGCQuantity {
+    GC_MODB, GC_DMODBDS, GC_DMODBDTHETA, GC_DMODBDZETA, GC_G, GC_IOTA,
+    GC_I, GC_DGDS, GC_DIDS,
+    GC_K, GC_DKDTHETA, GC_DKDZETA,
+    GC_SIZE,
+    GC_SIZE_VACUUM = GC_I,
+    GC_SIZE_NOK = GC_K
+};
+
 template<template<class, std::size_t, xt::layout_type> class T>
 class BoozerMagneticField {
     public:
@@ -61,6 +74,32 @@ class BoozerMagneticField {
         virtual void _psip_impl(Tensor2& psip) { throw logic_error("_psip_impl was not implemented"); }
         virtual void _iota_impl(Tensor2& iota) { throw logic_error("_iota_impl was not implemented"); }
         virtual void _diotads_impl(Tensor2& diotads) { throw logic_error("_diotads_impl was not implemented"); }
+        // by default the guiding center quantities are gathered from the individual quantities
+        virtual void _gc_quantities_impl(Tensor2& gc) {
+            Tensor2& modB = modB_ref();
+            Tensor2& modB_derivs = modB_derivs_ref();
+            Tensor2& G = G_ref();
+            Tensor2& iota = iota_ref();
+            Tensor2& I = I_ref();
+            Tensor2& dGds = dGds_ref();
+            Tensor2& dIds = dIds_ref();
+            Tensor2& K = K_ref();
+            Tensor2& K_derivs = K_derivs_ref();
+            for (int i = 0; i < npoints; ++i) {
+                gc(i, GC_MODB) = modB(i, 0);
+                gc(i, GC_DMODBDS) = modB_derivs(i, 0);
+                gc(i, GC_DMODBDTHETA) = modB_derivs(i, 1);
+                gc(i, GC_DMODBDZETA) = modB_derivs(i, 2);
+                gc(i, GC_G) = G(i, 0);
+                gc(i, GC_IOTA) = iota(i, 0);
+                gc(i, GC_I) = I(i, 0);
+                gc(i, GC_DGDS) = dGds(i, 0);
+                gc(i, GC_DIDS) = dIds(i, 0);
+                gc(i, GC_K) = K(i, 0);
+                gc(i, GC_DKDTHETA) = K_derivs(i, 0);
+                gc(i, GC_DKDZETA) = K_derivs(i, 1);
+            }
+        }
         virtual void _set_points() { }
 
         CachedTensor<T, 2> points;
@@ -69,7 +108,8 @@ class BoozerMagneticField {
           data_I, data_dIds, data_R, data_Z, data_nu, data_K, data_dRdtheta, data_dRdzeta, \
           data_dRds, data_R_derivs, data_dZdtheta, data_dZdzeta, data_dZds, data_Z_derivs, \
           data_dnudtheta, data_dnudzeta, data_dnuds, data_nu_derivs, data_dKdtheta, \
-          data_dKdzeta, data_K_derivs, data_d2modBdtheta2, data_d2modBdzeta2, data_d2modBdthetadzeta;
+          data_dKdzeta, data_K_derivs, data_d2modBdtheta2, data_d2modBdzeta2, data_d2modBdthetadzeta, \
+          data_gc_quantities;
         int npoints;
 
     public:
@@ -113,8 +153,13 @@ class BoozerMagneticField {
             data_dGds.invalidate_cache();
             data_dIds.invalidate_cache();
             data_diotads.invalidate_cache();
+            data_gc_quantities.invalidate_cache();
         }
 
+        // whether gc_quantities is computed in a single evaluation rather
+        // than gathered from the individual quantities (see InterpolatedBoozerField)
+        virtual bool fused_gc_quantities() { return false; }
+
         BoozerMagneticField& set_points(Tensor2& p) {
             this->invalidate_cache();
             this->points.invalidate_cache();
@@ -269,6 +314,12 @@ class BoozerMagneticField {
             return data_diotads.get_or_create_and_fill({npoints, 1}, [this](Tensor2& diotads) { return _diotads_impl(diotads);});
         }
 
+        // (npoints, GC_SIZE) array with the quantities needed by the guiding
+        // center equations, the columns are given by BoozerGCQuantity
+        Tensor2& gc_quantities_ref() {
+            return data_gc_quantities.get_or_create_and_fill({npoints, GC_SIZE}, [this](Tensor2& gc) { return _gc_quantities_impl(gc);});
+        }
+
         Tensor2 K() { return K_ref(); }
         Tensor2 dKdtheta() { return dKdtheta_ref(); }
         Tensor2 dKdzeta() { return dKdzeta_ref(); }
@@ -303,5 +354,6 @@ class BoozerMagneticField {
         Tensor2 dGds() { return dGds_ref(); }
         Tensor2 dIds() { return dIds_ref(); }
         Tensor2 diotads() { return diotads_ref(); }
+        Tensor2 gc_quantities() { return gc_quantities_ref(); }
 
 };
@@ -18,7 +18,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
           interp_dZdtheta, interp_dZdzeta, interp_dZds, interp_dnudtheta, \
           interp_dnudzeta, interp_dnuds, interp_dKdtheta, interp_dKdzeta, interp_K_derivs, \
           interp_nu_derivs, interp_R_derivs, interp_Z_derivs, interp_modB_derivs, \
-          interp_d2modBdtheta2, interp_d2modBdzeta2, interp_d2modBdthetadzeta;
+          interp_d2modBdtheta2, interp_d2modBdzeta2, interp_d2modBdthetadzeta, interp_gc_quantities;
         bool status_modB = false, status_dmodBdtheta = false, status_dmodBdzeta = false, \
           status_dmodBds = false, status_G = false, status_I = false, status_iota = false,
           status_dGds = false, status_dIds = false, status_diotads = false, status_psip = false,
@@ -29,24 +29,73 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
           status_dKdtheta = false, status_dKdzeta = false, status_K_derivs = false, \
           status_R_derivs = false, status_Z_derivs = false, status_nu_derivs = false, \
           status_modB_derivs = false, status_d2modBdtheta2 = false, status_d2modBdthetadzeta = false, \
-          status_d2modBdzeta2 = false;
+          status_d2modBdzeta2 = false, status_gc_quantities = false;
         const bool extrapolate;
+        // whether to fill the cells of the interpolants on demand, see RegularGridInterpolant3D::interpolate_lazy
+        const bool lazy = false;
+        std::mutex field_mutex;
+        // whether to interpolate all quantities needed by the guiding center
+        // equations with a single interpolant, see _gc_quantities_impl
+        const bool fused = false;
         const bool stellsym = false;
         const int nfp = 1;
         vector<bool> symmetries = vector<bool>(1, false);
 
+        struct InterpolantEntry {
+            string name;
+            shared_ptr<RegularGridInterpolant3D<Tensor2>>& interp;
+            bool& status;
+            bool fluxfunction; // flux functions only depend on s and use angle0_range for theta and zeta
+            int value_size;
+        };
+
+        // all interpolants of this field, used to save and load them
+        vector<InterpolantEntry> interpolant_entries() {
+            return {
+              {"modB", interp_modB, status_modB, false, 1},
+              {"dmodBdtheta", interp_dmodBdtheta, status_dmodBdtheta, false, 1},
+              {"dmodBdzeta", interp_dmodBdzeta, status_dmodBdzeta, false, 1},
+              {"dmodBds", interp_dmodBds, status_dmodBds, false, 1},
+              {"G", interp_G, status_G, true, 1},
+              {"iota", interp_iota, status_iota, true, 1},
+              {"dGds", interp_dGds, status_dGds, true, 1},
+              {"I", interp_I, status_I, true, 1},
+              {"dIds", interp_dIds, status_dIds, true, 1},
+              {"diotads", interp_diotads, status_diotads, true, 1},
+              {"psip", interp_psip, status_psip, true, 1},
+              {"R", interp_R, status_R, false, 1},
+              {"Z", interp_Z, status_Z, false, 1},
+              {"nu", interp_nu, status_nu, false, 1},
+              {"K", interp_K, status_K, false, 1},
+              {"dRdtheta", interp_dRdtheta, status_dRdtheta, false, 1},
+              {"dRdzeta", interp_dRdzeta, status_dRdzeta, false, 1},
+              {"dRds", interp_dRds, status_dRds, false, 1},
+              {"dZdtheta", interp_dZdtheta, status_dZdtheta, false, 1},
+              {"dZdzeta", interp_dZdzeta, status_dZdzeta, false, 1},
+              {"dZds", interp_dZds, status_dZds, false, 1},
+              {"dnudtheta", interp_dnudtheta, status_dnudtheta, false, 1},
+              {"dnudzeta", interp_dnudzeta, status_dnudzeta, false, 1},
+              {"dnuds", interp_dnuds, status_dnuds, false, 1},
+              {"dKdtheta", interp_dKdtheta, status_dKdtheta, false, 1},
+              {"dKdzeta", interp_dKdzeta, status_dKdzeta, false, 1},
+              {"K_derivs", interp_K_derivs, status_K_derivs, false, 2},
+              {"nu_derivs", interp_nu_derivs, status_nu_derivs, false, 3},
+              {"R_derivs", interp_R_derivs, status_R_derivs, false, 3},
+              {"Z_derivs", interp_Z_derivs, status_Z_derivs, false, 3},
+              {"modB_derivs", interp_modB_derivs, status_modB_derivs, false, 3},
+              {"d2modBdtheta2", interp_d2modBdtheta2, status_d2modBdtheta2, false, 1},
+              {"d2modBdzeta2", interp_d2modBdzeta2, status_d2modBdzeta2, false, 1},
+              {"d2modBdthetadzeta", interp_d2modBdthetadzeta, status_d2modBdthetadzeta, false, 1},
+              {"gc_quantities", interp_gc_quantities, status_gc_quantities, false, GC_SIZE}
+            };
+        }
+
     protected:
       void _psip_impl(Tensor2& psip) override {
           if(!interp_psip)
               interp_psip = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
           if(!status_psip) {
-              Tensor2 old_points = this->field->get_points();
-              string which_scalar = "psip";
-              std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                return fbatch_scalar(s,theta,zeta,which_scalar);
-              };
-              interp_psip->interpolate_batch(fbatch);
-              this->field->set_points(old_points);
+              build_interpolant(*interp_psip, "psip");
               status_psip = true;
           }
           Tensor2& stz = this->get_points_ref();
@@ -59,13 +108,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_G)
                 interp_G = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
             if(!status_G) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "G";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_G->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_G, "G");
                 status_G = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -78,13 +121,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_I)
                 interp_I = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
             if(!status_I) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "I";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_I->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_I, "I");
                 status_I = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -97,13 +134,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_iota)
                 interp_iota = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
             if(!status_iota) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "iota";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_iota->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_iota, "iota");
                 status_iota = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -116,13 +147,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dGds)
                 interp_dGds = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
             if(!status_dGds) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dGds";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dGds->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dGds, "dGds");
                 status_dGds = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -135,13 +160,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dIds)
                 interp_dIds = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
             if(!status_dIds) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dIds";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dIds->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dIds, "dIds");
                 status_dIds = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -154,13 +173,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_diotads)
                 interp_diotads = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
             if(!status_diotads) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "diotads";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_diotads->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_diotads, "diotads");
                 status_diotads = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -173,13 +186,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_K)
                 interp_K = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_K) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "K";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_K->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_K, "K");
                 status_K = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -195,13 +202,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dKdtheta)
                 interp_dKdtheta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dKdtheta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dKdtheta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dKdtheta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dKdtheta, "dKdtheta");
                 status_dKdtheta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -214,13 +215,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dKdzeta)
                 interp_dKdzeta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dKdzeta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dKdzeta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dKdzeta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dKdzeta, "dKdzeta");
                 status_dKdzeta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -233,13 +228,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_K_derivs)
                 interp_K_derivs = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 2, extrapolate);
             if(!status_K_derivs) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "K_derivs";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_K_derivs->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_K_derivs, "K_derivs");
                 status_K_derivs = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -252,13 +241,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_nu)
                 interp_nu = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_nu) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "nu";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_nu->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_nu, "nu");
                 status_nu = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -274,13 +257,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dnudtheta)
                 interp_dnudtheta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dnudtheta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dnudtheta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dnudtheta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dnudtheta, "dnudtheta");
                 status_dnudtheta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -293,13 +270,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dnudzeta)
                 interp_dnudzeta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dnudzeta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dnudzeta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dnudzeta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dnudzeta, "dnudzeta");
                 status_dnudzeta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -312,13 +283,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dnuds)
                 interp_dnuds = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dnuds) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dnuds";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dnuds->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dnuds, "dnuds");
                 status_dnuds = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -334,13 +299,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_nu_derivs)
                 interp_nu_derivs = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 3, extrapolate);
             if(!status_nu_derivs) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "nu_derivs";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_nu_derivs->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_nu_derivs, "nu_derivs");
                 status_nu_derivs = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -356,13 +315,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_R)
                 interp_R = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_R) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "R";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_R->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_R, "R");
                 status_R = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -375,13 +328,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dRdtheta)
                 interp_dRdtheta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dRdtheta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dRdtheta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dRdtheta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dRdtheta, "dRdtheta");
                 status_dRdtheta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -397,13 +344,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dRdzeta)
                 interp_dRdzeta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dRdzeta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dRdzeta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dRdzeta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dRdzeta, "dRdzeta");
                 status_dRdzeta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -419,13 +360,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dRds)
                 interp_dRds = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dRds) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dRds";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dRds->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dRds, "dRds");
                 status_dRds = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -438,13 +373,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_R_derivs)
                 interp_R_derivs = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 3, extrapolate);
             if(!status_R_derivs) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "R_derivs";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_R_derivs->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_R_derivs, "R_derivs");
                 status_R_derivs = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -460,13 +389,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_Z)
                 interp_Z = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_Z) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "Z";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_Z->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_Z, "Z");
                 status_Z = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -482,13 +405,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dZdtheta)
                 interp_dZdtheta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dZdtheta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dZdtheta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dZdtheta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dZdtheta, "dZdtheta");
                 status_dZdtheta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -501,13 +418,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dZdzeta)
                 interp_dZdzeta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dZdzeta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dZdzeta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dZdzeta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dZdzeta, "dZdzeta");
                 status_dZdzeta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -520,13 +431,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dZds)
                 interp_dZds = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dZds) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dZds";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dZds->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dZds, "dZds");
                 status_dZds = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -542,13 +447,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_Z_derivs)
                 interp_Z_derivs = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 3, extrapolate);
             if(!status_Z_derivs) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "Z_derivs";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_Z_derivs->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_Z_derivs, "Z_derivs");
                 status_Z_derivs = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -564,13 +463,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_modB)
                 interp_modB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_modB) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "modB";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_modB->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_modB, "modB");
                 status_modB = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -583,13 +476,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dmodBdtheta)
                 interp_dmodBdtheta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dmodBdtheta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dmodBdtheta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dmodBdtheta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dmodBdtheta, "dmodBdtheta");
                 status_dmodBdtheta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -605,13 +492,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dmodBdzeta)
                 interp_dmodBdzeta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dmodBdzeta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dmodBdzeta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dmodBdzeta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dmodBdzeta, "dmodBdzeta");
                 status_dmodBdzeta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -627,13 +508,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_dmodBds)
                 interp_dmodBds = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_dmodBds) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "dmodBds";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_dmodBds->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_dmodBds, "dmodBds");
                 status_dmodBds = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -646,13 +521,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_modB_derivs)
                 interp_modB_derivs = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 3, extrapolate);
             if(!status_modB_derivs) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "modB_derivs";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_modB_derivs->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_modB_derivs, "modB_derivs");
                 status_modB_derivs = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -668,13 +537,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_d2modBdtheta2)
                 interp_d2modBdtheta2 = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_d2modBdtheta2) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "d2modBdtheta2";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_d2modBdtheta2->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_d2modBdtheta2, "d2modBdtheta2");
                 status_d2modBdtheta2 = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -687,13 +550,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_d2modBdthetadzeta)
                 interp_d2modBdthetadzeta = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_d2modBdthetadzeta) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "d2modBdthetadzeta";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_d2modBdthetadzeta->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_d2modBdthetadzeta, "d2modBdthetadzeta");
                 status_d2modBdthetadzeta = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -706,13 +563,7 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             if(!interp_d2modBdzeta2)
                 interp_d2modBdzeta2 = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
             if(!status_d2modBdzeta2) {
-                Tensor2 old_points = this->field->get_points();
-                string which_scalar = "d2modBdzeta2";
-                std::function<Vec(Vec, Vec, Vec)> fbatch = [this,which_scalar](Vec s, Vec theta, Vec zeta) {
-                  return fbatch_scalar(s,theta,zeta,which_scalar);
-                };
-                interp_d2modBdzeta2->interpolate_batch(fbatch);
-                this->field->set_points(old_points);
+                build_interpolant(*interp_d2modBdzeta2, "d2modBdzeta2");
                 status_d2modBdzeta2 = true;
             }
             Tensor2& stz = this->get_points_ref();
@@ -721,6 +572,39 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
             interp_d2modBdzeta2->evaluate_batch(stz_sym, d2modBdzeta2);
         }
 
+        // All guiding center quantities are stored in one interpolant with
+        // value_size GC_SIZE, so that they are obtained with a single lookup
+        // per point instead of one per quantity. The flux functions are
+        // constant in theta and zeta and hence interpolated exactly in those
+        // directions.
+        void _gc_quantities_impl(Tensor2& gc) override {
+            if(!fused) {
+                BoozerMagneticField<T>::_gc_quantities_impl(gc);
+                return;
+            }
+            if(!interp_gc_quantities)
+                interp_gc_quantities = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, GC_SIZE, extrapolate);
+            if(!status_gc_quantities) {
+                build_interpolant(*interp_gc_quantities, "gc_quantities");
+                status_gc_quantities = true;
+            }
+            Tensor2& stz = this->get_points_ref();
+            Tensor2& stz_sym = points_cyl_sym.get_or_create({npoints, 3});
+            exploit_symmetries_points(stz, stz_sym);
+            interp_gc_quantities->evaluate_batch(stz_sym, gc);
+            if (stellsym) {
+                // modB, its s derivative and the derivatives of K are even,
+                // the angular derivatives of modB and K itself are odd
+                for (int i = 0; i < npoints; ++i) {
+                    if(symmetries[i]) {
+                        gc(i, GC_DMODBDTHETA) = -gc(i, GC_DMODBDTHETA);
+                        gc(i, GC_DMODBDZETA) = -gc(i, GC_DMODBDZETA);
+                        gc(i, GC_K) = -gc(i, GC_K);
+                    }
+                }
+            }
+        }
+
         void exploit_fluxfunction_points(Tensor2& stz, Tensor2& stz0){
             int npoints = stz.shape(0);
             double* dataptr = &(stz(0, 0));
@@ -891,12 +775,37 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
               scalar = this->field->dIds();
             } else if (which_scalar == "diotads") {
               scalar = this->field->diotads();
+            } else if (which_scalar == "gc_quantities") {
+              scalar = this->field->gc_quantities();
+              npoints = GC_SIZE*npoints;
             } else {
               throw std::runtime_error("Incorrect value for which_scalar.");
             }
             return Vec(scalar.data(), scalar.data()+npoints);
         }
 
+        // fbatch_scalar for the interpolants. The points of the underlying
+        // field are restored afterwards, and the underlying field is only
+        // evaluated from one thread at a time, since lazy interpolants may be
+        // filled concurrently.
+        std::function<Vec(Vec, Vec, Vec)> interpolated_function(string which_scalar) {
+            return [this,which_scalar](Vec s, Vec theta, Vec zeta) {
+                std::lock_guard<std::mutex> lock(field_mutex);
+                Tensor2 old_points = this->field->get_points();
+                Vec res = fbatch_scalar(s,theta,zeta,which_scalar);
+                this->field->set_points(old_points);
+                return res;
+            };
+        }
+
+        void build_interpolant(RegularGridInterpolant3D<Tensor2>& interp, string which_scalar) {
+            std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function(which_scalar);
+            if(lazy)
+                interp.interpolate_lazy(fbatch);
+            else
+                interp.interpolate_batch(fbatch);
+        }
+
     public:
         const shared_ptr<BoozerMagneticField<T>> field;
         const RangeTriplet s_range, theta_range, zeta_range, angle0_range = {0., M_PI, 1};
@@ -906,28 +815,58 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
         InterpolatedBoozerField(
                 shared_ptr<BoozerMagneticField<T>> field, InterpolationRule rule,
                 RangeTriplet s_range, RangeTriplet theta_range, RangeTriplet zeta_range,
-                bool extrapolate, int nfp, bool stellsym) :
-            BoozerMagneticField<T>(field->psi0), field(field), rule(rule), s_range(s_range), theta_range(theta_range), zeta_range(zeta_range), extrapolate(extrapolate), nfp(nfp), stellsym(stellsym)
+                bool extrapolate, int nfp, bool stellsym, bool lazy=false, bool fused=false) :
+            BoozerMagneticField<T>(field->psi0), field(field), rule(rule), s_range(s_range), theta_range(theta_range), zeta_range(zeta_range), extrapolate(extrapolate), lazy(lazy), fused(fused), nfp(nfp), stellsym(stellsym)
         {}
 
         InterpolatedBoozerField(
                 shared_ptr<BoozerMagneticField<T>> field, int degree,
                 RangeTriplet s_range, RangeTriplet theta_range, RangeTriplet zeta_range,
-                bool extrapolate, int nfp, bool stellsym) : InterpolatedBoozerField(field, UniformInterpolationRule(degree), s_range, theta_range, zeta_range, extrapolate, nfp, stellsym) {}
+                bool extrapolate, int nfp, bool stellsym, bool lazy=false, bool fused=false) : InterpolatedBoozerField(field, UniformInterpolationRule(degree), s_range, theta_range, zeta_range, extrapolate, nfp, stellsym, lazy, fused) {}
+
+        bool fused_gc_quantities() override { return fused; }
+
+        // number of cells of all interpolants built so far whose
+        // values have been computed, and their total number of cells.
+        // In lazy mode, the former only counts the cells visited so far.
+        uint64_t cells_filled() {
+            uint64_t res = 0;
+            for (auto& entry : interpolant_entries()) {
+                if(entry.status)
+                    res += entry.interp->cells_filled();
+            }
+            return res;
+        }
+
+        uint64_t cells_total() {
+            uint64_t res = 0;
+            for (auto& entry : interpolant_entries()) {
+                if(entry.status)
+                    res += entry.interp->cells_total();
+            }
+            return res;
+        }
+
+        // number of interpolation nodes at which the function values are
+        // kept in memory, see RegularGridInterpolant3D::dofs_stored
+        uint64_t dofs_stored() {
+            uint64_t res = 0;
+            for (auto& entry : interpolant_entries()) {
+                if(entry.status)
+                    res += entry.interp->dofs_stored();
+            }
+            return res;
+        }
 
                 std::pair<double, double> estimate_error_modB(int samples) {
                     if(!interp_modB) {
                       interp_modB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"modB");
-                    };
                     if(!status_modB) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_modB->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_modB, "modB");
                         status_modB = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("modB");
                     return interp_modB->estimate_error(fbatch, samples);
                 }
 
@@ -935,15 +874,11 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_K) {
                       interp_K = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"K");
-                    };
                     if(!status_K) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_K->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_K, "K");
                         status_K = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("K");
                     return interp_K->estimate_error(fbatch, samples);
                 }
 
@@ -951,15 +886,11 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_R) {
                       interp_R = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"R");
-                    };
                     if(!status_R) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_R->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_R, "R");
                         status_R = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("R");
                     return interp_R->estimate_error(fbatch, samples);
                 }
 
@@ -967,15 +898,11 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_Z) {
                       interp_Z = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"Z");
-                    };
                     if(!status_Z) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_Z->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_Z, "Z");
                         status_Z = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("Z");
                     return interp_Z->estimate_error(fbatch, samples);
                 }
 
@@ -983,15 +910,11 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_nu) {
                       interp_nu = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"nu");
-                    };
                     if(!status_nu) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_nu->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_nu, "nu");
                         status_nu = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("nu");
                     return interp_nu->estimate_error(fbatch, samples);
                 }
 
@@ -999,15 +922,11 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_G) {
                       interp_G = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"G");
-                    };
                     if(!status_G) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_G->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_G, "G");
                         status_G = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("G");
                     return interp_G->estimate_error(fbatch, samples);
                 }
 
@@ -1015,15 +934,11 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_I) {
                       interp_I = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"I");
-                    };
                     if(!status_I) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_I->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_I, "I");
                         status_I = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("I");
                     return interp_I->estimate_error(fbatch, samples);
                 }
 
@@ -1031,15 +946,44 @@ class InterpolatedBoozerField : public BoozerMagneticField<T> {
                     if(!interp_iota) {
                       interp_iota = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, 1, extrapolate);
                     }
-                    std::function<Vec(Vec, Vec, Vec)> fbatch = [this](Vec s, Vec theta, Vec zeta) {
-                      return fbatch_scalar(s,theta,zeta,"iota");
-                    };
                     if(!status_iota) {
-                        Tensor2 old_points = this->field->get_points();
-                        interp_iota->interpolate_batch(fbatch);
-                        this->field->set_points(old_points);
+                        build_interpolant(*interp_iota, "iota");
                         status_iota = true;
                     }
+                    std::function<Vec(Vec, Vec, Vec)> fbatch = interpolated_function("iota");
                     return interp_iota->estimate_error(fbatch, samples);
                 }
+
+                // Save all interpolants that have been built so far to a
+                // single file, so that they can be loaded again later without
+                // having to evaluate the underlying field. `dof_hash` should
+                // identify the underlying field.
+                void save_interpolants(const std::string& filename, uint64_t dof_hash) {
+                    vector<std::pair<string, shared_ptr<RegularGridInterpolant3D<Tensor2>>>> interpolants;
+                    for (auto& entry : interpolant_entries()) {
+                        if(entry.status)
+                            interpolants.push_back({entry.name, entry.interp});
+                    }
+                    RegularGridInterpolant3D<Tensor2>::save_archive(filename, interpolants, dof_hash);
+                }
+
+                // Load the interpolants written by save_interpolants. The
+                // field has to be constructed with the same rule and ranges,
+                // and `dof_hash` has to match the value used when saving.
+                void load_interpolants(const std::string& filename, uint64_t dof_hash, bool mmap) {
+                    auto entries = interpolant_entries();
+                    for (auto& stored : RegularGridInterpolant3D<Tensor2>::read_archive(filename)) {
+                        for (auto& entry : entries) {
+                            if(entry.name != stored.first)
+                                continue;
+                            if(entry.fluxfunction)
+                                entry.interp = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, angle0_range, angle0_range, entry.value_size, extrapolate);
+                            else
+                                entry.interp = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, s_range, theta_range, zeta_range, entry.value_size, extrapolate);
+                            entry.interp->load_cell_values(filename, mmap, dof_hash, stored.second);
+                            entry.status = true;
+                        }
+                    }
+                    this->invalidate_cache();
+                }
 };
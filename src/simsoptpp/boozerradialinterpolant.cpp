@@ -3,137 +3,192 @@
 #include "xtensor-python/pyarray.hpp"
 typedef xt::pyarray<double> Array;
 #include <xtensor/xview.hpp>
+#include "simdhelpers.h"
 
-Array compute_kmnc_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds,
-    Array& numns, Array& dnumnsds, Array& bmnc,
-    Array& rmns, Array& drmnsds, Array& zmnc, Array& dzmncds,
-    Array& numnc, Array& dnumncds, Array& bmns,
+// The Fourier sums below are evaluated for simd_size points at a time. For
+// consecutive modes with the same m whose n differ by the same step dn (as in
+// the output of booz_xform), cos and sin of the angle are updated with the
+// angle-addition formulas instead of being evaluated again.
+#if defined(USE_XSIMD)
+using vec_t = simd_t;
+constexpr int vec_size = simd_t::size;
+inline vec_t load_vec(const double* p) { return xs::load_aligned(p); }
+inline void store_vec(double* p, const vec_t& x) { x.store_aligned(p); }
+inline void sincos_vec(const vec_t& x, vec_t& s, vec_t& c) { xsimd::sincos(x, s, c); }
+#else
+using vec_t = double;
+constexpr int vec_size = 1;
+inline vec_t load_vec(const double* p) { return *p; }
+inline void store_vec(double* p, const vec_t& x) { *p = x; }
+inline void sincos_vec(const vec_t& x, vec_t& s, vec_t& c) { s = std::sin(x); c = std::cos(x); }
+#endif
+
+// recompute the angle from scratch every so often, to avoid accumulating
+// floating point error
+#define ANGLE_RECOMPUTE 5
+
+// Computes the cos (kmnc_kmns(0)) and sin (kmnc_kmns(1)) coefficients of K.
+// nonsym holds rmns, drmnsds, zmnc, dzmncds, numnc, dnumncds, bmns, or is
+// nullptr for stellarator symmetric fields.
+static Array compute_kmnc_kmns_impl(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds,
+    Array& numns, Array& dnumnsds, Array& bmnc, Array** nonsym,
     Array& iota, Array& G, Array& I, Array& xm, Array& xn, Array& thetas, Array& zetas) {
 
     int num_modes = rmnc.shape(0);
     int num_surf = rmnc.shape(1);
     int num_points = thetas.shape(0);
+    bool stellsym = (nonsym == nullptr);
 
     Array kmnc_kmns = xt::zeros<double>({2,num_modes,num_surf});
 
+    // modes whose angle follows from the previous one by the recurrence
+    double dn = 0.;
+    for (int im=1; im < num_modes; ++im) {
+      if (xm(im) == xm(im-1)) {
+        dn = xn(im) - xn(im-1);
+        break;
+      }
+    }
+    vector<bool> recurrence(num_modes, false);
+    int since_recompute = 0;
+    for (int im=1; im < num_modes; ++im) {
+      if (xm(im) == xm(im-1) && xn(im) - xn(im-1) == dn && since_recompute < ANGLE_RECOMPUTE - 1) {
+        recurrence[im] = true;
+        since_recompute++;
+      } else {
+        since_recompute = 0;
+      }
+    }
+
+    // pad the points to a multiple of vec_size, the extra points get K = 0
+    int num_padded = ((num_points + vec_size - 1) / vec_size) * vec_size;
+    AlignedPaddedVec thetas_p(num_padded, 0.), zetas_p(num_padded, 0.), mask(num_padded, 0.);
+    for (int ip=0; ip < num_points; ++ip) {
+      thetas_p[ip] = thetas(ip);
+      zetas_p[ip] = zetas(ip);
+      mask[ip] = 1.;
+    }
+
     // Outer iteration over surface
     #pragma omp parallel for
     for (int isurf=0; isurf < num_surf; ++isurf) {
-      for (int ip=0; ip < num_points; ++ip) {
-        double B = 0.;
-        double R = 0.;
-        double dRdtheta = 0.;
-        double dRdzeta = 0.;
-        double dRds = 0.;
-        double dZdtheta = 0.;
-        double dZdzeta = 0.;
-        double dZds = 0.;
-        double nu = 0.;
-        double dnuds = 0.;
-        double dnudtheta = 0.;
-        double dnudzeta = 0.;
+      vector<vec_t> cosines(num_modes), sines(num_modes);
+      vector<vec_t> kmnc(num_modes, vec_t(0.)), kmns(num_modes, vec_t(0.));
+      for (int ip=0; ip < num_padded; ip += vec_size) {
+        vec_t theta = load_vec(&thetas_p[ip]);
+        vec_t zeta = load_vec(&zetas_p[ip]);
+        vec_t sdn, cdn;
+        sincos_vec(dn*zeta, sdn, cdn);
+        vec_t B(0.), R(0.), dRdtheta(0.), dRdzeta(0.), dRds(0.), dZdtheta(0.), dZdzeta(0.), dZds(0.);
+        vec_t nu(0.), dnuds(0.), dnudtheta(0.), dnudzeta(0.);
+        vec_t s(0.), c(1.);
         for (int im=0; im < num_modes; ++im) {
-          double angle = xm(im)*thetas(ip)-xn(im)*zetas(ip);
-          B += bmnc(im,isurf)*cos(angle) + bmns(im,isurf)*sin(angle);
-          R += rmnc(im,isurf)*cos(angle) + rmns(im,isurf)*sin(angle);
-          dRdtheta += -rmnc(im,isurf)*xm(im)*sin(angle) + rmns(im,isurf)*xm(im)*cos(angle);
-          dRdzeta  +=  rmnc(im,isurf)*xn(im)*sin(angle) - rmns(im,isurf)*xn(im)*cos(angle);
-          dRds += drmncds(im,isurf)*cos(angle) + drmnsds(im,isurf)*sin(angle);
-          dZdtheta += zmns(im,isurf)*xm(im)*cos(angle) - zmnc(im,isurf)*xm(im)*sin(angle);
-          dZdzeta += -zmns(im,isurf)*xn(im)*cos(angle) + zmnc(im,isurf)*xn(im)*sin(angle);
-          dZds += dzmnsds(im,isurf)*sin(angle) + dzmncds(im,isurf)*cos(angle);
-          nu   += numns(im,isurf)*sin(angle) + numnc(im,isurf)*cos(angle);
-          dnuds += dnumnsds(im,isurf)*sin(angle) + dnumncds(im,isurf)*cos(angle);
-          dnudtheta += numns(im,isurf)*xm(im)*cos(angle) - numnc(im,isurf)*xm(im)*sin(angle);
-          dnudzeta += -numns(im,isurf)*xn(im)*cos(angle) + numnc(im,isurf)*xn(im)*sin(angle);
+          if (recurrence[im]) {
+            vec_t s_old = s;
+            s = s * cdn - c * sdn;
+            c = c * cdn + s_old * sdn;
+          } else {
+            sincos_vec(xm(im)*theta-xn(im)*zeta, s, c);
+          }
+          cosines[im] = c;
+          sines[im] = s;
+          double m = xm(im);
+          double n = xn(im);
+          B += bmnc(im,isurf)*c;
+          R += rmnc(im,isurf)*c;
+          dRdtheta += (-rmnc(im,isurf)*m)*s;
+          dRdzeta  += (rmnc(im,isurf)*n)*s;
+          dRds += drmncds(im,isurf)*c;
+          dZdtheta += (zmns(im,isurf)*m)*c;
+          dZdzeta += (-zmns(im,isurf)*n)*c;
+          dZds += dzmnsds(im,isurf)*s;
+          nu   += numns(im,isurf)*s;
+          dnuds += dnumnsds(im,isurf)*s;
+          dnudtheta += (numns(im,isurf)*m)*c;
+          dnudzeta += (-numns(im,isurf)*n)*c;
+          if (!stellsym) {
+            Array& rmns = *nonsym[0];
+            Array& drmnsds = *nonsym[1];
+            Array& zmnc = *nonsym[2];
+            Array& dzmncds = *nonsym[3];
+            Array& numnc = *nonsym[4];
+            Array& dnumncds = *nonsym[5];
+            Array& bmns = *nonsym[6];
+            B += bmns(im,isurf)*s;
+            R += rmns(im,isurf)*s;
+            dRdtheta += (rmns(im,isurf)*m)*c;
+            dRdzeta  += (-rmns(im,isurf)*n)*c;
+            dRds += drmnsds(im,isurf)*s;
+            dZdtheta += (-zmnc(im,isurf)*m)*s;
+            dZdzeta += (zmnc(im,isurf)*n)*s;
+            dZds += dzmncds(im,isurf)*c;
+            nu   += numnc(im,isurf)*c;
+            dnuds += dnumncds(im,isurf)*c;
+            dnudtheta += (-numnc(im,isurf)*m)*s;
+            dnudzeta += (numnc(im,isurf)*n)*s;
+          }
         }
-        double phi = zetas(ip) - nu;
-        double dphids = - dnuds;
-        double dphidtheta = - dnudtheta;
-        double dphidzeta = 1 - dnudzeta;
-        double dXdtheta = dRdtheta * cos(phi) - R * sin(phi) * dphidtheta;
-        double dYdtheta = dRdtheta * sin(phi) + R * cos(phi) * dphidtheta;
-        double dXds   = dRds   * cos(phi) - R * sin(phi) * dphids;
-        double dYds   = dRds   * sin(phi) + R * cos(phi) * dphids;
-        double dXdzeta  = dRdzeta  * cos(phi) - R * sin(phi) * dphidzeta;
-        double dYdzeta  = dRdzeta  * sin(phi) + R * cos(phi) * dphidzeta;
-        double gstheta = dXdtheta * dXds + dYdtheta * dYds + dZdtheta * dZds;
-        double gszeta  = dXdzeta  * dXds + dYdzeta  * dYds + dZdzeta  * dZds;
-        double sqrtg = (G(isurf) + iota(isurf)*I(isurf))/(B*B);
-        double K = (gszeta + iota(isurf)*gstheta)/sqrtg;
+        vec_t phi = zeta - nu;
+        vec_t sphi, cphi;
+        sincos_vec(phi, sphi, cphi);
+        vec_t dphids = - dnuds;
+        vec_t dphidtheta = - dnudtheta;
+        vec_t dphidzeta = 1. - dnudzeta;
+        vec_t dXdtheta = dRdtheta * cphi - R * sphi * dphidtheta;
+        vec_t dYdtheta = dRdtheta * sphi + R * cphi * dphidtheta;
+        vec_t dXds   = dRds   * cphi - R * sphi * dphids;
+        vec_t dYds   = dRds   * sphi + R * cphi * dphids;
+        vec_t dXdzeta  = dRdzeta  * cphi - R * sphi * dphidzeta;
+        vec_t dYdzeta  = dRdzeta  * sphi + R * cphi * dphidzeta;
+        vec_t gstheta = dXdtheta * dXds + dYdtheta * dYds + dZdtheta * dZds;
+        vec_t gszeta  = dXdzeta  * dXds + dYdzeta  * dYds + dZdzeta  * dZds;
+        vec_t sqrtg = (G(isurf) + iota(isurf)*I(isurf))/(B*B);
+        vec_t K = load_vec(&mask[ip]) * ((gszeta + iota(isurf)*gstheta)/sqrtg);
 
         for (int im=0; im < num_modes; ++im) {
-          double angle = xm(im)*thetas(ip)-xn(im)*zetas(ip);
-          if (im > 0) {
-            kmnc_kmns(1,im,isurf) = kmnc_kmns(1,im,isurf) + K*sin(angle)/(2.*M_PI*M_PI);
-            kmnc_kmns(0,im,isurf) = kmnc_kmns(0,im,isurf) + K*cos(angle)/(2.*M_PI*M_PI);
-          } else {
-            kmnc_kmns(0,im,isurf) = kmnc_kmns(0,im,isurf) + K*cos(angle)/(4.*M_PI*M_PI);
-          }
+          kmnc[im] += K*cosines[im];
+          kmns[im] += K*sines[im];
+        }
+      }
+
+      alignas(64) double lanes[vec_size];
+      for (int im=0; im < num_modes; ++im) {
+        double sum_c = 0., sum_s = 0.;
+        store_vec(lanes, kmnc[im]);
+        for (int l=0; l < vec_size; ++l)
+          sum_c += lanes[l];
+        store_vec(lanes, kmns[im]);
+        for (int l=0; l < vec_size; ++l)
+          sum_s += lanes[l];
+        if (im > 0) {
+          kmnc_kmns(1,im,isurf) = sum_s/(2.*M_PI*M_PI);
+          kmnc_kmns(0,im,isurf) = sum_c/(2.*M_PI*M_PI);
+        } else {
+          kmnc_kmns(0,im,isurf) = sum_c/(4.*M_PI*M_PI);
         }
       }
     }
     return kmnc_kmns;
 }
 
+Array compute_kmnc_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds,
+    Array& numns, Array& dnumnsds, Array& bmnc,
+    Array& rmns, Array& drmnsds, Array& zmnc, Array& dzmncds,
+    Array& numnc, Array& dnumncds, Array& bmns,
+    Array& iota, Array& G, Array& I, Array& xm, Array& xn, Array& thetas, Array& zetas) {
+    Array* nonsym[7] = {&rmns, &drmnsds, &zmnc, &dzmncds, &numnc, &dnumncds, &bmns};
+    return compute_kmnc_kmns_impl(rmnc, drmncds, zmns, dzmnsds, numns, dnumnsds, bmnc, nonsym, iota, G, I, xm, xn, thetas, zetas);
+}
+
 Array compute_kmns(Array& rmnc, Array& drmncds, Array& zmns, Array& dzmnsds, Array& numns, Array& dnumnsds, Array& bmnc, Array& iota, Array& G, Array& I, Array& xm, Array& xn, Array& thetas, Array& zetas) {
 
     int num_modes = rmnc.shape(0);
     int num_surf = rmnc.shape(1);
-    int num_points = thetas.shape(0);
-
+    Array kmnc_kmns = compute_kmnc_kmns_impl(rmnc, drmncds, zmns, dzmnsds, numns, dnumnsds, bmnc, nullptr, iota, G, I, xm, xn, thetas, zetas);
     Array kmns = xt::zeros<double>({num_modes,num_surf});
-
-    // Outer iteration over surface
-    #pragma omp parallel for
-    for (int isurf=0; isurf < num_surf; ++isurf) {
-      for (int ip=0; ip < num_points; ++ip) {
-        double B = 0.;
-        double R = 0.;
-        double dRdtheta = 0.;
-        double dRdzeta = 0.;
-        double dRds = 0.;
-        double dZdtheta = 0.;
-        double dZdzeta = 0.;
-        double dZds = 0.;
-        double nu = 0.;
-        double dnuds = 0.;
-        double dnudtheta = 0.;
-        double dnudzeta = 0.;
-        for (int im=0; im < num_modes; ++im) {
-          B += bmnc(im,isurf)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          R += rmnc(im,isurf)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dRdtheta += -rmnc(im,isurf)*xm(im)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dRdzeta +=   rmnc(im,isurf)*xn(im)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dRds += drmncds(im,isurf)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dZdtheta += zmns(im,isurf)*xm(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dZdzeta += -zmns(im,isurf)*xn(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dZds += dzmnsds(im,isurf)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          nu += numns(im,isurf)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dnuds += dnumnsds(im,isurf)*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dnudtheta += numns(im,isurf)*xm(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-          dnudzeta += -numns(im,isurf)*xn(im)*cos(xm(im)*thetas(ip)-xn(im)*zetas(ip));
-        }
-        double phi = zetas(ip) - nu;
-        double dphids = - dnuds;
-        double dphidtheta = - dnudtheta;
-        double dphidzeta = 1 - dnudzeta;
-        double dXdtheta = dRdtheta * cos(phi) - R * sin(phi) * dphidtheta;
-        double dYdtheta = dRdtheta * sin(phi) + R * cos(phi) * dphidtheta;
-        double dXds   = dRds   * cos(phi) - R * sin(phi) * dphids;
-        double dYds   = dRds   * sin(phi) + R * cos(phi) * dphids;
-        double dXdzeta  = dRdzeta  * cos(phi) - R * sin(phi) * dphidzeta;
-        double dYdzeta  = dRdzeta  * sin(phi) + R * cos(phi) * dphidzeta;
-        double gstheta = dXdtheta * dXds + dYdtheta * dYds + dZdtheta * dZds;
-        double gszeta  = dXdzeta  * dXds + dYdzeta  * dYds + dZdzeta  * dZds;
-        double sqrtg = (G(isurf) + iota(isurf)*I(isurf))/(B*B);
-        double K = (gszeta + iota(isurf)*gstheta)/sqrtg;
-
-        for (int im=1; im < num_modes; ++im) {
-          kmns(im,isurf) = kmns(im,isurf) + K*sin(xm(im)*thetas(ip)-xn(im)*zetas(ip))/(2.*M_PI*M_PI);
-        }
-      }
-    }
+    for (int im=1; im < num_modes; ++im)
+      for (int isurf=0; isurf < num_surf; ++isurf)
+        kmns(im,isurf) = kmnc_kmns(1,im,isurf);
     return kmns;
 }
 
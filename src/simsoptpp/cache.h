@@ -59,9 +59,20 @@ class Cache {
             return loc->second.data;
         }
 
+        void invalidate(string key){
+            auto loc = cache.find(key);
+            if(loc != cache.end())
+                loc->second.status = false;
+        }
+
         void invalidate_cache(){
             for (auto it = cache.begin(); it != cache.end(); ++it) {
                 it->second.status = false;
             }
         }
+
+        // Drop all arrays, not only mark them as outdated.
+        void clear(){
+            cache.clear();
+        }
 };
@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <cmath>
 using std::vector;
 
 #include <string>
@@ -39,6 +40,83 @@ Array curve_vjp_contraction(const Array& mat, const Array& v){
     return res;
 }
 
+// Table of cos(2*pi*step*j*q_k) and sin(2*pi*step*j*q_k) for j = 0, ...,
+// count-1 and all quadrature points q_k, used to evaluate Fourier series on
+// the quadrature points without calling sin and cos over and over again. If
+// all quadrature points lie on a uniform grid {m/N}, as is the case for the
+// default quadrature points and subsets thereof, the angles only take the N
+// values 2*pi*m/N and only those are stored. Otherwise the full table is
+// stored.
+class FourierTrigTable {
+    private:
+        int step = 0, count = 0;
+        long N = 0; // > 0 iff the quadrature points lie on the grid {m/N}
+        vector<long> m; // q_k = m[k]/N
+        vector<double> c, s;
+
+    public:
+        bool initialized() const { return count > 0; }
+
+        template<class Array>
+        void init(const Array& quadpoints, int _step, int _count) {
+            step = _step;
+            count = _count;
+            int nq = quadpoints.size();
+            N = 0;
+            if(nq > 1) {
+                double h = std::abs(quadpoints[1] - quadpoints[0]);
+                long NN = h > 0 ? std::lround(1./h) : 0;
+                bool uniform = NN > 0 && NN <= 1000000;
+                m = vector<long>(nq, 0);
+                for (int k = 0; k < nq && uniform; ++k) {
+                    double mk = quadpoints[k]*NN;
+                    m[k] = std::lround(mk);
+                    uniform = std::abs(mk - m[k]) < 1e-10*NN;
+                    m[k] = ((m[k] % NN) + NN) % NN;
+                }
+                if(uniform)
+                    N = NN;
+            }
+            if(N > 0) {
+                c = vector<double>(N);
+                s = vector<double>(N);
+                for (long i = 0; i < N; ++i) {
+                    c[i] = std::cos(2*M_PI*i/N);
+                    s[i] = std::sin(2*M_PI*i/N);
+                }
+            } else {
+                c = vector<double>(nq*count);
+                s = vector<double>(nq*count);
+                for (int k = 0; k < nq; ++k) {
+                    for (int j = 0; j < count; ++j) {
+                        c[k*count + j] = std::cos(2*M_PI*step*j*quadpoints[k]);
+                        s[k*count + j] = std::sin(2*M_PI*step*j*quadpoints[k]);
+                    }
+                }
+            }
+        }
+
+        // writes cos(2*pi*step*j*q_k) and sin(2*pi*step*j*q_k) for j = 0, ..., count-1 to cj and sj
+        void fill(int k, double* cj, double* sj) const {
+            if(N > 0) {
+                long inc = (step*m[k]) % N;
+                long idx = 0;
+                for (int j = 0; j < count; ++j) {
+                    cj[j] = c[idx];
+                    sj[j] = s[idx];
+                    idx += inc;
+                    if(idx >= N)
+                        idx -= N;
+                }
+            } else {
+                for (int j = 0; j < count; ++j) {
+                    cj[j] = c[k*count + j];
+                    sj[j] = s[k*count + j];
+                }
+            }
+        }
+};
+
 template<class Array>
 class Curve {
     private:
@@ -49,6 +127,10 @@ class Curve {
          * object */
         map<string, CachedArray<Array>> cache;
         map<string, CachedArray<Array>> cache_persistent;
+        // incremented whenever the cache is invalidated, i.e. whenever the
+        // curve may have changed. used by BiotSavart to only recompute the
+        // field of coils that have actually changed.
+        uint64_t version = 0;
 
 
     protected:
@@ -110,8 +192,11 @@ class Curve {
             for (auto it = cache.begin(); it != cache.end(); ++it) {
                 (it->second).status = false;
             }
+            ++version;
         }
 
+        uint64_t get_version() const { return version; }
+
         virtual void set_dofs(const vector<double>& _dofs) {
             this->set_dofs_impl(_dofs);
             this->invalidate_cache();
@@ -0,0 +1,4 @@
+#include "curve_impl.h"
+#include "xtensor/xarray.hpp"
+typedef xt::xarray<double> Array;
+template class Curve<Array>;
@@ -1,3 +1,5 @@
+#pragma once
+
 #include "curve.h"
 
 template<class Array>
@@ -52,8 +54,3 @@ void Curve<Array>::dincremental_arclength_by_dcoeff_impl(Array& data) {
         }
     }
 };
-
-
-#include "xtensor-python/pyarray.hpp"     // Numpy bindings
-typedef xt::pyarray<double> Array;
-template class Curve<Array>;
@@ -0,0 +1,4 @@
+#include "curve_impl.h"
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+template class Curve<Array>;
@@ -1,8 +1,86 @@
 #include "curverzfourier.h"
 
 
+template<class Array>
+void CurveRZFourier<Array>::compute_derivatives() {
+    vector<double> current_dofs = CurveRZFourier<Array>::get_dofs();
+    if(derivatives.size() > 0 && current_dofs == derivatives_dofs)
+        return;
+    if(!trig.initialized())
+        trig.init(quadpoints, nfp, order+1);
+    derivatives = vector<double>(4*numquadpoints*3, 0.);
+    vector<double> cn(order+1), sn(order+1);
+    double* g = derivatives.data();
+    int stride = numquadpoints*3;
+    for (int k = 0; k < numquadpoints; ++k) {
+        trig.fill(k, cn.data(), sn.data());
+        // r and z and their first three derivatives with respect to phi
+        double r[4] = {0., 0., 0., 0.};
+        double z[4] = {0., 0., 0., 0.};
+        for (int i = 0; i < order+1; ++i) {
+            double w = nfp*i;
+            double rcos = rc[i], rsin = 0., zcos = 0., zsin = 0.;
+            if(i > 0) {
+                zsin = zs[i-1];
+                if(!stellsym)
+                    rsin = rs[i-1];
+            }
+            if(!stellsym)
+                zcos = zc[i];
+            double rval = rcos*cn[i] + rsin*sn[i];
+            double rder = rsin*cn[i] - rcos*sn[i];
+            double zval = zsin*sn[i] + zcos*cn[i];
+            double zder = zsin*cn[i] - zcos*sn[i];
+            r[0] += rval;
+            r[1] += w*rder;
+            r[2] -= w*w*rval;
+            r[3] -= w*w*w*rder;
+            z[0] += zval;
+            z[1] += w*zder;
+            z[2] -= w*w*zval;
+            z[3] -= w*w*w*zder;
+        }
+        double phi = 2*M_PI*quadpoints[k];
+        double c = cos(phi), s = sin(phi);
+        // x = r cos(phi), y = r sin(phi), and d/dquadpoint = 2 pi d/dphi
+        double x[4] = {
+            r[0]*c,
+            r[1]*c - r[0]*s,
+            r[2]*c - 2*r[1]*s - r[0]*c,
+            r[3]*c - 3*r[2]*s - 3*r[1]*c + r[0]*s
+        };
+        double y[4] = {
+            r[0]*s,
+            r[1]*s + r[0]*c,
+            r[2]*s + 2*r[1]*c - r[0]*s,
+            r[3]*s + 3*r[2]*c - 3*r[1]*s - r[0]*c
+        };
+        double fak = 1.;
+        for (int d = 0; d < 4; ++d) {
+            g[d*stride + 3*k + 0] = fak*x[d];
+            g[d*stride + 3*k + 1] = fak*y[d];
+            g[d*stride + 3*k + 2] = fak*z[d];
+            fak *= 2*M_PI;
+        }
+    }
+    derivatives_dofs = current_dofs;
+}
+
+template<class Array>
+void CurveRZFourier<Array>::copy_derivative(Array& data, int d) {
+    compute_derivatives();
+    const double* g = derivatives.data() + d*numquadpoints*3;
+    for (int k = 0; k < numquadpoints; ++k)
+        for (int i = 0; i < 3; ++i)
+            data(k, i) = g[3*k + i];
+}
+
 template<class Array>
 void CurveRZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
+    if(&quadpoints == &this->quadpoints) {
+        copy_derivative(data, 0);
+        return;
+    }
     int numquadpoints = quadpoints.size();
     data *= 0;
     for (int k = 0; k < numquadpoints; ++k) {
@@ -31,98 +109,17 @@ void CurveRZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
 
 template<class Array>
 void CurveRZFourier<Array>::gammadash_impl(Array& data) {
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i] * ( -(i*nfp) * sin(nfp*i*phi) * cos(phi) - cos(nfp*i*phi) * sin(phi));
-            data(k, 1) += rc[i] * ( -(i*nfp) * sin(nfp*i*phi) * sin(phi) + cos(nfp*i*phi) * cos(phi));
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2) += zs[i-1] * (nfp*i) * cos(nfp*i*phi);
-        }
-    }
-    if(!stellsym){
-        for (int k = 0; k < numquadpoints; ++k) {
-            double phi = 2 * M_PI * quadpoints[k];
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1] * ( (i*nfp) * cos(nfp*i*phi) * cos(phi) - sin(nfp*i*phi) * sin(phi));
-                data(k, 1) += rs[i-1] * ( (i*nfp) * cos(nfp*i*phi) * sin(phi) + sin(nfp*i*phi) * cos(phi));
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2) -= zc[i] * (nfp*i) * sin(nfp*i*phi);
-            }
-        }
-    }
-    data *= (2*M_PI);
+    copy_derivative(data, 1);
 }
 
 template<class Array>
 void CurveRZFourier<Array>::gammadashdash_impl(Array& data) {
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i] * (+2*(nfp*i)*sin(nfp*i*phi)*sin(phi)-(pow(nfp*i, 2)+1)*cos(nfp*i*phi)*cos(phi));
-            data(k, 1) += rc[i] * (-2*(nfp*i)*sin(nfp*i*phi)*cos(phi)-(pow(nfp*i, 2)+1)*cos(nfp*i*phi)*sin(phi));
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2) -= zs[i-1] * pow(nfp*i, 2)*sin(nfp*i*phi);
-        }
-    }
-    if(!stellsym){
-        for (int k = 0; k < numquadpoints; ++k) {
-            double phi = 2 * M_PI * quadpoints[k];
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1] * (-(pow(nfp*i,2)+1)*sin(nfp*i*phi)*cos(phi) - 2*(i*nfp)*cos(nfp*i*phi)*sin(phi));
-                data(k, 1) += rs[i-1] * (-(pow(nfp*i,2)+1)*sin(nfp*i*phi)*sin(phi) + 2*(i*nfp)*cos(nfp*i*phi)*cos(phi));
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2) -= zc[i] * pow(nfp*i, 2)*cos(nfp*i*phi);
-            }
-        }
-    }
-    data *= 2*M_PI*2*M_PI;
+    copy_derivative(data, 2);
 }
 
 template<class Array>
 void CurveRZFourier<Array>::gammadashdashdash_impl(Array& data) {
-    data *= 0;
-    for (int k = 0; k < numquadpoints; ++k) {
-        double phi = 2 * M_PI * quadpoints[k];
-        for (int i = 0; i < order+1; ++i) {
-            data(k, 0) += rc[i]*(
-                    +(3*pow(nfp*i, 2) + 1)*cos(nfp*i*phi)*sin(phi)
-                    +(pow(nfp*i, 2) + 3)*(nfp*i)*sin(nfp*i*phi)*cos(phi)
-                    );
-            data(k, 1) += rc[i]*(
-                    +(pow(nfp*i, 2) + 3)*(nfp*i)*sin(nfp*i*phi)*sin(phi)
-                    -(3*pow(nfp*i, 2) + 1)*cos(nfp*i*phi)*cos(phi)
-                    );
-        }
-        for (int i = 1; i < order+1; ++i) {
-            data(k, 2) -= zs[i-1] * pow(nfp*i, 3) * cos(nfp*i*phi);
-        }
-    }
-    if(!stellsym){
-        for (int k = 0; k < numquadpoints; ++k) {
-            double phi = 2 * M_PI * quadpoints[k];
-            for (int i = 1; i < order+1; ++i) {
-                data(k, 0) += rs[i-1]*(
-                        -(pow(nfp*i,2)+3) * (nfp*i) * cos(nfp*i*phi)*cos(phi)
-                        +(3*pow(nfp*i,2)+1) * sin(nfp*i*phi)*sin(phi)
-                        );
-                data(k, 1) += rs[i-1]*(
-                        -(pow(nfp*i,2)+3)*(nfp*i)*cos(nfp*i*phi)*sin(phi) 
-                        -(3*pow(nfp*i,2)+1)*sin(nfp*i*phi)*cos(phi) 
-                        );
-            }
-            for (int i = 0; i < order+1; ++i) {
-                data(k, 2) += zc[i] * pow(nfp*i, 3) * sin(nfp*i*phi);
-            }
-        }
-    }
-    data *= 2*M_PI*2*M_PI*2*M_PI;
+    copy_derivative(data, 3);
 }
 
 template<class Array>
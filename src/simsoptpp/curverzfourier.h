@@ -124,4 +124,13 @@ class CurveRZFourier : public Curve<Array> {
         void dgammadashdash_by_dcoeff_impl(Array& data) override;
         void dgammadashdashdash_by_dcoeff_impl(Array& data) override;
 
+    private:
+        // gamma and its first three derivatives on the quadrature points are
+        // computed together in a single pass over a table of sin and cos,
+        // and kept until the dofs change.
+        FourierTrigTable trig;
+        vector<double> derivatives;
+        vector<double> derivatives_dofs;
+        void compute_derivatives();
+        void copy_derivative(Array& data, int d);
 };
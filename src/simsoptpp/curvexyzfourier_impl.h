@@ -0,0 +1,173 @@
+#pragma once
+
+#include "curvexyzfourier.h"
+
+template<class Array>
+void CurveXYZFourier<Array>::compute_derivatives() {
+    vector<double> current_dofs = CurveXYZFourier<Array>::get_dofs();
+    if(derivatives.size() > 0 && current_dofs == derivatives_dofs)
+        return;
+    if(!trig.initialized())
+        trig.init(quadpoints, 1, order+1);
+    derivatives = vector<double>(4*numquadpoints*3, 0.);
+    vector<double> cj(order+1), sj(order+1);
+    double* g = derivatives.data();
+    int stride = numquadpoints*3;
+    for (int k = 0; k < numquadpoints; ++k) {
+        trig.fill(k, cj.data(), sj.data());
+        for (int i = 0; i < 3; ++i) {
+            double g0 = dofs[i][0], g1 = 0., g2 = 0., g3 = 0.;
+            for (int j = 1; j < order+1; ++j) {
+                double w = 2*M_PI*j;
+                double sinterm = dofs[i][2*j-1]*sj[j] + dofs[i][2*j]*cj[j];
+                double costerm = dofs[i][2*j-1]*cj[j] - dofs[i][2*j]*sj[j];
+                g0 += sinterm;
+                g1 += w*costerm;
+                g2 -= w*w*sinterm;
+                g3 -= w*w*w*costerm;
+            }
+            g[0*stride + 3*k + i] = g0;
+            g[1*stride + 3*k + i] = g1;
+            g[2*stride + 3*k + i] = g2;
+            g[3*stride + 3*k + i] = g3;
+        }
+    }
+    derivatives_dofs = current_dofs;
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::copy_derivative(Array& data, int d) {
+    compute_derivatives();
+    const double* g = derivatives.data() + d*numquadpoints*3;
+    for (int k = 0; k < numquadpoints; ++k)
+        for (int i = 0; i < 3; ++i)
+            data(k, i) = g[3*k + i];
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::gamma_impl(Array& data, Array& quadpoints) {
+    if(&quadpoints == &this->quadpoints) {
+        copy_derivative(data, 0);
+        return;
+    }
+    int numquadpoints = quadpoints.size();
+    data *= 0;
+    for (int k = 0; k < numquadpoints; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            data(k, i) += dofs[i][0];
+            for (int j = 1; j < order+1; ++j) {
+                data(k, i) += dofs[i][2*j-1]*sin(2*M_PI*j*quadpoints[k]);
+                data(k, i) += dofs[i][2*j]*cos(2*M_PI*j*quadpoints[k]);
+            }
+        }
+    }
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::gammadash_impl(Array& data) {
+    copy_derivative(data, 1);
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::gammadashdash_impl(Array& data) {
+    copy_derivative(data, 2);
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::gammadashdashdash_impl(Array& data) {
+    copy_derivative(data, 3);
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
+    for (int k = 0; k < numquadpoints; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            data(k, i, i*(2*order+1)) = 1.;
+            for (int j = 1; j < order+1; ++j) {
+                data(k, i, i*(2*order+1) + 2*j-1) = sin(2*M_PI*j*quadpoints[k]);
+                data(k, i, i*(2*order+1) + 2*j  ) = cos(2*M_PI*j*quadpoints[k]);
+            }
+        }
+    }
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::dgammadash_by_dcoeff_impl(Array& data) {
+    for (int k = 0; k < numquadpoints; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 1; j < order+1; ++j) {
+                data(k, i, i*(2*order+1) + 2*j-1) = +2*M_PI*j*cos(2*M_PI*j*quadpoints[k]);
+                data(k, i, i*(2*order+1) + 2*j  ) = -2*M_PI*j*sin(2*M_PI*j*quadpoints[k]);
+            }
+        }
+    }
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::dgammadashdash_by_dcoeff_impl(Array& data) {
+    for (int k = 0; k < numquadpoints; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 1; j < order+1; ++j) {
+                data(k, i, i*(2*order+1) + 2*j-1) = -(2*M_PI*j)*(2*M_PI*j)*sin(2*M_PI*j*quadpoints[k]);
+                data(k, i, i*(2*order+1) + 2*j  ) = -(2*M_PI*j)*(2*M_PI*j)*cos(2*M_PI*j*quadpoints[k]);
+            }
+        }
+    }
+}
+
+template<class Array>
+void CurveXYZFourier<Array>::dgammadashdashdash_by_dcoeff_impl(Array& data) {
+    for (int k = 0; k < numquadpoints; ++k) {
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 1; j < order+1; ++j) {
+                data(k, i, i*(2*order+1) + 2*j-1) = -(2*M_PI*j)*(2*M_PI*j)*(2*M_PI*j)*cos(2*M_PI*j*quadpoints[k]);
+                data(k, i, i*(2*order+1) + 2*j  ) = +(2*M_PI*j)*(2*M_PI*j)*(2*M_PI*j)*sin(2*M_PI*j*quadpoints[k]);
+            }
+        }
+    }
+}
+
+// The vector Jacobian products below are evaluated without forming
+// dgamma_by_dcoeff. sin(2*pi*j*phi) and cos(2*pi*j*phi) are computed from
+// sin(2*pi*phi) and cos(2*pi*phi) using the angle addition formulas.
+template<class Array>
+Array CurveXYZFourier<Array>::dgamma_by_dcoeff_vjp_impl(Array& v) {
+    Array res = xt::zeros<double>({num_dofs()});
+    for (int k = 0; k < numquadpoints; ++k) {
+        double s1 = sin(2*M_PI*quadpoints[k]);
+        double c1 = cos(2*M_PI*quadpoints[k]);
+        double sj = 0., cj = 1.;
+        for (int i = 0; i < 3; ++i)
+            res(i*(2*order+1)) += v(k, i);
+        for (int j = 1; j < order+1; ++j) {
+            double temp = sj*c1 + cj*s1;
+            cj = cj*c1 - sj*s1;
+            sj = temp;
+            for (int i = 0; i < 3; ++i) {
+                res(i*(2*order+1) + 2*j-1) += v(k, i)*sj;
+                res(i*(2*order+1) + 2*j  ) += v(k, i)*cj;
+            }
+        }
+    }
+    return res;
+}
+
+template<class Array>
+Array CurveXYZFourier<Array>::dgammadash_by_dcoeff_vjp_impl(Array& v) {
+    Array res = xt::zeros<double>({num_dofs()});
+    for (int k = 0; k < numquadpoints; ++k) {
+        double s1 = sin(2*M_PI*quadpoints[k]);
+        double c1 = cos(2*M_PI*quadpoints[k]);
+        double sj = 0., cj = 1.;
+        for (int j = 1; j < order+1; ++j) {
+            double temp = sj*c1 + cj*s1;
+            cj = cj*c1 - sj*s1;
+            sj = temp;
+            for (int i = 0; i < 3; ++i) {
+                res(i*(2*order+1) + 2*j-1) += +v(k, i)*2*M_PI*j*cj;
+                res(i*(2*order+1) + 2*j  ) += -v(k, i)*2*M_PI*j*sj;
+            }
+        }
+    }
+    return res;
+}
@@ -0,0 +1,4 @@
+#include "curvexyzfourier_impl.h"
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+template class CurveXYZFourier<Array>;
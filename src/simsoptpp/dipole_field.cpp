@@ -293,86 +293,105 @@ Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp
 
     std::string cylindrical_str = "cylindrical";
     std::string toroidal_str = "toroidal";
-
-    // initialize pointer to the beginning of the dipole grid
-    double* m_points_ptr = &(m_points(0, 0));
+    bool rotate_frame = (coordinate_flag == cylindrical_str || coordinate_flag == toroidal_str);
     double fak = 1e-7;  // mu0 divided by 4 * pi factor
 
-    // Loop through the evaluation points by chunks of simd_size
-    #pragma omp parallel for schedule(static)
-    for(int i = 0; i < num_points; i += simd_size) {
-        auto point_i = Vec3dSimd();
-        auto n_i = Vec3dSimd();
-
-        // check that i + k isn't bigger than num_points
-        int klimit = std::min(simd_size, num_points - i);
-        for(int k = 0; k < klimit; k++){
-            for (int d = 0; d < 3; ++d) {
-                point_i[d][k] = points(i + k, d);
-                n_i[d][k] = unitnormal(i + k, d);
-            }
+    // The symmetries (rotation by phi0, after reflecting the y and
+    // z-components for stell = 1) are the same for every point, so the
+    // symmetric images of the dipoles and the rotations into the grid-aligned
+    // frame of each dipole are computed once here. They are stored as one
+    // array per component, padded to a multiple of simd_size by repeating the
+    // last dipole.
+    int nsym = (stellsym + 1) * nfp;
+    int num_padded = ((num_dipoles + simd_size - 1) / simd_size) * simd_size;
+    vector<double> cphi0(nsym), sphi0(nsym), sign(nsym);
+    for (int stell = 0; stell < (stellsym + 1); ++stell) {
+        for(int fp = 0; fp < nfp; ++fp) {
+            int s = stell * nfp + fp;
+            double phi0 = (2 * M_PI / ((double) nfp)) * fp;
+            cphi0[s] = std::cos(phi0);
+            sphi0[s] = std::sin(phi0);
+            sign[s] = (stell == 0) ? 1.0 : -1.0;
         }
-        // Loop through all the dipoles, using all the symmetries
-        for (int j = 0; j < num_dipoles; ++j) {
-            Vec3dSimd mp_j = Vec3dSimd(m_points_ptr[3 * j + 0], m_points_ptr[3 * j + 1], m_points_ptr[3 * j + 2]);
-            for (int stell = 0; stell < (stellsym + 1); ++stell) {
-                for(int fp = 0; fp < nfp; ++fp) {
-                    simd_t phi0 = (2 * M_PI / ((simd_t) nfp)) * fp;
-                    simd_t sphi0 = xsimd::sin(phi0);
-                    simd_t cphi0 = xsimd::cos(phi0);
-                    auto G_i = Vec3dSimd();
-
-                    // Calculate new dipole location after accounting for the symmetries
-                    // reflect the y and z-components and then rotate by phi0
-                    simd_t mp_x_new = mp_j.x * cphi0 - mp_j.y * sphi0 * pow(-1, stell);
-                    simd_t mp_y_new = mp_j.x * sphi0 + mp_j.y * cphi0 * pow(-1, stell);
-                    simd_t mp_z_new = mp_j.z * pow(-1, stell);
-                    Vec3dSimd mp_j_new = Vec3dSimd(mp_x_new, mp_y_new, mp_z_new);
-
-                    // Calculate new phi location if switching to cylindrical coordinates
-                    simd_t mp_phi_new = xsimd::atan2(mp_j.y, mp_j.x);
-                    simd_t mp_theta_new = xsimd::atan2(mp_j.z, sqrt(mp_j.x * mp_j.x + mp_j.y * mp_j.y) - R0);
-                    simd_t sphi_new = xsimd::sin(mp_phi_new);
-                    simd_t stheta_new = xsimd::sin(mp_theta_new);
-                    simd_t cphi_new = xsimd::cos(mp_phi_new);
-                    simd_t ctheta_new = xsimd::cos(mp_theta_new);
+    }
+    vector<AlignedPaddedVec> images(3 * nsym, AlignedPaddedVec(num_padded, 0.0));
+    vector<AlignedPaddedVec> frames(rotate_frame ? 9 : 0, AlignedPaddedVec(num_padded, 0.0));
+    for (int j = 0; j < num_padded; ++j) {
+        int jj = std::min(j, num_dipoles - 1);
+        double mx = m_points(jj, 0), my = m_points(jj, 1), mz = m_points(jj, 2);
+        for (int s = 0; s < nsym; ++s) {
+            images[3 * s + 0][j] = mx * cphi0[s] - my * sphi0[s] * sign[s];
+            images[3 * s + 1][j] = mx * sphi0[s] + my * cphi0[s] * sign[s];
+            images[3 * s + 2][j] = mz * sign[s];
+        }
+        if (!rotate_frame)
+            continue;
+        double phi = std::atan2(my, mx);
+        double theta = std::atan2(mz, std::sqrt(mx * mx + my * my) - R0);
+        double cphi = std::cos(phi), sphi = std::sin(phi);
+        double ctheta = (coordinate_flag == toroidal_str) ? std::cos(theta) : 1.0;
+        double stheta = (coordinate_flag == toroidal_str) ? std::sin(theta) : 0.0;
+        double frame[9] = {cphi * ctheta, sphi * ctheta, stheta,
+                           -sphi, cphi, 0.0,
+                           -cphi * stheta, -sphi * stheta, ctheta};
+        for (int d = 0; d < 9; ++d)
+            frames[d][j] = frame[d];
+    }
 
-                    // Compute the unsymmetrized inductance matrix
-                    Vec3dSimd r = point_i - mp_j_new;
-                    simd_t rmag_2 = normsq(r);
-                    simd_t rmag_inv   = rsqrt(rmag_2);
-                    simd_t rmag_inv_3 = rmag_inv * (rmag_inv * rmag_inv);
-                    simd_t rmag_inv_5 = rmag_inv_3 * (rmag_inv * rmag_inv);
-                    simd_t rdotn = inner(r, n_i);
-                    G_i.x = 3.0 * rdotn * r.x * rmag_inv_5 - n_i.x * rmag_inv_3;
-                    G_i.y = 3.0 * rdotn * r.y * rmag_inv_5 - n_i.y * rmag_inv_3;
-                    G_i.z = 3.0 * rdotn * r.z * rmag_inv_5 - n_i.z * rmag_inv_3;
-                    for(int k = 0; k < klimit; k++){
-                        if (coordinate_flag == cylindrical_str) {
-                            double Ax_temp = (G_i.x[k] * cphi0[k] + G_i.y[k] * sphi0[k]) * pow(-1, stell);
-                            double Ay_temp = (- G_i.x[k] * sphi0[k] + G_i.y[k] * cphi0[k]);
-                            A(i + k, j, 0) += fak * (Ax_temp * cphi_new[k] + Ay_temp * sphi_new[k]);
-                            A(i + k, j, 1) += fak * ( - Ax_temp * sphi_new[k] + Ay_temp * cphi_new[k]);
-                            A(i + k, j, 2) += fak * G_i.z[k];
-                        }
-                        else if (coordinate_flag == toroidal_str) {
-
-                            double Ax_temp = (G_i.x[k] * cphi0[k] + G_i.y[k] * sphi0[k]) * pow(-1, stell);
-                            double Ay_temp = (- G_i.x[k] * sphi0[k] + G_i.y[k] * cphi0[k]);
-                            double Az_temp = G_i.z[k];
-                            A(i + k, j, 0) += fak * (Ax_temp * cphi_new[k] * ctheta_new[k] + Ay_temp * sphi_new[k] * ctheta_new[k] + Az_temp * stheta_new[k]);
-                            A(i + k, j, 1) += fak * ( - Ax_temp * sphi_new[k] + Ay_temp * cphi_new[k]);
-                            A(i + k, j, 2) += fak * (- Ax_temp * cphi_new[k] * stheta_new[k] - Ay_temp * sphi_new[k] * stheta_new[k] + Az_temp * ctheta_new[k]);
-                        }
-                        else {
-                            // rotate by -phi0 and then flip x component
-                            // This should be the reverse of what is done to the m vector and the dipole grid
-                            // because A * m = A * R^T * R * m and R is an orthogonal matrix both
-                            // for a reflection and a rotation.
-                            A(i + k, j, 0) += fak * (G_i.x[k] * cphi0[k] + G_i.y[k] * sphi0[k]) * pow(-1, stell);
-                            A(i + k, j, 1) += fak * (- G_i.x[k] * sphi0[k] + G_i.y[k] * cphi0[k]);
-                            A(i + k, j, 2) += fak * G_i.z[k];
-                        }
+    // Blocks of points are distributed over the threads, and within a block
+    // the dipoles are processed in tiles whose images and frames stay in
+    // cache while they are used for every point of the block. Each point is
+    // evaluated for simd_size dipoles at a time, so that the results are
+    // written contiguously into row i of A.
+    constexpr int point_block = 32;
+    constexpr int dipole_tile = 64 * simd_size;
+    #pragma omp parallel for schedule(dynamic)
+    for (int i0 = 0; i0 < num_points; i0 += point_block) {
+        int i1 = std::min(i0 + point_block, num_points);
+        alignas(64) double buf[3][simd_size];
+        for (int j0 = 0; j0 < num_padded; j0 += dipole_tile) {
+            int j1 = std::min(j0 + dipole_tile, num_padded);
+            for (int i = i0; i < i1; ++i) {
+                Vec3dSimd point_i(points(i, 0), points(i, 1), points(i, 2));
+                Vec3dSimd n_i(unitnormal(i, 0), unitnormal(i, 1), unitnormal(i, 2));
+                double* A_i = &(A(i, 0, 0));
+                for (int j = j0; j < j1; j += simd_size) {
+                    // sum over the symmetries of the kernel rotated by -phi0
+                    // and then flipped in the x component. This should be the
+                    // reverse of what is done to the dipole grid because
+                    // A * m = A * R^T * R * m and R is an orthogonal matrix
+                    // both for a reflection and a rotation.
+                    Vec3dSimd G_sum;
+                    for (int s = 0; s < nsym; ++s) {
+                        Vec3dSimd r = point_i - Vec3dSimd(&images[3 * s][j], &images[3 * s + 1][j], &images[3 * s + 2][j]);
+                        simd_t rmag_2 = normsq(r);
+                        simd_t rmag_inv   = rsqrt(rmag_2);
+                        simd_t rmag_inv_3 = rmag_inv * (rmag_inv * rmag_inv);
+                        simd_t rmag_inv_5 = rmag_inv_3 * (rmag_inv * rmag_inv);
+                        simd_t rdotn_5 = 3.0 * inner(r, n_i) * rmag_inv_5;
+                        simd_t G_x = rdotn_5 * r.x - n_i.x * rmag_inv_3;
+                        simd_t G_y = rdotn_5 * r.y - n_i.y * rmag_inv_3;
+                        simd_t G_z = rdotn_5 * r.z - n_i.z * rmag_inv_3;
+                        G_sum.x += (G_x * cphi0[s] + G_y * sphi0[s]) * sign[s];
+                        G_sum.y += G_y * cphi0[s] - G_x * sphi0[s];
+                        G_sum.z += G_z;
+                    }
+                    if (rotate_frame) {
+                        simd_t f[9];
+                        for (int d = 0; d < 9; ++d)
+                            f[d] = xs::load_aligned(&frames[d][j]);
+                        Vec3dSimd G_frame(f[0] * G_sum.x + f[1] * G_sum.y + f[2] * G_sum.z,
+                                          f[3] * G_sum.x + f[4] * G_sum.y + f[5] * G_sum.z,
+                                          f[6] * G_sum.x + f[7] * G_sum.y + f[8] * G_sum.z);
+                        G_sum = G_frame;
+                    }
+                    G_sum *= fak;
+                    G_sum.store_aligned(buf[0], buf[1], buf[2]);
+                    int klimit = std::min(simd_size, num_dipoles - j);
+                    for (int k = 0; k < klimit; ++k) {
+                        A_i[3 * (j + k) + 0] = buf[0][k];
+                        A_i[3 * (j + k) + 1] = buf[1][k];
+                        A_i[3 * (j + k) + 2] = buf[2][k];
                     }
                 }
             }
@@ -842,4 +861,244 @@ Array define_a_uniform_cartesian_grid_between_two_toroidal_surfaces(Array& norma
         }
     }
     return final_grid;
-}
\ No newline at end of file
+}
+DipoleFieldOperator::DipoleFieldOperator(Array& points_, Array& m_points, Array& unitnormal, int nfp, int stellsym, Array& weights_, std::string coordinate_flag, double R0)
+{
+    if(points_.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("points needs to be in row-major storage order");
+    if(m_points.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("m_points needs to be in row-major storage order");
+    if(unitnormal.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("unit normal needs to be in row-major storage order");
+    num_points = points_.shape(0);
+    num_dipoles = m_points.shape(0);
+    if((int) unitnormal.shape(0) != num_points || (int) weights_.size() != num_points)
+          throw std::runtime_error("points, unitnormal and weights need to have the same length");
+    nsym = (stellsym + 1) * nfp;
+
+    points = vector<double>(points_.data(), points_.data() + 3 * num_points);
+    normals = vector<double>(unitnormal.data(), unitnormal.data() + 3 * num_points);
+    weights = vector<double>(num_points);
+    for (int i = 0; i < num_points; ++i)
+        weights[i] = weights_(i);
+
+    symmetries = vector<double>(3 * nsym);
+    for (int stell = 0; stell < (stellsym + 1); ++stell) {
+        for(int fp = 0; fp < nfp; ++fp) {
+            int s = stell * nfp + fp;
+            double phi0 = (2 * M_PI / ((double) nfp)) * fp;
+            symmetries[3 * s + 0] = std::cos(phi0);
+            symmetries[3 * s + 1] = std::sin(phi0);
+            symmetries[3 * s + 2] = pow(-1, stell);
+        }
+    }
+
+    std::string cylindrical_str = "cylindrical";
+    std::string toroidal_str = "toroidal";
+    images = vector<double>(3 * nsym * num_dipoles);
+    frames = vector<double>(9 * num_dipoles, 0.0);
+    for (int j = 0; j < num_dipoles; ++j) {
+        double x = m_points(j, 0), y = m_points(j, 1), z = m_points(j, 2);
+        for (int s = 0; s < nsym; ++s)
+            symmetric_image(s, &m_points(j, 0), &images[3 * (j * nsym + s)]);
+        double phi = std::atan2(y, x);
+        double theta = std::atan2(z, sqrt(x * x + y * y) - R0);
+        double cphi = std::cos(phi), sphi = std::sin(phi);
+        double ctheta = std::cos(theta), stheta = std::sin(theta);
+        double* F = &frames[9 * j];
+        if (coordinate_flag == cylindrical_str) {
+            F[0] = cphi;  F[1] = sphi; F[2] = 0.0;
+            F[3] = -sphi; F[4] = cphi; F[5] = 0.0;
+            F[6] = 0.0;   F[7] = 0.0;  F[8] = 1.0;
+        }
+        else if (coordinate_flag == toroidal_str) {
+            F[0] = cphi * ctheta;  F[1] = sphi * ctheta;  F[2] = stheta;
+            F[3] = -sphi;          F[4] = cphi;           F[5] = 0.0;
+            F[6] = -cphi * stheta; F[7] = -sphi * stheta; F[8] = ctheta;
+        }
+        else {
+            F[0] = 1.0; F[4] = 1.0; F[8] = 1.0;
+        }
+    }
+}
+
+// reflect the y and z-components and then rotate by phi0, as in dipole_field_Bn
+void DipoleFieldOperator::symmetric_image(int s, const double* x, double* y) const
+{
+    double cphi0 = symmetries[3 * s], sphi0 = symmetries[3 * s + 1], sign = symmetries[3 * s + 2];
+    y[0] = x[0] * cphi0 - x[1] * sphi0 * sign;
+    y[1] = x[0] * sphi0 + x[1] * cphi0 * sign;
+    y[2] = x[2] * sign;
+}
+
+// Same kernel as dipole_field_Bn. The rotation into the grid-aligned
+// coordinates is linear, so it is applied once after summing over the
+// symmetric copies of the dipole.
+void DipoleFieldOperator::entry(int i, int j, double* a) const
+{
+    const double* x = &points[3 * i];
+    const double* n = &normals[3 * i];
+    double g0 = 0.0, g1 = 0.0, g2 = 0.0;
+    for (int s = 0; s < nsym; ++s) {
+        const double* mp = &images[3 * (j * nsym + s)];
+        double rx = x[0] - mp[0], ry = x[1] - mp[1], rz = x[2] - mp[2];
+        double rmag_inv = rsqrt(rx * rx + ry * ry + rz * rz);
+        double rmag_inv_3 = rmag_inv * (rmag_inv * rmag_inv);
+        double rmag_inv_5 = rmag_inv_3 * (rmag_inv * rmag_inv);
+        double rdotn = rx * n[0] + ry * n[1] + rz * n[2];
+        double Gx = 3.0 * rdotn * rx * rmag_inv_5 - n[0] * rmag_inv_3;
+        double Gy = 3.0 * rdotn * ry * rmag_inv_5 - n[1] * rmag_inv_3;
+        double Gz = 3.0 * rdotn * rz * rmag_inv_5 - n[2] * rmag_inv_3;
+        double cphi0 = symmetries[3 * s], sphi0 = symmetries[3 * s + 1];
+        g0 += (Gx * cphi0 + Gy * sphi0) * symmetries[3 * s + 2];
+        g1 += - Gx * sphi0 + Gy * cphi0;
+        g2 += Gz;
+    }
+    double fak = 1e-7 * weights[i];  // mu0 divided by 4 * pi factor
+    const double* F = &frames[9 * j];
+    a[0] = fak * (F[0] * g0 + F[1] * g1 + F[2] * g2);
+    a[1] = fak * (F[3] * g0 + F[4] * g1 + F[5] * g2);
+    a[2] = fak * (F[6] * g0 + F[7] * g1 + F[8] * g2);
+}
+
+void DipoleFieldOperator::apply(const double* m, double* res) const
+{
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_points; ++i) {
+        double a[3];
+        double sum = 0.0;
+        for (int j = 0; j < num_dipoles; ++j) {
+            entry(i, j, a);
+            sum += a[0] * m[3 * j] + a[1] * m[3 * j + 1] + a[2] * m[3 * j + 2];
+        }
+        res[i] = sum;
+    }
+}
+
+void DipoleFieldOperator::apply_transpose(const double* y, double* res) const
+{
+    #pragma omp parallel for schedule(static)
+    for (int j = 0; j < num_dipoles; ++j) {
+        double a[3];
+        double sum0 = 0.0, sum1 = 0.0, sum2 = 0.0;
+        for (int i = 0; i < num_points; ++i) {
+            entry(i, j, a);
+            sum0 += a[0] * y[i];
+            sum1 += a[1] * y[i];
+            sum2 += a[2] * y[i];
+        }
+        res[3 * j] = sum0;
+        res[3 * j + 1] = sum1;
+        res[3 * j + 2] = sum2;
+    }
+}
+
+void DipoleFieldOperator::apply_normal(const double* m, double* res) const
+{
+    if (!has_gram())
+        return DipoleFieldLinearOperator::apply_normal(m, res);
+    Eigen::Map<const Eigen::VectorXd> eigen_m(m, 3 * num_dipoles);
+    Eigen::Map<Eigen::VectorXd> eigen_res(res, 3 * num_dipoles);
+    eigen_res.noalias() = gram * eigen_m;
+}
+
+void DipoleFieldOperator::column(int j, double* res) const
+{
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_points; ++i) {
+        double a[3];
+        entry(i, j / 3, a);
+        res[i] = a[j % 3];
+    }
+}
+
+// Accumulate A^T A from blocks of rows of A, so that A is never stored.
+void DipoleFieldOperator::cache_gram()
+{
+    int ncols = 3 * num_dipoles;
+    int block_size = 64;
+    gram = Eigen::MatrixXd::Zero(ncols, ncols);
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> rows(block_size, ncols);
+    for (int i0 = 0; i0 < num_points; i0 += block_size) {
+        int nrows = std::min(block_size, num_points - i0);
+        #pragma omp parallel for schedule(static)
+        for (int k = 0; k < nrows; ++k) {
+            for (int j = 0; j < num_dipoles; ++j)
+                entry(i0 + k, j, &rows(k, 3 * j));
+        }
+        gram.selfadjointView<Eigen::Lower>().rankUpdate(rows.topRows(nrows).transpose());
+    }
+    gram = gram.selfadjointView<Eigen::Lower>();
+}
+
+void DipoleFieldLinearOperator::apply_normal(const double* m, double* res) const
+{
+    vector<double> Am(ngrid());
+    apply(m, Am.data());
+    apply_transpose(Am.data(), res);
+}
+
+void DipoleFieldLinearOperator::column_norms_squared(double* res) const
+{
+    vector<double> col(ngrid());
+    for (int j = 0; j < 3 * ndipoles(); ++j) {
+        column(j, col.data());
+        double norm2 = 0.0;
+        for (double c : col)
+            norm2 += c * c;
+        res[j] = norm2;
+    }
+}
+
+Array DipoleFieldLinearOperator::matvec(Array& m)
+{
+    if(m.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("m needs to be in row-major storage order");
+    if((int) m.size() != 3 * ndipoles())
+        throw std::runtime_error("m needs to have 3 * ndipoles entries");
+    Array res = xt::zeros<double>({ngrid()});
+    apply(m.data(), res.data());
+    return res;
+}
+
+Array DipoleFieldLinearOperator::rmatvec(Array& y)
+{
+    if(y.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("y needs to be in row-major storage order");
+    if((int) y.size() != ngrid())
+        throw std::runtime_error("y needs to have ngrid entries");
+    Array res = xt::zeros<double>({3 * ndipoles()});
+    apply_transpose(y.data(), res.data());
+    return res;
+}
+
+Array DipoleFieldLinearOperator::normal_matvec(Array& m)
+{
+    if(m.layout() != xt::layout_type::row_major)
+          throw std::runtime_error("m needs to be in row-major storage order");
+    if((int) m.size() != 3 * ndipoles())
+        throw std::runtime_error("m needs to have 3 * ndipoles entries");
+    Array res = xt::zeros<double>({3 * ndipoles()});
+    apply_normal(m.data(), res.data());
+    return res;
+}
+
+Array DipoleFieldLinearOperator::get_column(int j)
+{
+    if(j < 0 || j >= 3 * ndipoles())
+        throw std::runtime_error("column index out of range");
+    Array res = xt::zeros<double>({ngrid()});
+    column(j, res.data());
+    return res;
+}
+
+Array DipoleFieldOperator::dense()
+{
+    Array A = xt::zeros<double>({num_points, 3 * num_dipoles});
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < num_points; ++i) {
+        for (int j = 0; j < num_dipoles; ++j)
+            entry(i, j, &A(i, 3 * j));
+    }
+    return A;
+}
@@ -4,8 +4,11 @@
 #include <tuple>  // c++ tuples
 #include <string> // for string class
 #include <iostream>
+#include <vector>
+#include <Eigen/Core>
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
 typedef xt::pyarray<double> Array;
+using std::vector;
 
 Array dipole_field_B(Array& points, Array& m_points, Array& m);
 
@@ -18,3 +21,74 @@ Array dipole_field_dA(Array& points, Array& m_points, Array& m);
 Array dipole_field_Bn(Array& points, Array& m_points, Array& unitnormal, int nfp, int stellsym, Array& b, std::string coordinate_flag="cartesian", double R0=0.0);
 
 Array define_a_uniform_cartesian_grid_between_two_toroidal_surfaces(Array& normal_inner, Array& normal_outer, Array& xyz_uniform, Array& xyz_inner, Array& xyz_outer);
+
+// Common interface of the representations of the matrix A returned by
+// dipole_field_Bn, reshaped to (ngrid, 3N) and with row i scaled by
+// weights(i), that never store A as a dense array.
+class DipoleFieldLinearOperator {
+    public:
+        virtual ~DipoleFieldLinearOperator() = default;
+
+        virtual int ngrid() const = 0;
+        virtual int ndipoles() const = 0;
+
+        // res = A m, with m of length 3N and res of length ngrid
+        virtual void apply(const double* m, double* res) const = 0;
+        // res = A^T y, with y of length ngrid and res of length 3N
+        virtual void apply_transpose(const double* y, double* res) const = 0;
+        // res = A^T A m
+        virtual void apply_normal(const double* m, double* res) const;
+        // res = A(:, j), with res of length ngrid
+        virtual void column(int j, double* res) const = 0;
+        // res_j = ||A(:, j)||^2 for all 3N columns
+        virtual void column_norms_squared(double* res) const;
+
+        Array matvec(Array& m);
+        Array rmatvec(Array& y);
+        Array normal_matvec(Array& m);
+        Array get_column(int j);
+};
+
+// Applies A and its transpose by recomputing the entries on the fly from the
+// dipole locations and the plasma points, so memory is O(ngrid + N) instead
+// of O(ngrid N). When 3N < ngrid the Gram matrix A^T A is smaller than A and
+// can be cached with cache_gram() instead.
+class DipoleFieldOperator : public DipoleFieldLinearOperator {
+    public:
+        DipoleFieldOperator(Array& points, Array& m_points, Array& unitnormal, int nfp, int stellsym, Array& weights, std::string coordinate_flag="cartesian", double R0=0.0);
+
+        int ngrid() const override { return num_points; }
+        int ndipoles() const override { return num_dipoles; }
+
+        void apply(const double* m, double* res) const override;
+        void apply_transpose(const double* y, double* res) const override;
+        // uses the cached Gram matrix if there is one
+        void apply_normal(const double* m, double* res) const override;
+        void column(int j, double* res) const override;
+
+        void cache_gram();
+        void clear_gram() { gram.resize(0, 0); }
+        bool has_gram() const { return gram.size() > 0; }
+
+        // the three entries A(i, 3j:3j+3)
+        void entry(int i, int j, double* a) const;
+        // number of symmetric copies of each dipole, and the location y of
+        // copy s of a dipole at x
+        int nsymmetries() const { return nsym; }
+        void symmetric_image(int s, const double* x, double* y) const;
+        const double* point(int i) const { return &points[3 * i]; }
+
+        // the dense matrix A, only meant for testing on small problems
+        Array dense();
+
+    private:
+        int num_points, num_dipoles, nsym;
+        vector<double> points, normals, weights;
+        // (N, nsym, 3) locations of the symmetric copies of each dipole
+        vector<double> images;
+        // (nsym, 3) cos(phi0), sin(phi0) and (-1)^stell of each copy
+        vector<double> symmetries;
+        // (N, 3, 3) rotation from cartesian to the grid-aligned coordinates of each dipole
+        vector<double> frames;
+        Eigen::MatrixXd gram;
+};
@@ -0,0 +1,390 @@
+#include "dipole_field_hmatrix.h"
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+DipoleFieldHMatrix::DipoleFieldHMatrix(Array& points, Array& m_points, Array& unitnormal, int nfp, int stellsym, Array& weights, std::string coordinate_flag, double R0, double tol, int leaf_size, double eta) :
+    kernel(points, m_points, unitnormal, nfp, stellsym, weights, coordinate_flag, R0), tol(tol), eta(eta), leaf_size(leaf_size)
+{
+    if(tol <= 0 || leaf_size <= 0 || eta <= 0)
+        throw std::runtime_error("tol, leaf_size and eta need to be positive");
+    int num_points = kernel.ngrid();
+    int num_dipoles = kernel.ndipoles();
+
+    vector<double> point_xyz(kernel.point(0), kernel.point(0) + 3 * num_points);
+    vector<double> dipole_xyz(3 * num_dipoles);
+    for (int j = 0; j < num_dipoles; ++j)
+        for (int d = 0; d < 3; ++d)
+            dipole_xyz[3 * j + d] = m_points(j, d);
+
+    point_perm.resize(num_points);
+    dipole_perm.resize(num_dipoles);
+    std::iota(point_perm.begin(), point_perm.end(), 0);
+    std::iota(dipole_perm.begin(), dipole_perm.end(), 0);
+    build_tree(point_xyz, point_perm, point_tree, 0, num_points);
+    build_tree(dipole_xyz, dipole_perm, dipole_tree, 0, num_dipoles);
+    dipole_inv.resize(num_dipoles);
+    for (int q = 0; q < num_dipoles; ++q)
+        dipole_inv[dipole_perm[q]] = q;
+
+    vector<std::pair<int, int>> leaves;
+    vector<bool> lowrank;
+    partition(0, 0, leaves, lowrank);
+    blocks.resize(leaves.size());
+    for (size_t k = 0; k < leaves.size(); ++k) {
+        const Cluster& t = point_tree[leaves[k].first];
+        const Cluster& s = dipole_tree[leaves[k].second];
+        blocks[k].row_begin = t.begin;
+        blocks[k].row_end = t.end;
+        blocks[k].col_begin = s.begin;
+        blocks[k].col_end = s.end;
+        blocks[k].lowrank = lowrank[k];
+    }
+
+    #pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < (int) blocks.size(); ++k) {
+        if (blocks[k].lowrank)
+            fill_aca(blocks[k]);
+        else
+            fill_dense(blocks[k]);
+    }
+}
+
+// Recursive bisection along the longest side of the bounding box. Returns
+// the index of the new cluster in `tree`; the root is cluster 0.
+int DipoleFieldHMatrix::build_tree(const vector<double>& xyz, vector<int>& perm, vector<Cluster>& tree, int begin, int end)
+{
+    int idx = tree.size();
+    tree.push_back(Cluster());
+    Cluster c;
+    c.begin = begin;
+    c.end = end;
+    for (int d = 0; d < 3; ++d) {
+        c.lo[d] = std::numeric_limits<double>::infinity();
+        c.hi[d] = -std::numeric_limits<double>::infinity();
+    }
+    for (int k = begin; k < end; ++k) {
+        for (int d = 0; d < 3; ++d) {
+            c.lo[d] = std::min(c.lo[d], xyz[3 * perm[k] + d]);
+            c.hi[d] = std::max(c.hi[d], xyz[3 * perm[k] + d]);
+        }
+    }
+    if (end - begin > leaf_size) {
+        int axis = 0;
+        for (int d = 1; d < 3; ++d)
+            if (c.hi[d] - c.lo[d] > c.hi[axis] - c.lo[axis])
+                axis = d;
+        int mid = begin + (end - begin) / 2;
+        std::nth_element(perm.begin() + begin, perm.begin() + mid, perm.begin() + end,
+                [&](int a, int b) { return xyz[3 * a + axis] < xyz[3 * b + axis]; });
+        c.left = build_tree(xyz, perm, tree, begin, mid);
+        c.right = build_tree(xyz, perm, tree, mid, end);
+    }
+    tree[idx] = c;
+    return idx;
+}
+
+// A block is admissible if both clusters are small compared to the distance
+// between the point cluster and every symmetric copy of the dipole cluster.
+// The copies of the dipole bounding box are bounded by the bounding box of
+// the copies of its corners.
+bool DipoleFieldHMatrix::admissible(const Cluster& t, const Cluster& s) const
+{
+    auto diam = [](const Cluster& c) {
+        return std::sqrt((c.hi[0] - c.lo[0]) * (c.hi[0] - c.lo[0]) + (c.hi[1] - c.lo[1]) * (c.hi[1] - c.lo[1]) + (c.hi[2] - c.lo[2]) * (c.hi[2] - c.lo[2]));
+    };
+    double size = std::max(diam(t), diam(s));
+    double dist = std::numeric_limits<double>::infinity();
+    for (int sym = 0; sym < kernel.nsymmetries(); ++sym) {
+        double lo[3], hi[3];
+        for (int d = 0; d < 3; ++d) {
+            lo[d] = std::numeric_limits<double>::infinity();
+            hi[d] = -std::numeric_limits<double>::infinity();
+        }
+        for (int corner = 0; corner < 8; ++corner) {
+            double x[3] = {(corner & 1) ? s.hi[0] : s.lo[0], (corner & 2) ? s.hi[1] : s.lo[1], (corner & 4) ? s.hi[2] : s.lo[2]};
+            double y[3];
+            kernel.symmetric_image(sym, x, y);
+            for (int d = 0; d < 3; ++d) {
+                lo[d] = std::min(lo[d], y[d]);
+                hi[d] = std::max(hi[d], y[d]);
+            }
+        }
+        double dist2 = 0.0;
+        for (int d = 0; d < 3; ++d) {
+            double gap = std::max({0.0, lo[d] - t.hi[d], t.lo[d] - hi[d]});
+            dist2 += gap * gap;
+        }
+        dist = std::min(dist, std::sqrt(dist2));
+    }
+    return size <= eta * dist;
+}
+
+void DipoleFieldHMatrix::partition(int t, int s, vector<std::pair<int, int>>& leaves, vector<bool>& lowrank) const
+{
+    const Cluster& ct = point_tree[t];
+    const Cluster& cs = dipole_tree[s];
+    if (admissible(ct, cs)) {
+        leaves.push_back({t, s});
+        lowrank.push_back(true);
+    } else if (ct.left < 0 && cs.left < 0) {
+        leaves.push_back({t, s});
+        lowrank.push_back(false);
+    } else if (ct.left < 0) {
+        partition(t, cs.left, leaves, lowrank);
+        partition(t, cs.right, leaves, lowrank);
+    } else if (cs.left < 0) {
+        partition(ct.left, s, leaves, lowrank);
+        partition(ct.right, s, leaves, lowrank);
+    } else {
+        partition(ct.left, cs.left, leaves, lowrank);
+        partition(ct.left, cs.right, leaves, lowrank);
+        partition(ct.right, cs.left, leaves, lowrank);
+        partition(ct.right, cs.right, leaves, lowrank);
+    }
+}
+
+// row i and column c of a block, in the local (permuted) numbering
+void DipoleFieldHMatrix::block_row(const Block& b, int i, double* row) const
+{
+    int p = point_perm[b.row_begin + i];
+    for (int q = 0; q < b.col_end - b.col_begin; ++q)
+        kernel.entry(p, dipole_perm[b.col_begin + q], row + 3 * q);
+}
+
+void DipoleFieldHMatrix::block_column(const Block& b, int c, double* col) const
+{
+    int j = dipole_perm[b.col_begin + c / 3];
+    double a[3];
+    for (int i = 0; i < b.row_end - b.row_begin; ++i) {
+        kernel.entry(point_perm[b.row_begin + i], j, a);
+        col[i] = a[c % 3];
+    }
+}
+
+void DipoleFieldHMatrix::fill_dense(Block& b) const
+{
+    int m = b.row_end - b.row_begin;
+    int n = 3 * (b.col_end - b.col_begin);
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor> D(m, n);
+    for (int i = 0; i < m; ++i)
+        block_row(b, i, &D(i, 0));
+    b.D = D;
+    b.lowrank = false;
+}
+
+// Adaptive cross approximation with partial pivoting, followed by a
+// recompression of U V^T with a QR decomposition of both factors and an SVD of
+// the small core matrix. Falls back to a dense block if the rank gets too large
+// for the low rank form to save memory.
+void DipoleFieldHMatrix::fill_aca(Block& b) const
+{
+    int m = b.row_end - b.row_begin;
+    int n = 3 * (b.col_end - b.col_begin);
+    int max_rank = std::min(m, n) / 2;
+    vector<Eigen::VectorXd> us, vs;
+    vector<bool> used(m, false);
+    Eigen::VectorXd row(n), col(m);
+    double norm2 = 0.0;
+    int i = 0;
+    while (true) {
+        block_row(b, i, row.data());
+        for (size_t l = 0; l < us.size(); ++l)
+            row -= us[l](i) * vs[l];
+        used[i] = true;
+        int j;
+        double pivot = row.cwiseAbs().maxCoeff(&j);
+        if (pivot == 0.0) {
+            // this row is already reproduced exactly, try the next unused one
+            auto next = std::find(used.begin(), used.end(), false);
+            if (next == used.end())
+                break;
+            i = std::distance(used.begin(), next);
+            continue;
+        }
+        Eigen::VectorXd v = row / row(j);
+        block_column(b, j, col.data());
+        for (size_t l = 0; l < us.size(); ++l)
+            col -= vs[l](j) * us[l];
+
+        // update the estimate of the Frobenius norm of the approximation
+        double uu = col.squaredNorm(), vv = v.squaredNorm();
+        for (size_t l = 0; l < us.size(); ++l)
+            norm2 += 2 * us[l].dot(col) * vs[l].dot(v);
+        norm2 += uu * vv;
+        us.push_back(col);
+        vs.push_back(v);
+        if (std::sqrt(uu * vv) <= tol * std::sqrt(norm2))
+            break;
+        if ((int) us.size() >= max_rank)
+            return fill_dense(b);
+
+        // the next pivot row is the unused row where the new column is largest
+        i = -1;
+        double best = -1.0;
+        for (int r = 0; r < m; ++r) {
+            if (!used[r] && std::abs(col(r)) > best) {
+                best = std::abs(col(r));
+                i = r;
+            }
+        }
+        if (i < 0)
+            break;
+    }
+
+    int k = us.size();
+    if (k == 0) {
+        b.U = Eigen::MatrixXd::Zero(m, 0);
+        b.V = Eigen::MatrixXd::Zero(n, 0);
+        return;
+    }
+    Eigen::MatrixXd U(m, k), V(n, k);
+    for (int l = 0; l < k; ++l) {
+        U.col(l) = us[l];
+        V.col(l) = vs[l];
+    }
+    Eigen::HouseholderQR<Eigen::MatrixXd> qu(U), qv(V);
+    Eigen::MatrixXd Ru = qu.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+    Eigen::MatrixXd Rv = qv.matrixQR().topRows(k).triangularView<Eigen::Upper>();
+    Eigen::JacobiSVD<Eigen::MatrixXd> svd(Ru * Rv.transpose(), Eigen::ComputeThinU | Eigen::ComputeThinV);
+    const Eigen::VectorXd& sigma = svd.singularValues();
+    // smallest rank r with ||sigma(r:)|| <= tol ||sigma||
+    double total = sigma.squaredNorm(), tail = total;
+    int r = 0;
+    while (r < k && tail > tol * tol * total) {
+        tail -= sigma(r) * sigma(r);
+        r++;
+    }
+    r = std::max(r, 1);
+    Eigen::MatrixXd Qu = qu.householderQ() * Eigen::MatrixXd::Identity(m, k);
+    Eigen::MatrixXd Qv = qv.householderQ() * Eigen::MatrixXd::Identity(n, k);
+    b.U = Qu * (svd.matrixU().leftCols(r) * sigma.head(r).asDiagonal());
+    b.V = Qv * svd.matrixV().leftCols(r);
+}
+
+void DipoleFieldHMatrix::apply(const double* m, double* res) const
+{
+    int num_points = ngrid();
+    std::fill(res, res + num_points, 0.0);
+    #pragma omp parallel
+    {
+        vector<double> local(num_points, 0.0);
+        Eigen::VectorXd x, y;
+        #pragma omp for schedule(dynamic)
+        for (int k = 0; k < (int) blocks.size(); ++k) {
+            const Block& b = blocks[k];
+            int ncols = b.col_end - b.col_begin;
+            x.resize(3 * ncols);
+            for (int q = 0; q < ncols; ++q)
+                for (int d = 0; d < 3; ++d)
+                    x(3 * q + d) = m[3 * dipole_perm[b.col_begin + q] + d];
+            if (b.lowrank)
+                y = b.U * (b.V.transpose() * x);
+            else
+                y = b.D * x;
+            for (int i = 0; i < b.row_end - b.row_begin; ++i)
+                local[point_perm[b.row_begin + i]] += y(i);
+        }
+        #pragma omp critical
+        for (int i = 0; i < num_points; ++i)
+            res[i] += local[i];
+    }
+}
+
+void DipoleFieldHMatrix::apply_transpose(const double* yin, double* res) const
+{
+    int n = 3 * ndipoles();
+    std::fill(res, res + n, 0.0);
+    #pragma omp parallel
+    {
+        vector<double> local(n, 0.0);
+        Eigen::VectorXd x, y;
+        #pragma omp for schedule(dynamic)
+        for (int k = 0; k < (int) blocks.size(); ++k) {
+            const Block& b = blocks[k];
+            int nrows = b.row_end - b.row_begin;
+            y.resize(nrows);
+            for (int i = 0; i < nrows; ++i)
+                y(i) = yin[point_perm[b.row_begin + i]];
+            if (b.lowrank)
+                x = b.V * (b.U.transpose() * y);
+            else
+                x = b.D.transpose() * y;
+            for (int q = 0; q < b.col_end - b.col_begin; ++q)
+                for (int d = 0; d < 3; ++d)
+                    local[3 * dipole_perm[b.col_begin + q] + d] += x(3 * q + d);
+        }
+        #pragma omp critical
+        for (int j = 0; j < n; ++j)
+            res[j] += local[j];
+    }
+}
+
+void DipoleFieldHMatrix::column(int j, double* res) const
+{
+    std::fill(res, res + ngrid(), 0.0);
+    int q = dipole_inv[j / 3];
+    for (const Block& b : blocks) {
+        if (q < b.col_begin || q >= b.col_end)
+            continue;
+        int c = 3 * (q - b.col_begin) + j % 3;
+        Eigen::VectorXd y;
+        if (b.lowrank)
+            y = b.U * b.V.row(c).transpose();
+        else
+            y = b.D.col(c);
+        for (int i = 0; i < b.row_end - b.row_begin; ++i)
+            res[point_perm[b.row_begin + i]] += y(i);
+    }
+}
+
+// The blocks of a column are disjoint, so the squared norms of the column
+// restricted to each block add up. For a low rank block the squared norm of
+// column c is V(c, :) U^T U V(c, :)^T.
+void DipoleFieldHMatrix::column_norms_squared(double* res) const
+{
+    int n = 3 * ndipoles();
+    std::fill(res, res + n, 0.0);
+    #pragma omp parallel
+    {
+        vector<double> local(n, 0.0);
+        #pragma omp for schedule(dynamic)
+        for (int k = 0; k < (int) blocks.size(); ++k) {
+            const Block& b = blocks[k];
+            int ncols = 3 * (b.col_end - b.col_begin);
+            Eigen::VectorXd norms;
+            if (b.lowrank)
+                norms = ((b.V * (b.U.transpose() * b.U)).cwiseProduct(b.V)).rowwise().sum();
+            else
+                norms = b.D.colwise().squaredNorm().transpose();
+            for (int c = 0; c < ncols; ++c)
+                local[3 * dipole_perm[b.col_begin + c / 3] + c % 3] += norms(c);
+        }
+        #pragma omp critical
+        for (int j = 0; j < n; ++j)
+            res[j] += local[j];
+    }
+}
+
+size_t DipoleFieldHMatrix::memory() const
+{
+    size_t total = 0;
+    for (const Block& b : blocks)
+        total += b.U.size() + b.V.size() + b.D.size();
+    return total;
+}
+
+int DipoleFieldHMatrix::max_rank() const
+{
+    int rank = 0;
+    for (const Block& b : blocks)
+        if (b.lowrank)
+            rank = std::max(rank, int(b.U.cols()));
+    return rank;
+}
+
+int DipoleFieldHMatrix::nlowrank() const
+{
+    return std::count_if(blocks.begin(), blocks.end(), [](const Block& b) { return b.lowrank; });
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+#include <Eigen/Core>
+#include "dipole_field.h"
+
+// Hierarchical matrix approximation of the matrix A of dipole_field_Bn
+// (reshaped to (ngrid, 3N) with row i scaled by weights(i)). The plasma points
+// and the dipoles are both organised in a cluster tree obtained by recursive
+// bisection. A block of A between a patch of the plasma surface and a cluster
+// of dipoles whose symmetric copies are all far away from the patch is
+// numerically low rank, and is stored as U V^T computed by adaptive cross
+// approximation (ACA) to a relative accuracy tol. The remaining blocks, which
+// are small, are stored densely.
+class DipoleFieldHMatrix : public DipoleFieldLinearOperator {
+    public:
+        DipoleFieldHMatrix(Array& points, Array& m_points, Array& unitnormal, int nfp, int stellsym, Array& weights, std::string coordinate_flag="cartesian", double R0=0.0, double tol=1e-6, int leaf_size=32, double eta=2.0);
+
+        int ngrid() const override { return kernel.ngrid(); }
+        int ndipoles() const override { return kernel.ndipoles(); }
+
+        void apply(const double* m, double* res) const override;
+        void apply_transpose(const double* y, double* res) const override;
+        void column(int j, double* res) const override;
+        void column_norms_squared(double* res) const override;
+
+        // number of doubles stored, and that number relative to the dense matrix
+        size_t memory() const;
+        double compression_ratio() const { return double(memory()) / (double(ngrid()) * 3 * ndipoles()); }
+        int max_rank() const;
+        int nblocks() const { return blocks.size(); }
+        int nlowrank() const;
+
+    private:
+        struct Cluster {
+            // range of the cluster in the permuted ordering
+            int begin, end;
+            double lo[3], hi[3];
+            int left = -1, right = -1;
+        };
+
+        // Dense blocks only use D. Low rank blocks store the block as U V^T.
+        // Rows are plasma points and columns are the 3 components of each
+        // dipole, both in the permuted ordering.
+        struct Block {
+            int row_begin, row_end, col_begin, col_end;
+            bool lowrank;
+            Eigen::MatrixXd U, V, D;
+        };
+
+        DipoleFieldOperator kernel;
+        double tol, eta;
+        int leaf_size;
+        // point_perm[k] and dipole_perm[k] are the original indices of the k-th
+        // point and dipole in the cluster ordering, dipole_inv is the inverse
+        vector<int> point_perm, dipole_perm, dipole_inv;
+        vector<Cluster> point_tree, dipole_tree;
+        vector<Block> blocks;
+
+        int build_tree(const vector<double>& xyz, vector<int>& perm, vector<Cluster>& tree, int begin, int end);
+        bool admissible(const Cluster& t, const Cluster& s) const;
+        void partition(int t, int s, vector<std::pair<int, int>>& leaves, vector<bool>& lowrank) const;
+        void fill_dense(Block& b) const;
+        void fill_aca(Block& b) const;
+        void block_row(const Block& b, int i, double* row) const;
+        void block_column(const Block& b, int c, double* col) const;
+};
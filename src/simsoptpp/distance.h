@@ -0,0 +1,100 @@
+#pragma once
+
+#include <vector>
+#include <tuple>
+#include <cmath>
+#include <cstdint>
+using std::vector;
+using std::tuple;
+
+/*
+ * Uniform grid of cubes with side length `cellsize` over a collection of point
+ * clouds. The points are sorted by cell, and the non-empty cells are stored in
+ * a flat hash table with open addressing, so that looking up the points in a
+ * cell does not allocate and the points of a cell are contiguous in memory.
+ */
+class SpatialHashGrid {
+    public:
+        template<class Array>
+        SpatialHashGrid(const vector<Array>& pointClouds, double cellsize);
+
+        // Calls f(q) for all points q in the 27 cells around (x, y, z), which
+        // includes all points that are less than cellsize away.
+        template<class F>
+        void for_each_neighbour(double x, double y, double z, F f) const {
+            int64_t i = cell(x), j = cell(y), k = cell(z);
+            for (int ii = -1; ii <= 1; ++ii) {
+                for (int jj = -1; jj <= 1; ++jj) {
+                    for (int kk = -1; kk <= 1; ++kk) {
+                        int c = find(i + ii, j + jj, k + kk);
+                        if(c < 0)
+                            continue;
+                        for (int q = start[c]; q < start[c+1]; ++q)
+                            f(q);
+                    }
+                }
+            }
+        }
+
+        int size() const { return cloud.size(); }
+
+        // Coordinates of the q-th point, the cloud it belongs to and its index
+        // in that cloud.
+        vector<double> xyz;
+        vector<int> cloud;
+        vector<int> index;
+
+    private:
+        struct Slot {
+            int64_t i, j, k;
+            int cell; // -1 if the slot is empty
+        };
+        double cellsize;
+        vector<Slot> table;
+        uint64_t mask;
+        vector<int> start;
+
+        int64_t cell(double x) const {
+            return (int64_t) std::floor(x/cellsize);
+        }
+
+        uint64_t slot(int64_t i, int64_t j, int64_t k) const {
+            uint64_t h = uint64_t(i)*0x9E3779B97F4A7C15ull ^ uint64_t(j)*0xC2B2AE3D27D4EB4Full ^ uint64_t(k)*0x165667B19E3779F9ull;
+            return (h ^ (h >> 29)) & mask;
+        }
+
+        int find(int64_t i, int64_t j, int64_t k) const {
+            for (uint64_t s = slot(i, j, k);; s = (s + 1) & mask) {
+                const Slot& e = table[s];
+                if(e.cell < 0)
+                    return -1;
+                if(e.i == i && e.j == j && e.k == k)
+                    return e.cell;
+            }
+        }
+};
+
+// For all pairings (i, j) with j < i and j < num_base_curves of point clouds
+// that have two points less than threshold apart, returns (i, j, d, k, l),
+// where d is the distance between point k of cloud i and point l of cloud j,
+// the closest pair of points. No pairings are returned if threshold <= 0.
+template<class Array>
+vector<tuple<int, int, double, int, int>> closest_points_within_collection(vector<Array>& pointClouds, double threshold, int num_base_curves);
+
+// Same as above, but for all pairings of a cloud i in pointCloudsA and a cloud j in pointCloudsB.
+template<class Array>
+vector<tuple<int, int, double, int, int>> closest_points_between_two_collections(vector<Array>& pointCloudsA, vector<Array>& pointCloudsB, double threshold);
+
+/*
+ * Returns the penalty in CurveCurveDistance,
+ *
+ *     J = \sum_{i} \sum_{j < i, j < num_base_curves} 1/(n_i n_j) \sum_{k, l} |l_{i,k}| |l_{j,l}| max(0, d_min - |r_{i,k} - r_{j,l}|)^2,
+ *
+ * where r_{i,k} and l_{i,k} are the k-th row of gammas[i] and gammadashs[i]
+ * and n_i is the number of quadrature points of curve i. If dJ_by_dgammas
+ * and dJ_by_dgammadashs are not empty, they are set to the derivatives of J
+ * with respect to gammas and gammadashs. For minimum_distance <= 0, J and its
+ * derivatives are zero.
+ */
+template<class Array>
+double curve_curve_distance_penalty(vector<Array>& gammas, vector<Array>& gammadashs, double minimum_distance, int num_base_curves, vector<Array>& dJ_by_dgammas, vector<Array>& dJ_by_dgammadashs);
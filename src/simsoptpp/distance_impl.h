@@ -0,0 +1,263 @@
+#pragma once
+
+#include "distance.h"
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+
+template<class Array>
+SpatialHashGrid::SpatialHashGrid(const vector<Array>& pointClouds, double cellsize) : cellsize(cellsize) {
+    if(!(cellsize > 0))
+        throw std::runtime_error("cellsize needs to be positive");
+    int n = 0;
+    for (auto& points : pointClouds)
+        n += points.shape(0);
+    uint64_t capacity = 16;
+    while(capacity < 2*uint64_t(n))
+        capacity *= 2;
+    table = vector<Slot>(capacity, {0, 0, 0, -1});
+    mask = capacity - 1;
+
+    // Find the cell of each point, adding the cell to the table if it is new.
+    vector<int> point_cell(n);
+    vector<int> count;
+    int q = 0;
+    for (auto& points : pointClouds) {
+        for (int l = 0; l < points.shape(0); ++l) {
+            int64_t i = cell(points(l, 0));
+            int64_t j = cell(points(l, 1));
+            int64_t k = cell(points(l, 2));
+            uint64_t s = slot(i, j, k);
+            while(table[s].cell >= 0 && !(table[s].i == i && table[s].j == j && table[s].k == k))
+                s = (s + 1) & mask;
+            if(table[s].cell < 0) {
+                table[s] = {i, j, k, int(count.size())};
+                count.push_back(0);
+            }
+            point_cell[q++] = table[s].cell;
+            count[table[s].cell]++;
+        }
+    }
+
+    // Counting sort of the points by cell.
+    start = vector<int>(count.size() + 1, 0);
+    for (int c = 0; c < count.size(); ++c)
+        start[c+1] = start[c] + count[c];
+    vector<int> next(start.begin(), start.end() - 1);
+    xyz = vector<double>(3*n);
+    cloud = vector<int>(n);
+    index = vector<int>(n);
+    q = 0;
+    for (int p = 0; p < pointClouds.size(); ++p) {
+        auto& points = pointClouds[p];
+        for (int l = 0; l < points.shape(0); ++l) {
+            int r = next[point_cell[q++]]++;
+            xyz[3*r + 0] = points(l, 0);
+            xyz[3*r + 1] = points(l, 1);
+            xyz[3*r + 2] = points(l, 2);
+            cloud[r] = p;
+            index[r] = l;
+        }
+    }
+}
+
+// The closest pair of points found so far for each pairing of clouds. Ties are
+// broken by the point indices, so that the result does not depend on the
+// order in which the threads find the pairs.
+struct ClosestPoints {
+    vector<double> dist2;
+    vector<int> k;
+    vector<int> l;
+
+    ClosestPoints(int npairs) : dist2(npairs, std::numeric_limits<double>::infinity()), k(npairs, -1), l(npairs, -1) {}
+
+    void update(int pair, double d2, int kk, int ll) {
+        if(d2 < dist2[pair] || (d2 == dist2[pair] && (kk < k[pair] || (kk == k[pair] && ll < l[pair])))) {
+            dist2[pair] = d2;
+            k[pair] = kk;
+            l[pair] = ll;
+        }
+    }
+
+    void merge(const ClosestPoints& other) {
+        for (int pair = 0; pair < dist2.size(); ++pair) {
+            if(other.k[pair] >= 0)
+                update(pair, other.dist2[pair], other.k[pair], other.l[pair]);
+        }
+    }
+};
+
+template<class Array>
+vector<tuple<int, int, double, int, int>> closest_points_within_collection(vector<Array>& pointClouds, double threshold, int num_base_curves) {
+    /*
+       The points of all clouds are put on a grid with cell size threshold,
+       so that only points in neighbouring cells have to be compared. Each
+       thread keeps the closest pairs it has found in its own buffer, and
+       the buffers are merged at the end.
+       */
+    if(threshold <= 0)
+        return {};
+    int nclouds = pointClouds.size();
+    int nbase = std::min(num_base_curves, nclouds);
+    SpatialHashGrid grid(pointClouds, threshold);
+    double t2 = threshold*threshold;
+    ClosestPoints closest(nclouds*nbase);
+#pragma omp parallel
+    {
+        ClosestPoints closest_private(nclouds*nbase);
+#pragma omp for
+        for (int q = 0; q < grid.size(); ++q) {
+            int i = grid.cloud[q];
+            const double* x = &grid.xyz[3*q];
+            grid.for_each_neighbour(x[0], x[1], x[2], [&](int r) {
+                int j = grid.cloud[r];
+                if(j >= i || j >= nbase)
+                    return;
+                const double* y = &grid.xyz[3*r];
+                double d2 = (x[0]-y[0])*(x[0]-y[0]) + (x[1]-y[1])*(x[1]-y[1]) + (x[2]-y[2])*(x[2]-y[2]);
+                if(d2 < t2)
+                    closest_private.update(i*nbase + j, d2, grid.index[q], grid.index[r]);
+            });
+        }
+#pragma omp critical
+        closest.merge(closest_private);
+    }
+
+    vector<tuple<int, int, double, int, int>> res;
+    for (int i = 0; i < nclouds; ++i) {
+        for (int j = 0; j < std::min(i, nbase); ++j) {
+            int pair = i*nbase + j;
+            if(closest.k[pair] >= 0)
+                res.push_back({i, j, std::sqrt(closest.dist2[pair]), closest.k[pair], closest.l[pair]});
+        }
+    }
+    return res;
+}
+
+template<class Array>
+vector<tuple<int, int, double, int, int>> closest_points_between_two_collections(vector<Array>& pointCloudsA, vector<Array>& pointCloudsB, double threshold) {
+    /*
+       Only the clouds in B are put on a grid, and the points in A are
+       looked up in it.
+       */
+    if(threshold <= 0)
+        return {};
+    int nA = pointCloudsA.size();
+    int nB = pointCloudsB.size();
+    SpatialHashGrid grid(pointCloudsB, threshold);
+    double t2 = threshold*threshold;
+    ClosestPoints closest(nA*nB);
+#pragma omp parallel
+    {
+        ClosestPoints closest_private(nA*nB);
+        for (int i = 0; i < nA; ++i) {
+            Array& points = pointCloudsA[i];
+#pragma omp for
+            for (int k = 0; k < points.shape(0); ++k) {
+                double x[3] = {points(k, 0), points(k, 1), points(k, 2)};
+                grid.for_each_neighbour(x[0], x[1], x[2], [&](int r) {
+                    const double* y = &grid.xyz[3*r];
+                    double d2 = (x[0]-y[0])*(x[0]-y[0]) + (x[1]-y[1])*(x[1]-y[1]) + (x[2]-y[2])*(x[2]-y[2]);
+                    if(d2 < t2)
+                        closest_private.update(i*nB + grid.cloud[r], d2, k, grid.index[r]);
+                });
+            }
+        }
+#pragma omp critical
+        closest.merge(closest_private);
+    }
+
+    vector<tuple<int, int, double, int, int>> res;
+    for (int i = 0; i < nA; ++i) {
+        for (int j = 0; j < nB; ++j) {
+            int pair = i*nB + j;
+            if(closest.k[pair] >= 0)
+                res.push_back({i, j, std::sqrt(closest.dist2[pair]), closest.k[pair], closest.l[pair]});
+        }
+    }
+    return res;
+}
+
+template<class Array>
+double curve_curve_distance_penalty(vector<Array>& gammas, vector<Array>& gammadashs, double minimum_distance, int num_base_curves, vector<Array>& dJ_by_dgammas, vector<Array>& dJ_by_dgammadashs) {
+    /*
+       Only pairs of points less than minimum_distance apart contribute, so
+       the points are put on a grid with that cell size and each point is
+       only compared with the points in the neighbouring cells. Each point
+       collects the derivatives with respect to its own gamma and gammadash,
+       so the pairs are visited from both sides but no two threads write to
+       the same entry.
+       */
+    int ncurves = gammas.size();
+    int nbase = std::min(num_base_curves, ncurves);
+    bool derivatives = dJ_by_dgammas.size() > 0;
+    if(minimum_distance <= 0) {
+        // no two points are ever closer than that
+        if(derivatives) {
+            for (int i = 0; i < ncurves; ++i) {
+                for (int k = 0; k < gammas[i].shape(0); ++k) {
+                    for (int d = 0; d < 3; ++d) {
+                        dJ_by_dgammas[i](k, d) = 0.;
+                        dJ_by_dgammadashs[i](k, d) = 0.;
+                    }
+                }
+            }
+        }
+        return 0.;
+    }
+    SpatialHashGrid grid(gammas, minimum_distance);
+    int n = grid.size();
+    vector<double> arclength(n);
+    vector<double> weight(n);
+    for (int q = 0; q < n; ++q) {
+        auto& l = gammadashs[grid.cloud[q]];
+        int k = grid.index[q];
+        arclength[q] = std::sqrt(l(k, 0)*l(k, 0) + l(k, 1)*l(k, 1) + l(k, 2)*l(k, 2));
+        weight[q] = arclength[q]/gammas[grid.cloud[q]].shape(0);
+    }
+
+    double d2min = minimum_distance*minimum_distance;
+    double J = 0.;
+#pragma omp parallel for reduction(+:J) schedule(dynamic, 64)
+    for (int q = 0; q < n; ++q) {
+        int i = grid.cloud[q];
+        const double* x = &grid.xyz[3*q];
+        double dJ_by_dx[3] = {0., 0., 0.};
+        double dJ_by_darclength = 0.;
+        grid.for_each_neighbour(x[0], x[1], x[2], [&](int r) {
+            int j = grid.cloud[r];
+            if(!((j < i && j < nbase) || (i < j && i < nbase)))
+                return;
+            const double* y = &grid.xyz[3*r];
+            double diff[3] = {x[0]-y[0], x[1]-y[1], x[2]-y[2]};
+            double d2 = diff[0]*diff[0] + diff[1]*diff[1] + diff[2]*diff[2];
+            if(d2 >= d2min)
+                return;
+            double d = std::sqrt(d2);
+            double pen = minimum_distance - d;
+            if(j < i)
+                J += weight[q]*weight[r]*pen*pen;
+            if(derivatives) {
+                if(d > 0) {
+                    double c = -2*weight[q]*weight[r]*pen/d;
+                    dJ_by_dx[0] += c*diff[0];
+                    dJ_by_dx[1] += c*diff[1];
+                    dJ_by_dx[2] += c*diff[2];
+                }
+                dJ_by_darclength += weight[r]*pen*pen;
+            }
+        });
+        if(derivatives) {
+            int k = grid.index[q];
+            auto& res_gamma = dJ_by_dgammas[i];
+            auto& res_gammadash = dJ_by_dgammadashs[i];
+            auto& l = gammadashs[i];
+            double c = arclength[q] > 0 ? dJ_by_darclength/(gammas[i].shape(0)*arclength[q]) : 0.;
+            for (int d = 0; d < 3; ++d) {
+                res_gamma(k, d) = dJ_by_dx[d];
+                res_gammadash(k, d) = c*l(k, d);
+            }
+        }
+    }
+    return J;
+}
@@ -0,0 +1,8 @@
+#include "distance_impl.h"
+#include "xtensor-python/pyarray.hpp"     // Numpy bindings
+typedef xt::pyarray<double> Array;
+
+template SpatialHashGrid::SpatialHashGrid(const vector<Array>& pointClouds, double cellsize);
+template vector<tuple<int, int, double, int, int>> closest_points_within_collection<Array>(vector<Array>& pointClouds, double threshold, int num_base_curves);
+template vector<tuple<int, int, double, int, int>> closest_points_between_two_collections<Array>(vector<Array>& pointCloudsA, vector<Array>& pointCloudsB, double threshold);
+template double curve_curve_distance_penalty<Array>(vector<Array>& gammas, vector<Array>& gammadashs, double minimum_distance, int num_base_curves, vector<Array>& dJ_by_dgammas, vector<Array>& dJ_by_dgammadashs);
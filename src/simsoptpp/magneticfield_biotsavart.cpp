@@ -3,12 +3,158 @@
 #include <fmt/core.h>
 #include <fmt/format.h>
 
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
+
 template<class Array>
 void set_array_to_zero(Array& data){
     std::fill(data.begin(), data.end(), 0.);
 }
 
 
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void BiotSavart<T, Array>::invalidate_changed_coils() {
+    int ncoils = this->coils.size();
+    if(coil_versions.size() != ncoils) {
+        coil_versions = vector<uint64_t>(ncoils, 0);
+        coil_points_versions = vector<uint64_t>(ncoils, 0);
+        field_cache.invalidate_cache();
+    }
+    for (int i = 0; i < ncoils; ++i) {
+        uint64_t version = this->coils[i]->curve->get_version();
+        if(coil_versions[i] == version && coil_points_versions[i] == points_version)
+            continue;
+        for(string key : {"B", "dB", "ddB", "A", "dA", "ddA"})
+            field_cache.invalidate(fmt::format("{}_{}", key, i));
+        coil_versions[i] = version;
+        coil_points_versions[i] = points_version;
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+std::vector<int> BiotSavart<T, Array>::coils_to_recompute(string field, int derivatives) {
+    this->invalidate_changed_coils();
+    std::vector<int> res;
+    int ncoils = this->coils.size();
+    for (int i = 0; i < ncoils; ++i) {
+        bool uptodate = field_cache.get_status(fmt::format("{}_{}", field, i));
+        if(derivatives > 0)
+            uptodate = uptodate && field_cache.get_status(fmt::format("d{}_{}", field, i));
+        if(derivatives > 1)
+            uptodate = uptodate && field_cache.get_status(fmt::format("dd{}_{}", field, i));
+        if(!uptodate)
+            res.push_back(i);
+    }
+    return res;
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void BiotSavart<T, Array>::compute_symmetric(string field, int derivatives, const std::vector<int>& coils_to_compute) {
+    if(derivatives < 0 || derivatives > 2)
+        throw logic_error("Only two derivatives of Biot Savart implemented");
+    bool vector_potential = field == "A";
+    auto& points = this->get_points_cart_ref();
+    int ncoils = this->coils.size();
+    int nbase = symmetry_base_curves.size();
+    if(!symmetry_perms_valid || symmetry_perms_points_version != points_version) {
+        symmetry_perms = vector<vector<int>>(ncoils);
+        for (int i = 0; i < ncoils; ++i)
+            symmetry_perms[i] = symmetry_permutation(points.data(), npoints, symmetry_matrices[i]);
+        symmetry_perms_points_version = points_version;
+        symmetry_perms_valid = true;
+    }
+
+    // the field of a base curve at the evaluation points is needed if one of
+    // its copies maps the points onto themselves. for all other coils we
+    // evaluate the base curve at the transformed points instead.
+    vector<bool> base_needed(nbase, false);
+    for (int i : coils_to_compute)
+        if(symmetry_perms[i].size() > 0)
+            base_needed[symmetry_base_idx[i]] = true;
+
+    // allocate all temporary arrays in serial, see compute()
+    vector<Array> base_F(nbase), base_dF(nbase), base_ddF(nbase);
+    vector<Array> coil_F(ncoils), coil_dF(ncoils), coil_ddF(ncoils);
+    auto allocate_field = [&](vector<Array>& F, vector<Array>& dF, vector<Array>& ddF, int i) {
+        F[i] = xt::zeros<double>({npoints, 3});
+        dF[i] = xt::zeros<double>({derivatives > 0 ? npoints : 1, 3, 3});
+        ddF[i] = xt::zeros<double>({derivatives > 1 ? npoints : 1, 3, 3, 3});
+    };
+    for (int b = 0; b < nbase; ++b)
+        if(base_needed[b])
+            allocate_field(base_F, base_dF, base_ddF, b);
+    for (int i : coils_to_compute)
+        if(symmetry_perms[i].size() == 0)
+            allocate_field(coil_F, coil_dF, coil_ddF, i);
+
+    auto kernel = [&](AlignedPaddedVec& px, AlignedPaddedVec& py, AlignedPaddedVec& pz, Array& gamma, Array& gammadash, Array& F, Array& dF, Array& ddF) {
+        if(vector_potential) {
+            if(derivatives == 0) biot_savart_kernel_A<Array, 0>(px, py, pz, gamma, gammadash, F, dF, ddF);
+            else if(derivatives == 1) biot_savart_kernel_A<Array, 1>(px, py, pz, gamma, gammadash, F, dF, ddF);
+            else biot_savart_kernel_A<Array, 2>(px, py, pz, gamma, gammadash, F, dF, ddF);
+        } else {
+            if(derivatives == 0) biot_savart_kernel_precision<Array, 0>(precision, px, py, pz, gamma, gammadash, F, dF, ddF);
+            else if(derivatives == 1) biot_savart_kernel_precision<Array, 1>(precision, px, py, pz, gamma, gammadash, F, dF, ddF);
+            else biot_savart_kernel_precision<Array, 2>(precision, px, py, pz, gamma, gammadash, F, dF, ddF);
+        }
+    };
+
+#pragma omp parallel for
+    for (int b = 0; b < nbase; ++b) {
+        if(!base_needed[b])
+            continue;
+        kernel(pointsx, pointsy, pointsz, symmetry_base_curves[b]->gamma(), symmetry_base_curves[b]->gammadash(), base_F[b], base_dF[b], base_ddF[b]);
+    }
+
+    int ncompute = coils_to_compute.size();
+#pragma omp parallel for
+    for (int ii = 0; ii < ncompute; ++ii) {
+        int i = coils_to_compute[ii];
+        int b = symmetry_base_idx[i];
+        const SymmetryMatrix& M = symmetry_matrices[i];
+        const vector<int>& perm = symmetry_perms[i];
+        Array* F = &base_F[b];
+        Array* dF = &base_dF[b];
+        Array* ddF = &base_ddF[b];
+        if(perm.size() == 0) {
+            AlignedPaddedVec px(npoints, 0.), py(npoints, 0.), pz(npoints, 0.);
+            double y[3];
+            for (int j = 0; j < npoints; ++j) {
+                symmetry_apply_transpose(M, &(points(j, 0)), y);
+                px[j] = y[0];
+                py[j] = y[1];
+                pz[j] = y[2];
+            }
+            kernel(px, py, pz, symmetry_base_curves[b]->gamma(), symmetry_base_curves[b]->gammadash(), coil_F[i], coil_dF[i], coil_ddF[i]);
+            F = &coil_F[i];
+            dF = &coil_dF[i];
+            ddF = &coil_ddF[i];
+        }
+        // the magnetic field is a pseudovector, the vector potential is not
+        double s = vector_potential ? 1. : symmetry_det(M);
+        Array& Fi = field_cache.get_or_create(fmt::format("{}_{}", field, i), {npoints, 3});
+        for (int j = 0; j < npoints; ++j) {
+            int k = perm.size() > 0 ? perm[j] : j;
+            symmetry_rotate_vector(M, s, &((*F)(k, 0)), &(Fi(j, 0)));
+        }
+        if(derivatives > 0) {
+            Array& dFi = field_cache.get_or_create(fmt::format("d{}_{}", field, i), {npoints, 3, 3});
+            for (int j = 0; j < npoints; ++j) {
+                int k = perm.size() > 0 ? perm[j] : j;
+                symmetry_rotate_rank2(M, s, &((*dF)(k, 0, 0)), &(dFi(j, 0, 0)));
+            }
+        }
+        if(derivatives > 1) {
+            Array& ddFi = field_cache.get_or_create(fmt::format("dd{}_{}", field, i), {npoints, 3, 3, 3});
+            for (int j = 0; j < npoints; ++j) {
+                int k = perm.size() > 0 ? perm[j] : j;
+                symmetry_rotate_rank3(M, s, &((*ddF)(k, 0, 0, 0)), &(ddFi(j, 0, 0, 0)));
+            }
+        }
+    }
+}
+
 template<template<class, std::size_t, xt::layout_type> class T, class Array>
 void BiotSavart<T, Array>::compute(int derivatives) {
     //fmt::print("Calling compute({})\n", derivatives);
@@ -27,61 +173,75 @@ void BiotSavart<T, Array>::compute(int derivatives) {
     set_array_to_zero(dB);
     set_array_to_zero(ddB);
 
+    // The fields of the individual coils are only recomputed for coils whose
+    // curve has changed (or if higher derivatives are requested than were
+    // computed before). If only the currents changed, the total field is
+    // simply summed up again from the cached fields of each coil.
+    std::vector<int> coils_to_compute = this->coils_to_recompute("B", derivatives);
     std::vector<double> currents(ncoils, 0.);
     // Creating new xtensor arrays from an openmp thread doesn't appear
     // to be safe. so we do that here in serial.
-    for (int i = 0; i < ncoils; ++i) {
-        this->coils[i]->curve->gamma();
-        this->coils[i]->curve->gammadash();
+    for (int i : coils_to_compute) {
+        auto curve = this->has_symmetry() ? symmetry_base_curves[symmetry_base_idx[i]] : this->coils[i]->curve;
+        curve->gamma();
+        curve->gammadash();
         field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
         if(derivatives > 0)
             field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
         if(derivatives > 1)
             field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
+    }
+    for (int i = 0; i < ncoils; ++i) {
         currents[i] = this->coils[i]->current->get_value();
     }
 
+    if(this->has_symmetry()) {
+        this->compute_symmetric("B", derivatives, coils_to_compute);
+    } else {
+        int ncompute = coils_to_compute.size();
 #pragma omp parallel for
-    for (int i = 0; i < ncoils; ++i) {
-        Array& Bi = field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
-        set_array_to_zero(Bi);
-        Array& gamma = this->coils[i]->curve->gamma();
-        Array& gammadash = this->coils[i]->curve->gammadash();
-        double current = currents[i];
-        if(derivatives == 0){
-            biot_savart_kernel<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dummyjac, dummyhess);
-        } else {
-            Array& dBi = field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
-            set_array_to_zero(dBi);
-            if(derivatives == 1) {
-                biot_savart_kernel<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, dummyhess);
+        for (int ii = 0; ii < ncompute; ++ii) {
+            int i = coils_to_compute[ii];
+            Array& Bi = field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
+            set_array_to_zero(Bi);
+            Array& gamma = this->coils[i]->curve->gamma();
+            Array& gammadash = this->coils[i]->curve->gammadash();
+            double current = currents[i];
+            if(derivatives == 0){
+                biot_savart_kernel_precision<Array, 0>(precision, pointsx, pointsy, pointsz, gamma, gammadash, Bi, dummyjac, dummyhess);
             } else {
-                Array& ddBi = field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
-                set_array_to_zero(ddBi);
-                if (derivatives == 2) {
-                    biot_savart_kernel<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, ddBi);
+                Array& dBi = field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
+                set_array_to_zero(dBi);
+                if(derivatives == 1) {
+                    biot_savart_kernel_precision<Array, 1>(precision, pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, dummyhess);
                 } else {
-                    throw logic_error("Only two derivatives of Biot Savart implemented");
+                    Array& ddBi = field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
+                    set_array_to_zero(ddBi);
+                    if (derivatives == 2) {
+                        biot_savart_kernel_precision<Array, 2>(precision, pointsx, pointsy, pointsz, gamma, gammadash, Bi, dBi, ddBi);
+                    } else {
+                        throw logic_error("Only two derivatives of Biot Savart implemented");
+                    }
                 }
             }
         }
     }
     for (int i = 0; i < ncoils; ++i) {
         Array& Bi = field_cache.get_or_create(fmt::format("B_{}", i), {npoints, 3});
-        double current = this->coils[i]->current->get_value();
+        double current = currents[i];
         xt::noalias(B) = B + current * Bi;
     }
     if(derivatives>=1) {
         for (int i = 0; i < ncoils; ++i) {
             Array& dBi = field_cache.get_or_create(fmt::format("dB_{}", i), {npoints, 3, 3});
-            double current = this->coils[i]->current->get_value();
+            double current = currents[i];
             xt::noalias(dB) = dB + current * dBi;
         }
     }
     if(derivatives>=2) {
         for (int i = 0; i < ncoils; ++i) {
             Array& ddBi = field_cache.get_or_create(fmt::format("ddB_{}", i), {npoints, 3, 3, 3});
-            double current = this->coils[i]->current->get_value();
+            double current = currents[i];
             xt::noalias(ddB) = ddB + current * ddBi;
         }
     }
@@ -112,65 +272,236 @@ void BiotSavart<T, Array>::compute_A(int derivatives) {
     // coils point at the same current in the background, and if the
     // `get_value` function for that is implemented in python, then this will
     // freeze in parallel.
+    std::vector<int> coils_to_compute = this->coils_to_recompute("A", derivatives);
     std::vector<double> currents(ncoils, 0.);
-    for (int i = 0; i < ncoils; ++i) {
-        this->coils[i]->curve->gamma();
-        this->coils[i]->curve->gammadash();
+    for (int i : coils_to_compute) {
+        auto curve = this->has_symmetry() ? symmetry_base_curves[symmetry_base_idx[i]] : this->coils[i]->curve;
+        curve->gamma();
+        curve->gammadash();
         field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
         if(derivatives > 0)
             field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
         if(derivatives > 1)
             field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
+    }
+    for (int i = 0; i < ncoils; ++i) {
         currents[i] = this->coils[i]->current->get_value();
     }
 
+    if(this->has_symmetry()) {
+        this->compute_symmetric("A", derivatives, coils_to_compute);
+    } else {
+        int ncompute = coils_to_compute.size();
 #pragma omp parallel for
-    for (int i = 0; i < ncoils; ++i) {
-        Array& Ai = field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
-        set_array_to_zero(Ai);
-        Array& gamma = this->coils[i]->curve->gamma();
-        Array& gammadash = this->coils[i]->curve->gammadash();
-        double current = currents[i];
-        if(derivatives == 0){
-            biot_savart_kernel_A<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dummyjac, dummyhess);
-        } else {
-            Array& dAi = field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
-            set_array_to_zero(dAi);
-            if(derivatives == 1) {
-                biot_savart_kernel_A<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, dummyhess);
+        for (int ii = 0; ii < ncompute; ++ii) {
+            int i = coils_to_compute[ii];
+            Array& Ai = field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
+            set_array_to_zero(Ai);
+            Array& gamma = this->coils[i]->curve->gamma();
+            Array& gammadash = this->coils[i]->curve->gammadash();
+            double current = currents[i];
+            if(derivatives == 0){
+                biot_savart_kernel_A<Array, 0>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dummyjac, dummyhess);
             } else {
-                Array& ddAi = field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
-                set_array_to_zero(ddAi);
-                if (derivatives == 2) {
-                    biot_savart_kernel_A<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, ddAi);
+                Array& dAi = field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
+                set_array_to_zero(dAi);
+                if(derivatives == 1) {
+                    biot_savart_kernel_A<Array, 1>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, dummyhess);
                 } else {
-                    throw logic_error("Only two derivatives of Biot Savart vector potential implemented");
+                    Array& ddAi = field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
+                    set_array_to_zero(ddAi);
+                    if (derivatives == 2) {
+                        biot_savart_kernel_A<Array, 2>(pointsx, pointsy, pointsz, gamma, gammadash, Ai, dAi, ddAi);
+                    } else {
+                        throw logic_error("Only two derivatives of Biot Savart vector potential implemented");
+                    }
                 }
             }
         }
     }
     for (int i = 0; i < ncoils; ++i) {
         Array& Ai = field_cache.get_or_create(fmt::format("A_{}", i), {npoints, 3});
-        double current = this->coils[i]->current->get_value();
+        double current = currents[i];
         xt::noalias(A) = A + current * Ai;
     }
     if(derivatives>=1) {
         for (int i = 0; i < ncoils; ++i) {
             Array& dAi = field_cache.get_or_create(fmt::format("dA_{}", i), {npoints, 3, 3});
-            double current = this->coils[i]->current->get_value();
+            double current = currents[i];
             xt::noalias(dA) = dA + current * dAi;
         }
     }
     if(derivatives>=2) {
         for (int i = 0; i < ncoils; ++i) {
             Array& ddAi = field_cache.get_or_create(fmt::format("ddA_{}", i), {npoints, 3, 3, 3});
-            double current = this->coils[i]->current->get_value();
+            double current = currents[i];
             xt::noalias(ddA) = ddA + current * ddAi;
         }
     }
 }
 
 
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void BiotSavart<T, Array>::compute_fused(string field, int derivatives) {
+    if(derivatives < 0 || derivatives > 2)
+        throw logic_error("Only two derivatives of Biot Savart implemented");
+    bool vector_potential = field == "A";
+    auto points = this->get_points_cart_ref();
+    Tensor3 _dummyjac = xt::zeros<double>({1, 1, 1});
+    Tensor4 _dummyhess = xt::zeros<double>({1, 1, 1, 1});
+    Tensor2& F = vector_potential ? data_A.get_or_create({npoints, 3}) : data_B.get_or_create({npoints, 3});
+    Tensor3& dF = derivatives >= 1 ? (vector_potential ? data_dA.get_or_create({npoints, 3, 3}) : data_dB.get_or_create({npoints, 3, 3})) : _dummyjac;
+    Tensor4& ddF = derivatives >= 2 ? (vector_potential ? data_ddA.get_or_create({npoints, 3, 3, 3}) : data_ddB.get_or_create({npoints, 3, 3, 3})) : _dummyhess;
+    set_array_to_zero(F);
+    set_array_to_zero(dF);
+    set_array_to_zero(ddF);
+
+    // gamma, gammadash and the currents may be computed in python, so get
+    // them in serial.
+    int ncoils = this->coils.size();
+    vector<Array*> gammas(ncoils), gammadashs(ncoils);
+    vector<double> currents(ncoils);
+    for (int i = 0; i < ncoils; ++i) {
+        gammas[i] = &(this->coils[i]->curve->gamma());
+        gammadashs[i] = &(this->coils[i]->curve->gammadash());
+        currents[i] = this->coils[i]->current->get_value();
+    }
+
+    // Each thread owns one tile sized buffer for the field of a single coil.
+    // Creating xtensor arrays from an openmp thread doesn't appear to be
+    // safe, so they are allocated here.
+#if defined(_OPENMP)
+    int nthreads = omp_get_max_threads();
+#else
+    int nthreads = 1;
+#endif
+    vector<Array> tile_F(nthreads), tile_dF(nthreads), tile_ddF(nthreads);
+    for (int t = 0; t < nthreads; ++t) {
+        tile_F[t] = xt::zeros<double>({fused_tile_size, 3});
+        tile_dF[t] = xt::zeros<double>({derivatives > 0 ? fused_tile_size : 1, 3, 3});
+        tile_ddF[t] = xt::zeros<double>({derivatives > 1 ? fused_tile_size : 1, 3, 3, 3});
+    }
+
+    int ntiles = (npoints + fused_tile_size - 1)/fused_tile_size;
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int tile = 0; tile < ntiles; ++tile) {
+#if defined(_OPENMP)
+        int tid = omp_get_thread_num();
+#else
+        int tid = 0;
+#endif
+        int start = tile * fused_tile_size;
+        int n = std::min(fused_tile_size, npoints - start);
+        AlignedPaddedVec px(n, 0.), py(n, 0.), pz(n, 0.);
+        for (int j = 0; j < n; ++j) {
+            px[j] = points(start+j, 0);
+            py[j] = points(start+j, 1);
+            pz[j] = points(start+j, 2);
+        }
+        Array& Fc = tile_F[tid];
+        Array& dFc = tile_dF[tid];
+        Array& ddFc = tile_ddF[tid];
+        for (int i = 0; i < ncoils; ++i) {
+            Array& gamma = *gammas[i];
+            Array& gammadash = *gammadashs[i];
+            if(vector_potential) {
+                if(derivatives == 0) biot_savart_kernel_A<Array, 0>(px, py, pz, gamma, gammadash, Fc, dFc, ddFc);
+                else if(derivatives == 1) biot_savart_kernel_A<Array, 1>(px, py, pz, gamma, gammadash, Fc, dFc, ddFc);
+                else biot_savart_kernel_A<Array, 2>(px, py, pz, gamma, gammadash, Fc, dFc, ddFc);
+            } else {
+                if(derivatives == 0) biot_savart_kernel_precision<Array, 0>(precision, px, py, pz, gamma, gammadash, Fc, dFc, ddFc);
+                else if(derivatives == 1) biot_savart_kernel_precision<Array, 1>(precision, px, py, pz, gamma, gammadash, Fc, dFc, ddFc);
+                else biot_savart_kernel_precision<Array, 2>(precision, px, py, pz, gamma, gammadash, Fc, dFc, ddFc);
+            }
+            double current = currents[i];
+            double* Fc_ptr = &(Fc(0, 0));
+            double* F_ptr = &(F(start, 0));
+            for (int k = 0; k < 3*n; ++k)
+                F_ptr[k] += current * Fc_ptr[k];
+            if(derivatives > 0) {
+                double* dFc_ptr = &(dFc(0, 0, 0));
+                double* dF_ptr = &(dF(start, 0, 0));
+                for (int k = 0; k < 9*n; ++k)
+                    dF_ptr[k] += current * dFc_ptr[k];
+            }
+            if(derivatives > 1) {
+                double* ddFc_ptr = &(ddFc(0, 0, 0, 0));
+                double* ddF_ptr = &(ddF(start, 0, 0, 0));
+                for (int k = 0; k < 27*n; ++k)
+                    ddF_ptr[k] += current * ddFc_ptr[k];
+            }
+        }
+    }
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+BiotSavartTree BiotSavart<T, Array>::build_tree() {
+    int ncoils = this->coils.size();
+    int nsources = 0;
+    for (int i = 0; i < ncoils; ++i)
+        nsources += this->coils[i]->curve->gamma().shape(0);
+    vector<double> positions(3*nsources, 0.);
+    vector<double> elements(3*nsources, 0.);
+    int offset = 0;
+    for (int i = 0; i < ncoils; ++i) {
+        Array& gamma = this->coils[i]->curve->gamma();
+        Array& gammadash = this->coils[i]->curve->gammadash();
+        int nquad = gamma.shape(0);
+        double fak = 1e-7 * this->coils[i]->current->get_value() / nquad;
+        for (int j = 0; j < nquad; ++j) {
+            for (int l = 0; l < 3; ++l) {
+                positions[3*(offset+j)+l] = gamma(j, l);
+                elements[3*(offset+j)+l] = fak * gammadash(j, l);
+            }
+        }
+        offset += nquad;
+    }
+    return BiotSavartTree(positions, elements, tree_theta, tree_order);
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void BiotSavart<T, Array>::compute_tree(int derivatives) {
+    auto points = this->get_points_cart_ref();
+    this->fill_points(points);
+    Tensor3 _dummyjac = xt::zeros<double>({1, 1, 1});
+    Tensor4 _dummyhess = xt::zeros<double>({1, 1, 1, 1});
+    Tensor2& B = data_B.get_or_create({npoints, 3});
+    Tensor3& dB = derivatives >= 1 ? data_dB.get_or_create({npoints, 3, 3}) : _dummyjac;
+    Tensor4& ddB = derivatives >= 2 ? data_ddB.get_or_create({npoints, 3, 3, 3}) : _dummyhess;
+
+    auto tree = this->build_tree();
+    if(derivatives == 0)
+        tree.template B<0>(pointsx, pointsy, pointsz, B, dB, ddB);
+    else if(derivatives == 1)
+        tree.template B<1>(pointsx, pointsy, pointsz, B, dB, ddB);
+    else if(derivatives == 2)
+        tree.template B<2>(pointsx, pointsy, pointsz, B, dB, ddB);
+    else
+        throw logic_error("Only two derivatives of Biot Savart implemented");
+}
+
+template<template<class, std::size_t, xt::layout_type> class T, class Array>
+void BiotSavart<T, Array>::compute_A_tree(int derivatives) {
+    auto points = this->get_points_cart_ref();
+    this->fill_points(points);
+    Tensor3 _dummyjac = xt::zeros<double>({1, 1, 1});
+    Tensor4 _dummyhess = xt::zeros<double>({1, 1, 1, 1});
+    Tensor2& A = data_A.get_or_create({npoints, 3});
+    Tensor3& dA = derivatives >= 1 ? data_dA.get_or_create({npoints, 3, 3}) : _dummyjac;
+    Tensor4& ddA = derivatives >= 2 ? data_ddA.get_or_create({npoints, 3, 3, 3}) : _dummyhess;
+
+    auto tree = this->build_tree();
+    if(derivatives == 0)
+        tree.template A<0>(pointsx, pointsy, pointsz, A, dA, ddA);
+    else if(derivatives == 1)
+        tree.template A<1>(pointsx, pointsy, pointsz, A, dA, ddA);
+    else if(derivatives == 2)
+        tree.template A<2>(pointsx, pointsy, pointsz, A, dA, ddA);
+    else
+        throw logic_error("Only two derivatives of Biot Savart vector potential implemented");
+}
+
+
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
 #include "xtensor-python/pytensor.hpp"     // Numpy bindings
 typedef xt::pyarray<double> PyArray;
@@ -1,9 +1,13 @@
 #pragma once 
 
 #include <vector>
+#include <fmt/core.h>
 #include "xtensor/xarray.hpp"
 #include "xtensor/xlayout.hpp"
 #include "simdhelpers.h"
+#include "biot_savart_impl.h"
+#include "biot_savart_tree.h"
+#include "biot_savart_symmetry.h"
 #include "magneticfield.h"
 #include "coil.h"
 
@@ -19,6 +23,36 @@ class BiotSavart : public MagneticField<T> {
 
     private:
         Cache<Array> field_cache;
+        // opening angle and expansion order of the tree code. theta = 0 means
+        // that the field is computed by direct summation.
+        double tree_theta = 0.;
+        int tree_order = 4;
+        // precision used for B and its first derivative, see
+        // BiotSavartPrecision.
+        BiotSavartPrecision precision = BiotSavartPrecision::Double;
+        // if true, the total field is computed tile by tile without storing
+        // the fields of the individual coils, see set_fused_evaluation().
+        bool fused = false;
+        static constexpr int fused_tile_size = 256;
+        // the per coil fields B_i, dB_i, ... in field_cache are only valid for
+        // the version of the coil's curve and of the points stored here. see
+        // invalidate_changed_coils().
+        vector<uint64_t> coil_versions, coil_points_versions;
+        uint64_t points_version = 0;
+        void invalidate_changed_coils();
+        std::vector<int> coils_to_recompute(string field, int derivatives);
+
+        // if set, coil i is given by symmetry_matrices[i] applied to the
+        // curve symmetry_base_curves[symmetry_base_idx[i]], see set_symmetry().
+        vector<shared_ptr<Curve<Array>>> symmetry_base_curves;
+        vector<int> symmetry_base_idx;
+        vector<SymmetryMatrix> symmetry_matrices;
+        // for each coil, the permutation of the points induced by its symmetry
+        // matrix (empty if the points are not invariant under it)
+        vector<vector<int>> symmetry_perms;
+        uint64_t symmetry_perms_points_version = 0;
+        bool symmetry_perms_valid = false;
+        void compute_symmetric(string field, int derivatives, const std::vector<int>& coils_to_compute);
 
         #if defined(USE_XSIMD)
         // this vectors are aligned in memory for fast simd usage.
@@ -71,30 +105,66 @@ class BiotSavart : public MagneticField<T> {
 
     protected:
 
+        void _set_points_cb() override {
+            ++points_version;
+        }
+
         void _B_impl(Tensor2& B) override {
-            this->compute(0);
+            if(tree_theta > 0)
+                this->compute_tree(0);
+            else if(fused)
+                this->compute_fused("B", 0);
+            else
+                this->compute(0);
         }
         
         void _dB_by_dX_impl(Tensor3& dB_by_dX) override {
-            this->compute(1);
+            if(tree_theta > 0)
+                this->compute_tree(1);
+            else if(fused)
+                this->compute_fused("B", 1);
+            else
+                this->compute(1);
         }
 
         void _d2B_by_dXdX_impl(Tensor4& d2B_by_dXdX) override {
-            this->compute(2);
+            if(tree_theta > 0)
+                this->compute_tree(2);
+            else if(fused)
+                this->compute_fused("B", 2);
+            else
+                this->compute(2);
         }
         
         void _A_impl(Tensor2& A) override {
-            this->compute_A(0);
+            if(tree_theta > 0)
+                this->compute_A_tree(0);
+            else if(fused)
+                this->compute_fused("A", 0);
+            else
+                this->compute_A(0);
         }
         
         void _dA_by_dX_impl(Tensor3& dA_by_dX) override {
-            this->compute_A(1);
+            if(tree_theta > 0)
+                this->compute_A_tree(1);
+            else if(fused)
+                this->compute_fused("A", 1);
+            else
+                this->compute_A(1);
         }
 
         void _d2A_by_dXdX_impl(Tensor4& d2A_by_dXdX) override {
-            this->compute_A(2);
+            if(tree_theta > 0)
+                this->compute_A_tree(2);
+            else if(fused)
+                this->compute_fused("A", 2);
+            else
+                this->compute_A(2);
         }
 
+        BiotSavartTree build_tree();
+
 
 
     public:
@@ -113,16 +183,123 @@ class BiotSavart : public MagneticField<T> {
 
         void compute(int derivatives);
         void compute_A(int derivatives);
+        void compute_tree(int derivatives);
+        void compute_A_tree(int derivatives);
+        void compute_fused(string field, int derivatives);
+
+        /*
+         * Use a Barnes-Hut tree code instead of direct summation to evaluate
+         * B, A and their derivatives. Clusters of quadrature points whose
+         * radius is smaller than `theta` times their distance to the target
+         * point are replaced by a multipole expansion of order `order`, so the
+         * error decays like theta^(order+1). Passing theta = 0 switches back to
+         * direct summation. Note that the per coil fields used for the
+         * derivatives with respect to the coil dofs are always computed by
+         * direct summation.
+         */
+        void set_tree_evaluation(double theta, int order) {
+            if(theta < 0. || theta >= 1.)
+                throw std::runtime_error("The opening angle theta has to be in [0, 1).");
+            if(order < 0)
+                throw std::runtime_error("The expansion order has to be non-negative.");
+            tree_theta = theta;
+            tree_order = order;
+            this->invalidate_cache();
+        }
+
+        /*
+         * Tell BiotSavart that coil i is obtained by applying the orthogonal
+         * matrix matrices[i] to the curve base_curves[base_idx[i]], i.e.
+         * gamma_i = matrices[i] @ gamma_base. The field of each coil is then
+         * computed from its base curve. When the evaluation points are
+         * invariant under the symmetries (e.g. quadrature points on a full
+         * torus), the field of each base curve is only evaluated once for all
+         * of its copies.
+         */
+        void set_symmetry(vector<shared_ptr<Curve<Array>>> base_curves, vector<int> base_idx, vector<Array> matrices) {
+            int ncoils = coils.size();
+            if(base_idx.size() != ncoils || matrices.size() != ncoils)
+                throw std::runtime_error("base_idx and matrices need to have one entry per coil.");
+            vector<SymmetryMatrix> mats(ncoils);
+            for (int i = 0; i < ncoils; ++i) {
+                if(base_idx[i] < 0 || base_idx[i] >= base_curves.size())
+                    throw std::runtime_error(fmt::format("base_idx[{}]={} is not a valid index into base_curves.", i, base_idx[i]));
+                if(base_curves[base_idx[i]]->numquadpoints != coils[i]->curve->numquadpoints)
+                    throw std::runtime_error(fmt::format("Coil {} and its base curve have a different number of quadrature points.", i));
+                if(matrices[i].dimension() != 2 || matrices[i].shape(0) != 3 || matrices[i].shape(1) != 3)
+                    throw std::runtime_error("The symmetry matrices need to have shape (3, 3).");
+                for (int j = 0; j < 3; ++j)
+                    for (int k = 0; k < 3; ++k)
+                        mats[i][3*j+k] = matrices[i](j, k);
+            }
+            symmetry_base_curves = base_curves;
+            symmetry_base_idx = base_idx;
+            symmetry_matrices = mats;
+            symmetry_perms_valid = false;
+            this->field_cache.invalidate_cache();
+            this->invalidate_cache();
+        }
+
+        void clear_symmetry() {
+            symmetry_base_curves.clear();
+            symmetry_base_idx.clear();
+            symmetry_matrices.clear();
+            symmetry_perms_valid = false;
+            this->field_cache.invalidate_cache();
+            this->invalidate_cache();
+        }
+
+        bool has_symmetry() const { return symmetry_base_curves.size() > 0; }
+
+        /*
+         * Set the floating point precision used to evaluate B and its first
+         * derivative by direct summation: "double" (default), "mixed" or
+         * "single", see BiotSavartPrecision. Second derivatives and the vector
+         * potential are always computed in double precision.
+         */
+        void set_precision(string prec) {
+            precision = biot_savart_precision_from_string(prec);
+            this->field_cache.invalidate_cache();
+            this->invalidate_cache();
+        }
+
+        string get_precision() const { return biot_savart_precision_to_string(precision); }
+
+        /*
+         * Compute the total field directly instead of storing the field of
+         * every coil and summing them up afterwards. The points are split
+         * into tiles of fused_tile_size points that are distributed over the
+         * threads, and each tile loops over all coils with the currents
+         * folded in. This needs O(npoints) memory instead of
+         * O(ncoils*npoints), and is parallel even for few coils, but the
+         * fields of unchanged coils are no longer reused. The per coil fields
+         * needed for the derivatives with respect to the currents are
+         * still computed on demand by compute().
+         */
+        void set_fused_evaluation(bool enabled) {
+            fused = enabled;
+            if(fused)
+                this->field_cache.clear();
+            this->invalidate_cache();
+        }
+
+        bool get_fused_evaluation() const { return fused; }
+
+        double get_tree_theta() const { return tree_theta; }
+        int get_tree_order() const { return tree_order; }
+        // The fields of the individual coils are not cleared here, but are
+        // kept until the corresponding coil or the points change.
         virtual void invalidate_cache() override {
             MagneticField<T>::invalidate_cache();
-            this->field_cache.invalidate_cache();
         }
 
         Array& fieldcache_get_or_create(string key, vector<int> dims){
+            this->invalidate_changed_coils();
             return this->field_cache.get_or_create(key, dims);
         }
 
         bool fieldcache_get_status(string key){
+            this->invalidate_changed_coils();
             return this->field_cache.get_status(key);
         }
 
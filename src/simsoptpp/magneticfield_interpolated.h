@@ -22,8 +22,7 @@ class InterpolatedField : public MagneticField<T> {
         const int nfp = 1;
         vector<bool> symmetries = vector<bool>(1, false);
 
-    protected:
-        void _B_cyl_impl(Tensor2& B_cyl) override {
+        void build_interp_B() {
             if(!interp_B)
                 interp_B = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
             if(!status_B) {
@@ -32,6 +31,22 @@ class InterpolatedField : public MagneticField<T> {
                 this->field->set_points_cart(old_points);
                 status_B = true;
             }
+        }
+
+        void build_interp_GradAbsB() {
+            if(!interp_GradAbsB)
+                interp_GradAbsB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
+            if(!status_GradAbsB) {
+                Tensor2 old_points = this->field->get_points_cart();
+                interp_GradAbsB->interpolate_batch(fbatch_GradAbsB);
+                this->field->set_points_cart(old_points);
+                status_GradAbsB = true;
+            }
+        }
+
+    protected:
+        void _B_cyl_impl(Tensor2& B_cyl) override {
+            build_interp_B();
             if(nfp > 1 || stellsym){
                 Tensor2& rphiz = this->get_points_cyl_ref();
                 Tensor2& rphiz_sym = points_cyl_sym.get_or_create({npoints, 3});
@@ -44,14 +59,7 @@ class InterpolatedField : public MagneticField<T> {
         }
 
         void _GradAbsB_cyl_impl(Tensor2& GradAbsB_cyl) override {
-            if(!interp_GradAbsB)
-                interp_GradAbsB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_GradAbsB) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_GradAbsB->interpolate_batch(fbatch_GradAbsB);
-                this->field->set_points_cart(old_points);
-                status_GradAbsB = true;
-            }
+            build_interp_GradAbsB();
             if(nfp > 1 || stellsym){
                 Tensor2& rphiz = this->get_points_cyl_ref();
                 Tensor2& rphiz_sym = points_cyl_sym.get_or_create({npoints, 3});
@@ -187,25 +195,54 @@ class InterpolatedField : public MagneticField<T> {
                 bool extrapolate, int nfp, bool stellsym, std::function<std::vector<bool>(Vec, Vec, Vec)> skip) : InterpolatedField(field, UniformInterpolationRule(degree), r_range, phi_range, z_range, extrapolate, nfp, stellsym, skip) {}
 
         std::pair<double, double> estimate_error_B(int samples) {
-            if(!interp_B)
-                interp_B = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_B) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_B->interpolate_batch(fbatch_B);
-                this->field->set_points_cart(old_points);
-                status_B = true;
-            }
+            build_interp_B();
             return interp_B->estimate_error(this->fbatch_B, samples);
         }
         std::pair<double, double> estimate_error_GradAbsB(int samples) {
-            if(!interp_GradAbsB)
-                interp_GradAbsB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
-            if(!status_GradAbsB) {
-                Tensor2 old_points = this->field->get_points_cart();
-                interp_GradAbsB->interpolate_batch(fbatch_GradAbsB);
-                this->field->set_points_cart(old_points);
-                status_GradAbsB = true;
-            }
+            build_interp_GradAbsB();
             return interp_GradAbsB->estimate_error(this->fbatch_GradAbsB, samples);
         }
+
+        // Returns a new InterpolatedField that shares the (read-only)
+        // interpolants with this field, but has its own caches. This allows
+        // evaluating the same interpolant from multiple threads without
+        // having to build and store it multiple times.
+        shared_ptr<InterpolatedField<T>> clone() {
+            build_interp_B();
+            build_interp_GradAbsB();
+            auto res = std::make_shared<InterpolatedField<T>>(field, rule, r_range, phi_range, z_range, extrapolate, nfp, stellsym, skip);
+            res->interp_B = interp_B;
+            res->status_B = true;
+            res->interp_GradAbsB = interp_GradAbsB;
+            res->status_GradAbsB = true;
+            return res;
+        }
+
+        // Save the interpolants of B and GradAbsB to a single file, so that
+        // they can be loaded again later (e.g. in a different process)
+        // without having to evaluate the underlying field. `dof_hash` should
+        // identify the underlying field, e.g. a hash of the coil dofs.
+        void save_interpolants(const std::string& filename, uint64_t dof_hash) {
+            build_interp_B();
+            build_interp_GradAbsB();
+            RegularGridInterpolant3D<Tensor2>::save_archive(filename, {{"B", interp_B}, {"GradAbsB", interp_GradAbsB}}, dof_hash);
+        }
+
+        // Load the interpolants written by save_interpolants. The field has
+        // to be constructed with the same rule, ranges and skip function,
+        // and `dof_hash` has to match the value used when saving.
+        void load_interpolants(const std::string& filename, uint64_t dof_hash, bool mmap) {
+            for (auto& entry : RegularGridInterpolant3D<Tensor2>::read_archive(filename)) {
+                if(entry.first == "B") {
+                    interp_B = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
+                    interp_B->load_cell_values(filename, mmap, dof_hash, entry.second);
+                    status_B = true;
+                } else if(entry.first == "GradAbsB") {
+                    interp_GradAbsB = std::make_shared<RegularGridInterpolant3D<Tensor2>>(rule, r_range, phi_range, z_range, 3, extrapolate, skip);
+                    interp_GradAbsB->load_cell_values(filename, mmap, dof_hash, entry.second);
+                    status_GradAbsB = true;
+                }
+            }
+            this->invalidate_cache();
+        }
 };
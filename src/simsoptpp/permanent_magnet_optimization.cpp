@@ -5,6 +5,7 @@
 #include "xtensor/xsort.hpp"
 #include "xtensor/xview.hpp"
 #include <functional>
+#include <limits>
 #include <vector>
 #include <math.h>
 
@@ -94,9 +95,8 @@ double find_max_alphaf(double x1, double x2, double x3, double p1, double p2, do
 
 // print out all the possible loss terms in the objective function
 // and record histories of the dipole moments, objective values, etc.
-void print_MwPGP(Array& A_obj, Array& b_obj, Array& x_k1, Array& m_proxy, Array& m_maxima, Array& m_history, Array& objective_history, Array& R2_history, int print_iter, int k, double nu, double reg_l0, double reg_l1, double reg_l2)
+void print_MwPGP(const LinearOperator& apply_A, int ngrid, Array& b_obj, Array& x_k1, Array& m_proxy, Array& m_maxima, Array& m_history, Array& objective_history, Array& R2_history, int print_iter, int k, double nu, double reg_l0, double reg_l1, double reg_l2)
 {
-    int ngrid = A_obj.shape(0);
     int N = m_maxima.shape(0);
     double R2 = 0.0;
     double N2 = 0.0;
@@ -119,10 +119,7 @@ void print_MwPGP(Array& A_obj, Array& b_obj, Array& x_k1, Array& m_proxy, Array&
 
     // Computation of R2 takes more work than the other loss terms... need to compute
     // the linear least-squares term.
-    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_mat(const_cast<double*>(A_obj.data()), ngrid, 3*N);
-    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(x_k1.data()), 3*N, 1);
-    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(R2_temp.data()), ngrid, 1);
-    eigen_res = eigen_mat*eigen_v;
+    apply_A(x_k1.data(), R2_temp.data());
 #pragma omp parallel for reduction(+: R2)
     for(int i = 0; i < ngrid; ++i) {
 	R2 += (R2_temp(i) - b_obj(i)) * (R2_temp(i) - b_obj(i));
@@ -149,10 +146,11 @@ void print_MwPGP(Array& A_obj, Array& b_obj, Array& x_k1, Array& m_proxy, Array&
 // See Bouchala, Jiří, et al.On the solution of convex QPQC
 // problems with elliptic and other separable constraints with
 // strong curvature. Applied Mathematics and Computation 247 (2014): 848-864.
-std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_obj, Array& ATb, Array& m_proxy, Array& m0, Array& m_maxima, double alpha, double nu, double epsilon, double reg_l0, double reg_l1, double reg_l2, int max_iter, double min_fb, bool verbose)
+// apply_ATA and apply_A compute A^T A v and A v respectively, so that the
+// algorithm works both with a dense A_obj and with a DipoleFieldOperator.
+static std::tuple<Array, Array, Array, Array> MwPGP_impl(const LinearOperator& apply_ATA, const LinearOperator& apply_A, int ngrid, Array& b_obj, Array& ATb, Array& m_proxy, Array& m0, Array& m_maxima, double alpha, double nu, double epsilon, double reg_l0, double reg_l1, double reg_l2, int max_iter, double min_fb, bool verbose)
 {
     // Needs ATb in shape (N, 3)
-    int ngrid = A_obj.shape(0);
     int N = ATb.shape(0);
     int print_iter = 0;
     double x_sum;
@@ -177,14 +175,14 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
     // Add contribution from relax-and-split term
     Array ATb_rs = ATb + m_proxy / nu;
 
-    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_mat(const_cast<double*>(A_obj.data()), ngrid, 3*N);
+    // A^TA * m + contributions from L2 and relax-and-split terms
+    auto apply_hessian = [&](Array& v, Array& res) {
+        apply_ATA(v.data(), res.data());
+        res += 2 * (reg_l2 + 1.0 / (2.0 * nu)) * v;
+    };
 
     // Set up initial g and p Arrays
-    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(m0.data()), 1, 3*N);
-    Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(g.data()), 1, 3*N);
-
-    // A^TA * m + contributions from L2 and relax-and-split terms
-    eigen_res = eigen_v*eigen_mat.transpose()*eigen_mat + 2 * eigen_v * (reg_l2 + 1.0 / (2.0 * nu));
+    apply_hessian(m0, g);
 
     // subtract off A^T * b + m_proxy / nu for fully initialized g
     g -= ATb_rs;
@@ -210,10 +208,7 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
         norm_phi_temp = 0.0;
         gp = 0.0;
         pATAp = 0.0;
-        ATAp = xt::zeros<double>({N, 3});
-        Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(p.data()), 1, 3*N);
-        Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(ATAp.data()), 1, 3*N);
-        eigen_res = eigen_v*eigen_mat.transpose()*eigen_mat + 2 * eigen_v * (reg_l2 + 1.0 / (2.0 * nu));
+        apply_hessian(p, ATAp);
 #pragma omp parallel for reduction(+: norm_g_alpha_p, norm_phi_temp, gp, pATAp) private(phi_temp1, phi_temp2, phi_temp3, g_alpha_p1, g_alpha_p2, g_alpha_p3)
         for(int i = 0; i < N; ++i) {
             std::tie(g_alpha_p1, g_alpha_p2, g_alpha_p3) = g_reduced_projected_gradient(x_k1(i, 0), x_k1(i, 1), x_k1(i, 2), g(i, 0), g(i, 1), g(i, 2), alpha, m_maxima(i));
@@ -268,9 +263,7 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
                 }
 
                 // update g and p
-                Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(x_k1.data()), 1, 3*N);
-                Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(g.data()), 1, 3*N);
-                eigen_res = eigen_v*eigen_mat.transpose()*eigen_mat + 2 * eigen_v * (reg_l2 + 1.0 / (2.0 * nu));
+                apply_hessian(x_k1, g);
 #pragma omp parallel for
                 for (int i = 0; i < N; ++i) {
                     for (int jj = 0; jj < 3; ++jj) {
@@ -288,9 +281,7 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
             }
 
             // update g and p
-            Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_v(const_cast<double*>(x_k1.data()), 1, 3*N);
-            Eigen::Map<Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_res(const_cast<double*>(g.data()), 1, 3*N);
-            eigen_res = eigen_v*eigen_mat.transpose()*eigen_mat + 2 * eigen_v * (reg_l2 + 1.0 / (2.0 * nu));
+            apply_hessian(x_k1, g);
 #pragma omp parallel for
             for (int i = 0; i < N; ++i) {
                 for (int jj = 0; jj < 3; ++jj) {
@@ -302,7 +293,7 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
 
 	// fairly convoluted way to print every ~ max_iter / 20 iterations
         if (verbose && ((k % (int(max_iter / 5.0)) == 0) || k == 0 || k == max_iter - 1)) {
-	    print_MwPGP(A_obj, b_obj, x_k1, m_proxy, m_maxima, m_history, objective_history, R2_history, print_iter, k, nu, reg_l0, reg_l1, reg_l2);
+	    print_MwPGP(apply_A, ngrid, b_obj, x_k1, m_proxy, m_maxima, m_history, objective_history, R2_history, print_iter, k, nu, reg_l0, reg_l1, reg_l2);
 	    if (R2_history(print_iter) < min_fb) break;
             print_iter += 1;
 	}
@@ -323,6 +314,33 @@ std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_ob
     return std::make_tuple(objective_history, R2_history, m_history, x_k1);
 }
 
+std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_obj, Array& ATb, Array& m_proxy, Array& m0, Array& m_maxima, double alpha, double nu, double epsilon, double reg_l0, double reg_l1, double reg_l2, int max_iter, double min_fb, bool verbose)
+{
+    int ngrid = A_obj.shape(0);
+    int N = ATb.shape(0);
+    Eigen::Map<const Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,Eigen::RowMajor>> eigen_mat(A_obj.data(), ngrid, 3*N);
+    auto apply_A = [&](const double* v, double* res) {
+        Eigen::Map<const Eigen::VectorXd> eigen_v(v, 3*N);
+        Eigen::Map<Eigen::VectorXd> eigen_res(res, ngrid);
+        eigen_res.noalias() = eigen_mat*eigen_v;
+    };
+    auto apply_ATA = [&](const double* v, double* res) {
+        Eigen::Map<const Eigen::RowVectorXd> eigen_v(v, 3*N);
+        Eigen::Map<Eigen::RowVectorXd> eigen_res(res, 3*N);
+        eigen_res.noalias() = eigen_v*eigen_mat.transpose()*eigen_mat;
+    };
+    return MwPGP_impl(apply_ATA, apply_A, ngrid, b_obj, ATb, m_proxy, m0, m_maxima, alpha, nu, epsilon, reg_l0, reg_l1, reg_l2, max_iter, min_fb, verbose);
+}
+
+std::tuple<Array, Array, Array, Array> MwPGP_algorithm_matrix_free(DipoleFieldLinearOperator& A_op, Array& b_obj, Array& ATb, Array& m_proxy, Array& m0, Array& m_maxima, double alpha, double nu, double epsilon, double reg_l0, double reg_l1, double reg_l2, int max_iter, double min_fb, bool verbose)
+{
+    if(A_op.ndipoles() != (int) ATb.shape(0))
+        throw std::runtime_error("A_op and ATb have a different number of dipoles");
+    auto apply_A = [&](const double* v, double* res) { A_op.apply(v, res); };
+    auto apply_ATA = [&](const double* v, double* res) { A_op.apply_normal(v, res); };
+    return MwPGP_impl(apply_ATA, apply_A, A_op.ngrid(), b_obj, ATb, m_proxy, m0, m_maxima, alpha, nu, epsilon, reg_l0, reg_l1, reg_l2, max_iter, min_fb, verbose);
+}
+
 
 // fairly convoluted way to print every ~ K / nhistory iterations
 void print_GPMO(int k, int ngrid, int& print_iter, Array& x, double* Aij_mj_ptr, Array& objective_history, Array& Bn_history, Array& m_history, double mmax_sum, double* normal_norms_ptr) 
@@ -375,15 +393,166 @@ Array connectivity_matrix(Array& dipole_grid_xyz, int Nadjacent)
     return connectivity_inds;
 }
 
+// Candidate scores for the greedy step of GPMO. Placing or removing a magnet
+// changes the residual r = A m - b by one column A_j of A, so instead of
+// recomputing ||r +- A_j||^2 over all ngrid points for every candidate, we
+// keep s_j = A_j^T r and n_j = ||A_j||^2 and use
+// ||r +- A_j||^2 = ||r||^2 +- 2 s_j + n_j. Each update then only needs the
+// dot products A_j^T A_k of the remaining candidates with the changed column.
+// A is either stored as in the GPMO functions, i.e. with shape (3N, ngrid),
+// or given by a DipoleFieldLinearOperator whose columns are scaled by
+// column_scaling, in which case these dot products are one transpose matvec.
+class GPMOScores {
+    public:
+        GPMOScores(const double* A, const double* mmax, int N3, int ngrid, int single_direction) :
+            A(A), op(nullptr), scaling(nullptr), mmax(mmax), N3(N3), ngrid(ngrid), s(N3, 0.0), n(N3, 0.0), pos(N3, -1)
+        {
+            init_active(single_direction);
+#pragma omp parallel for schedule(static)
+            for (int a = 0; a < (int) active.size(); ++a) {
+                int j = active[a];
+                n[j] = column(j).squaredNorm();
+            }
+        }
+
+        GPMOScores(const DipoleFieldLinearOperator& op, const double* scaling, const double* mmax, int single_direction) :
+            A(nullptr), op(&op), scaling(scaling), mmax(mmax), N3(3 * op.ndipoles()), ngrid(op.ngrid()), s(N3, 0.0), n(N3, 0.0), pos(N3, -1), col(ngrid), tmp(N3)
+        {
+            init_active(single_direction);
+            op.column_norms_squared(n.data());
+            for (int j = 0; j < N3; ++j)
+                n[j] *= scaling[j] * scaling[j];
+        }
+
+        // compute the scores of all candidates for the residual r
+        void set_residual(const double* r) {
+            if (op) {
+                op->apply_transpose(r, tmp.data());
+                for (int j : active)
+                    s[j] = scaling[j] * tmp[j];
+                return;
+            }
+#pragma omp parallel for schedule(static)
+            for (int a = 0; a < (int) active.size(); ++a) {
+                int j = active[a];
+                s[j] = column(j).dot(Vec(r, ngrid));
+            }
+        }
+
+        // r <- r + sign * A_k, and update the scores of the remaining candidates
+        void add(int k, double sign, double* r) {
+            if (op) {
+                op->column(k, col.data());
+                for (int i = 0; i < ngrid; ++i) {
+                    col[i] *= scaling[k];
+                    r[i] += sign * col[i];
+                }
+                op->apply_transpose(col.data(), tmp.data());
+                for (int j : active)
+                    s[j] += sign * scaling[j] * tmp[j];
+                return;
+            }
+            const double* Ak = A + size_t(k) * ngrid;
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < ngrid; ++i)
+                r[i] += sign * Ak[i];
+            // this pass over A is the bulk of the work, Eigen's dot products
+            // are vectorized
+#pragma omp parallel for schedule(static)
+            for (int a = 0; a < (int) active.size(); ++a) {
+                int j = active[a];
+                s[j] += sign * column(j).dot(column(k));
+            }
+        }
+
+        // remove all three components of a dipole from the candidates
+        void deactivate(int dipole) {
+            for (int jj = 0; jj < 3; ++jj) {
+                int j = 3 * dipole + jj;
+                if (pos[j] < 0)
+                    continue;
+                int last = active.back();
+                active[pos[j]] = last;
+                pos[last] = pos[j];
+                active.pop_back();
+                pos[j] = -1;
+            }
+        }
+
+        // make a dipole available again, e.g. after backtracking
+        void activate(int dipole, const double* r, int single_direction) {
+            for (int jj = 0; jj < 3; ++jj) {
+                int j = 3 * dipole + jj;
+                if (pos[j] >= 0 || (single_direction >= 0 && jj != single_direction))
+                    continue;
+                if (op) {
+                    op->column(j, col.data());
+                    s[j] = scaling[j] * Vec(col.data(), ngrid).dot(Vec(r, ngrid));
+                }
+                else {
+                    s[j] = column(j).dot(Vec(r, ngrid));
+                }
+                pos[j] = active.size();
+                active.push_back(j);
+            }
+        }
+
+        // Returns the candidate that minimizes ||r +- A_j||^2 + mmax_j^2, as an
+        // index into the 6N vector of the +A_j and -A_j orientations. Ties are
+        // broken by the smallest index, as std::min_element would.
+        int argmin() const {
+            double best = std::numeric_limits<double>::infinity();
+            int best_ind = 0;
+            for (int j : active) {
+                double base = n[j] + mmax[j] * mmax[j];
+                double plus = base + 2 * s[j];
+                double minus = base - 2 * s[j];
+                if (plus < best || (plus == best && j < best_ind)) {
+                    best = plus;
+                    best_ind = j;
+                }
+                if (minus < best || (minus == best && j + N3 < best_ind)) {
+                    best = minus;
+                    best_ind = j + N3;
+                }
+            }
+            return best_ind;
+        }
+
+        int ndipoles() const { return N3 / 3; }
+        int npoints() const { return ngrid; }
+
+    private:
+        using Vec = Eigen::Map<const Eigen::VectorXd>;
+        const double* A;
+        const DipoleFieldLinearOperator* op;
+        const double* scaling;
+        const double* mmax;
+        int N3, ngrid;
+        vector<double> s, n;
+        vector<int> active, pos;
+        // work arrays for the operator version
+        vector<double> col, tmp;
+
+        void init_active(int single_direction) {
+            int j_update = (single_direction >= 0) ? 3 : 1;
+            for (int j = std::max(0, single_direction); j < N3; j += j_update) {
+                pos[j] = active.size();
+                active.push_back(j);
+            }
+        }
+
+        Vec column(int j) const { return Vec(A + size_t(j) * ngrid, ngrid); }
+};
+
 // GPMO algorithm with backtracking to fix wyrms -- close cancellations between
 // two nearby, oppositely oriented magnets. 
-std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int backtracking, Array& dipole_grid_xyz, int single_direction, int Nadjacent, int max_nMagnets)
+static std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking_impl(GPMOScores& scores, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int backtracking, Array& dipole_grid_xyz, int single_direction, int Nadjacent, int max_nMagnets)
 {
-    int ngrid = A_obj.shape(1);
-    int N = int(A_obj.shape(0) / 3);
+    int ngrid = scores.npoints();
+    int N = scores.ndipoles();
     int N3 = 3 * N;
     int print_iter = 0;
-    int skj_inds;
 
     Array x = xt::zeros<double>({N, 3});
 
@@ -399,19 +568,12 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
     // initialize Gamma_complement with all indices available
     Array Gamma_complement = xt::ones<bool>({N, 3});
 
-    // initialize least-square values to large numbers
-    vector<double> R2s(6 * N, 1e50);
-
     vector<int> skj(K);
     vector<int> skjj(K);
     vector<int> skjj_ind(N);
     vector<double> sign_fac(K);
     vector<double> sk_sign_fac(N);
 
-    double* R2s_ptr = &(R2s[0]);
-    double* Aij_ptr = &(A_obj(0, 0));
-    double* Gamma_ptr = &(Gamma_complement(0, 0));
-
     // initialize running matrix-vector product
     Array Aij_mj_sum = -b_obj;
     double* Aij_mj_ptr = &(Aij_mj_sum(0));
@@ -422,36 +584,16 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
     // get indices for dipoles that are adjacent to dipole j
     Array Connect = connectivity_matrix(dipole_grid_xyz, Nadjacent);
 
-    // if using a single direction, increase j by 3 each iteration
-    int j_update = 1;
-    if (single_direction >= 0) j_update = 3;
+    scores.set_residual(Aij_mj_ptr);
     Array num_nonzeros = xt::zeros<int>({nhistory + 1});
     int num_nonzero = 0;
     int k = 0;
 
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
-#pragma omp parallel for schedule(static)
-	for (int j = std::max(0, single_direction); j < N3; j += j_update) {
-
-	    // Check all the allowed dipole positions
-	    if (Gamma_ptr[j]) {
-		double R2 = 0.0;
-		double R2minus = 0.0;
-		int nj = ngrid * j;
-
-		// Compute contribution of jth dipole component, either with +- orientation
-		for(int i = 0; i < ngrid; ++i) {
-		    R2 += (Aij_mj_ptr[i] + Aij_ptr[i + nj]) * (Aij_mj_ptr[i] + Aij_ptr[i + nj]); 
-		    R2minus += (Aij_mj_ptr[i] - Aij_ptr[i + nj]) * (Aij_mj_ptr[i] - Aij_ptr[i + nj]); 
-		}
-		R2s_ptr[j] = R2 + (mmax_ptr[j] * mmax_ptr[j]);
-		R2s_ptr[j + N3] = R2minus + (mmax_ptr[j] * mmax_ptr[j]);
-	    }
-	}
 
 	// find the dipole that most minimizes the least-squares term
-        skj[k] = int(std::distance(R2s.begin(), std::min_element(R2s.begin(), R2s.end())));
+        skj[k] = scores.argmin();
 	if (skj[k] >= N3) {
 	    skj[k] -= N3;
 	    sign_fac[k] = -1.0;
@@ -471,15 +613,10 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
 
 	// Add binary magnet and get rid of the magnet (all three components)
         // from the complement of Gamma
-	skj_inds = (3 * skj[k] + skjj[k]) * ngrid;
-#pragma omp parallel for schedule(static)
-	for(int i = 0; i < ngrid; ++i) {
-            Aij_mj_ptr[i] += sign_fac[k] * Aij_ptr[i + skj_inds];
-	}
+        scores.deactivate(skj[k]);
+        scores.add(3 * skj[k] + skjj[k], sign_fac[k], Aij_mj_ptr);
         for (int j = 0; j < 3; ++j) {
             Gamma_complement(skj[k], j) = false;
-	    R2s[3 * skj[k] + j] = 1e50;
-	    R2s[N3 + 3 * skj[k] + j] = 1e50;
 	}
 
 	// backtrack by removing adjacent dipoles that are equal and opposite
@@ -506,12 +643,10 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
 		         }
 
 	                 // Subtract off this pair's contribution to Aij * mj
-			 int skj_ind1 = (3 * jk + skjj_ind[jk]) * ngrid;
-	                 int skj_ind2 = (3 * cj + skjj_ind[cj]) * ngrid;
-#pragma omp parallel for schedule(static)
-			 for(int i = 0; i < ngrid; ++i) {
-		             Aij_mj_ptr[i] -= sk_sign_fac[jk] * Aij_ptr[i + skj_ind1] + sk_sign_fac[cj] * Aij_ptr[i + skj_ind2];
-			 }
+			 scores.add(3 * jk + skjj_ind[jk], -sk_sign_fac[jk], Aij_mj_ptr);
+			 scores.add(3 * cj + skjj_ind[cj], -sk_sign_fac[cj], Aij_mj_ptr);
+			 scores.activate(jk, Aij_mj_ptr, single_direction);
+			 scores.activate(cj, Aij_mj_ptr, single_direction);
 	                 mmax_sum -= mmax_ptr[jk] * mmax_ptr[jk];
 	                 mmax_sum -= mmax_ptr[cj] * mmax_ptr[cj];
 			 // set sign_fac = 0 so that these magnets do not keep getting dewyrmed
@@ -567,6 +702,21 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Ar
     return std::make_tuple(objective_history, Bn_history, m_history, num_nonzeros, x);
 }
 
+std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int backtracking, Array& dipole_grid_xyz, int single_direction, int Nadjacent, int max_nMagnets)
+{
+    // all dipole components (or only single_direction) start out as candidates
+    GPMOScores scores(&(A_obj(0, 0)), &(mmax(0)), A_obj.shape(0), A_obj.shape(1), single_direction);
+    return GPMO_backtracking_impl(scores, b_obj, mmax, normal_norms, K, verbose, nhistory, backtracking, dipole_grid_xyz, single_direction, Nadjacent, max_nMagnets);
+}
+
+std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking_matrix_free(DipoleFieldLinearOperator& A_op, Array& column_scaling, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int backtracking, Array& dipole_grid_xyz, int single_direction, int Nadjacent, int max_nMagnets)
+{
+    if(3 * A_op.ndipoles() != (int) column_scaling.size() || A_op.ngrid() != (int) b_obj.size())
+        throw std::runtime_error("A_op, column_scaling and b_obj have inconsistent sizes");
+    GPMOScores scores(A_op, &(column_scaling(0)), &(mmax(0)), single_direction);
+    return GPMO_backtracking_impl(scores, b_obj, mmax, normal_norms, K, verbose, nhistory, backtracking, dipole_grid_xyz, single_direction, Nadjacent, max_nMagnets);
+}
+
 // Run the GPMO algorithm, placing a dipole and all of the closest Nadjacent dipoles down
 // all at once each iteration. All of these dipoles are aligned in the same way by assumption 
 std::tuple<Array, Array, Array, Array> GPMO_multi(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, Array& dipole_grid_xyz, int single_direction, int Nadjacent)
@@ -1066,10 +1216,10 @@ std::tuple<Array, Array, Array, Array> GPMO_ArbVec(Array& A_obj, Array& b_obj, A
 // Run the GPMO algorithm for solving 
 // the permanent magnet optimization problem.
 // The A matrix should be rescaled by m_maxima since we are assuming all ones in m.
-std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int single_direction) 
+static std::tuple<Array, Array, Array, Array> GPMO_baseline_impl(GPMOScores& scores, Array& b_obj, Array& normal_norms, int K, bool verbose, int nhistory) 
 {
-    int ngrid = A_obj.shape(1);
-    int N = int(A_obj.shape(0) / 3);
+    int ngrid = scores.npoints();
+    int N = scores.ndipoles();
     int N3 = 3 * N;
     int print_iter = 0;
 
@@ -1084,53 +1234,23 @@ std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj,
     if (verbose)
         printf("Iteration ... |Am - b|^2 ... lam*|m|^2\n");
 
-    // initialize Gamma_complement with all indices available
-    Array Gamma_complement = xt::ones<bool>({N, 3});
-	
-    // initialize least-square values to large numbers    
-    vector<double> R2s(6 * N, 1e50);
     vector<int> skj(K);
     vector<int> skjj(K);
     vector<double> sign_fac(K);
     
-    double* R2s_ptr = &(R2s[0]);
-    double* Aij_ptr = &(A_obj(0, 0));
-    double* Gamma_ptr = &(Gamma_complement(0, 0));
-    
     // initialize running matrix-vector product
     Array Aij_mj_sum = -b_obj;
     double mmax_sum = 0.0;
     double* Aij_mj_ptr = &(Aij_mj_sum(0));
     double* normal_norms_ptr = &(normal_norms(0));
-    double* mmax_ptr = &(mmax(0));
 
-    // if using a single direction, increase j by 3 each iteration
-    int j_update = 1;
-    if (single_direction >= 0) j_update = 3;
+    scores.set_residual(Aij_mj_ptr);
     
     // Main loop over the optimization iterations
     for (int k = 0; k < K; ++k) {
-#pragma omp parallel for schedule(static)
-	for (int j = std::max(0, single_direction); j < N3; j += j_update) {
-
-	    // Check all the allowed dipole positions
-	    if (Gamma_ptr[j]) {
-		double R2 = 0.0;
-		double R2minus = 0.0;
-		int nj = ngrid * j;
-
-		// Compute contribution of jth dipole component, either with +- orientation
-		for(int i = 0; i < ngrid; ++i) {
-		    R2 += (Aij_mj_ptr[i] + Aij_ptr[i + nj]) * (Aij_mj_ptr[i] + Aij_ptr[i + nj]);
-		    R2minus += (Aij_mj_ptr[i] - Aij_ptr[i + nj]) * (Aij_mj_ptr[i] - Aij_ptr[i + nj]); 
-		}
-		R2s_ptr[j] = R2 + (mmax_ptr[j] * mmax_ptr[j]);
-		R2s_ptr[j + N3] = R2minus + (mmax_ptr[j] * mmax_ptr[j]);
-	    }
-	}
 
 	// find the dipole that most minimizes the least-squares term
-        skj[k] = int(std::distance(R2s.begin(), std::min_element(R2s.begin(), R2s.end())));
+        skj[k] = scores.argmin();
 	if (skj[k] >= N3) {
 	    skj[k] -= N3;
 	    sign_fac[k] = -1.0;
@@ -1143,17 +1263,9 @@ std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj,
         x(skj[k], skjj[k]) = sign_fac[k];
 
 	// Add binary magnet and get rid of the magnet (all three components)
-        // from the complement of Gamma 
-	int skj_inds = (3 * skj[k] + skjj[k]) * ngrid;
-#pragma omp parallel for schedule(static)
-	for(int i = 0; i < ngrid; ++i) {
-            Aij_mj_ptr[i] += sign_fac[k] * Aij_ptr[i + skj_inds];
-	}
-        for (int j = 0; j < 3; ++j) {
-            Gamma_complement(skj[k], j) = false;
-	    R2s[3 * skj[k] + j] = 1e50;
-	    R2s[N3 + 3 * skj[k] + j] = 1e50;
-        }
+        // from the candidates
+        scores.deactivate(skj[k]);
+        scores.add(3 * skj[k] + skjj[k], sign_fac[k], Aij_mj_ptr);
 
 	if (verbose && (((k % int(K / nhistory)) == 0) || k == 0 || k == K - 1)) {
             print_GPMO(k, ngrid, print_iter, x, Aij_mj_ptr, objective_history, Bn_history, m_history, mmax_sum, normal_norms_ptr);
@@ -1161,3 +1273,18 @@ std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj,
     }
     return std::make_tuple(objective_history, Bn_history, m_history, x);
 }
+
+std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int single_direction) 
+{
+    // all dipole components (or only single_direction) start out as candidates
+    GPMOScores scores(&(A_obj(0, 0)), &(mmax(0)), A_obj.shape(0), A_obj.shape(1), single_direction);
+    return GPMO_baseline_impl(scores, b_obj, normal_norms, K, verbose, nhistory);
+}
+
+std::tuple<Array, Array, Array, Array> GPMO_baseline_matrix_free(DipoleFieldLinearOperator& A_op, Array& column_scaling, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int single_direction) 
+{
+    if(3 * A_op.ndipoles() != (int) column_scaling.size() || A_op.ngrid() != (int) b_obj.size())
+        throw std::runtime_error("A_op, column_scaling and b_obj have inconsistent sizes");
+    GPMOScores scores(A_op, &(column_scaling(0)), &(mmax(0)), single_direction);
+    return GPMO_baseline_impl(scores, b_obj, normal_norms, K, verbose, nhistory);
+}
@@ -3,10 +3,15 @@
 #include <cmath>  // pow function
 #include <tuple>  // c++ tuples
 #include <algorithm>  // std::min_element function
+#include <functional>
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
+#include "dipole_field.h"
 typedef xt::pyarray<double> Array;
 using std::vector;
 
+// computes res = M v for some linear operator M
+using LinearOperator = std::function<void(const double* v, double* res)>;
+
 // helper functions for convex MwPGP algorithm
 std::tuple<double, double, double> projection_L2_balls(double x1, double x2, double x3, double m_maxima);
 std::tuple<double, double, double> phi_MwPGP(double x1, double x2, double x3, double g1, double g2, double g3, double m_maxima);
@@ -14,11 +19,15 @@ std::tuple<double, double, double> beta_tilde(double x1, double x2, double x3, d
 std::tuple<double, double, double> g_reduced_gradient(double x1, double x2, double x3, double g1, double g2, double g3, double alpha, double m_maxima);
 std::tuple<double, double, double> g_reduced_projected_gradient(double x1, double x2, double x3, double g1, double g2, double g3, double alpha, double m_maxima);
 double find_max_alphaf(double x1, double x2, double x3, double p1, double p2, double p3, double m_maxima);
-void print_MwPGP(Array& A_obj, Array& b_obj, Array& x_k1, Array& m_proxy, Array& m_maxima, Array& m_history, Array& objective_history, Array& R2_history, int print_iter, int k, double nu, double reg_l0, double reg_l1, double reg_l2);
+void print_MwPGP(const LinearOperator& apply_A, int ngrid, Array& b_obj, Array& x_k1, Array& m_proxy, Array& m_maxima, Array& m_history, Array& objective_history, Array& R2_history, int print_iter, int k, double nu, double reg_l0, double reg_l1, double reg_l2);
 
 // the hyperparameters all have default values if they are left unspecified -- see python.cpp
 std::tuple<Array, Array, Array, Array> MwPGP_algorithm(Array& A_obj, Array& b_obj, Array& ATb, Array& m_proxy, Array& m0, Array& m_maxima, double alpha, double nu=1.0e100, double epsilon=1.0e-4, double reg_l0=0.0, double reg_l1=0.0, double reg_l2=0.0, int max_iter=500, double min_fb=1.0e-20, bool verbose=false);
 
+// same as above, but applies A^T A through a DipoleFieldOperator or
+// DipoleFieldHMatrix instead of a dense A_obj
+std::tuple<Array, Array, Array, Array> MwPGP_algorithm_matrix_free(DipoleFieldLinearOperator& A_op, Array& b_obj, Array& ATb, Array& m_proxy, Array& m0, Array& m_maxima, double alpha, double nu=1.0e100, double epsilon=1.0e-4, double reg_l0=0.0, double reg_l1=0.0, double reg_l2=0.0, int max_iter=500, double min_fb=1.0e-20, bool verbose=false);
+
 // variants of the GPMO algorithm
 std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int backtracking, Array& dipole_grid_xyz, int single_direction, int Nadjacent, int max_nMagnets);
 std::tuple<Array, Array, Array, Array> GPMO_multi(Array& A_obj, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, Array& dipole_grid_xyz, int single_direction, int Nadjacent);
@@ -30,6 +39,11 @@ std::tuple<Array, Array, Array, Array, Array> GPMO_ArbVec_backtracking(
     int max_nMagnets);
 std::tuple<Array, Array, Array, Array> GPMO_baseline(Array& A_obj, Array& b_obj, Array&mmax, Array& normal_norms, int K, bool verbose, int nhistory, int single_direction);
 
+// GPMO_baseline and GPMO_backtracking with A_obj given as the transpose of
+// A_op with row j scaled by column_scaling(j)
+std::tuple<Array, Array, Array, Array> GPMO_baseline_matrix_free(DipoleFieldLinearOperator& A_op, Array& column_scaling, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int single_direction);
+std::tuple<Array, Array, Array, Array, Array> GPMO_backtracking_matrix_free(DipoleFieldLinearOperator& A_op, Array& column_scaling, Array& b_obj, Array& mmax, Array& normal_norms, int K, bool verbose, int nhistory, int backtracking, Array& dipole_grid_xyz, int single_direction, int Nadjacent, int max_nMagnets);
+
 // helper functions for GPMO algorithm
 void print_GPMO(int k, int ngrid, int& print_iter, Array& x, double* Aij_mj_ptr, Array& objective_history, Array& Bn_history, Array& m_history, double mmax_sum, double* normal_norms_ptr); 
 Array connectivity_matrix(Array& dipole_grid_xyz, int Nadjacent);
@@ -150,4 +150,8 @@ template <class BoozerMagneticFieldBase = PyBoozerMagneticField> class PyBoozerM
         virtual void _psip_impl(typename BoozerMagneticFieldBase::Tensor2& data) override {
             PYBIND11_OVERLOAD(void, BoozerMagneticFieldBase, _psip_impl, data);
         }
+
+        virtual void _gc_quantities_impl(typename BoozerMagneticFieldBase::Tensor2& data) override {
+            PYBIND11_OVERLOAD(void, BoozerMagneticFieldBase, _gc_quantities_impl, data);
+        }
 };
@@ -16,6 +16,7 @@ typedef xt::pytensor<double, 2, xt::layout_type::row_major> PyTensor;
 #include "biot_savart_vjp_py.h"
 #include "boozerradialinterpolant.h"
 #include "dipole_field.h"
+#include "dipole_field_hmatrix.h"
 #include "dommaschk.h"
 #include "integral_BdotN.h"
 #include "permanent_magnet_optimization.h"
@@ -52,11 +53,14 @@ PYBIND11_MODULE(simsoptpp, m) {
     m.attr("using_xsimd") = false;
 #endif
 
-    m.def("biot_savart", &biot_savart);
-    m.def("biot_savart_B", &biot_savart_B);
+    m.def("biot_savart", &biot_savart, py::arg("points"), py::arg("gammas"), py::arg("dgamma_by_dphis"), py::arg("B"), py::arg("dB_by_dX"), py::arg("d2B_by_dXdX"), py::arg("precision")="double");
+    m.def("biot_savart_B", &biot_savart_B, py::arg("points"), py::arg("gammas"), py::arg("dgamma_by_dphis"), py::arg("currents"), py::arg("precision")="double",
+            "Evaluate the field of the given coils. `precision` is one of 'double', 'mixed' or 'single'.");
     m.def("biot_savart_vjp", &biot_savart_vjp);
     m.def("biot_savart_vjp_graph", &biot_savart_vjp_graph);
     m.def("biot_savart_vector_potential_vjp_graph", &biot_savart_vector_potential_vjp_graph);
+    m.def("biot_savart_vjp_graph_symmetric", &biot_savart_vjp_graph_symmetric);
+    m.def("biot_savart_vector_potential_vjp_graph_symmetric", &biot_savart_vector_potential_vjp_graph_symmetric);
 
     // Functions below are implemented for permanent magnet optimization
     m.def("dipole_field_B" , &dipole_field_B);
@@ -65,15 +69,38 @@ PYBIND11_MODULE(simsoptpp, m) {
     m.def("dipole_field_dA" , &dipole_field_dA);
     m.def("dipole_field_Bn" , &dipole_field_Bn, py::arg("points"), py::arg("m_points"), py::arg("unitnormal"), py::arg("nfp"), py::arg("stellsym"), py::arg("b"), py::arg("coordinate_flag") = "cartesian", py::arg("R0") = 0.0);
     m.def("define_a_uniform_cartesian_grid_between_two_toroidal_surfaces" , &define_a_uniform_cartesian_grid_between_two_toroidal_surfaces);
+    py::class_<DipoleFieldLinearOperator, shared_ptr<DipoleFieldLinearOperator>>(m, "DipoleFieldLinearOperator", "The matrix of dipole_field_Bn, applied without storing it densely.")
+        .def_property_readonly("ngrid", &DipoleFieldLinearOperator::ngrid)
+        .def_property_readonly("ndipoles", &DipoleFieldLinearOperator::ndipoles)
+        .def("matvec", &DipoleFieldLinearOperator::matvec)
+        .def("rmatvec", &DipoleFieldLinearOperator::rmatvec)
+        .def("normal_matvec", &DipoleFieldLinearOperator::normal_matvec)
+        .def("get_column", &DipoleFieldLinearOperator::get_column);
+    py::class_<DipoleFieldOperator, shared_ptr<DipoleFieldOperator>, DipoleFieldLinearOperator>(m, "DipoleFieldOperator", "Applies the matrix of dipole_field_Bn and its transpose without storing it.")
+        .def(py::init<Array&, Array&, Array&, int, int, Array&, std::string, double>(), py::arg("points"), py::arg("m_points"), py::arg("unitnormal"), py::arg("nfp"), py::arg("stellsym"), py::arg("weights"), py::arg("coordinate_flag") = "cartesian", py::arg("R0") = 0.0)
+        .def("dense", &DipoleFieldOperator::dense)
+        .def("cache_gram", &DipoleFieldOperator::cache_gram)
+        .def("clear_gram", &DipoleFieldOperator::clear_gram)
+        .def("has_gram", &DipoleFieldOperator::has_gram);
+    py::class_<DipoleFieldHMatrix, shared_ptr<DipoleFieldHMatrix>, DipoleFieldLinearOperator>(m, "DipoleFieldHMatrix", "Hierarchical low rank approximation of the matrix of dipole_field_Bn.")
+        .def(py::init<Array&, Array&, Array&, int, int, Array&, std::string, double, double, int, double>(), py::arg("points"), py::arg("m_points"), py::arg("unitnormal"), py::arg("nfp"), py::arg("stellsym"), py::arg("weights"), py::arg("coordinate_flag") = "cartesian", py::arg("R0") = 0.0, py::arg("tol") = 1e-6, py::arg("leaf_size") = 32, py::arg("eta") = 2.0)
+        .def_property_readonly("memory", &DipoleFieldHMatrix::memory)
+        .def_property_readonly("compression_ratio", &DipoleFieldHMatrix::compression_ratio)
+        .def_property_readonly("max_rank", &DipoleFieldHMatrix::max_rank)
+        .def_property_readonly("nblocks", &DipoleFieldHMatrix::nblocks)
+        .def_property_readonly("nlowrank", &DipoleFieldHMatrix::nlowrank);
 
     // Permanent magnet optimization algorithms have many default arguments
     m.def("MwPGP_algorithm", &MwPGP_algorithm, py::arg("A_obj"), py::arg("b_obj"), py::arg("ATb"), py::arg("m_proxy"), py::arg("m0"), py::arg("m_maxima"), py::arg("alpha"), py::arg("nu") = 1.0e100, py::arg("epsilon") = 1.0e-3, py::arg("reg_l0") = 0.0, py::arg("reg_l1") = 0.0, py::arg("reg_l2") = 0.0, py::arg("max_iter") = 500, py::arg("min_fb") = 1.0e-20, py::arg("verbose") = false);
+    m.def("MwPGP_algorithm_matrix_free", &MwPGP_algorithm_matrix_free, py::arg("A_op"), py::arg("b_obj"), py::arg("ATb"), py::arg("m_proxy"), py::arg("m0"), py::arg("m_maxima"), py::arg("alpha"), py::arg("nu") = 1.0e100, py::arg("epsilon") = 1.0e-3, py::arg("reg_l0") = 0.0, py::arg("reg_l1") = 0.0, py::arg("reg_l2") = 0.0, py::arg("max_iter") = 500, py::arg("min_fb") = 1.0e-20, py::arg("verbose") = false);
     // variants of GPMO algorithm
     m.def("GPMO_backtracking", &GPMO_backtracking, py::arg("A_obj"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100, py::arg("backtracking") = 100, py::arg("dipole_grid_xyz"), py::arg("single_direction") = -1, py::arg("Nadjacent") = 7, py::arg("max_nMagnets"));
     m.def("GPMO_multi", &GPMO_multi, py::arg("A_obj"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100, py::arg("dipole_grid_xyz"), py::arg("single_direction") = -1, py::arg("Nadjacent") = 7);
     m.def("GPMO_ArbVec", &GPMO_ArbVec, py::arg("A_obj"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("pol_vectors"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100);
     m.def("GPMO_ArbVec_backtracking", &GPMO_ArbVec_backtracking, py::arg("A_obj"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("pol_vectors"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100, py::arg("backtracking") = 100, py::arg("dipole_grid_xyz"), py::arg("Nadjacent") = 7, py::arg("thresh_angle") = 3.1415926535897931, py::arg("max_nMagnets"));
     m.def("GPMO_baseline", &GPMO_baseline, py::arg("A_obj"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100, py::arg("single_direction") = -1);
+    m.def("GPMO_backtracking_matrix_free", &GPMO_backtracking_matrix_free, py::arg("A_op"), py::arg("column_scaling"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100, py::arg("backtracking") = 100, py::arg("dipole_grid_xyz"), py::arg("single_direction") = -1, py::arg("Nadjacent") = 7, py::arg("max_nMagnets"));
+    m.def("GPMO_baseline_matrix_free", &GPMO_baseline_matrix_free, py::arg("A_op"), py::arg("column_scaling"), py::arg("b_obj"), py::arg("mmax"), py::arg("normal_norms"), py::arg("K") = 1000, py::arg("verbose") = false, py::arg("nhistory") = 100, py::arg("single_direction") = -1);
 
     m.def("DommaschkB" , &DommaschkB);
     m.def("DommaschkdB", &DommaschkdB);
@@ -52,6 +52,7 @@ template <typename T, typename S> void register_common_field_methods(S &c) {
      .def("dGds", py::overload_cast<>(&T::dGds), "Returns a `(npoints, 1)` array containing the derivative of the magnetic field toroidal covariant component wrt s in Boozer coordinates.")
      .def("dIds", py::overload_cast<>(&T::dIds), "Returns a `(npoints, 1)` array containing the derivative of the magnetic field poloidal covariant component wrt s in Boozer coordinates.")
      .def("diotads", py::overload_cast<>(&T::diotads), "Returns a `(npoints, 1)` array containing the derivative of the rotational transform wrt s in Boozer coordinates.")
+     .def("gc_quantities", py::overload_cast<>(&T::gc_quantities), "Returns a `(npoints, 12)` array containing (modB, dmodBds, dmodBdtheta, dmodBdzeta, G, iota, I, dGds, dIds, K, dKdtheta, dKdzeta), i.e. all quantities needed by the guiding center equations.")
 
      .def("dKdtheta_ref", py::overload_cast<>(&T::dKdtheta_ref), "Same as `dKdtheta`, but returns a reference to the array (this array should be read only).")
      .def("dKdzeta_ref", py::overload_cast<>(&T::dKdzeta_ref), "Same as `dKdzeta`, but returns a reference to the array (this array should be read only).")
@@ -87,6 +88,7 @@ template <typename T, typename S> void register_common_field_methods(S &c) {
      .def("dGds_ref", py::overload_cast<>(&T::dGds_ref), "Same as `dGds`, but returns a reference to the array (this array should be read only).")
      .def("dIds_ref", py::overload_cast<>(&T::dIds_ref), "Same as `dIds`, but returns a reference to the array (this array should be read only).")
      .def("diotads_ref", py::overload_cast<>(&T::diotads_ref), "Same as `diotads`, but returns a reference to the array (this array should be read only).")
+     .def("gc_quantities_ref", py::overload_cast<>(&T::gc_quantities_ref), "Same as `gc_quantities`, but returns a reference to the array (this array should be read only).")
 
      .def("invalidate_cache", &T::invalidate_cache, "Clear the cache. Called automatically after each call to `set_points[...]`.")
      .def("get_points", &T::get_points, "Get the point where the field should be evaluated in Boozer coordinates.")
@@ -100,8 +102,10 @@ void init_boozermagneticfields(py::module_ &m){
   register_common_field_methods<PyBoozerMagneticField>(mf);
 
   auto ifield = py::class_<PyInterpolatedBoozerField, shared_ptr<PyInterpolatedBoozerField>, PyBoozerMagneticField>(m, "InterpolatedBoozerField")
-      .def(py::init<shared_ptr<PyBoozerMagneticField>, InterpolationRule, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool>())
-      .def(py::init<shared_ptr<PyBoozerMagneticField>, int, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool>())
+      .def(py::init<shared_ptr<PyBoozerMagneticField>, InterpolationRule, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool, bool, bool>(),
+          py::arg("field"), py::arg("rule"), py::arg("s_range"), py::arg("theta_range"), py::arg("zeta_range"), py::arg("extrapolate"), py::arg("nfp"), py::arg("stellsym"), py::arg("lazy")=false, py::arg("fused")=false)
+      .def(py::init<shared_ptr<PyBoozerMagneticField>, int, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool, bool, bool>(),
+          py::arg("field"), py::arg("degree"), py::arg("s_range"), py::arg("theta_range"), py::arg("zeta_range"), py::arg("extrapolate"), py::arg("nfp"), py::arg("stellsym"), py::arg("lazy")=false, py::arg("fused")=false)
       .def("estimate_error_K", &PyInterpolatedBoozerField::estimate_error_K)
       .def("estimate_error_modB", &PyInterpolatedBoozerField::estimate_error_modB)
       .def("estimate_error_R", &PyInterpolatedBoozerField::estimate_error_R)
@@ -110,6 +114,12 @@ void init_boozermagneticfields(py::module_ &m){
       .def("estimate_error_G", &PyInterpolatedBoozerField::estimate_error_G)
       .def("estimate_error_I", &PyInterpolatedBoozerField::estimate_error_I)
       .def("estimate_error_iota", &PyInterpolatedBoozerField::estimate_error_iota)
+      .def("save_interpolants", &PyInterpolatedBoozerField::save_interpolants, py::arg("filename"), py::arg("dof_hash")=0)
+      .def("load_interpolants", &PyInterpolatedBoozerField::load_interpolants, py::arg("filename"), py::arg("dof_hash")=0, py::arg("mmap")=true)
+      .def("cells_filled", &PyInterpolatedBoozerField::cells_filled)
+      .def("cells_total", &PyInterpolatedBoozerField::cells_total)
+      .def("dofs_stored", &PyInterpolatedBoozerField::dofs_stored)
+      .def("fused_gc_quantities", &PyInterpolatedBoozerField::fused_gc_quantities)
       .def_readonly("s_range", &PyInterpolatedBoozerField::s_range)
       .def_readonly("theta_range", &PyInterpolatedBoozerField::theta_range)
       .def_readonly("zeta_range", &PyInterpolatedBoozerField::zeta_range)
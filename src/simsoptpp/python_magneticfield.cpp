@@ -72,8 +72,14 @@ void init_magneticfields(py::module_ &m){
         .def(py::init<InterpolationRule, RangeTriplet, RangeTriplet, RangeTriplet, int, bool, std::function<std::vector<bool>(Vec, Vec, Vec)>>())
         .def(py::init<InterpolationRule, RangeTriplet, RangeTriplet, RangeTriplet, int, bool>())
         .def("interpolate_batch", &RegularGridInterpolant3D<PyTensor>::interpolate_batch, "Interpolate a function by evaluating the function on all interpolation nodes simultanuously.")
+        .def("interpolate_lazy", &RegularGridInterpolant3D<PyTensor>::interpolate_lazy, "Interpolate a function lazily: the function is only evaluated on the interpolation nodes of a cell the first time the interpolant is evaluated in that cell.")
+        .def("cells_filled", &RegularGridInterpolant3D<PyTensor>::cells_filled, "Number of cells on which the interpolant has been computed.")
+        .def("cells_total", &RegularGridInterpolant3D<PyTensor>::cells_total, "Number of cells of the interpolant that are not skipped.")
+        .def("dofs_stored", &RegularGridInterpolant3D<PyTensor>::dofs_stored, "Number of interpolation nodes at which the function values are kept in memory (only lazy interpolants keep them).")
         .def("evaluate", &RegularGridInterpolant3D<PyTensor>::evaluate, "Evaluate the interpolant at a point.")
-        .def("evaluate_batch", &RegularGridInterpolant3D<PyTensor>::evaluate_batch, "Evaluate the interpolant at multiple points (faster than `evaluate` as it uses prefetching).");
+        .def("evaluate_batch", &RegularGridInterpolant3D<PyTensor>::evaluate_batch, "Evaluate the interpolant at multiple points (faster than `evaluate` as it uses prefetching).")
+        .def("save_cell_values", &RegularGridInterpolant3D<PyTensor>::save_cell_values, py::arg("filename"), py::arg("dof_hash")=0, "Write the values of the interpolant on all cells to a binary file. `dof_hash` is stored in the file and identifies the function that was interpolated.")
+        .def("load_cell_values", &RegularGridInterpolant3D<PyTensor>::load_cell_values, py::arg("filename"), py::arg("mmap")=true, py::arg("dof_hash")=0, py::arg("offset")=0, "Load the values of the interpolant from a file written by `save_cell_values`. The interpolant has to be constructed with the same grid, rule and skip function, and `dof_hash` has to match the value used when saving. If `mmap` is true, the file is mapped into memory read-only, so that multiple processes loading the same file share the memory.");
 
 
     py::class_<CurrentBase<PyArray>, shared_ptr<CurrentBase<PyArray>>, PyCurrentBaseTrampoline>(m, "CurrentBase")
@@ -99,6 +105,16 @@ void init_magneticfields(py::module_ &m){
     auto bs = py::class_<PyBiotSavart, PyMagneticFieldTrampoline<PyBiotSavart>, shared_ptr<PyBiotSavart>, PyMagneticField>(m, "BiotSavart")
         .def(py::init<vector<shared_ptr<Coil<PyArray>>>>())
         .def("compute", &PyBiotSavart::compute)
+        .def("set_tree_evaluation", &PyBiotSavart::set_tree_evaluation, py::arg("theta"), py::arg("order")=4, "Evaluate the field using a Barnes-Hut tree code with opening angle `theta` and multipole expansion order `order`. `theta=0` switches back to direct summation.")
+        .def("get_tree_theta", &PyBiotSavart::get_tree_theta)
+        .def("get_tree_order", &PyBiotSavart::get_tree_order)
+        .def("set_symmetry", &PyBiotSavart::set_symmetry, py::arg("base_curves"), py::arg("base_idx"), py::arg("matrices"), "Compute the field of coil `i` from the curve `base_curves[base_idx[i]]` rotated by `matrices[i]`.")
+        .def("clear_symmetry", &PyBiotSavart::clear_symmetry)
+        .def("has_symmetry", &PyBiotSavart::has_symmetry)
+        .def("set_precision", &PyBiotSavart::set_precision, py::arg("precision"), "Evaluate B and its first derivative in 'double', 'mixed' or 'single' precision.")
+        .def("get_precision", &PyBiotSavart::get_precision)
+        .def("set_fused_evaluation", &PyBiotSavart::set_fused_evaluation, py::arg("enabled"), "Compute the total field tile by tile, without storing the fields of the individual coils.")
+        .def("get_fused_evaluation", &PyBiotSavart::get_fused_evaluation)
         .def("fieldcache_get_or_create", &PyBiotSavart::fieldcache_get_or_create)
         .def("fieldcache_get_status", &PyBiotSavart::fieldcache_get_status)
         .def_readonly("coils", &PyBiotSavart::coils);
@@ -109,6 +125,9 @@ void init_magneticfields(py::module_ &m){
         .def(py::init<shared_ptr<PyMagneticField>, int, RangeTriplet, RangeTriplet, RangeTriplet, bool, int, bool, std::function<std::vector<bool>(Vec, Vec, Vec)>>())
         .def("estimate_error_B", &PyInterpolatedField::estimate_error_B)
         .def("estimate_error_GradAbsB", &PyInterpolatedField::estimate_error_GradAbsB)
+        .def("clone", &PyInterpolatedField::clone)
+        .def("save_interpolants", &PyInterpolatedField::save_interpolants, py::arg("filename"), py::arg("dof_hash")=0)
+        .def("load_interpolants", &PyInterpolatedField::load_interpolants, py::arg("filename"), py::arg("dof_hash")=0, py::arg("mmap")=true)
         .def_readonly("r_range", &PyInterpolatedField::r_range)
         .def_readonly("phi_range", &PyInterpolatedField::phi_range)
         .def_readonly("z_range", &PyInterpolatedField::z_range)
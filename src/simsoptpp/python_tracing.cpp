@@ -26,6 +26,14 @@ void init_tracing(py::module_ &m){
     py::class_<LevelsetStoppingCriterion<PyTensor>, shared_ptr<LevelsetStoppingCriterion<PyTensor>>, StoppingCriterion>(m, "LevelsetStoppingCriterion")
         .def(py::init<shared_ptr<RegularGridInterpolant3D<PyTensor>>>());
 
+    py::class_<TrajectorySink, shared_ptr<TrajectorySink>>(m, "TrajectorySink")
+        .def("flush", &TrajectorySink::flush);
+    py::class_<BinaryFileTrajectorySink, shared_ptr<BinaryFileTrajectorySink>, TrajectorySink>(m, "BinaryFileTrajectorySink")
+        .def(py::init<std::string, bool>(), py::arg("filename"), py::arg("append")=false)
+        .def("close", &BinaryFileTrajectorySink::close);
+    py::class_<CallbackTrajectorySink<PyArray>, shared_ptr<CallbackTrajectorySink<PyArray>>, TrajectorySink>(m, "CallbackTrajectorySink")
+        .def(py::init<std::function<void(int, PyArray&)>>());
+
     m.def("particle_guiding_center_boozer_tracing", &particle_guiding_center_boozer_tracing<xt::pytensor>,
         py::arg("field"),
         py::arg("stz_init"),
@@ -38,7 +46,10 @@ void init_tracing(py::module_ &m){
         py::arg("vacuum"),
         py::arg("noK"),
         py::arg("zetas")=vector<double>{},
-        py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{}
+        py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{},
+        py::arg("save_every")=1,
+        py::arg("sink")=nullptr,
+        py::arg("sink_id")=0
         );
 
     m.def("particle_guiding_center_tracing", &particle_guiding_center_tracing<xt::pytensor>,
@@ -52,6 +63,37 @@ void init_tracing(py::module_ &m){
         py::arg("tol"),
         py::arg("vacuum"),
         py::arg("phis")=vector<double>{},
+        py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{},
+        py::arg("save_every")=1,
+        py::arg("sink")=nullptr,
+        py::arg("sink_id")=0
+        );
+
+    m.def("particle_guiding_center_tracing_parallel", &particle_guiding_center_tracing_parallel<xt::pytensor>,
+        py::arg("fields"),
+        py::arg("xyz_inits"),
+        py::arg("m"),
+        py::arg("q"),
+        py::arg("vtotal"),
+        py::arg("vtangs"),
+        py::arg("tmax"),
+        py::arg("tol"),
+        py::arg("vacuum"),
+        py::arg("phis")=vector<double>{},
+        py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{}
+        );
+
+    m.def("particle_guiding_center_tracing_batch", &particle_guiding_center_tracing_batch<xt::pytensor>,
+        py::arg("field"),
+        py::arg("xyz_inits"),
+        py::arg("m"),
+        py::arg("q"),
+        py::arg("vtotal"),
+        py::arg("vtangs"),
+        py::arg("tmax"),
+        py::arg("tol"),
+        py::arg("vacuum"),
+        py::arg("phis")=vector<double>{},
         py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{}
         );
 
@@ -64,7 +106,10 @@ void init_tracing(py::module_ &m){
         py::arg("tmax"),
         py::arg("tol"),
         py::arg("phis")=vector<double>{},
-        py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{}
+        py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{},
+        py::arg("save_every")=1,
+        py::arg("sink")=nullptr,
+        py::arg("sink_id")=0
         );
 
     m.def("fieldline_tracing", &fieldline_tracing<xt::pytensor>,
@@ -73,7 +118,11 @@ void init_tracing(py::module_ &m){
             py::arg("tmax"),
             py::arg("tol"),
             py::arg("phis")=vector<double>{},
-            py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{});
+            py::arg("stopping_criteria")=vector<shared_ptr<StoppingCriterion>>{},
+            py::arg("poincare")=false,
+            py::arg("save_every")=1,
+            py::arg("sink")=nullptr,
+            py::arg("sink_id")=0);
 
     m.def("get_phi", &get_phi);
 }
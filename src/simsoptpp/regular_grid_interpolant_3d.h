@@ -1,15 +1,21 @@
 #pragma once
 #include "simdhelpers.h"
-#include <unordered_map>
+#include <cstring>
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <fmt/core.h>
 #include <fmt/ranges.h>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <random>
 #include <stdexcept>
 #include <stdint.h>
+#include <string>
 #include <tuple>
+#include <unordered_map>
 #include <vector>
 
 using Vec = std::vector<double>;
@@ -98,12 +104,37 @@ class RegularGridInterpolant3D {
         // location of the mesh nodes in [xmin, xmax], [ymin, ymax], and [zmin, zmax]. superset of xmesh, ymesh, zmesh
         // has size nx*degree + 1, ny*degree + 1, and nz*degree + 1 respectively
         Vec xdof, ydof, zdof;
-        // subset of the tensor product of the dof locations. if none of the dofs are skipped, these all have size
-        // (nx*degree + 1) * (ny*degree + 1) * (nz*degree + 1), but now they have size dofs_to_keep
-        Vec xdoftensor_reduced, ydoftensor_reduced, zdoftensor_reduced;
 
-        Vec vals; // contains the values of the function to be interpolated at the dofs, of size dofs_to_keep * value_size
-        std::unordered_map<int, AlignedPaddedVec> all_local_vals_map; // maps each cell to an array of size (degree+1)**3 * padded_value_size
+        // the values at the dofs of each cell that is not skipped, stored
+        // contiguously. cell `cell_idx` occupies the (degree+1)**3 * padded_value_size
+        // entries starting at local_vals_size * cell_to_local_idx[cell_idx].
+        // skipped cells have cell_to_local_idx[cell_idx] = -1.
+        AlignedPaddedVec all_local_vals;
+        std::vector<int32_t> cell_to_local_idx;
+        // points to the start of all_local_vals, or to the start of the values
+        // in a memory mapped file (see load_cell_values). nullptr until the
+        // interpolant has been built or loaded.
+        const double* all_local_vals_ptr = nullptr;
+        std::shared_ptr<const void> mapped_file; // keeps a memory mapped file alive
+
+        // In lazy mode (see interpolate_lazy) the values of a cell are only
+        // computed the first time the interpolant is evaluated in that cell.
+        // lazy_cell_ptrs[cell_idx] then points to the values of the cell, or
+        // is nullptr if the cell has not been filled yet. The values live in
+        // lazy_storage, which is only ever appended to. The function values
+        // at the dofs computed so far are kept in lazy_dof_vals, at the slot
+        // given by lazy_dof_slot, so that the memory used scales with the
+        // number of cells visited rather than with the whole grid.
+        bool lazy = false;
+        std::function<Vec(Vec, Vec, Vec)> lazy_f;
+        std::unique_ptr<std::atomic<const double*>[]> lazy_cell_ptrs;
+        std::deque<AlignedPaddedVec> lazy_storage;
+        int lazy_storage_used = 0; // number of cells used in lazy_storage.back()
+        std::unordered_map<uint32_t, uint32_t> lazy_dof_slot;
+        Vec lazy_dof_vals;
+        std::atomic<uint32_t> cells_filled_count{0};
+        std::atomic<uint32_t> dofs_stored_count{0};
+        std::mutex lazy_mutex;
         std::vector<bool> skip_cell; // whether to skip each cell or not
         // since we are skipping some dofs, we need mappings into the list of
         // reduced dofs, e.g. if we skip dofs 3, then reduced to full would
@@ -112,7 +143,6 @@ class RegularGridInterpolant3D {
 
         uint32_t cells_to_skip, cells_to_keep, dofs_to_skip, dofs_to_keep; // which cells and dofs we skip and keep
         int local_vals_size;
-        Vec pkxs, pkys, pkzs;
 
         #if defined(USE_XSIMD)
         static const int simdcount = xsimd::simd_type<double>::size; // vector width for simd instructions
@@ -139,9 +169,48 @@ class RegularGridInterpolant3D {
             return i*(degree+1)*(degree+1) + j*(degree+1) + k;
         }
 
+        // location of the dof with index `dof` in the reduced list of dofs
+        inline void dof_location(uint32_t dof, double& x, double& y, double& z){
+            int degree = rule.degree;
+            uint32_t full = reduced_to_full_map[dof];
+            uint32_t nyz = (ny*degree+1)*(nz*degree+1);
+            x = xdof[full / nyz];
+            y = ydof[(full % nyz) / (nz*degree+1)];
+            z = zdof[full % (nz*degree+1)];
+        }
+
+        // the values on cell `cell_idx`, or nullptr if the cell is skipped or
+        // the interpolant has not been built. fills the cell in lazy mode.
+        inline const double* cell_values(int cell_idx) {
+            if(cell_idx < 0 || cell_idx >= nx*ny*nz || cell_to_local_idx[cell_idx] < 0)
+                return nullptr;
+            if(!lazy)
+                return all_local_vals_ptr ? all_local_vals_ptr + (size_t)local_vals_size * cell_to_local_idx[cell_idx] : nullptr;
+            const double* ptr = lazy_cell_ptrs[cell_idx].load(std::memory_order_acquire);
+            if(!ptr) {
+                fill_cells({cell_idx});
+                ptr = lazy_cell_ptrs[cell_idx].load(std::memory_order_acquire);
+            }
+            return ptr;
+        }
+
+        // copy the values at the dofs of a cell into the layout used for
+        // evaluation, dof_vals(dof) returns the values at a (reduced) dof
+        template<class F>
+        void copy_local_vals(int cell_idx, double* local_vals, F dof_vals);
+        // free everything that is only needed in lazy mode
+        void release_lazy_storage();
+        // compute the values on all cells in `cells` that have not been filled yet (lazy mode only)
+        void fill_cells(std::vector<int> cells);
+
         int locate_unsafe(double x, double y, double z);
+        int locate(double x, double y, double z, double& xlocal, double& ylocal, double& zlocal);
         void evaluate_inplace(double x, double y, double z, double* res);
         void evaluate_local(double x, double y, double z, int cell_idx, double* res);
+        // evaluate the interpolant on cell `cell_idx` at up to simdcount
+        // points at once. `local` contains the local coordinates of all
+        // points, `idxs` the indices of the n points to evaluate.
+        void evaluate_local_batch(const double* local, const uint32_t* idxs, int n, int cell_idx, double* res);
 
     public:
 
@@ -153,9 +222,6 @@ class RegularGridInterpolant3D {
             value_size(value_size), out_of_bounds_ok(out_of_bounds_ok)
         {
             int degree = rule.degree;
-            pkxs = Vec(degree+1, 0.);
-            pkys = Vec(degree+1, 0.);
-            pkzs = Vec(degree+1, 0.);
             hx = (xmax-xmin)/nx;
             hy = (ymax-ymin)/ny;
             hz = (zmax-zmin)/nz;
@@ -204,6 +270,12 @@ class RegularGridInterpolant3D {
                 }
             }
             cells_to_keep = nx*ny*nz - cells_to_skip;
+            cell_to_local_idx = std::vector<int32_t>(nx*ny*nz, -1);
+            int32_t local_idx = 0;
+            for (int i = 0; i < nx*ny*nz; ++i) {
+                if(!skip_cell[i])
+                    cell_to_local_idx[i] = local_idx++;
+            }
 
             // now build the interpolation points in 1d.
             xdof = Vec(nx*degree+1, 0.);
@@ -225,21 +297,8 @@ class RegularGridInterpolant3D {
                     zdof[i*degree+j] = zmesh[i] + rule.nodes[j]*hz;
                 }
             }
+            // the dofs are the tensor product of these points
             uint32_t n =  (nx*degree+1)*(ny*degree+1)*(nz*degree+1);
-            // turn these into a tensor product grid
-            Vec xdoftensor(n, 0.);
-            Vec ydoftensor(n, 0.);
-            Vec zdoftensor(n, 0.);
-            for (int i = 0; i <= nx*degree; ++i) {
-                for (int j = 0; j <= ny*degree; ++j) {
-                    for (int k = 0; k <= nz*degree; ++k) {
-                        uint32_t offset = idx_dof(i, j, k);
-                        xdoftensor[offset] = xdof[i];
-                        ydoftensor[offset] = ydof[j];
-                        zdoftensor[offset] = zdof[k];
-                    }
-                }
-            }
             // Now we need to figure out which of these dofs we keep, and which
             // to discard.  To do this, we loop over the cells, and for each
             // cell that shouldn't be skipped, we mark all dofs in that cell.
@@ -280,17 +339,6 @@ class RegularGridInterpolant3D {
                 }
             }
 
-            // build the reduced list of interpolation points
-            xdoftensor_reduced = Vec(dofs_to_keep, 0.);
-            ydoftensor_reduced = Vec(dofs_to_keep, 0.);
-            zdoftensor_reduced = Vec(dofs_to_keep, 0.);
-            for (long i = 0; i < dofs_to_keep; ++i) {
-                xdoftensor_reduced[i] = xdoftensor[reduced_to_full_map[i]];
-                ydoftensor_reduced[i] = ydoftensor[reduced_to_full_map[i]];
-                zdoftensor_reduced[i] = zdoftensor[reduced_to_full_map[i]];
-            }
-            vals = Vec(dofs_to_keep * value_size, 0.);
-
             // round up value_size to nearest multiple of simdcount
             padded_value_size = (value_size % simdcount) ? (value_size + simdcount) - (value_size % simdcount) : value_size;
             int nnodes = (nx*degree+1)*(ny*degree+1)*(nz*degree+1);
@@ -301,11 +349,39 @@ class RegularGridInterpolant3D {
             {}
 
         void interpolate_batch(std::function<Vec(Vec, Vec, Vec)> &f); // build the interpolant
+        // build the interpolant lazily: the values on each cell are computed
+        // from f the first time the interpolant is evaluated in that cell.
+        // Filling is thread-safe, f is never called from two threads at once.
+        void interpolate_lazy(std::function<Vec(Vec, Vec, Vec)> &f);
+
+        // number of cells whose values have been computed, and the total
+        // number of cells that are not skipped
+        uint32_t cells_filled() const { return lazy ? cells_filled_count.load() : (all_local_vals_ptr ? cells_to_keep : 0); }
+        uint32_t cells_total() const { return cells_to_keep; }
+        // number of dofs at which the values of the function are kept in
+        // memory. Only lazy interpolants keep them, to fill further cells.
+        uint32_t dofs_stored() const { return lazy ? dofs_stored_count.load() : 0; }
 
         Vec evaluate(double x, double y, double z); // evaluate the interpolant at one location
         void evaluate_batch(Array& xyz, Array& fxyz); // evluate the interpolant at multiple locations
 
         std::pair<double, double> estimate_error(std::function<Vec(Vec, Vec, Vec)> &f, int samples);
+
+        // write the values on all cells to a binary file, and read them back
+        // in. With mmap=true, the file is mapped into memory read-only instead
+        // of being copied, so that all processes on a node that load the
+        // same file share a single copy of the table. `dof_hash` identifies
+        // the function that was interpolated (e.g. a hash of the coil dofs);
+        // loading fails if it differs from the value stored in the file.
+        void write_cell_values(std::ostream& out, uint64_t dof_hash);
+        void save_cell_values(const std::string& filename, uint64_t dof_hash);
+        void load_cell_values(const std::string& filename, bool mmap, uint64_t dof_hash, uint64_t offset);
+
+        // store several named interpolants in a single file, and return the
+        // names and offsets (to be passed to load_cell_values) of the
+        // interpolants in such a file.
+        static void save_archive(const std::string& filename, const std::vector<std::pair<std::string, std::shared_ptr<RegularGridInterpolant3D<Array>>>>& interpolants, uint64_t dof_hash);
+        static std::vector<std::pair<std::string, uint64_t>> read_archive(const std::string& filename);
 };
 
 
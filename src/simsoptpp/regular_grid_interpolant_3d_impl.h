@@ -3,6 +3,11 @@
 #include "xtensor/xlayout.hpp"
 #define _USE_MATH_DEFINES
 #include <math.h>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 
 #define _EPS_ 1e-13
@@ -14,54 +19,204 @@ template<class Array>
 void RegularGridInterpolant3D<Array>::interpolate_batch(std::function<Vec(Vec, Vec, Vec)> &f) {
     int BATCH_SIZE = 16384;
     int NUM_BATCHES = dofs_to_keep/BATCH_SIZE + (dofs_to_keep % BATCH_SIZE != 0);
+    // the values at the dofs are only needed until they have been copied to the cells
+    Vec vals((size_t)dofs_to_keep * value_size, 0.);
     for (int i = 0; i < NUM_BATCHES; ++i) {
         uint32_t first = i * BATCH_SIZE;
         uint32_t last = std::min((uint32_t)((i+1) * BATCH_SIZE), dofs_to_keep);
-        Vec xsub(xdoftensor_reduced.begin() + first, xdoftensor_reduced.begin() + last);
-        Vec ysub(ydoftensor_reduced.begin() + first, ydoftensor_reduced.begin() + last);
-        Vec zsub(zdoftensor_reduced.begin() + first, zdoftensor_reduced.begin() + last);
+        Vec xsub(last-first), ysub(last-first), zsub(last-first);
+        for (uint32_t j = first; j < last; ++j)
+            dof_location(j, xsub[j-first], ysub[j-first], zsub[j-first]);
         Vec fxyzsub  = f(xsub, ysub, zsub);
         for (int j = 0; j < last-first; ++j) {
             for (int l = 0; l < value_size; ++l) {
-                vals[first * value_size + j * value_size + l] = fxyzsub[j * value_size + l];
+                vals[(size_t)(first + j) * value_size + l] = fxyzsub[j * value_size + l];
             }
         }
     }
+    all_local_vals = AlignedPaddedVec((size_t)cells_to_keep * local_vals_size, 0.);
+
+    for (int meshidx = 0; meshidx < nx*ny*nz; ++meshidx) {
+        if(skip_cell[meshidx])
+            continue;
+        copy_local_vals(meshidx, all_local_vals.data() + (size_t)local_vals_size * cell_to_local_idx[meshidx],
+                [&](uint32_t dof) { return vals.data() + (size_t)value_size * dof; });
+    }
+    mapped_file.reset();
+    all_local_vals_ptr = all_local_vals.data();
+    release_lazy_storage();
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::release_lazy_storage() {
+    lazy = false;
+    lazy_cell_ptrs.reset();
+    lazy_storage.clear();
+    lazy_dof_slot = std::unordered_map<uint32_t, uint32_t>();
+    Vec().swap(lazy_dof_vals);
+    dofs_stored_count = 0;
+}
+
+template<class Array>
+template<class F>
+void RegularGridInterpolant3D<Array>::copy_local_vals(int cell_idx, double* local_vals, F dof_vals) {
     int degree = rule.degree;
-    all_local_vals_map = std::unordered_map<int, AlignedPaddedVec>();
-    all_local_vals_map.reserve(cells_to_keep);
-
-    for (int xidx = 0; xidx < nx; ++xidx) {
-        for (int yidx = 0; yidx < ny; ++yidx) {
-            for (int zidx = 0; zidx < nz; ++zidx) {
-                int meshidx = idx_cell(xidx, yidx, zidx);
-                if(skip_cell[meshidx])
-                    continue;
-                AlignedPaddedVec local_vals(local_vals_size, 0.);
-                for (int i = 0; i < degree+1; ++i) {
-                    for (int j = 0; j < degree+1; ++j) {
-                        for (int k = 0; k < degree+1; ++k) {
-                            int offset = value_size*full_to_reduced_map[idx_dof(xidx*degree+i, yidx*degree+j, zidx*degree+k)];
-                            int offset_local = padded_value_size * idx_dof_local(i, j, k);
-                            for (int l = 0; l < value_size; ++l) {
-                                local_vals[offset_local + l] = vals[offset + l];
-                            }
-                        }
-                    }
+    int xidx = cell_idx / (ny*nz);
+    int yidx = (cell_idx / nz) % ny;
+    int zidx = cell_idx % nz;
+    for (int i = 0; i < degree+1; ++i) {
+        for (int j = 0; j < degree+1; ++j) {
+            for (int k = 0; k < degree+1; ++k) {
+                const double* vals = dof_vals(full_to_reduced_map[idx_dof(xidx*degree+i, yidx*degree+j, zidx*degree+k)]);
+                int offset_local = padded_value_size * idx_dof_local(i, j, k);
+                for (int l = 0; l < value_size; ++l) {
+                    local_vals[offset_local + l] = vals[l];
                 }
-                all_local_vals_map.insert({meshidx, local_vals});
             }
         }
     }
 }
 
+template<class Array>
+void RegularGridInterpolant3D<Array>::interpolate_lazy(std::function<Vec(Vec, Vec, Vec)> &f) {
+    std::lock_guard<std::mutex> lock(lazy_mutex);
+    lazy_f = f;
+    lazy_cell_ptrs.reset(new std::atomic<const double*>[nx*ny*nz]);
+    for (int i = 0; i < nx*ny*nz; ++i)
+        lazy_cell_ptrs[i].store(nullptr, std::memory_order_relaxed);
+    lazy_storage.clear();
+    lazy_storage_used = 0;
+    lazy_dof_slot = std::unordered_map<uint32_t, uint32_t>();
+    Vec().swap(lazy_dof_vals);
+    cells_filled_count = 0;
+    dofs_stored_count = 0;
+    all_local_vals = AlignedPaddedVec();
+    mapped_file.reset();
+    all_local_vals_ptr = nullptr;
+    lazy = true;
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::fill_cells(std::vector<int> cells) {
+    // cells are allocated in chunks, so that we don't need one allocation per cell
+    const int CELLS_PER_CHUNK = 64;
+    int BATCH_SIZE = 16384;
+    int degree = rule.degree;
+    std::lock_guard<std::mutex> lock(lazy_mutex);
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    // another thread may have filled some of the cells in the meantime
+    cells.erase(std::remove_if(cells.begin(), cells.end(), [this](int cell_idx) {
+        return lazy_cell_ptrs[cell_idx].load(std::memory_order_relaxed) != nullptr;
+    }), cells.end());
+    if(cells.size() == 0)
+        return;
+
+    // find the dofs of these cells at which f has not been evaluated yet.
+    // neighbouring cells share the dofs on their common faces.
+    std::vector<uint32_t> dofs;
+    for (int cell_idx : cells) {
+        int xidx = cell_idx / (ny*nz);
+        int yidx = (cell_idx / nz) % ny;
+        int zidx = cell_idx % nz;
+        for (int i = 0; i < degree+1; ++i) {
+            for (int j = 0; j < degree+1; ++j) {
+                for (int k = 0; k < degree+1; ++k) {
+                    uint32_t dof = full_to_reduced_map[idx_dof(xidx*degree+i, yidx*degree+j, zidx*degree+k)];
+                    if(lazy_dof_slot.find(dof) == lazy_dof_slot.end())
+                        dofs.push_back(dof);
+                }
+            }
+        }
+    }
+    std::sort(dofs.begin(), dofs.end());
+    dofs.erase(std::unique(dofs.begin(), dofs.end()), dofs.end());
+    Vec vals(dofs.size() * value_size);
+    for (size_t first = 0; first < dofs.size(); first += BATCH_SIZE) {
+        size_t last = std::min(first + BATCH_SIZE, dofs.size());
+        Vec xsub(last-first), ysub(last-first), zsub(last-first);
+        for (size_t j = first; j < last; ++j)
+            dof_location(dofs[j], xsub[j-first], ysub[j-first], zsub[j-first]);
+        Vec fxyzsub = lazy_f(xsub, ysub, zsub);
+        std::copy(fxyzsub.begin(), fxyzsub.begin() + (last-first) * value_size, vals.begin() + first * value_size);
+    }
+    // only store the values once f has succeeded for all of them
+    uint32_t slot = lazy_dof_vals.size() / value_size;
+    for (uint32_t dof : dofs)
+        lazy_dof_slot[dof] = slot++;
+    lazy_dof_vals.insert(lazy_dof_vals.end(), vals.begin(), vals.end());
+    dofs_stored_count = lazy_dof_slot.size();
+
+    for (int cell_idx : cells) {
+        if(lazy_storage.empty() || lazy_storage_used == CELLS_PER_CHUNK) {
+            lazy_storage.emplace_back(CELLS_PER_CHUNK * local_vals_size, 0.);
+            lazy_storage_used = 0;
+        }
+        double* local_vals = lazy_storage.back().data() + local_vals_size * lazy_storage_used++;
+        copy_local_vals(cell_idx, local_vals, [this](uint32_t dof) {
+            return lazy_dof_vals.data() + (size_t)value_size * lazy_dof_slot[dof];
+        });
+        lazy_cell_ptrs[cell_idx].store(local_vals, std::memory_order_release);
+        cells_filled_count++;
+    }
+}
+
 template<class Array>
 void RegularGridInterpolant3D<Array>::evaluate_batch(Array& xyz, Array& fxyz){
     if(fxyz.layout() != xt::layout_type::row_major)
           throw std::runtime_error("fxyz needs to be in row-major storage order");
     int npoints = xyz.shape(0);
+    if(lazy) {
+        // fill all cells that are hit by one of the points at once, so that
+        // the function is evaluated on as few, large batches as possible.
+        std::vector<int> missing;
+        double xlocal, ylocal, zlocal;
+        for (int i = 0; i < npoints; ++i) {
+            int cell_idx = locate(xyz(i, 0), xyz(i, 1), xyz(i, 2), xlocal, ylocal, zlocal);
+            if(cell_idx >= 0 && cell_idx < nx*ny*nz && cell_to_local_idx[cell_idx] >= 0
+                    && !lazy_cell_ptrs[cell_idx].load(std::memory_order_acquire))
+                missing.push_back(cell_idx);
+        }
+        if(missing.size() > 0)
+            fill_cells(missing);
+    }
+    // without simd there is nothing to gain from grouping the points
+    if(simdcount == 1 || npoints < 2*simdcount) {
+        for (int i = 0; i < npoints; ++i) {
+            evaluate_inplace(xyz(i, 0), xyz(i, 1), xyz(i, 2), fxyz.data() + value_size*i);
+        }
+        return;
+    }
+
+    // For larger batches, we first locate all points and then sort them by
+    // cell. Points in the same cell are then evaluated together, simdcount
+    // points at a time, so that the values on each cell are only loaded once
+    // per group of points and the basis functions are evaluated in simd.
+    static thread_local Vec local;
+    static thread_local std::vector<uint64_t> keys;
+    static thread_local std::vector<uint32_t> idxs;
+    local.resize(3*npoints);
+    keys.resize(npoints);
+    idxs.resize(npoints);
     for (int i = 0; i < npoints; ++i) {
-        evaluate_inplace(xyz(i, 0), xyz(i, 1), xyz(i, 2), fxyz.data() + value_size*i);
+        int cell_idx = locate(xyz(i, 0), xyz(i, 1), xyz(i, 2), local[3*i], local[3*i+1], local[3*i+2]);
+        keys[i] = (uint64_t(uint32_t(cell_idx)) << 32) | uint32_t(i);
+    }
+    std::sort(keys.begin(), keys.end());
+    for (int i = 0; i < npoints; ++i) {
+        idxs[i] = uint32_t(keys[i]);
+    }
+    double* res = fxyz.data();
+    int start = 0;
+    while(start < npoints) {
+        uint32_t cell = keys[start] >> 32;
+        int end = start + 1;
+        while(end < npoints && (keys[end] >> 32) == cell)
+            ++end;
+        for (int i = start; i < end; i += simdcount) {
+            evaluate_local_batch(local.data(), idxs.data() + i, std::min(simdcount, end-i), int(cell), res);
+        }
+        start = end;
     }
 }
 
@@ -82,7 +237,7 @@ int RegularGridInterpolant3D<Array>::locate_unsafe(double x, double y, double z)
 }
 
 template<class Array>
-void RegularGridInterpolant3D<Array>::evaluate_inplace(double x, double y, double z, double* res){
+int RegularGridInterpolant3D<Array>::locate(double x, double y, double z, double& xlocal, double& ylocal, double& zlocal){
 
     // to avoid funny business when the data is just a tiny bit out of bounds
     // due to machine precision, we perform this check and shift
@@ -104,25 +259,39 @@ void RegularGridInterpolant3D<Array>::evaluate_inplace(double x, double y, doubl
         if(zidx < 0 || zidx >= nz)
             throw std::runtime_error(fmt::format("zidxs={} not within [0, {}]", zidx, nz-1));
     }
-    double xlocal = (x-xmesh[xidx])/hx;
-    double ylocal = (y-ymesh[yidx])/hy;
-    double zlocal = (z-zmesh[zidx])/hz;
-    return evaluate_local(xlocal, ylocal, zlocal, idx_cell(xidx, yidx, zidx), res);
+    xlocal = (x-xmesh[xidx])/hx;
+    ylocal = (y-ymesh[yidx])/hy;
+    zlocal = (z-zmesh[zidx])/hz;
+    return idx_cell(xidx, yidx, zidx);
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::evaluate_inplace(double x, double y, double z, double* res){
+    double xlocal, ylocal, zlocal;
+    int cell_idx = locate(x, y, z, xlocal, ylocal, zlocal);
+    return evaluate_local(xlocal, ylocal, zlocal, cell_idx, res);
 }
 
 template<class Array>
 void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double z, int cell_idx, double* res)
 {
     int degree = rule.degree;
-    auto got = all_local_vals_map.find(cell_idx);
-    if (got == all_local_vals_map.end()) {
+    const double* vals_local = cell_values(cell_idx);
+    if (!vals_local) {
         if(out_of_bounds_ok)
             return;
         else
-            throw std::runtime_error(fmt::format("cell_idx={} not in all_local_vals_map", cell_idx));
+            throw std::runtime_error(fmt::format("cell_idx={} is not part of the interpolant", cell_idx));
     }
 
-    double* vals_local = got->second.data();
+    // scratch space for the basis functions. this is thread local so that
+    // an interpolant can be evaluated from multiple threads at once.
+    static thread_local Vec pkxs, pkys, pkzs;
+    if(pkxs.size() < std::size_t(degree+1)) {
+        pkxs.resize(degree+1);
+        pkys.resize(degree+1);
+        pkzs.resize(degree+1);
+    }
     #if defined(USE_XSIMD)
     if(xsimd::simd_type<double>::size >= 3){
         simd_t xyz;
@@ -150,7 +319,7 @@ void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double
     for(int l=0; l<padded_value_size; l += simdcount) {
         simd_t sumi(0.);
         int offset_local = l;
-        double* val_ptr = &(vals_local[offset_local]);
+        const double* val_ptr = &(vals_local[offset_local]);
         for (int i = 0; i < degree+1; ++i) {
             simd_t sumj(0.); 
             for (int j = 0; j < degree+1; ++j) {
@@ -179,7 +348,7 @@ void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double
     for(int l=0; l<padded_value_size; l += simdcount) {
         double sumi(0.);
         int offset_local = l;
-        double* val_ptr = &(vals_local[offset_local]);
+        const double* val_ptr = &(vals_local[offset_local]);
         for (int i = 0; i < degree+1; ++i) {
             double sumj(0.);
             for (int j = 0; j < degree+1; ++j) {
@@ -200,6 +369,292 @@ void RegularGridInterpolant3D<Array>::evaluate_local(double x, double y, double
     #endif
 }
 
+template<class Array>
+void RegularGridInterpolant3D<Array>::evaluate_local_batch(const double* local, const uint32_t* idxs, int n, int cell_idx, double* res)
+{
+    #if defined(USE_XSIMD)
+    int degree = rule.degree;
+    const double* vals_local = n < 2 ? nullptr : cell_values(cell_idx);
+    if (!vals_local) {
+    #endif
+        // single points and points outside of the interpolant are handled
+        // (and errors are raised) just as in evaluate_inplace.
+        for (int m = 0; m < n; ++m) {
+            const double* xyz = local + 3*idxs[m];
+            evaluate_local(xyz[0], xyz[1], xyz[2], cell_idx, res + value_size*idxs[m]);
+        }
+    #if defined(USE_XSIMD)
+        return;
+    }
+
+    // the basis functions, evaluated at all points. lane m corresponds to
+    // point idxs[m], unused lanes repeat the last point.
+    static thread_local AlignedPaddedVec pks;
+    pks.resize(3*(degree+1)*simdcount);
+    simd_t x, y, z;
+    for (int m = 0; m < simdcount; ++m) {
+        const double* xyz = local + 3*idxs[std::min(m, n-1)];
+        x[m] = xyz[0];
+        y[m] = xyz[1];
+        z[m] = xyz[2];
+    }
+    double* pkxs = pks.data();
+    double* pkys = pkxs + (degree+1)*simdcount;
+    double* pkzs = pkys + (degree+1)*simdcount;
+    for (int k = 0; k < degree+1; ++k) {
+        this->rule.basis_fun(k, x).store_aligned(pkxs + k*simdcount);
+        this->rule.basis_fun(k, y).store_aligned(pkys + k*simdcount);
+        this->rule.basis_fun(k, z).store_aligned(pkzs + k*simdcount);
+    }
+
+    // same order of operations as in evaluate_local, so that the results
+    // agree bit for bit, but vectorized over points instead of over the
+    // components of the output.
+    for (int l = 0; l < value_size; ++l) {
+        simd_t sumi(0.);
+        const double* val_ptr = vals_local + l;
+        for (int i = 0; i < degree+1; ++i) {
+            simd_t sumj(0.);
+            for (int j = 0; j < degree+1; ++j) {
+                simd_t sumk(0.);
+                for (int k = 0; k < degree+1; ++k) {
+                    sumk = xsimd::fma(simd_t(*val_ptr), xsimd::load_aligned(pkzs + k*simdcount), sumk);
+                    val_ptr += padded_value_size;
+                }
+                sumj = xsimd::fma(sumk, xsimd::load_aligned(pkys + j*simdcount), sumj);
+            }
+            sumi = xsimd::fma(sumj, xsimd::load_aligned(pkxs + i*simdcount), sumi);
+        }
+        for (int m = 0; m < n; ++m) {
+            res[value_size*idxs[m] + l] = sumi[m];
+        }
+    }
+    #endif
+}
+
+// Layout of the data written by write_cell_values: a fixed size header,
+// followed by the nodes of the interpolation rule, the cell_to_local_idx
+// array (which also encodes which cells are skipped) and the contiguous cell
+// values. All offsets are relative to the start of the header and are a
+// multiple of CELL_FILE_ALIGNMENT, so that the values can be used directly
+// (and loaded with aligned simd instructions) when the file is memory mapped.
+#define CELL_FILE_MAGIC 0x3344494752505353ull // "SSPRGID3"
+#define CELL_FILE_VERSION 2
+#define CELL_FILE_ALIGNMENT 64
+
+struct CellFileHeader {
+    uint64_t magic;
+    uint32_t version;
+    int32_t nx, ny, nz, degree, value_size, padded_value_size;
+    uint32_t cells_to_keep;
+    double xmin, xmax, ymin, ymax, zmin, zmax;
+    uint64_t dof_hash; // identifies the function that was interpolated, see load_cell_values
+    uint64_t nodes_offset, index_offset, values_offset, size;
+};
+
+inline uint64_t cell_file_align(uint64_t offset) {
+    return ((offset + CELL_FILE_ALIGNMENT - 1)/CELL_FILE_ALIGNMENT)*CELL_FILE_ALIGNMENT;
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::write_cell_values(std::ostream& out, uint64_t dof_hash) {
+    if(!all_local_vals_ptr && !lazy)
+        throw std::runtime_error("Interpolant has not been built yet, call interpolate_batch first.");
+    if(lazy) {
+        // the file always contains all cells, so fill the ones that are still missing
+        std::vector<int> all_cells;
+        for (int i = 0; i < nx*ny*nz; ++i) {
+            if(cell_to_local_idx[i] >= 0)
+                all_cells.push_back(i);
+        }
+        fill_cells(all_cells);
+    }
+    CellFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    header.magic = CELL_FILE_MAGIC;
+    header.version = CELL_FILE_VERSION;
+    header.nx = nx; header.ny = ny; header.nz = nz;
+    header.degree = rule.degree;
+    header.value_size = value_size;
+    header.padded_value_size = padded_value_size;
+    header.cells_to_keep = cells_to_keep;
+    header.xmin = xmin; header.xmax = xmax;
+    header.ymin = ymin; header.ymax = ymax;
+    header.zmin = zmin; header.zmax = zmax;
+    header.dof_hash = dof_hash;
+    uint64_t nodes_size = sizeof(double) * rule.nodes.size();
+    uint64_t index_size = sizeof(int32_t) * cell_to_local_idx.size();
+    uint64_t values_size = sizeof(double) * (uint64_t)cells_to_keep * local_vals_size;
+    header.nodes_offset = cell_file_align(sizeof(header));
+    header.index_offset = cell_file_align(header.nodes_offset + nodes_size);
+    header.values_offset = cell_file_align(header.index_offset + index_size);
+    header.size = cell_file_align(header.values_offset + values_size);
+
+    std::vector<char> zeros(CELL_FILE_ALIGNMENT, 0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(zeros.data(), header.nodes_offset - sizeof(header));
+    out.write(reinterpret_cast<const char*>(rule.nodes.data()), nodes_size);
+    out.write(zeros.data(), header.index_offset - header.nodes_offset - nodes_size);
+    out.write(reinterpret_cast<const char*>(cell_to_local_idx.data()), index_size);
+    out.write(zeros.data(), header.values_offset - header.index_offset - index_size);
+    if(lazy) {
+        for (int i = 0; i < nx*ny*nz; ++i) {
+            if(cell_to_local_idx[i] >= 0)
+                out.write(reinterpret_cast<const char*>(cell_values(i)), sizeof(double) * local_vals_size);
+        }
+    } else {
+        out.write(reinterpret_cast<const char*>(all_local_vals_ptr), values_size);
+    }
+    out.write(zeros.data(), header.size - header.values_offset - values_size);
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::save_cell_values(const std::string& filename, uint64_t dof_hash) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if(!out)
+        throw std::runtime_error(fmt::format("Could not open {} for writing.", filename));
+    write_cell_values(out, dof_hash);
+    if(!out)
+        throw std::runtime_error(fmt::format("Failed to write to {}.", filename));
+}
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::load_cell_values(const std::string& filename, bool mmap, uint64_t dof_hash, uint64_t offset) {
+    std::ifstream in(filename, std::ios::binary);
+    if(!in)
+        throw std::runtime_error(fmt::format("Could not open {} for reading.", filename));
+    CellFileHeader header;
+    in.seekg(offset);
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!in || header.magic != CELL_FILE_MAGIC)
+        throw std::runtime_error(fmt::format("{} does not contain an interpolant at offset {}.", filename, offset));
+    if(header.version != CELL_FILE_VERSION)
+        throw std::runtime_error(fmt::format("{} has version {}, but only version {} is supported.", filename, header.version, CELL_FILE_VERSION));
+    if(header.dof_hash != dof_hash)
+        throw std::runtime_error(fmt::format("The interpolant stored in {} was computed for a different function (hash {} instead of {}).", filename, header.dof_hash, dof_hash));
+    // the file is only usable if it was written by an interpolant on the
+    // same grid, with the same rule, the same skipped cells and the same padding.
+    if(header.nx != nx || header.ny != ny || header.nz != nz || header.degree != rule.degree
+            || header.value_size != value_size || header.padded_value_size != padded_value_size
+            || header.cells_to_keep != cells_to_keep
+            || header.xmin != xmin || header.xmax != xmax || header.ymin != ymin
+            || header.ymax != ymax || header.zmin != zmin || header.zmax != zmax)
+        throw std::runtime_error(fmt::format("The interpolant stored in {} does not match this interpolant.", filename));
+    Vec file_nodes(rule.nodes.size());
+    in.seekg(offset + header.nodes_offset);
+    in.read(reinterpret_cast<char*>(file_nodes.data()), sizeof(double) * file_nodes.size());
+    if(!in || file_nodes != rule.nodes)
+        throw std::runtime_error(fmt::format("The interpolation rule used in {} does not match the one of this interpolant.", filename));
+    std::vector<int32_t> file_cell_to_local_idx(cell_to_local_idx.size());
+    in.seekg(offset + header.index_offset);
+    in.read(reinterpret_cast<char*>(file_cell_to_local_idx.data()), sizeof(int32_t) * file_cell_to_local_idx.size());
+    if(!in || file_cell_to_local_idx != cell_to_local_idx)
+        throw std::runtime_error(fmt::format("The cells skipped in {} do not match the ones skipped by this interpolant.", filename));
+    uint64_t values_size = sizeof(double) * (uint64_t)cells_to_keep * local_vals_size;
+
+    if(!mmap) {
+        all_local_vals = AlignedPaddedVec((size_t)cells_to_keep * local_vals_size, 0.);
+        in.seekg(offset + header.values_offset);
+        in.read(reinterpret_cast<char*>(all_local_vals.data()), values_size);
+        if(!in)
+            throw std::runtime_error(fmt::format("Failed to read from {}.", filename));
+        mapped_file.reset();
+        all_local_vals_ptr = all_local_vals.data();
+        release_lazy_storage();
+        return;
+    }
+
+    if(offset % CELL_FILE_ALIGNMENT != 0)
+        throw std::runtime_error(fmt::format("Offset {} is not suitably aligned for memory mapping.", offset));
+    int fd = open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+        throw std::runtime_error(fmt::format("Could not open {} for reading.", filename));
+    struct stat st;
+    if(fstat(fd, &st) != 0 || (uint64_t)st.st_size < offset + header.values_offset + values_size) {
+        close(fd);
+        throw std::runtime_error(fmt::format("{} is truncated.", filename));
+    }
+    size_t length = st.st_size;
+    void* addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays valid after closing the file
+    if(addr == MAP_FAILED)
+        throw std::runtime_error(fmt::format("Could not memory map {}.", filename));
+    mapped_file = std::shared_ptr<const void>(addr, [length](const void* p) { munmap(const_cast<void*>(p), length); });
+    all_local_vals = AlignedPaddedVec();
+    all_local_vals_ptr = reinterpret_cast<const double*>(static_cast<const char*>(addr) + offset + header.values_offset);
+    release_lazy_storage();
+}
+
+// Several interpolants (e.g. all the interpolants of an InterpolatedField)
+// can be stored in a single file: a header with the number of interpolants,
+// followed by a table of names and offsets, followed by the interpolants
+// themselves in the format written by write_cell_values.
+#define INTERPOLANT_ARCHIVE_MAGIC 0x3156494843524153ull // "SARCHIV1"
+#define INTERPOLANT_ARCHIVE_VERSION 1
+#define INTERPOLANT_ARCHIVE_NAME_LENGTH 48
+
+struct InterpolantArchiveHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t count;
+};
+
+struct InterpolantArchiveEntry {
+    char name[INTERPOLANT_ARCHIVE_NAME_LENGTH];
+    uint64_t offset;
+};
+
+template<class Array>
+void RegularGridInterpolant3D<Array>::save_archive(const std::string& filename, const std::vector<std::pair<std::string, std::shared_ptr<RegularGridInterpolant3D<Array>>>>& interpolants, uint64_t dof_hash) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    if(!out)
+        throw std::runtime_error(fmt::format("Could not open {} for writing.", filename));
+    InterpolantArchiveHeader header = {INTERPOLANT_ARCHIVE_MAGIC, INTERPOLANT_ARCHIVE_VERSION, (uint32_t)interpolants.size()};
+    std::vector<InterpolantArchiveEntry> entries(interpolants.size());
+    // first write the header with empty entries, and then fill in the
+    // offsets once we know them
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), sizeof(InterpolantArchiveEntry) * entries.size());
+    std::vector<char> zeros(CELL_FILE_ALIGNMENT, 0);
+    for (size_t i = 0; i < interpolants.size(); ++i) {
+        if(interpolants[i].first.size() >= INTERPOLANT_ARCHIVE_NAME_LENGTH)
+            throw std::runtime_error(fmt::format("Interpolant name {} is too long.", interpolants[i].first));
+        std::memset(entries[i].name, 0, INTERPOLANT_ARCHIVE_NAME_LENGTH);
+        std::memcpy(entries[i].name, interpolants[i].first.data(), interpolants[i].first.size());
+        uint64_t pos = out.tellp();
+        out.write(zeros.data(), cell_file_align(pos) - pos);
+        entries[i].offset = cell_file_align(pos);
+        interpolants[i].second->write_cell_values(out, dof_hash);
+    }
+    out.seekp(sizeof(header));
+    out.write(reinterpret_cast<const char*>(entries.data()), sizeof(InterpolantArchiveEntry) * entries.size());
+    if(!out)
+        throw std::runtime_error(fmt::format("Failed to write to {}.", filename));
+}
+
+template<class Array>
+std::vector<std::pair<std::string, uint64_t>> RegularGridInterpolant3D<Array>::read_archive(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    if(!in)
+        throw std::runtime_error(fmt::format("Could not open {} for reading.", filename));
+    InterpolantArchiveHeader header;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!in || header.magic != INTERPOLANT_ARCHIVE_MAGIC)
+        throw std::runtime_error(fmt::format("{} is not an interpolant archive.", filename));
+    if(header.version != INTERPOLANT_ARCHIVE_VERSION)
+        throw std::runtime_error(fmt::format("{} has version {}, but only version {} is supported.", filename, header.version, INTERPOLANT_ARCHIVE_VERSION));
+    std::vector<InterpolantArchiveEntry> entries(header.count);
+    in.read(reinterpret_cast<char*>(entries.data()), sizeof(InterpolantArchiveEntry) * entries.size());
+    if(!in)
+        throw std::runtime_error(fmt::format("Failed to read from {}.", filename));
+    std::vector<std::pair<std::string, uint64_t>> res;
+    for (auto& entry : entries) {
+        entry.name[INTERPOLANT_ARCHIVE_NAME_LENGTH-1] = '\0';
+        res.push_back({std::string(entry.name), entry.offset});
+    }
+    return res;
+}
+
 template<class Array>
 std::pair<double, double> RegularGridInterpolant3D<Array>::estimate_error(std::function<Vec(Vec, Vec, Vec)> &f, int samples) {
     std::default_random_engine generator;
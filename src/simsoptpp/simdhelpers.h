@@ -50,6 +50,7 @@ class aligned_padded_allocator : public xs::aligned_allocator<T, Align> {
 };
 
 using AlignedPaddedVec = std::vector<double, aligned_padded_allocator<double, XSIMD_DEFAULT_ALIGNMENT>>;
+using AlignedPaddedFloatVec = std::vector<float, aligned_padded_allocator<float, XSIMD_DEFAULT_ALIGNMENT>>;
 using simd_t = xs::simd_type<double>;
 
 #else
@@ -125,6 +126,7 @@ public:
 };
 
 using AlignedPaddedVec = std::vector<double, AlignedPaddedAllocator<double>>;
+using AlignedPaddedFloatVec = std::vector<float, AlignedPaddedAllocator<float>>;
 
 #endif
 
@@ -161,3 +163,22 @@ inline simd_t rsqrt(const simd_t& r2){
 inline double rsqrt(const double& r2){
     return 1./std::sqrt(r2);
 }
+
+// Single precision counterparts used by the reduced precision Biot-Savart
+// kernel. Without xsimd, a 'vector' of floats is just a float, so that the
+// same code can be used in both cases.
+#if defined(USE_XSIMD)
+using simd_float_t = xs::simd_type<float>;
+constexpr int simd_float_size = simd_float_t::size;
+inline simd_float_t load_float(const float* p) { return xs::load_aligned(p); }
+inline void store_float(float* p, const simd_float_t& x) { x.store_aligned(p); }
+inline simd_float_t fma_float(const simd_float_t& a, const simd_float_t& b, const simd_float_t& c) { return xsimd::fma(a, b, c); }
+inline simd_float_t rsqrt_float(const simd_float_t& r2) { return 1.f/xsimd::sqrt(r2); }
+#else
+using simd_float_t = float;
+constexpr int simd_float_size = 1;
+inline simd_float_t load_float(const float* p) { return *p; }
+inline void store_float(float* p, const simd_float_t& x) { *p = x; }
+inline simd_float_t fma_float(const simd_float_t& a, const simd_float_t& b, const simd_float_t& c) { return a*b + c; }
+inline simd_float_t rsqrt_float(const simd_float_t& r2) { return 1.f/std::sqrt(r2); }
+#endif
@@ -534,28 +534,23 @@ void Surface<Array>::darea_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 Array Surface<Array>::dnormal_by_dcoeff_vjp(Array& v) {
+    // n = gammadash1 x gammadash2, so v . dn = dgammadash1 . (gammadash2 x v) + dgammadash2 . (v x gammadash1)
     auto dg1 = this->gammadash1();
     auto dg2 = this->gammadash2();
     Array res_dgammadash1 = xt::zeros<double>({numquadpoints_phi, numquadpoints_theta, 3});
     Array res_dgammadash2 = xt::zeros<double>({numquadpoints_phi, numquadpoints_theta, 3});
+#pragma omp parallel for
     for (int i = 0; i < numquadpoints_phi; ++i) {
         for (int j = 0; j < numquadpoints_theta; ++j) {
-            for (int d = 0; d < 3; ++d) {
-                double ed[3] = {0., 0., 0.};
-                ed[d] = 1.0;
-                double temp[3] = {0., 0., 0.};
-                temp[0] = ed[1]*dg2(i, j, 2) - ed[2]*dg2(i, j, 1);
-                temp[1] = ed[2]*dg2(i, j, 0) - ed[0]*dg2(i, j, 2);
-                temp[2] = ed[0]*dg2(i, j, 1) - ed[1]*dg2(i, j, 0);
-                res_dgammadash1(i, j, d) = temp[0] * v(i, j, 0) + temp[1] * v(i, j, 1) + temp[2] * v(i, j, 2);
-                temp[0] = dg1(i, j, 1)*ed[2] - dg1(i, j, 2)*ed[1];
-                temp[1] = dg1(i, j, 2)*ed[0] - dg1(i, j, 0)*ed[2];
-                temp[2] = dg1(i, j, 0)*ed[1] - dg1(i, j, 1)*ed[0];
-                res_dgammadash2(i, j, d) = temp[0] * v(i, j, 0) + temp[1] * v(i, j, 1) + temp[2] * v(i, j, 2);
-            }
+            res_dgammadash1(i, j, 0) = dg2(i, j, 1)*v(i, j, 2) - dg2(i, j, 2)*v(i, j, 1);
+            res_dgammadash1(i, j, 1) = dg2(i, j, 2)*v(i, j, 0) - dg2(i, j, 0)*v(i, j, 2);
+            res_dgammadash1(i, j, 2) = dg2(i, j, 0)*v(i, j, 1) - dg2(i, j, 1)*v(i, j, 0);
+            res_dgammadash2(i, j, 0) = v(i, j, 1)*dg1(i, j, 2) - v(i, j, 2)*dg1(i, j, 1);
+            res_dgammadash2(i, j, 1) = v(i, j, 2)*dg1(i, j, 0) - v(i, j, 0)*dg1(i, j, 2);
+            res_dgammadash2(i, j, 2) = v(i, j, 0)*dg1(i, j, 1) - v(i, j, 1)*dg1(i, j, 0);
         }
     }
-    return dgammadash1_by_dcoeff_vjp(res_dgammadash1) + dgammadash2_by_dcoeff_vjp(res_dgammadash2);
+    return dgammadash1_dgammadash2_by_dcoeff_vjp(res_dgammadash1, res_dgammadash2);
 }
 
 template<class Array>
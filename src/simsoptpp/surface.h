@@ -10,11 +10,315 @@ using std::map;
 #include <stdexcept>
 using std::logic_error;
 
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <cmath>
+
 #include "xtensor/xarray.hpp"
 #include "cachedarray.h"
 #include "curve.h"
 #include <Eigen/Dense>
 
+class SurfaceFourierBasis {
+    /*
+       Tables of
+
+           cos(n nfp phi), sin(n nfp phi) for n = 0, ..., ntor,
+           cos(m theta), sin(m theta)     for m = 0, ..., mpol,
+           cos(phi), sin(phi)
+
+       on a tensor product quadrature grid. Since
+
+           cos(m theta - n nfp phi) = cos(m theta) cos(n nfp phi) + sin(m theta) sin(n nfp phi)
+           sin(m theta - n nfp phi) = sin(m theta) cos(n nfp phi) - cos(m theta) sin(n nfp phi)
+
+       the Fourier surfaces evaluate their series and derivatives from these
+       tables instead of calling sin and cos for every mode and point.
+
+       The tables only depend on the grid and the resolution, so surfaces on the
+       same grid share one instance, obtained via SurfaceFourierBasis::get.
+       */
+
+    public:
+        const vector<double> quadpoints_phi;
+        const vector<double> quadpoints_theta;
+        const int nphi;
+        const int ntheta;
+        const int mpol;
+        const int ntor;
+        const int nfp;
+        vector<double> cosphi, sinphi; // (nphi)
+        vector<double> cosn, sinn;     // (nphi, ntor+1)
+        vector<double> cosm, sinm;     // (mpol+1, ntheta)
+
+        SurfaceFourierBasis(const vector<double>& _quadpoints_phi, const vector<double>& _quadpoints_theta, int _mpol, int _ntor, int _nfp) :
+            quadpoints_phi(_quadpoints_phi), quadpoints_theta(_quadpoints_theta),
+            nphi(_quadpoints_phi.size()), ntheta(_quadpoints_theta.size()), mpol(_mpol), ntor(_ntor), nfp(_nfp),
+            cosphi(nphi), sinphi(nphi), cosn(nphi*(ntor+1)), sinn(nphi*(ntor+1)),
+            cosm((mpol+1)*ntheta), sinm((mpol+1)*ntheta) {
+            for (int k1 = 0; k1 < nphi; ++k1) {
+                double phi = 2*M_PI*quadpoints_phi[k1];
+                cosphi[k1] = std::cos(phi);
+                sinphi[k1] = std::sin(phi);
+                for (int n = 0; n <= ntor; ++n) {
+                    cosn[k1*(ntor+1) + n] = std::cos(n*nfp*phi);
+                    sinn[k1*(ntor+1) + n] = std::sin(n*nfp*phi);
+                }
+            }
+            for (int m = 0; m <= mpol; ++m) {
+                for (int k2 = 0; k2 < ntheta; ++k2) {
+                    double theta = 2*M_PI*quadpoints_theta[k2];
+                    cosm[m*ntheta + k2] = std::cos(m*theta);
+                    sinm[m*ntheta + k2] = std::sin(m*theta);
+                }
+            }
+        }
+
+        template<class Array>
+        bool matches(const Array& _quadpoints_phi, const Array& _quadpoints_theta, int _mpol, int _ntor, int _nfp) const {
+            if(_mpol != mpol || _ntor != ntor || _nfp != nfp)
+                return false;
+            if((int)_quadpoints_phi.size() != nphi || (int)_quadpoints_theta.size() != ntheta)
+                return false;
+            for (int k1 = 0; k1 < nphi; ++k1)
+                if(_quadpoints_phi[k1] != quadpoints_phi[k1])
+                    return false;
+            for (int k2 = 0; k2 < ntheta; ++k2)
+                if(_quadpoints_theta[k2] != quadpoints_theta[k2])
+                    return false;
+            return true;
+        }
+
+        // Returns the tables for the given grid and resolution, reusing the
+        // ones of any other surface that is still alive.
+        static std::shared_ptr<const SurfaceFourierBasis> get(const vector<double>& _quadpoints_phi, const vector<double>& _quadpoints_theta, int _mpol, int _ntor, int _nfp) {
+            typedef std::tuple<int, int, int, vector<double>, vector<double>> Key;
+            static std::mutex mutex;
+            static map<Key, std::weak_ptr<const SurfaceFourierBasis>> registry;
+            Key key(_mpol, _ntor, _nfp, _quadpoints_phi, _quadpoints_theta);
+            std::lock_guard<std::mutex> lock(mutex);
+            auto loc = registry.find(key);
+            if(loc != registry.end()) {
+                auto basis = loc->second.lock();
+                if(basis)
+                    return basis;
+            }
+            for (auto it = registry.begin(); it != registry.end();) {
+                if(it->second.expired())
+                    it = registry.erase(it);
+                else
+                    ++it;
+            }
+            auto basis = std::make_shared<const SurfaceFourierBasis>(_quadpoints_phi, _quadpoints_theta, _mpol, _ntor, _nfp);
+            registry[key] = basis;
+            return basis;
+        }
+
+        // cos(n nfp phi) and sin(n nfp phi) at the k1-th phi point, for -ntor <= n <= ntor.
+        inline void cos_sin_n(int k1, int n, double& c, double& s) const {
+            int an = n < 0 ? -n : n;
+            c = cosn[k1*(ntor+1) + an];
+            s = n < 0 ? -sinn[k1*(ntor+1) + an] : sinn[k1*(ntor+1) + an];
+        }
+
+        // cos(m theta - n nfp phi) and sin(m theta - n nfp phi) at the point
+        // (k1, k2), for 0 <= m <= mpol and -ntor <= n <= ntor, stored at index
+        // m*(2*ntor+1) + n + ntor.
+        void fill(int k1, int k2, double* c, double* s) const {
+            for (int m = 0; m <= mpol; ++m) {
+                double ca = cosm[m*ntheta + k2];
+                double sa = sinm[m*ntheta + k2];
+                for (int i = 0; i < 2*ntor+1; ++i) {
+                    double cb, sb;
+                    cos_sin_n(k1, i - ntor, cb, sb);
+                    c[m*(2*ntor+1) + i] = ca*cb + sa*sb;
+                    s[m*(2*ntor+1) + i] = sa*cb - ca*sb;
+                }
+            }
+        }
+
+        // cos(m theta - n nfp phi) and sin(m theta - n nfp phi) for all modes
+        // at one grid point, set via at(k1, k2).
+        class Modes {
+            public:
+                Modes(const SurfaceFourierBasis& _basis) : basis(_basis),
+                    c((_basis.mpol+1)*(2*_basis.ntor+1)), s((_basis.mpol+1)*(2*_basis.ntor+1)) {}
+                void at(int k1, int k2) {
+                    basis.fill(k1, k2, c.data(), s.data());
+                }
+                inline double cos(int m, int n) const {
+                    return c[m*(2*basis.ntor+1) + n + basis.ntor];
+                }
+                inline double sin(int m, int n) const {
+                    return s[m*(2*basis.ntor+1) + n + basis.ntor];
+                }
+            private:
+                const SurfaceFourierBasis& basis;
+                vector<double> c;
+                vector<double> s;
+        };
+
+        // Number of derivatives up to the given order that synthesize computes.
+        static int num_derivatives(int order) {
+            return (order+1)*(order+2)/2;
+        }
+
+        /*
+         * Evaluates
+         *
+         *     f(phi, theta) = \sum_{m=0}^{mpol} \sum_{n=-ntor}^{ntor} C_{m,n} cos(m theta - n nfp phi) + S_{m,n} sin(m theta - n nfp phi)
+         *
+         * and its derivatives with respect to phi and theta up to the given
+         * order (at most 2) on the grid. C and S are (mpol+1, 2*ntor+1) arrays
+         * in row-major order, either may be null. out has shape
+         * (num_derivatives(order), nphi, ntheta) and contains
+         *
+         *     f, f_phi, f_theta, f_phiphi, f_phitheta, f_thetatheta.
+         *
+         * The sum over n is done once per phi, so the cost is
+         * O(nphi*mpol*ntor + nphi*ntheta*mpol) instead of O(nphi*ntheta*mpol*ntor).
+         */
+        void synthesize(const double* C, const double* S, int order, double* out) const {
+            int size = nphi*ntheta;
+            int nd = num_derivatives(order);
+#pragma omp parallel for
+            for (int k1 = 0; k1 < nphi; ++k1) {
+                // f = \sum_m cos(m theta) P_m(phi) + sin(m theta) Q_m(phi)
+                vector<double> P((order+1)*(mpol+1), 0.);
+                vector<double> Q((order+1)*(mpol+1), 0.);
+                for (int m = 0; m <= mpol; ++m) {
+                    for (int i = 0; i < 2*ntor+1; ++i) {
+                        int n = i - ntor;
+                        double cb, sb;
+                        cos_sin_n(k1, n, cb, sb);
+                        double c = C ? C[m*(2*ntor+1) + i] : 0.;
+                        double s = S ? S[m*(2*ntor+1) + i] : 0.;
+                        double p = c*cb - s*sb;
+                        double q = c*sb + s*cb;
+                        double nn = n*nfp;
+                        P[m] += p;
+                        Q[m] += q;
+                        if(order >= 1) {
+                            P[(mpol+1) + m] -= nn*q;
+                            Q[(mpol+1) + m] += nn*p;
+                        }
+                        if(order >= 2) {
+                            P[2*(mpol+1) + m] -= nn*nn*p;
+                            Q[2*(mpol+1) + m] -= nn*nn*q;
+                        }
+                    }
+                }
+                for (int d = 0; d < nd; ++d)
+                    for (int k2 = 0; k2 < ntheta; ++k2)
+                        out[d*size + k1*ntheta + k2] = 0.;
+                for (int m = 0; m <= mpol; ++m) {
+                    const double* ca = &cosm[m*ntheta];
+                    const double* sa = &sinm[m*ntheta];
+                    double P0 = P[m], Q0 = Q[m];
+                    double* f = &out[k1*ntheta];
+                    for (int k2 = 0; k2 < ntheta; ++k2)
+                        f[k2] += ca[k2]*P0 + sa[k2]*Q0;
+                    if(order >= 1) {
+                        double P1 = P[(mpol+1) + m], Q1 = Q[(mpol+1) + m];
+                        double* f_phi = &out[size + k1*ntheta];
+                        double* f_theta = &out[2*size + k1*ntheta];
+                        for (int k2 = 0; k2 < ntheta; ++k2) {
+                            f_phi[k2] += ca[k2]*P1 + sa[k2]*Q1;
+                            f_theta[k2] += m*(ca[k2]*Q0 - sa[k2]*P0);
+                        }
+                        if(order >= 2) {
+                            double P2 = P[2*(mpol+1) + m], Q2 = Q[2*(mpol+1) + m];
+                            double* f_phiphi = &out[3*size + k1*ntheta];
+                            double* f_phitheta = &out[4*size + k1*ntheta];
+                            double* f_thetatheta = &out[5*size + k1*ntheta];
+                            for (int k2 = 0; k2 < ntheta; ++k2) {
+                                f_phiphi[k2] += ca[k2]*P2 + sa[k2]*Q2;
+                                f_phitheta[k2] += m*(ca[k2]*Q1 - sa[k2]*P1);
+                                f_thetatheta[k2] -= m*m*(ca[k2]*P0 + sa[k2]*Q0);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        /*
+         * Adjoint of synthesize: given weights w of shape
+         * (num_derivatives(order), nphi, ntheta), computes
+         *
+         *     gC_{m,n} = \sum_{d, k1, k2} w_{d,k1,k2} d out_{d,k1,k2} / d C_{m,n}
+         *
+         * and likewise gS. gC and gS are (mpol+1, 2*ntor+1) and are overwritten.
+         */
+        void synthesize_vjp(const double* w, int order, double* gC, double* gS) const {
+            int size = nphi*ntheta;
+            int ncoeff = (mpol+1)*(2*ntor+1);
+            for (int j = 0; j < ncoeff; ++j) {
+                gC[j] = 0.;
+                gS[j] = 0.;
+            }
+#pragma omp parallel
+            {
+                vector<double> gC_private(ncoeff, 0.);
+                vector<double> gS_private(ncoeff, 0.);
+#pragma omp for
+                for (int k1 = 0; k1 < nphi; ++k1) {
+                    for (int m = 0; m <= mpol; ++m) {
+                        const double* ca = &cosm[m*ntheta];
+                        const double* sa = &sinm[m*ntheta];
+                        double dP0 = 0., dQ0 = 0., dP1 = 0., dQ1 = 0., dP2 = 0., dQ2 = 0.;
+                        const double* w0 = &w[k1*ntheta];
+                        for (int k2 = 0; k2 < ntheta; ++k2) {
+                            dP0 += ca[k2]*w0[k2];
+                            dQ0 += sa[k2]*w0[k2];
+                        }
+                        if(order >= 1) {
+                            const double* w_phi = &w[size + k1*ntheta];
+                            const double* w_theta = &w[2*size + k1*ntheta];
+                            for (int k2 = 0; k2 < ntheta; ++k2) {
+                                dP1 += ca[k2]*w_phi[k2];
+                                dQ1 += sa[k2]*w_phi[k2];
+                                dP0 -= m*sa[k2]*w_theta[k2];
+                                dQ0 += m*ca[k2]*w_theta[k2];
+                            }
+                        }
+                        if(order >= 2) {
+                            const double* w_phiphi = &w[3*size + k1*ntheta];
+                            const double* w_phitheta = &w[4*size + k1*ntheta];
+                            const double* w_thetatheta = &w[5*size + k1*ntheta];
+                            for (int k2 = 0; k2 < ntheta; ++k2) {
+                                dP2 += ca[k2]*w_phiphi[k2];
+                                dQ2 += sa[k2]*w_phiphi[k2];
+                                dP1 -= m*sa[k2]*w_phitheta[k2];
+                                dQ1 += m*ca[k2]*w_phitheta[k2];
+                                dP0 -= m*m*ca[k2]*w_thetatheta[k2];
+                                dQ0 -= m*m*sa[k2]*w_thetatheta[k2];
+                            }
+                        }
+                        for (int i = 0; i < 2*ntor+1; ++i) {
+                            int n = i - ntor;
+                            double cb, sb;
+                            cos_sin_n(k1, n, cb, sb);
+                            double nn = n*nfp;
+                            double dp = dP0 + nn*dQ1 - nn*nn*dP2;
+                            double dq = dQ0 - nn*dP1 - nn*nn*dQ2;
+                            gC_private[m*(2*ntor+1) + i] += dp*cb + dq*sb;
+                            gS_private[m*(2*ntor+1) + i] += dq*cb - dp*sb;
+                        }
+                    }
+                }
+#pragma omp critical
+                {
+                    for (int j = 0; j < ncoeff; ++j) {
+                        gC[j] += gC_private[j];
+                        gS[j] += gS_private[j];
+                    }
+                }
+            }
+        }
+};
+
 template<class Array>
 Array surface_vjp_contraction(const Array& mat, const Array& v);
 
@@ -56,6 +360,8 @@ class Surface {
 
         std::unique_ptr<Eigen::FullPivHouseholderQR<Eigen::MatrixXd>> qr; //QR factorisation of dgamma_by_dcoeff, for least squares fitting.
 
+        std::shared_ptr<const SurfaceFourierBasis> fourier_basis_cache;
+
     // We'd really like these to be protected, but I'm not sure that plays well
     // with accessing them from python child classes.
     public://protected:
@@ -80,6 +386,24 @@ class Surface {
             }
         }
 
+        // Trig tables for the given grid, see SurfaceFourierBasis. The tables for
+        // the surface's own grid are kept, and checked against the current
+        // quadrature points and resolution on every call.
+        std::shared_ptr<const SurfaceFourierBasis> fourier_basis(Array& _quadpoints_phi, Array& _quadpoints_theta, int mpol, int ntor, int nfp) {
+            if(fourier_basis_cache && fourier_basis_cache->matches(_quadpoints_phi, _quadpoints_theta, mpol, ntor, nfp))
+                return fourier_basis_cache;
+            vector<double> qphi(_quadpoints_phi.size());
+            for (size_t i = 0; i < qphi.size(); ++i)
+                qphi[i] = _quadpoints_phi[i];
+            vector<double> qtheta(_quadpoints_theta.size());
+            for (size_t i = 0; i < qtheta.size(); ++i)
+                qtheta[i] = _quadpoints_theta[i];
+            auto basis = SurfaceFourierBasis::get(qphi, qtheta, mpol, ntor, nfp);
+            if(&_quadpoints_phi == &quadpoints_phi && &_quadpoints_theta == &quadpoints_theta)
+                fourier_basis_cache = basis;
+            return basis;
+        }
+
         void least_squares_fit(Array& target_values);
         void fit_to_curve(Curve<Array>& curve, double radius, bool flip_theta);
         void scale(double scale);
@@ -129,6 +453,12 @@ class Surface {
             return surface_vjp_contraction<Array>(dgammadash2_by_dcoeff(), v);
         };
 
+        // v1 . dgammadash1_by_dcoeff + v2 . dgammadash2_by_dcoeff, which the
+        // Fourier surfaces compute in a single pass over the dofs.
+        virtual Array dgammadash1_dgammadash2_by_dcoeff_vjp(Array& v1, Array& v2) {
+            return dgammadash1_by_dcoeff_vjp(v1) + dgammadash2_by_dcoeff_vjp(v2);
+        };
+
         void surface_curvatures_impl(Array& data);
         void dsurface_curvatures_by_dcoeff_impl(Array& data);
         void first_fund_form_impl(Array& data);
@@ -1,130 +1,64 @@
 #include "surfacerzfourier.h"
-#include "simdhelpers.h"
 
 // Optimization notes:
-// We use two "tricks" in this part of the code to speed up some of the functions.
-// 1) We use SIMD instructions to parallelise across the angle theta.
-// 2) This parametrization requires the evaluation of
+// This parametrization requires the evaluation of
 //          sin(m*theta-n*nfp*phi) and cos(m*theta-n*nfp*phi)
-//    for many values of n and m. Since trigonometric functions are expensive,
-//    we want to avoid lots of calls to sin and cos. Instead, we use the rules
-//          sin(a + b) = cos(b) sin(a) + cos(a) sin(b)
-//          cos(a + b) = cos(a) cos(b) - sin(a) sin(b)
-//    to write
-//          sin(m*theta-(n+1)*nfp*phi) = cos(-nfp*phi) * sin(m*theta-n*nfp*phi) + cos(m*theta-n*nfp*phi) * sin(-nfp*phi)
-//          cos(m*theta-(n+1)*nfp*phi) = cos(m*theta-n*nfp*phi) * cos(-nfp*phi) + sin(m*theta-n*nfp*phi) * sin(-nfp*phi)
-//    In our code we loop over n. So we start with n=-ntor, and then we always
-//    just increase the angle by -nfp*phi.
+// for many values of n and m. Instead of calling sin and cos, we read them
+// from the tables in SurfaceFourierBasis, which are shared among all surfaces
+// on the same quadrature grid. For r and z and their derivatives the sums over
+// n are carried out once per phi (see SurfaceFourierBasis::synthesize), and
+// the vector Jacobian products use the adjoint of that.
 
-#define ANGLE_RECOMPUTE 5
-
-#if defined(USE_XSIMD)
+template<class Array>
+void SurfaceRZFourier<Array>::synthesize_rz(const SurfaceFourierBasis& basis, int order, vector<double>& r, vector<double>& z) {
+    int size = basis.nphi*basis.ntheta*SurfaceFourierBasis::num_derivatives(order);
+    r.resize(size);
+    z.resize(size);
+    basis.synthesize(rc.data(), stellsym ? nullptr : rs.data(), order, r.data());
+    basis.synthesize(stellsym ? nullptr : zc.data(), zs.data(), order, z.data());
+}
 
 template<class Array>
-void SurfaceRZFourier<Array>::gamma_impl(Array& data, Array& quadpoints_phi, Array& quadpoints_theta) {
-    int numquadpoints_phi = quadpoints_phi.size();
-    int numquadpoints_theta = quadpoints_theta.size();
-    constexpr int simd_size = xsimd::simd_type<double>::size;
-#pragma omp parallel for
-    for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
-        for(int k2 = 0; k2 < numquadpoints_theta; k2 += simd_size) {
-            simd_t theta;
-            for (int l = 0; l < simd_size; ++l) {
-                if(k2 + l >= numquadpoints_theta)
-                    break;
-                theta[l] = 2*M_PI * quadpoints_theta[k2+l];
-            }
-            simd_t r(0.);
-            simd_t z(0.);
-            double sin_nfpphi = sin(-nfp*phi);
-            double cos_nfpphi = cos(-nfp*phi);
-            for (int m = 0; m <= mpol; ++m) {
-                simd_t sinterm, costerm;
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    // recompute the angle from scratch every so often, to
-                    // avoid accumulating floating point error
-                    if(i % ANGLE_RECOMPUTE == 0)
-                        xsimd::sincos(m*theta-n*nfp*phi, sinterm, costerm);
-                    r += rc(m, i) * costerm;
-                    if(!stellsym) {
-                        r += rs(m, i) * sinterm;
-                        z += zc(m, i) * costerm;
-                    }
-                    z += zs(m, i) * sinterm;
-                    if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                        simd_t sinterm_old = sinterm;
-                        simd_t costerm_old = costerm;
-                        sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                        costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                    }
-                }
-            }
-            auto x = r * cos(phi);
-            auto y = r * sin(phi);
-            for (int l = 0; l < simd_size; ++l) {
-                if(k2 + l >= numquadpoints_theta)
-                    break;
-                data(k1, k2+l, 0) = x[l];
-                data(k1, k2+l, 1) = y[l];
-                data(k1, k2+l, 2) = z[l];
-            }
-        }
+Array SurfaceRZFourier<Array>::synthesize_rz_vjp(const SurfaceFourierBasis& basis, int order, vector<double>& w_r, vector<double>& w_z) {
+    int shift = (mpol+1)*(2*ntor+1);
+    vector<double> grc(shift), grs(shift), gzc(shift), gzs(shift);
+    basis.synthesize_vjp(w_r.data(), order, grc.data(), grs.data());
+    basis.synthesize_vjp(w_z.data(), order, gzc.data(), gzs.data());
+    Array res = xt::zeros<double>({num_dofs()});
+    int counter = 0;
+    for (int i = ntor; i < shift; ++i)
+        res[counter++] = grc[i];
+    if(!stellsym) {
+        for (int i = ntor+1; i < shift; ++i)
+            res[counter++] = grs[i];
+        for (int i = ntor; i < shift; ++i)
+            res[counter++] = gzc[i];
     }
+    for (int i = ntor+1; i < shift; ++i)
+        res[counter++] = gzs[i];
+    return res;
 }
 
-#else
-
 template<class Array>
 void SurfaceRZFourier<Array>::gamma_impl(Array& data, Array& quadpoints_phi, Array& quadpoints_theta) {
-    int numquadpoints_phi = quadpoints_phi.size();
-    int numquadpoints_theta = quadpoints_theta.size();
-    constexpr int simd_size = 1;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> r, z;
+    synthesize_rz(*basis, 0, r, z);
+    int numquadpoints_phi = basis->nphi;
+    int numquadpoints_theta = basis->ntheta;
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        auto phi  = 2*M_PI*quadpoints_phi[k1];
-        for(int k2 = 0; k2 < numquadpoints_theta; k2 += simd_size) {
-            auto theta = 2*M_PI * quadpoints_theta[k2];
-            double r(0.);
-            double z(0.);
-            double sin_nfpphi = sin(-nfp*phi);
-            double cos_nfpphi = cos(-nfp*phi);
-            for (int m = 0; m <= mpol; ++m) {
-                double sinterm, costerm;
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    // recompute the angle from scratch every so often, to
-                    // avoid accumulating floating point error
-                    if(i % ANGLE_RECOMPUTE == 0) {
-                        sinterm = sin(m*theta - n*nfp*phi);
-                        costerm = cos(m*theta - n*nfp*phi);
-                    }
-                    r += rc(m, i) * costerm;
-                    if(!stellsym) {
-                        r += rs(m, i) * sinterm;
-                        z += zc(m, i) * costerm;
-                    }
-                    z += zs(m, i) * sinterm;
-                    if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                        auto sinterm_old = sinterm;
-                        auto costerm_old = costerm;
-                        sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                        costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                    }
-                }
-            }
-            auto x = r * cos(phi);
-            auto y = r * sin(phi);
-            data(k1, k2, 0) = x;
-            data(k1, k2, 1) = y;
-            data(k1, k2, 2) = z;
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
+            int j = k1*numquadpoints_theta + k2;
+            data(k1, k2, 0) = r[j] * cosphi;
+            data(k1, k2, 1) = r[j] * sinphi;
+            data(k1, k2, 2) = z[j];
         }
     }
 }
 
-#endif
-
 template<class Array>
 void SurfaceRZFourier<Array>::gamma_lin(Array& data, Array& quadpoints_phi, Array& quadpoints_theta) {
     int numquadpoints = quadpoints_phi.size();
@@ -152,485 +86,174 @@ void SurfaceRZFourier<Array>::gamma_lin(Array& data, Array& quadpoints_phi, Arra
     }
 }
 
-#if defined(USE_XSIMD)
-
 template<class Array>
 void SurfaceRZFourier<Array>::gammadash1_impl(Array& data) {
-    constexpr int simd_size = xsimd::simd_type<double>::size;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> r, z;
+    synthesize_rz(*basis, 1, r, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
-        for(int k2 = 0; k2 < numquadpoints_theta; k2 += simd_size) {
-            simd_t theta;
-            for (int l = 0; l < simd_size; ++l) {
-                if(k2 + l >= numquadpoints_theta)
-                    break;
-                theta[l] = 2*M_PI * quadpoints_theta[k2+l];
-            }
-            simd_t r(0.);
-            simd_t rd(0.);
-            simd_t zd(0.);
-            double sin_nfpphi = sin(-nfp*phi);
-            double cos_nfpphi = cos(-nfp*phi);
-            for (int m = 0; m <= mpol; ++m) {
-                simd_t sinterm, costerm;
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                     // recompute the angle from scratch every so often, to
-                     // avoid accumulating floating point error
-                    if(i % ANGLE_RECOMPUTE == 0)
-                        xsimd::sincos(m*theta-n*nfp*phi, sinterm, costerm);
-                    r  += rc(m, i) * costerm;
-                    rd += rc(m, i) * (n*nfp) * sinterm;
-                    if(!stellsym) {
-                        r  += rs(m, i) * sinterm;
-                        rd += rs(m, i) * (-n*nfp)*costerm;
-                        zd += zc(m, i) * (n*nfp)*sinterm;
-                    }
-                    zd += zs(m, i) * (-n*nfp)*costerm;
-                    if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                        simd_t sinterm_old = sinterm;
-                        simd_t costerm_old = costerm;
-                        sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                        costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                    }
-                }
-            }
-            auto xd = 2*M_PI*(rd * cos(phi) - r * sin(phi));
-            auto yd = 2*M_PI*(rd * sin(phi) + r * cos(phi));
-            zd *= 2*M_PI;
-            for (int l = 0; l < simd_size; ++l) {
-                if(k2 + l >= numquadpoints_theta)
-                    break;
-                data(k1, k2+l, 0) = xd[l];
-                data(k1, k2+l, 1) = yd[l];
-                data(k1, k2+l, 2) = zd[l];
-            }
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
+            int j = k1*numquadpoints_theta + k2;
+            double rd = r[size + j];
+            data(k1, k2, 0) = 2*M_PI*(rd * cosphi - r[j] * sinphi);
+            data(k1, k2, 1) = 2*M_PI*(rd * sinphi + r[j] * cosphi);
+            data(k1, k2, 2) = 2*M_PI*z[size + j];
         }
     }
 }
 
-#else
-
 template<class Array>
-void SurfaceRZFourier<Array>::gammadash1_impl(Array& data) {
-    constexpr int simd_size = 1;
-    #pragma omp parallel for
+void SurfaceRZFourier<Array>::gammadash2_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> r, z;
+    synthesize_rz(*basis, 1, r, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
-        for(int k2 = 0; k2 < numquadpoints_theta; k2 += simd_size) {
-            double theta = 2*M_PI * quadpoints_theta[k2];
-            double r(0.);
-            double rd(0.);
-            double zd(0.);
-            double sin_nfpphi = sin(-nfp*phi);
-            double cos_nfpphi = cos(-nfp*phi);
-            for (int m = 0; m <= mpol; ++m) {
-                double sinterm, costerm;
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                     // recompute the angle from scratch every so often, to
-                     // avoid accumulating floating point error
-                    if(i % ANGLE_RECOMPUTE == 0){
-                        sinterm = sin(m*theta-n*nfp*phi);
-                        costerm = cos(m*theta-n*nfp*phi);
-                    }
-                    r  += rc(m, i) * costerm;
-                    rd += rc(m, i) * (n*nfp) * sinterm;
-                    if(!stellsym) {
-                        r  += rs(m, i) * sinterm;
-                        rd += rs(m, i) * (-n*nfp)*costerm;
-                        zd += zc(m, i) * (n*nfp)*sinterm;
-                    }
-                    zd += zs(m, i) * (-n*nfp)*costerm;
-                    if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                        auto sinterm_old = sinterm;
-                        auto costerm_old = costerm;
-                        sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                        costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                    }
-                }
-            }
-            auto xd = 2*M_PI*(rd * cos(phi) - r * sin(phi));
-            auto yd = 2*M_PI*(rd * sin(phi) + r * cos(phi));
-            zd *= 2*M_PI;
-            data(k1, k2, 0) = xd;
-            data(k1, k2, 1) = yd;
-            data(k1, k2, 2) = zd;
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
+            int j = k1*numquadpoints_theta + k2;
+            double rd = r[2*size + j];
+            data(k1, k2, 0) = 2*M_PI*rd * cosphi;
+            data(k1, k2, 1) = 2*M_PI*rd * sinphi;
+            data(k1, k2, 2) = 2*M_PI*z[2*size + j];
         }
     }
 }
 
-#endif
-
 template<class Array>
 void SurfaceRZFourier<Array>::gammadash1dash1_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> r, z;
+    synthesize_rz(*basis, 2, r, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double r = 0;
-            double rd = 0;
-            double rdd = 0;
-            double zdd = 0;
-            for (int i = 0; i < 2*ntor+1; ++i) {
-                int n  = i - ntor;
-                for (int m = 0; m <= mpol; ++m) {
-                    r  += rc(m, i) * cos(m*theta-n*nfp*phi);
-                    rd += -rc(m, i) * (-n*nfp) * sin(m*theta-n*nfp*phi);
-                    rdd += -rc(m, i) * (-n*nfp) * (-n*nfp) * cos(m*theta-n*nfp*phi);
-                    if(!stellsym) {
-                        r  += rs(m, i) * sin(m*theta-n*nfp*phi);
-                        rd += rs(m, i) * (-n*nfp)*cos(m*theta-n*nfp*phi);
-                        rdd += -rs(m, i) * (-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi);
-                        zdd += -zc(m, i) * (-n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi);
-                    }
-                    zdd += -zs(m, i) * (-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 4*M_PI*M_PI*(rdd * cos(phi) - 2 * rd * sin(phi) - r * cos(phi));
-            data(k1, k2, 1) = 4*M_PI*M_PI*(rdd * sin(phi) + 2 * rd * cos(phi) - r * sin(phi));
-            data(k1, k2, 2) = 4*M_PI*M_PI*zdd;
+            int j = k1*numquadpoints_theta + k2;
+            double rd = r[size + j];
+            double rdd = r[3*size + j];
+            data(k1, k2, 0) = 4*M_PI*M_PI*(rdd * cosphi - 2 * rd * sinphi - r[j] * cosphi);
+            data(k1, k2, 1) = 4*M_PI*M_PI*(rdd * sinphi + 2 * rd * cosphi - r[j] * sinphi);
+            data(k1, k2, 2) = 4*M_PI*M_PI*z[3*size + j];
         }
     }
 }
 
 template<class Array>
 void SurfaceRZFourier<Array>::gammadash1dash2_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> r, z;
+    synthesize_rz(*basis, 2, r, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double rd2 = 0;
-            double rd1d2 = 0;
-            double zd1d2 = 0;
-            for (int i = 0; i < 2*ntor+1; ++i) {
-                int n  = i - ntor;
-                for (int m = 0; m <= mpol; ++m) {
-                    rd2 += -rc(m, i) * (m) * sin(m*theta-n*nfp*phi);
-                    rd1d2 += -rc(m, i) * (-n*nfp) * (m) * cos(m*theta-n*nfp*phi);
-                    if(!stellsym) {
-                        rd2 += rs(m, i) * (m) * cos(m*theta-n*nfp*phi);
-                        rd1d2 += - rs(m, i) * (-n*nfp) * (m) * sin(m*theta-n*nfp*phi);
-                        zd1d2 += -zc(m, i) * (-n*nfp) * m * cos(m*theta-n*nfp*phi);
-                    }
-                    zd1d2 += -zs(m, i) * (-n*nfp) * (m) * sin(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 4*M_PI*M_PI*(rd1d2 * cos(phi) - rd2 * sin(phi));
-            data(k1, k2, 1) = 4*M_PI*M_PI*(rd1d2 * sin(phi) + rd2 * cos(phi));
-            data(k1, k2, 2) = 4*M_PI*M_PI*zd1d2;
+            int j = k1*numquadpoints_theta + k2;
+            double rd2 = r[2*size + j];
+            double rd1d2 = r[4*size + j];
+            data(k1, k2, 0) = 4*M_PI*M_PI*(rd1d2 * cosphi - rd2 * sinphi);
+            data(k1, k2, 1) = 4*M_PI*M_PI*(rd1d2 * sinphi + rd2 * cosphi);
+            data(k1, k2, 2) = 4*M_PI*M_PI*z[4*size + j];
         }
     }
 }
 
 template<class Array>
 void SurfaceRZFourier<Array>::gammadash2dash2_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> r, z;
+    synthesize_rz(*basis, 2, r, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double rd = 0;
-            double zd = 0;
-            double rdd = 0;
-            double zdd = 0;
-            for (int i = 0; i < 2*ntor+1; ++i) {
-                int n  = i - ntor;
-                for (int m = 0; m <= mpol; ++m) {
-                    rd += -rc(m, i) * (m) * sin(m*theta-n*nfp*phi);
-                    rdd += -rc(m, i) * (m) * (m) * cos(m*theta-n*nfp*phi);
-                    if(!stellsym) {
-                        rd +=    rs(m, i) * m * cos(m*theta-n*nfp*phi);
-                        rdd +=  -rs(m, i) * m * m * sin(m*theta-n*nfp*phi);
-                        zd +=  -zc(m, i) * m * sin(m*theta-n*nfp*phi);
-                        zdd += -zc(m, i) * m * m * cos(m*theta-n*nfp*phi);
-                    }
-                    zd += zs(m, i) * m * cos(m*theta-n*nfp*phi);
-                    zdd += -zs(m, i) * m * m * sin(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 4*M_PI*M_PI*rdd*cos(phi);
-            data(k1, k2, 1) = 4*M_PI*M_PI*rdd*sin(phi);
-            data(k1, k2, 2) = 4*M_PI*M_PI*zdd;
+            int j = k1*numquadpoints_theta + k2;
+            double rdd = r[5*size + j];
+            data(k1, k2, 0) = 4*M_PI*M_PI*rdd * cosphi;
+            data(k1, k2, 1) = 4*M_PI*M_PI*rdd * sinphi;
+            data(k1, k2, 2) = 4*M_PI*M_PI*z[5*size + j];
         }
     }
 }
 
-#if defined(USE_XSIMD)
-
 template<class Array>
-void SurfaceRZFourier<Array>::gammadash2_impl(Array& data) {
-    constexpr int simd_size = xsimd::simd_type<double>::size;
+Array SurfaceRZFourier<Array>::gamma_vjp(Array* v, Array* vdash1, Array* vdash2) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    int order = (vdash1 || vdash2) ? 1 : 0;
+    int size = numquadpoints_phi*numquadpoints_theta;
+    vector<double> w_r((2*order+1)*size, 0.), w_z((2*order+1)*size, 0.);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
-        for(int k2 = 0; k2 < numquadpoints_theta; k2 += simd_size) {
-            simd_t theta;
-            for (int l = 0; l < simd_size; ++l) {
-                if(k2 + l >= numquadpoints_theta)
-                    break;
-                theta[l] = 2*M_PI * quadpoints_theta[k2+l];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
+            int j = k1*numquadpoints_theta + k2;
+            if(v) {
+                w_r[j] += (*v)(k1, k2, 0) * cosphi + (*v)(k1, k2, 1) * sinphi;
+                w_z[j] += (*v)(k1, k2, 2);
             }
-            simd_t rd(0.);
-            simd_t zd(0.);
-            double sin_nfpphi = sin(-nfp*phi);
-            double cos_nfpphi = cos(-nfp*phi);
-            for (int m = 0; m <= mpol; ++m) {
-                simd_t sinterm, costerm;
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                     // recompute the angle from scratch every so often, to
-                     // avoid accumulating floating point error
-                    if(i % ANGLE_RECOMPUTE == 0)
-                        xsimd::sincos(m*theta-n*nfp*phi, sinterm, costerm);
-                    rd += rc(m, i) * (-m) * sinterm;
-                    if(!stellsym) {
-                        rd += rs(m, i) * m * costerm;
-                        zd += zc(m, i) * (-m) * sinterm;
-                    }
-                    zd += zs(m, i) * m * costerm;
-                    if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                        simd_t sinterm_old = sinterm;
-                        simd_t costerm_old = costerm;
-                        sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                        costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                    }
-                }
+            if(vdash1) {
+                w_r[j] += 2*M_PI*((*vdash1)(k1, k2, 1) * cosphi - (*vdash1)(k1, k2, 0) * sinphi);
+                w_r[size + j] += 2*M_PI*((*vdash1)(k1, k2, 0) * cosphi + (*vdash1)(k1, k2, 1) * sinphi);
+                w_z[size + j] += 2*M_PI*(*vdash1)(k1, k2, 2);
             }
-            auto xd = 2*M_PI*rd*cos(phi);
-            auto yd = 2*M_PI*rd*sin(phi);
-            zd *= 2*M_PI;
-            for (int l = 0; l < simd_size; ++l) {
-                if(k2 + l >= numquadpoints_theta)
-                    break;
-                data(k1, k2+l, 0) = xd[l];
-                data(k1, k2+l, 1) = yd[l];
-                data(k1, k2+l, 2) = zd[l];
+            if(vdash2) {
+                w_r[2*size + j] += 2*M_PI*((*vdash2)(k1, k2, 0) * cosphi + (*vdash2)(k1, k2, 1) * sinphi);
+                w_z[2*size + j] += 2*M_PI*(*vdash2)(k1, k2, 2);
             }
         }
     }
+    return synthesize_rz_vjp(*basis, order, w_r, w_z);
 }
 
-#else
-
 template<class Array>
-void SurfaceRZFourier<Array>::gammadash2_impl(Array& data) {
-    constexpr int simd_size = 1;
-    #pragma omp parallel for
-    for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
-        for(int k2 = 0; k2 < numquadpoints_theta; k2 += simd_size) {
-            double theta = 2*M_PI * quadpoints_theta[k2];
-            double rd(0.);
-            double zd(0.);
-            double sin_nfpphi = sin(-nfp*phi);
-            double cos_nfpphi = cos(-nfp*phi);
-            for (int m = 0; m <= mpol; ++m) {
-                double sinterm, costerm;
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                     // recompute the angle from scratch every so often, to
-                     // avoid accumulating floating point error
-                    if(i % ANGLE_RECOMPUTE == 0) {
-                        sinterm = sin(m*theta-n*nfp*phi);
-                        costerm = cos(m*theta-n*nfp*phi);
-                    }
-                    rd += rc(m, i) * (-m) * sinterm;
-                    if(!stellsym) {
-                        rd += rs(m, i) * m * costerm;
-                        zd += zc(m, i) * (-m) * sinterm;
-                    }
-                    zd += zs(m, i) * m * costerm;
-                    if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                        auto sinterm_old = sinterm;
-                        auto costerm_old = costerm;
-                        sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                        costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                    }
-                }
-            }
-            auto xd = 2*M_PI*rd*cos(phi);
-            auto yd = 2*M_PI*rd*sin(phi);
-            zd *= 2*M_PI;
-            data(k1, k2, 0) = xd;
-            data(k1, k2, 1) = yd;
-            data(k1, k2, 2) = zd;
-        }
-    }
+Array SurfaceRZFourier<Array>::dgamma_by_dcoeff_vjp(Array& v) {
+    return gamma_vjp(&v, nullptr, nullptr);
 }
 
-#endif
-
-#if defined(USE_XSIMD)
 template<class Array>
-Array SurfaceRZFourier<Array>::dgamma_by_dcoeff_vjp(Array& v) {
-    Array res = xt::zeros<double>({num_dofs()});
-    constexpr int simd_size = xsimd::simd_type<double>::size;
-    auto resptr = &(res(0));
-#pragma omp parallel
-    {
-        double* resptr_private = new double[num_dofs()];
-        for (int i = 0; i < num_dofs(); ++i) {
-            resptr_private[i] = 0.;
-        }
-#pragma omp for
-        for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-            double phi  = 2*M_PI*quadpoints_phi[k1];
-            double sinphi = sin(phi);
-            double cosphi = cos(phi);
-
-            for(int i = 0; i < numquadpoints_theta; i += simd_size) {
-                simd_t theta(0.);
-                simd_t v0(0.);
-                simd_t v1(0.);
-                simd_t v2(0.);
-                for (int l = 0; l < simd_size; ++l) {
-                    if(i + l >= numquadpoints_theta)
-                        break;
-                    v0[l] = v(k1, i+l, 0);
-                    v1[l] = v(k1, i+l, 1);
-                    v2[l] = v(k1, i+l, 2);
-                    theta[l] = 2*M_PI * quadpoints_theta[i+l];
-                }
-                int counter = 0;
-                int shift0 = -ntor;
-                int shift1 = !stellsym ? shift0 + (mpol+1) * (2*ntor+1) - ntor - 1 : shift0;
-                int shift2 = !stellsym ? shift1 + (mpol+1) * (2*ntor+1) - ntor : shift1;
-                int shift3 = shift2 + (mpol+1)*(2*ntor+1) - ntor - 1;
-                double sin_nfpphi = sin(-nfp*phi);
-                double cos_nfpphi = cos(-nfp*phi);
-                for (int m = 0; m <= mpol; ++m) {
-                    simd_t sinterm, costerm;
-                    for (int n = -ntor; n <= ntor; ++n) {
-                        int i = n + ntor;
-                         // recompute the angle from scratch every so often, to
-                         // avoid accumulating floating point error
-                        if(i % ANGLE_RECOMPUTE == 0)
-                            xsimd::sincos(m*theta-n*nfp*phi, sinterm, costerm);
-                        if(!(m==0 && n<0)){
-                            resptr_private[counter+shift0] += cosphi * xsimd::hadd(costerm * v0);
-                            resptr_private[counter+shift0] += sinphi * xsimd::hadd(costerm * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<=0)){
-                            resptr_private[counter+shift1] += cosphi * xsimd::hadd(sinterm * v0);
-                            resptr_private[counter+shift1] += sinphi * xsimd::hadd(sinterm * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<0)){
-                            resptr_private[counter+shift2] += xsimd::hadd(costerm * v2);
-                        }
-                        if(!(m==0 && n<=0)){
-                            resptr_private[counter+shift3] += xsimd::hadd(sinterm * v2);
-                        }
-                        counter++;
-                        if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                            simd_t sinterm_old = sinterm;
-                            simd_t costerm_old = costerm;
-                            sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                            costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                        }
-                    }
-                }
-            }
-        }
-#pragma omp critical
-        {
-            for(int i=0; i<num_dofs(); ++i) {
-                resptr[i] += resptr_private[i];
-            }
-        }
-    }
-    return res;
+Array SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_vjp(Array& v) {
+    return gamma_vjp(nullptr, &v, nullptr);
 }
 
-#else
 template<class Array>
-Array SurfaceRZFourier<Array>::dgamma_by_dcoeff_vjp(Array& v) {
-    Array res = xt::zeros<double>({num_dofs()});
-    constexpr int simd_size = 1;
-    auto resptr = &(res(0));
-    #pragma omp parallel
-    {
-        double* resptr_private = new double[num_dofs()];
-        for (int i = 0; i < num_dofs(); ++i) {
-            resptr_private[i] = 0.;
-        }
-#pragma omp for
-        for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-            double phi  = 2*M_PI*quadpoints_phi[k1];
-            double sinphi = sin(phi);
-            double cosphi = cos(phi);
-
-            for(int i = 0; i < numquadpoints_theta; i += simd_size) {
-                double theta = 2*M_PI * quadpoints_theta[i];
-                double v0 = v(k1, i, 0);
-                double v1 = v(k1, i, 1);
-                double v2 = v(k1, i, 2);
-                int counter = 0;
-                int shift0 = -ntor;
-                int shift1 = !stellsym ? shift0 + (mpol+1) * (2*ntor+1) - ntor - 1 : shift0;
-                int shift2 = !stellsym ? shift1 + (mpol+1) * (2*ntor+1) - ntor : shift1;
-                int shift3 = shift2 + (mpol+1)*(2*ntor+1) - ntor - 1;
-                double sin_nfpphi = sin(-nfp*phi);
-                double cos_nfpphi = cos(-nfp*phi);
-                for (int m = 0; m <= mpol; ++m) {
-                    double sinterm, costerm;
-                    for (int n = -ntor; n <= ntor; ++n) {
-                        int i = n + ntor;
-                         // recompute the angle from scratch every so often, to
-                         // avoid accumulating floating point error
-                        if(i % ANGLE_RECOMPUTE == 0)
-                            sinterm = sin(m*theta-n*nfp*phi);
-                            costerm = cos(m*theta-n*nfp*phi);
-                        if(!(m==0 && n<0)){
-                            resptr_private[counter+shift0] += cosphi * costerm * v0;
-                            resptr_private[counter+shift0] += sinphi * costerm * v1;
-                        }
-                        if(!(stellsym) && !(m==0 && n<=0)){
-                            resptr_private[counter+shift1] += cosphi * sinterm * v0;
-                            resptr_private[counter+shift1] += sinphi * sinterm * v1;
-                        }
-                        if(!(stellsym) && !(m==0 && n<0)){
-                            resptr_private[counter+shift2] += costerm * v2;
-                        }
-                        if(!(m==0 && n<=0)){
-                            resptr_private[counter+shift3] += sinterm * v2;
-                        }
-                        counter++;
-                        if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                            auto sinterm_old = sinterm;
-                            auto costerm_old = costerm;
-                            sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                            costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                        }
-                    }
-                }
-            }
-        }
-#pragma omp critical
-        {
-            for(int i=0; i<num_dofs(); ++i) {
-                resptr[i] += resptr_private[i];
-            }
-        }
-    }
-    return res;
+Array SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_vjp(Array& v) {
+    return gamma_vjp(nullptr, nullptr, &v);
 }
 
-#endif
+template<class Array>
+Array SurfaceRZFourier<Array>::dgammadash1_dgammadash2_by_dcoeff_vjp(Array& v1, Array& v2) {
+    return gamma_vjp(nullptr, &v1, &v2);
+}
 
 template<class Array>
 void SurfaceRZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int m = 0; m <= mpol; ++m) {
                 for (int n = -ntor; n <= ntor; ++n) {
                     if(m==0 && n<0) continue;
-                    data(k1, k2, 0, counter) = cos(m*theta-n*nfp*phi) * cos(phi);
-                    data(k1, k2, 1, counter) = cos(m*theta-n*nfp*phi) * sin(phi);
+                    data(k1, k2, 0, counter) = modes.cos(m, n) * cosphi;
+                    data(k1, k2, 1, counter) = modes.cos(m, n) * sinphi;
                     data(k1, k2, 2, counter) = 0;
                     counter++;
                 }
@@ -639,8 +262,8 @@ void SurfaceRZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<=0) continue;
-                        data(k1, k2, 0, counter) = sin(m*theta-n*nfp*phi) * cos(phi);
-                        data(k1, k2, 1, counter) = sin(m*theta-n*nfp*phi) * sin(phi);
+                        data(k1, k2, 0, counter) = modes.sin(m, n) * cosphi;
+                        data(k1, k2, 1, counter) = modes.sin(m, n) * sinphi;
                         data(k1, k2, 2, counter) = 0;
                         counter++;
                     }
@@ -650,7 +273,7 @@ void SurfaceRZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
                         if(m==0 && n<0) continue;
                         data(k1, k2, 0, counter) = 0;
                         data(k1, k2, 1, counter) = 0;
-                        data(k1, k2, 2, counter) = cos(m*theta-n*nfp*phi);
+                        data(k1, k2, 2, counter) = modes.cos(m, n);
                         counter++;
                     }
                 }
@@ -660,7 +283,7 @@ void SurfaceRZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
                     if(m==0 && n<=0) continue;
                     data(k1, k2, 0, counter) = 0;
                     data(k1, k2, 1, counter) = 0;
-                    data(k1, k2, 2, counter) = sin(m*theta-n*nfp*phi);
+                    data(k1, k2, 2, counter) = modes.sin(m, n);
                     counter++;
                 }
             }
@@ -668,183 +291,22 @@ void SurfaceRZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
     }
 }
 
-#if defined(USE_XSIMD)
-
-template<class Array>
-Array SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_vjp(Array& v) {
-    Array res = xt::zeros<double>({num_dofs()});
-    constexpr int simd_size = xsimd::simd_type<double>::size;
-    auto resptr = &(res(0));
-#pragma omp parallel
-    {
-        double* resptr_private = new double[num_dofs()];
-        for (int i = 0; i < num_dofs(); ++i) {
-            resptr_private[i] = 0.;
-        }
-#pragma omp for
-        for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-            double phi  = 2*M_PI*quadpoints_phi[k1];
-            double sinphi = sin(phi);
-            double cosphi = cos(phi);
-
-            for(int i = 0; i < numquadpoints_theta; i += simd_size) {
-                simd_t theta(0.);
-                simd_t v0(0.);
-                simd_t v1(0.);
-                simd_t v2(0.);
-                for (int l = 0; l < simd_size; ++l) {
-                    if(i + l >= numquadpoints_theta)
-                        break;
-                    v0[l] = v(k1, i+l, 0);
-                    v1[l] = v(k1, i+l, 1);
-                    v2[l] = v(k1, i+l, 2);
-                    theta[l] = 2*M_PI * quadpoints_theta[i+l];
-                }
-                int counter = 0;
-                int shift0 = -ntor;
-                int shift1 = !stellsym ? shift0 + (mpol+1) * (2*ntor+1) - ntor - 1 : shift0;
-                int shift2 = !stellsym ? shift1 + (mpol+1) * (2*ntor+1) - ntor : shift1;
-                int shift3 = shift2 + (mpol+1)*(2*ntor+1) - ntor - 1;
-
-                double sin_nfpphi = sin(-nfp*phi);
-                double cos_nfpphi = cos(-nfp*phi);
-                for (int m = 0; m <= mpol; ++m) {
-                    simd_t sinterm, costerm;
-                    for (int n = -ntor; n <= ntor; ++n) {
-                        int i = n + ntor;
-                        // recompute the angle from scratch every so often, to
-                        // avoid accumulating floating point error
-                        if(i % ANGLE_RECOMPUTE == 0)
-                            xsimd::sincos(m*theta-n*nfp*phi, sinterm, costerm);
-                        if(!(m==0 && n<0)){
-                            resptr_private[counter+shift0] += xsimd::hadd((sinterm * ((n*nfp) * cosphi) - costerm * sinphi) * v0);
-                            resptr_private[counter+shift0] += xsimd::hadd((sinterm * ((n*nfp) * sinphi) + costerm * cosphi) * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<=0)){
-                            resptr_private[counter+shift1] += xsimd::hadd((costerm * ((-n*nfp)*cosphi) - sinterm * sinphi) * v0);
-                            resptr_private[counter+shift1] += xsimd::hadd((costerm * ((-n*nfp)*sinphi) + sinterm * cosphi) * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<0)){
-                            resptr_private[counter+shift2] += xsimd::hadd((n*nfp)*sinterm * v2);
-                        }
-                        if(!(m==0 && n<=0)){
-                            resptr_private[counter+shift3] += xsimd::hadd((-n*nfp)*costerm * v2);
-                        }
-                        counter++;
-                        if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                            simd_t sinterm_old = sinterm;
-                            simd_t costerm_old = costerm;
-                            sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                            costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                        }
-                    }
-                }
-            }
-        }
-#pragma omp critical
-        {
-            for(int i=0; i<num_dofs(); ++i) {
-                resptr[i] += resptr_private[i];
-            }
-        }
-    }
-    res *= 2*M_PI;
-    return res;
-}
-
-#else
-
-template<class Array>
-Array SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_vjp(Array& v) {
-    Array res = xt::zeros<double>({num_dofs()});
-    constexpr int simd_size = 1;
-    auto resptr = &(res(0));
-    #pragma omp parallel
-    {
-        double* resptr_private = new double[num_dofs()];
-        for (int i = 0; i < num_dofs(); ++i) {
-            resptr_private[i] = 0.;
-        }
-        #pragma omp for
-        for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-            double phi  = 2*M_PI*quadpoints_phi[k1];
-            double sinphi = sin(phi);
-            double cosphi = cos(phi);
-
-            for(int i = 0; i < numquadpoints_theta; i += simd_size) {
-                double theta = 2*M_PI * quadpoints_theta[i];
-                double v0 = v(k1, i, 0);
-                double v1 = v(k1, i, 1);
-                double v2 = v(k1, i, 2);
-
-                int counter = 0;
-                int shift0 = -ntor;
-                int shift1 = !stellsym ? shift0 + (mpol+1) * (2*ntor+1) - ntor - 1 : shift0;
-                int shift2 = !stellsym ? shift1 + (mpol+1) * (2*ntor+1) - ntor : shift1;
-                int shift3 = shift2 + (mpol+1)*(2*ntor+1) - ntor - 1;
-
-                double sin_nfpphi = sin(-nfp*phi);
-                double cos_nfpphi = cos(-nfp*phi);
-                for (int m = 0; m <= mpol; ++m) {
-                    double sinterm, costerm;
-                    for (int n = -ntor; n <= ntor; ++n) {
-                        int i = n + ntor;
-                        // recompute the angle from scratch every so often, to
-                        // avoid accumulating floating point error
-                        if(i % ANGLE_RECOMPUTE == 0)
-                            sinterm = sin(m*theta-n*nfp*phi);
-                            costerm = cos(m*theta-n*nfp*phi);
-                        if(!(m==0 && n<0)){
-                            resptr_private[counter+shift0] += ((sinterm * ((n*nfp) * cosphi) - costerm * sinphi) * v0);
-                            resptr_private[counter+shift0] += ((sinterm * ((n*nfp) * sinphi) + costerm * cosphi) * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<=0)){
-                            resptr_private[counter+shift1] += ((costerm * ((-n*nfp)*cosphi) - sinterm * sinphi) * v0);
-                            resptr_private[counter+shift1] += ((costerm * ((-n*nfp)*sinphi) + sinterm * cosphi) * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<0)){
-                            resptr_private[counter+shift2] += ((n*nfp)*sinterm * v2);
-                        }
-                        if(!(m==0 && n<=0)){
-                            resptr_private[counter+shift3] += ((-n*nfp)*costerm * v2);
-                        }
-                        counter++;
-                        if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                            auto sinterm_old = sinterm;
-                            auto costerm_old = costerm;
-                            sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                            costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                        }
-                    }
-                }
-            }
-        }
-#pragma omp critical
-        {
-            for(int i=0; i<num_dofs(); ++i) {
-                resptr[i] += resptr_private[i];
-            }
-        }
-    }
-    res *= 2*M_PI;
-    return res;
-}
-
-#endif
-
 template<class Array>
 void SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int m = 0; m <= mpol; ++m) {
                 for (int n = -ntor; n <= ntor; ++n) {
                     if(m==0 && n<0) continue;
-                    data(k1, k2, 0, counter) = 2*M_PI*((n*nfp) * sin(m*theta-n*nfp*phi) * cos(phi) - cos(m*theta-n*nfp*phi) * sin(phi));
-                    data(k1, k2, 1, counter) = 2*M_PI*((n*nfp) * sin(m*theta-n*nfp*phi) * sin(phi) + cos(m*theta-n*nfp*phi) * cos(phi));
+                    data(k1, k2, 0, counter) = 2*M_PI*((n*nfp) * modes.sin(m, n) * cosphi - modes.cos(m, n) * sinphi);
+                    data(k1, k2, 1, counter) = 2*M_PI*((n*nfp) * modes.sin(m, n) * sinphi + modes.cos(m, n) * cosphi);
                     data(k1, k2, 2, counter) = 0;
                     counter++;
                 }
@@ -853,8 +315,8 @@ void SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<=0) continue;
-                        data(k1, k2, 0, counter) = 2*M_PI*((-n*nfp)*cos(m*theta-n*nfp*phi) * cos(phi) - sin(m*theta-n*nfp*phi) * sin(phi));
-                        data(k1, k2, 1, counter) = 2*M_PI*((-n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi) + sin(m*theta-n*nfp*phi) * cos(phi));
+                        data(k1, k2, 0, counter) = 2*M_PI*((-n*nfp)*modes.cos(m, n) * cosphi - modes.sin(m, n) * sinphi);
+                        data(k1, k2, 1, counter) = 2*M_PI*((-n*nfp)*modes.cos(m, n) * sinphi + modes.sin(m, n) * cosphi);
                         data(k1, k2, 2, counter) = 0;
                         counter++;
                     }
@@ -864,7 +326,7 @@ void SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
                         if(m==0 && n<0) continue;
                         data(k1, k2, 0, counter) = 0;
                         data(k1, k2, 1, counter) = 0;
-                        data(k1, k2, 2, counter) = 2*M_PI*(n*nfp)*sin(m*theta-n*nfp*phi);
+                        data(k1, k2, 2, counter) = 2*M_PI*(n*nfp)*modes.sin(m, n);
                         counter++;
                     }
                 }
@@ -874,7 +336,7 @@ void SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
                     if(m==0 && n<=0) continue;
                     data(k1, k2, 0, counter) = 0;
                     data(k1, k2, 1, counter) = 0;
-                    data(k1, k2, 2, counter) = 2*M_PI*(-n*nfp)*cos(m*theta-n*nfp*phi);
+                    data(k1, k2, 2, counter) = 2*M_PI*(-n*nfp)*modes.cos(m, n);
                     counter++;
                 }
             }
@@ -884,18 +346,21 @@ void SurfaceRZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceRZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int m = 0; m <= mpol; ++m) {
                 for (int n = -ntor; n <= ntor; ++n) {
                     if(m==0 && n<0) continue;
-                    data(k1, k2, 0, counter) = 4*M_PI*M_PI*(m * (n*nfp) * cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                            + m * sin(m*theta-n*nfp*phi) * sin(phi));
-                    data(k1, k2, 1, counter) = 4*M_PI*M_PI*(   m * (n*nfp) * cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                             - m * sin(m*theta-n*nfp*phi) * cos(phi));
+                    data(k1, k2, 0, counter) = 4*M_PI*M_PI*(m * (n*nfp) * modes.cos(m, n) * cosphi \
+                                                            + m * modes.sin(m, n) * sinphi);
+                    data(k1, k2, 1, counter) = 4*M_PI*M_PI*(   m * (n*nfp) * modes.cos(m, n) * sinphi \
+                                                             - m * modes.sin(m, n) * cosphi);
                     data(k1, k2, 2, counter) = 0;
                     counter++;
                 }
@@ -904,10 +369,10 @@ void SurfaceRZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<=0) continue;
-                        data(k1, k2, 0, counter) = 4*M_PI*M_PI*(-(-n*nfp)*m*sin(m*theta-n*nfp*phi)*cos(phi) \
-                                                                - m*cos(m*theta-n*nfp*phi)*sin(phi));
-                        data(k1, k2, 1, counter) = 4*M_PI*M_PI*(-(-n*nfp)*m*sin(m*theta-n*nfp*phi)*sin(phi) \
-                                                                + m*cos(m*theta-n*nfp*phi)*cos(phi));
+                        data(k1, k2, 0, counter) = 4*M_PI*M_PI*(-(-n*nfp)*m*modes.sin(m, n)*cosphi \
+                                                                - m*modes.cos(m, n)*sinphi);
+                        data(k1, k2, 1, counter) = 4*M_PI*M_PI*(-(-n*nfp)*m*modes.sin(m, n)*sinphi \
+                                                                + m*modes.cos(m, n)*cosphi);
                         data(k1, k2, 2, counter) = 0;
                         counter++;
                     }
@@ -917,7 +382,7 @@ void SurfaceRZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
                         if(m==0 && n<0) continue;
                         data(k1, k2, 0, counter) = 0;
                         data(k1, k2, 1, counter) = 0;
-                        data(k1, k2, 2, counter) = 4*M_PI*M_PI*n*nfp*m*cos(m*theta-n*nfp*phi);
+                        data(k1, k2, 2, counter) = 4*M_PI*M_PI*n*nfp*m*modes.cos(m, n);
                         counter++;
                     }
                 }
@@ -927,7 +392,7 @@ void SurfaceRZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
                     if(m==0 && n<=0) continue;
                     data(k1, k2, 0, counter) = 0;
                     data(k1, k2, 1, counter) = 0;
-                    data(k1, k2, 2, counter) = -4*M_PI*M_PI*(-n*nfp)*m*sin(m*theta-n*nfp*phi);
+                    data(k1, k2, 2, counter) = -4*M_PI*M_PI*(-n*nfp)*m*modes.sin(m, n);
                     counter++;
                 }
             }
@@ -937,20 +402,23 @@ void SurfaceRZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceRZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int m = 0; m <= mpol; ++m) {
                 for (int n = -ntor; n <= ntor; ++n) {
                     if(m==0 && n<0) continue;
-                    data(k1, k2, 0, counter) = 4*M_PI*M_PI*(- (-n*nfp) * (-n*nfp) * cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                            + 2 * (-n*nfp) * sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                            - cos(m*theta-n*nfp*phi) * cos(phi));
-                    data(k1, k2, 1, counter) = 4*M_PI*M_PI*(- (-n*nfp) * (-n*nfp) * cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                            - 2 * (-n*nfp) * sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                            - cos(m*theta-n*nfp*phi) * sin(phi));
+                    data(k1, k2, 0, counter) = 4*M_PI*M_PI*(- (-n*nfp) * (-n*nfp) * modes.cos(m, n) * cosphi \
+                                                            + 2 * (-n*nfp) * modes.sin(m, n) * sinphi \
+                                                            - modes.cos(m, n) * cosphi);
+                    data(k1, k2, 1, counter) = 4*M_PI*M_PI*(- (-n*nfp) * (-n*nfp) * modes.cos(m, n) * sinphi \
+                                                            - 2 * (-n*nfp) * modes.sin(m, n) * cosphi \
+                                                            - modes.cos(m, n) * sinphi);
                     data(k1, k2, 2, counter) = 0;
                     counter++;
                 }
@@ -959,12 +427,12 @@ void SurfaceRZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<=0) continue;
-                        data(k1, k2, 0, counter) = 4*M_PI*M_PI*(-(-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                                - 2*(-n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                                - sin(m*theta-n*nfp*phi) * cos(phi));
-                        data(k1, k2, 1, counter) = 4*M_PI*M_PI*(-(-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                                + 2*(-n*nfp)*cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                                - sin(m*theta-n*nfp*phi) * sin(phi));
+                        data(k1, k2, 0, counter) = 4*M_PI*M_PI*(-(-n*nfp)*(-n*nfp)*modes.sin(m, n) * cosphi \
+                                                                - 2*(-n*nfp)*modes.cos(m, n) * sinphi \
+                                                                - modes.sin(m, n) * cosphi);
+                        data(k1, k2, 1, counter) = 4*M_PI*M_PI*(-(-n*nfp)*(-n*nfp)*modes.sin(m, n) * sinphi \
+                                                                + 2*(-n*nfp)*modes.cos(m, n) * cosphi \
+                                                                - modes.sin(m, n) * sinphi);
                         data(k1, k2, 2, counter) = 0;
                         counter++;
                     }
@@ -974,7 +442,7 @@ void SurfaceRZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
                         if(m==0 && n<0) continue;
                         data(k1, k2, 0, counter) = 0;
                         data(k1, k2, 1, counter) = 0;
-                        data(k1, k2, 2, counter) = -4*M_PI*M_PI*(-n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi);
+                        data(k1, k2, 2, counter) = -4*M_PI*M_PI*(-n*nfp)*(-n*nfp)*modes.cos(m, n);
                         counter++;
                     }
                 }
@@ -984,7 +452,7 @@ void SurfaceRZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
                     if(m==0 && n<=0) continue;
                     data(k1, k2, 0, counter) = 0;
                     data(k1, k2, 1, counter) = 0;
-                    data(k1, k2, 2, counter) = -4*M_PI*M_PI*(-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi);
+                    data(k1, k2, 2, counter) = -4*M_PI*M_PI*(-n*nfp)*(-n*nfp)*modes.sin(m, n);
                     counter++;
                 }
             }
@@ -992,183 +460,22 @@ void SurfaceRZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
     }
 }
 
-#if defined(USE_XSIMD)
-
-template<class Array>
-Array SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_vjp(Array& v) {
-    Array res = xt::zeros<double>({num_dofs()});
-    constexpr int simd_size = xsimd::simd_type<double>::size;
-    auto resptr = &(res(0));
-#pragma omp parallel
-    {
-        double* resptr_private = new double[num_dofs()];
-        for (int i = 0; i < num_dofs(); ++i) {
-            resptr_private[i] = 0.;
-        }
-#pragma omp for
-        for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-            double phi  = 2*M_PI*quadpoints_phi[k1];
-            double sinphi = sin(phi);
-            double cosphi = cos(phi);
-
-            for(int i = 0; i < numquadpoints_theta; i += simd_size) {
-                simd_t theta(0.);
-                simd_t v0(0.);
-                simd_t v1(0.);
-                simd_t v2(0.);
-                for (int l = 0; l < simd_size; ++l) {
-                    if(i + l >= numquadpoints_theta)
-                        break;
-                    v0[l] = v(k1, i+l, 0);
-                    v1[l] = v(k1, i+l, 1);
-                    v2[l] = v(k1, i+l, 2);
-                    theta[l] = 2*M_PI * quadpoints_theta[i+l];
-                }
-                int counter = 0;
-                int shift0 = -ntor;
-                int shift1 = !stellsym ? shift0 + (mpol+1) * (2*ntor+1) - ntor - 1 : shift0;
-                int shift2 = !stellsym ? shift1 + (mpol+1) * (2*ntor+1) - ntor : shift1;
-                int shift3 = shift2 + (mpol+1)*(2*ntor+1) - ntor - 1;
-
-                double sin_nfpphi = sin(-nfp*phi);
-                double cos_nfpphi = cos(-nfp*phi);
-                for (int m = 0; m <= mpol; ++m) {
-                    simd_t sinterm, costerm;
-                    for (int n = -ntor; n <= ntor; ++n) {
-                        int i = n + ntor;
-                        // recompute the angle from scratch every so often, to
-                        // avoid accumulating floating point error
-                        if(i % ANGLE_RECOMPUTE == 0)
-                            xsimd::sincos(m*theta-n*nfp*phi, sinterm, costerm);
-                        if(!(m==0 && n<0)){
-                            resptr_private[counter+shift0] -= (cosphi * m) * xsimd::hadd(sinterm * v0);
-                            resptr_private[counter+shift0] -= (sinphi * m) * xsimd::hadd(sinterm * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<=0)){
-                            resptr_private[counter+shift1] += (cosphi * m) * xsimd::hadd(costerm * v0);
-                            resptr_private[counter+shift1] += (sinphi * m) * xsimd::hadd(costerm * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<0)){
-                            resptr_private[counter+shift2] -= m * xsimd::hadd(sinterm * v2);
-                        }
-                        if(!(m==0 && n<=0)){
-                            resptr_private[counter+shift3] += m * xsimd::hadd(costerm * v2);
-                        }
-                        counter++;
-                        if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                            simd_t sinterm_old = sinterm;
-                            simd_t costerm_old = costerm;
-                            sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                            costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                        }
-                    }
-                }
-            }
-        }
-#pragma omp critical
-        {
-            for(int i=0; i<num_dofs(); ++i) {
-                resptr[i] += resptr_private[i];
-            }
-        }
-    }
-    res *= 2*M_PI;
-    return res;
-}
-
-#else
-
-template<class Array>
-Array SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_vjp(Array& v) {
-    Array res = xt::zeros<double>({num_dofs()});
-    constexpr int simd_size = 1;
-    auto resptr = &(res(0));
-    #pragma omp parallel
-    {
-        double* resptr_private = new double[num_dofs()];
-        for (int i = 0; i < num_dofs(); ++i) {
-            resptr_private[i] = 0.;
-        }
-        #pragma omp for
-        for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-            double phi  = 2*M_PI*quadpoints_phi[k1];
-            double sinphi = sin(phi);
-            double cosphi = cos(phi);
-
-            for(int i = 0; i < numquadpoints_theta; i += simd_size) {
-                double theta = 2*M_PI * quadpoints_theta[i];
-                double v0 = v(k1, i, 0);
-                double v1 = v(k1, i, 1);
-                double v2 = v(k1, i, 2);
-
-                int counter = 0;
-                int shift0 = -ntor;
-                int shift1 = !stellsym ? shift0 + (mpol+1) * (2*ntor+1) - ntor - 1 : shift0;
-                int shift2 = !stellsym ? shift1 + (mpol+1) * (2*ntor+1) - ntor : shift1;
-                int shift3 = shift2 + (mpol+1)*(2*ntor+1) - ntor - 1;
-
-                double sin_nfpphi = sin(-nfp*phi);
-                double cos_nfpphi = cos(-nfp*phi);
-                for (int m = 0; m <= mpol; ++m) {
-                    double sinterm, costerm;
-                    for (int n = -ntor; n <= ntor; ++n) {
-                        int i = n + ntor;
-                        // recompute the angle from scratch every so often, to
-                        // avoid accumulating floating point error
-                        if(i % ANGLE_RECOMPUTE == 0)
-                            sinterm = sin(m*theta-n*nfp*phi);
-                            costerm = cos(m*theta-n*nfp*phi);
-                        if(!(m==0 && n<0)){
-                            resptr_private[counter+shift0] -= (cosphi * m) * (sinterm * v0);
-                            resptr_private[counter+shift0] -= (sinphi * m) * (sinterm * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<=0)){
-                            resptr_private[counter+shift1] += (cosphi * m) * (costerm * v0);
-                            resptr_private[counter+shift1] += (sinphi * m) * (costerm * v1);
-                        }
-                        if(!(stellsym) && !(m==0 && n<0)){
-                            resptr_private[counter+shift2] -= m * (sinterm * v2);
-                        }
-                        if(!(m==0 && n<=0)){
-                            resptr_private[counter+shift3] += m * (costerm * v2);
-                        }
-                        counter++;
-                        if(i % ANGLE_RECOMPUTE != ANGLE_RECOMPUTE - 1){
-                            auto sinterm_old = sinterm;
-                            auto costerm_old = costerm;
-                            sinterm = cos_nfpphi * sinterm_old + costerm_old * sin_nfpphi;
-                            costerm = costerm_old * cos_nfpphi - sinterm_old * sin_nfpphi;
-                        }
-                    }
-                }
-            }
-        }
-        #pragma omp critical
-        {
-            for(int i=0; i<num_dofs(); ++i) {
-                resptr[i] += resptr_private[i];
-            }
-        }
-    }
-    res *= 2*M_PI;
-    return res;
-}
-
-#endif
-
 template<class Array>
 void SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int m = 0; m <= mpol; ++m) {
                 for (int n = -ntor; n <= ntor; ++n) {
                     if(m==0 && n<0) continue;
-                    data(k1, k2, 0, counter) = 2*M_PI*(-m) * sin(m*theta-n*nfp*phi)*cos(phi);
-                    data(k1, k2, 1, counter) = 2*M_PI*(-m) * sin(m*theta-n*nfp*phi)*sin(phi);
+                    data(k1, k2, 0, counter) = 2*M_PI*(-m) * modes.sin(m, n)*cosphi;
+                    data(k1, k2, 1, counter) = 2*M_PI*(-m) * modes.sin(m, n)*sinphi;
                     data(k1, k2, 2, counter) = 0;
                     counter++;
                 }
@@ -1177,8 +484,8 @@ void SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<=0) continue;
-                        data(k1, k2, 0, counter) = 2*M_PI*m * cos(m*theta-n*nfp*phi)*cos(phi);
-                        data(k1, k2, 1, counter) = 2*M_PI*m * cos(m*theta-n*nfp*phi)*sin(phi);
+                        data(k1, k2, 0, counter) = 2*M_PI*m * modes.cos(m, n)*cosphi;
+                        data(k1, k2, 1, counter) = 2*M_PI*m * modes.cos(m, n)*sinphi;
                         data(k1, k2, 2, counter) = 0;
                         counter++;
                     }
@@ -1188,7 +495,7 @@ void SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
                         if(m==0 && n<0) continue;
                         data(k1, k2, 0, counter) = 0;
                         data(k1, k2, 1, counter) = 0;
-                        data(k1, k2, 2, counter) = 2*M_PI*(-m) * sin(m*theta-n*nfp*phi);
+                        data(k1, k2, 2, counter) = 2*M_PI*(-m) * modes.sin(m, n);
                         counter++;
                     }
                 }
@@ -1198,7 +505,7 @@ void SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
                     if(m==0 && n<=0) continue;
                     data(k1, k2, 0, counter) = 0;
                     data(k1, k2, 1, counter) = 0;
-                    data(k1, k2, 2, counter) = 2*M_PI*m * cos(m*theta-n*nfp*phi);
+                    data(k1, k2, 2, counter) = 2*M_PI*m * modes.cos(m, n);
                     counter++;
                 }
             }
@@ -1208,16 +515,19 @@ void SurfaceRZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceRZFourier<Array>::dgammadash2dash2_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int m = 0; m <= mpol; ++m) {
                 for (int n = -ntor; n <= ntor; ++n) {
                     if(m==0 && n<0) continue;
-                    data(k1, k2, 0, counter) = -4*M_PI*M_PI * m * m * cos(m*theta-n*nfp*phi)*cos(phi);
-                    data(k1, k2, 1, counter) = -4*M_PI*M_PI* m * m * cos(m*theta-n*nfp*phi)*sin(phi);
+                    data(k1, k2, 0, counter) = -4*M_PI*M_PI * m * m * modes.cos(m, n)*cosphi;
+                    data(k1, k2, 1, counter) = -4*M_PI*M_PI* m * m * modes.cos(m, n)*sinphi;
                     data(k1, k2, 2, counter) = 0;
                     counter++;
                 }
@@ -1226,8 +536,8 @@ void SurfaceRZFourier<Array>::dgammadash2dash2_by_dcoeff_impl(Array& data) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<=0) continue;
-                        data(k1, k2, 0, counter) = -4*M_PI*M_PI*m*m*sin(m*theta-n*nfp*phi)*cos(phi);
-                        data(k1, k2, 1, counter) = -4*M_PI*M_PI*m*m*sin(m*theta-n*nfp*phi)*sin(phi);
+                        data(k1, k2, 0, counter) = -4*M_PI*M_PI*m*m*modes.sin(m, n)*cosphi;
+                        data(k1, k2, 1, counter) = -4*M_PI*M_PI*m*m*modes.sin(m, n)*sinphi;
                         data(k1, k2, 2, counter) = 0;
                         counter++;
                     }
@@ -1237,7 +547,7 @@ void SurfaceRZFourier<Array>::dgammadash2dash2_by_dcoeff_impl(Array& data) {
                         if(m==0 && n<0) continue;
                         data(k1, k2, 0, counter) = 0;
                         data(k1, k2, 1, counter) = 0;
-                        data(k1, k2, 2, counter) = -4*M_PI*M_PI*m*m*cos(m*theta-n*nfp*phi);
+                        data(k1, k2, 2, counter) = -4*M_PI*M_PI*m*m*modes.cos(m, n);
                         counter++;
                     }
                 }
@@ -1247,7 +557,7 @@ void SurfaceRZFourier<Array>::dgammadash2dash2_by_dcoeff_impl(Array& data) {
                     if(m==0 && n<=0) continue;
                     data(k1, k2, 0, counter) = 0;
                     data(k1, k2, 1, counter) = 0;
-                    data(k1, k2, 2, counter) = -4*M_PI*M_PI*m*m*sin(m*theta-n*nfp*phi);
+                    data(k1, k2, 2, counter) = -4*M_PI*M_PI*m*m*modes.sin(m, n);
                     counter++;
                 }
             }
@@ -117,4 +117,13 @@ class SurfaceRZFourier : public Surface<Array> {
         Array dgamma_by_dcoeff_vjp(Array& v) override;
         Array dgammadash1_by_dcoeff_vjp(Array& v) override;
         Array dgammadash2_by_dcoeff_vjp(Array& v) override;
+        Array dgammadash1_dgammadash2_by_dcoeff_vjp(Array& v1, Array& v2) override;
+
+    private:
+        // r and z and their derivatives up to the given order, see SurfaceFourierBasis::synthesize.
+        void synthesize_rz(const SurfaceFourierBasis& basis, int order, vector<double>& r, vector<double>& z);
+        // Gradient with respect to the dofs, given the weights w_r and w_z of r, z and their derivatives.
+        Array synthesize_rz_vjp(const SurfaceFourierBasis& basis, int order, vector<double>& w_r, vector<double>& w_z);
+        // Sum of the vjps of gamma, gammadash1 and gammadash2 with v, vdash1 and vdash2, any of which may be null.
+        Array gamma_vjp(Array* v, Array* vdash1, Array* vdash2);
 };
@@ -1,32 +1,121 @@
 #include "surfacexyzfourier.h"
 
+// \hat x, \hat y and z and their derivatives are evaluated from the trig tables
+// in SurfaceFourierBasis, which are shared among all surfaces on the same
+// quadrature grid, with the sums over n carried out once per phi (see
+// SurfaceFourierBasis::synthesize). Writing u = \hat x + i \hat y, we have
+// x + i y = u e^{i phi}, so that e.g. d(x + i y)/dphi = (u_phi + i u) e^{i phi}.
+
+template<class Array>
+void SurfaceXYZFourier<Array>::synthesize_xyz(const SurfaceFourierBasis& basis, int order, vector<double>& xhat, vector<double>& yhat, vector<double>& z) {
+    int size = basis.nphi*basis.ntheta*SurfaceFourierBasis::num_derivatives(order);
+    xhat.resize(size);
+    yhat.resize(size);
+    z.resize(size);
+    basis.synthesize(xc.data(), xs.data(), order, xhat.data());
+    basis.synthesize(yc.data(), ys.data(), order, yhat.data());
+    basis.synthesize(zc.data(), zs.data(), order, z.data());
+}
+
 template<class Array>
 void SurfaceXYZFourier<Array>::gamma_impl(Array& data, Array& quadpoints_phi, Array& quadpoints_theta) {
-    int numquadpoints_phi = quadpoints_phi.size();
-    int numquadpoints_theta = quadpoints_theta.size();
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> xhat, yhat, z;
+    synthesize_xyz(*basis, 0, xhat, yhat, z);
+    int numquadpoints_phi = basis->nphi;
+    int numquadpoints_theta = basis->ntheta;
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double x = 0;
-            double y = 0;
-            double z = 0;
-            for (int m = 0; m <= mpol; ++m) {
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    double xhat = get_coeff(0, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double yhat = get_coeff(1, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * sin(m*theta-n*nfp*phi);
-                    x += xhat * cos(phi) - yhat * sin(phi);
-                    y += xhat * sin(phi) + yhat * cos(phi);
-                    z += get_coeff(2, true , m, i) * cos(m*theta-n*nfp*phi) + get_coeff(2, false, m, i) * sin(m*theta-n*nfp*phi);
-                }
+            int j = k1*numquadpoints_theta + k2;
+            data(k1, k2, 0) = xhat[j] * cosphi - yhat[j] * sinphi;
+            data(k1, k2, 1) = xhat[j] * sinphi + yhat[j] * cosphi;
+            data(k1, k2, 2) = z[j];
+        }
+    }
+}
+
+template<class Array>
+Array SurfaceXYZFourier<Array>::gamma_vjp(Array* v, Array* vdash1, Array* vdash2) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    int order = (vdash1 || vdash2) ? 1 : 0;
+    int size = numquadpoints_phi*numquadpoints_theta;
+    vector<double> w_x((2*order+1)*size, 0.), w_y((2*order+1)*size, 0.), w_z((2*order+1)*size, 0.);
+#pragma omp parallel for
+    for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
+            int j = k1*numquadpoints_theta + k2;
+            // rotate the weights back into the (\hat x, \hat y) frame
+            if(v) {
+                w_x[j] += (*v)(k1, k2, 0) * cosphi + (*v)(k1, k2, 1) * sinphi;
+                w_y[j] += (*v)(k1, k2, 1) * cosphi - (*v)(k1, k2, 0) * sinphi;
+                w_z[j] += (*v)(k1, k2, 2);
+            }
+            if(vdash1) {
+                double a = 2*M_PI*((*vdash1)(k1, k2, 0) * cosphi + (*vdash1)(k1, k2, 1) * sinphi);
+                double b = 2*M_PI*((*vdash1)(k1, k2, 1) * cosphi - (*vdash1)(k1, k2, 0) * sinphi);
+                w_x[j] += b;
+                w_y[j] -= a;
+                w_x[size + j] += a;
+                w_y[size + j] += b;
+                w_z[size + j] += 2*M_PI*(*vdash1)(k1, k2, 2);
+            }
+            if(vdash2) {
+                w_x[2*size + j] += 2*M_PI*((*vdash2)(k1, k2, 0) * cosphi + (*vdash2)(k1, k2, 1) * sinphi);
+                w_y[2*size + j] += 2*M_PI*((*vdash2)(k1, k2, 1) * cosphi - (*vdash2)(k1, k2, 0) * sinphi);
+                w_z[2*size + j] += 2*M_PI*(*vdash2)(k1, k2, 2);
             }
-            data(k1, k2, 0) = x;
-            data(k1, k2, 1) = y;
-            data(k1, k2, 2) = z;
         }
     }
+
+    int shift = (mpol+1)*(2*ntor+1);
+    vector<double> gxc(shift), gxs(shift), gyc(shift), gys(shift), gzc(shift), gzs(shift);
+    basis->synthesize_vjp(w_x.data(), order, gxc.data(), gxs.data());
+    basis->synthesize_vjp(w_y.data(), order, gyc.data(), gys.data());
+    basis->synthesize_vjp(w_z.data(), order, gzc.data(), gzs.data());
+    Array res = xt::zeros<double>({num_dofs()});
+    int counter = 0;
+    for (int i = ntor; i < shift; ++i)
+        res[counter++] = gxc[i];
+    if(!stellsym) {
+        for (int i = ntor+1; i < shift; ++i)
+            res[counter++] = gxs[i];
+        for (int i = ntor; i < shift; ++i)
+            res[counter++] = gyc[i];
+    }
+    for (int i = ntor+1; i < shift; ++i)
+        res[counter++] = gys[i];
+    if(!stellsym) {
+        for (int i = ntor; i < shift; ++i)
+            res[counter++] = gzc[i];
+    }
+    for (int i = ntor+1; i < shift; ++i)
+        res[counter++] = gzs[i];
+    return res;
+}
+
+template<class Array>
+Array SurfaceXYZFourier<Array>::dgamma_by_dcoeff_vjp(Array& v) {
+    return gamma_vjp(&v, nullptr, nullptr);
+}
+
+template<class Array>
+Array SurfaceXYZFourier<Array>::dgammadash1_by_dcoeff_vjp(Array& v) {
+    return gamma_vjp(nullptr, &v, nullptr);
+}
+
+template<class Array>
+Array SurfaceXYZFourier<Array>::dgammadash2_by_dcoeff_vjp(Array& v) {
+    return gamma_vjp(nullptr, nullptr, &v);
+}
+
+template<class Array>
+Array SurfaceXYZFourier<Array>::dgammadash1_dgammadash2_by_dcoeff_vjp(Array& v1, Array& v2) {
+    return gamma_vjp(nullptr, &v1, &v2);
 }
 
 template<class Array>
@@ -59,153 +148,105 @@ void SurfaceXYZFourier<Array>::gamma_lin(Array& data, Array& quadpoints_phi, Arr
 
 template<class Array>
 void SurfaceXYZFourier<Array>::gammadash1_impl(Array& data) {
-    data *= 0.;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> xhat, yhat, z;
+    synthesize_xyz(*basis, 1, xhat, yhat, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double xdash = 0;
-            double ydash = 0;
-            double zdash = 0;
-            for (int m = 0; m <= mpol; ++m) {
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    double xhat = get_coeff(0, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double yhat = get_coeff(1, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double xhatdash = get_coeff(0, true, m, i) * (n*nfp)*sin(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * (-n*nfp)*cos(m*theta-n*nfp*phi);
-                    double yhatdash = get_coeff(1, true, m, i) * (n*nfp)*sin(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * (-n*nfp)*cos(m*theta-n*nfp*phi);
-                    xdash += xhatdash * cos(phi) - yhatdash * sin(phi) - xhat * sin(phi) - yhat * cos(phi);
-                    ydash += xhatdash * sin(phi) + yhatdash * cos(phi) + xhat * cos(phi) - yhat * sin(phi);
-                    zdash += get_coeff(2, true , m, i) * (n*nfp)*sin(m*theta-n*nfp*phi) + get_coeff(2, false, m, i) * (-n*nfp)*cos(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 2*M_PI*xdash;
-            data(k1, k2, 1) = 2*M_PI*ydash;
-            data(k1, k2, 2) = 2*M_PI*zdash;
+            int j = k1*numquadpoints_theta + k2;
+            double xd = xhat[size + j] - yhat[j];
+            double yd = yhat[size + j] + xhat[j];
+            data(k1, k2, 0) = 2*M_PI*(xd * cosphi - yd * sinphi);
+            data(k1, k2, 1) = 2*M_PI*(xd * sinphi + yd * cosphi);
+            data(k1, k2, 2) = 2*M_PI*z[size + j];
         }
     }
 }
 
 template<class Array>
 void SurfaceXYZFourier<Array>::gammadash2_impl(Array& data) {
-    data *= 0.;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> xhat, yhat, z;
+    synthesize_xyz(*basis, 1, xhat, yhat, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double xdash = 0;
-            double ydash = 0;
-            double zdash = 0;
-            for (int m = 0; m <= mpol; ++m) {
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    double xhatdash = get_coeff(0, true, m, i) * (-m)* sin(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * m * cos(m*theta-n*nfp*phi);
-                    double yhatdash = get_coeff(1, true, m, i) * (-m)* sin(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * m * cos(m*theta-n*nfp*phi);
-                    xdash += xhatdash * cos(phi) - yhatdash * sin(phi);
-                    ydash += xhatdash * sin(phi) + yhatdash * cos(phi);
-                    zdash += get_coeff(2, true , m, i) * (-m) * sin(m*theta-n*nfp*phi) + get_coeff(2, false, m, i) * m * cos(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 2*M_PI*xdash;
-            data(k1, k2, 1) = 2*M_PI*ydash;
-            data(k1, k2, 2) = 2*M_PI*zdash;
+            int j = k1*numquadpoints_theta + k2;
+            double xd = xhat[2*size + j];
+            double yd = yhat[2*size + j];
+            data(k1, k2, 0) = 2*M_PI*(xd * cosphi - yd * sinphi);
+            data(k1, k2, 1) = 2*M_PI*(xd * sinphi + yd * cosphi);
+            data(k1, k2, 2) = 2*M_PI*z[2*size + j];
         }
     }
 }
 
 template<class Array>
 void SurfaceXYZFourier<Array>::gammadash1dash1_impl(Array& data) {
-    data *= 0.;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> xhat, yhat, z;
+    synthesize_xyz(*basis, 2, xhat, yhat, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double xdd = 0;
-            double ydd = 0;
-            double zdd = 0;
-            for (int m = 0; m <= mpol; ++m) {
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    double xhat = get_coeff(0, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double yhat = get_coeff(1, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double xhatd = -get_coeff(0, true, m, i) * (-n*nfp)*sin(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * (-n*nfp)*cos(m*theta-n*nfp*phi);
-                    double yhatd = -get_coeff(1, true, m, i) * (-n*nfp)*sin(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * (-n*nfp)*cos(m*theta-n*nfp*phi);
-                    double xhatdd = -get_coeff(0, true, m, i) * (-n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi) - get_coeff(0, false, m, i) * (-n*nfp) * (-n*nfp)*sin(m*theta-n*nfp*phi);
-                    double yhatdd = -get_coeff(1, true, m, i) * (-n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi) - get_coeff(1, false, m, i) * (-n*nfp) * (-n*nfp)*sin(m*theta-n*nfp*phi);
-
-                    xdd += xhatdd * cos(phi) - 2*xhatd * sin(phi) - xhat * cos(phi)
-                         - yhatdd * sin(phi) - 2*yhatd * cos(phi) + yhat * sin(phi);
-                    ydd += xhatdd * sin(phi) + 2*xhatd * cos(phi) - xhat * sin(phi)
-                         + yhatdd * cos(phi) - 2*yhatd * sin(phi) - yhat * cos(phi);
-                    zdd += -get_coeff(2, true , m, i) * (-n*nfp) * (-n*nfp) * cos(m*theta-n*nfp*phi) - get_coeff(2, false, m, i) * (-n*nfp) * (-n*nfp) * sin(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 4*M_PI*M_PI*xdd;
-            data(k1, k2, 1) = 4*M_PI*M_PI*ydd;
-            data(k1, k2, 2) = 4*M_PI*M_PI*zdd;
+            int j = k1*numquadpoints_theta + k2;
+            double xdd = xhat[3*size + j] - 2*yhat[size + j] - xhat[j];
+            double ydd = yhat[3*size + j] + 2*xhat[size + j] - yhat[j];
+            data(k1, k2, 0) = 4*M_PI*M_PI*(xdd * cosphi - ydd * sinphi);
+            data(k1, k2, 1) = 4*M_PI*M_PI*(xdd * sinphi + ydd * cosphi);
+            data(k1, k2, 2) = 4*M_PI*M_PI*z[3*size + j];
         }
     }
 }
 
 template<class Array>
 void SurfaceXYZFourier<Array>::gammadash1dash2_impl(Array& data) {
-    data *= 0.;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> xhat, yhat, z;
+    synthesize_xyz(*basis, 2, xhat, yhat, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double xd1d2 = 0;
-            double yd1d2 = 0;
-            double zd1d2 = 0;
-            for (int m = 0; m <= mpol; ++m) {
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    double xhat = get_coeff(0, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double yhat = get_coeff(1, true, m, i) * cos(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * sin(m*theta-n*nfp*phi);
-                    double xhatd2 = -get_coeff(0, true, m, i) * (m)*sin(m*theta-n*nfp*phi) + get_coeff(0, false, m, i) * (m)*cos(m*theta-n*nfp*phi);
-                    double yhatd2 = -get_coeff(1, true, m, i) * (m)*sin(m*theta-n*nfp*phi) + get_coeff(1, false, m, i) * (m)*cos(m*theta-n*nfp*phi);
-                    double xhatd1d2 = -get_coeff(0, true, m, i) * (-n*nfp)*(m)*cos(m*theta-n*nfp*phi) - get_coeff(0, false, m, i) * (-n*nfp) * (m)*sin(m*theta-n*nfp*phi);
-                    double yhatd1d2 = -get_coeff(1, true, m, i) * (-n*nfp)*(m)*cos(m*theta-n*nfp*phi) - get_coeff(1, false, m, i) * (-n*nfp) * (m)*sin(m*theta-n*nfp*phi);
-
-                    xd1d2 += xhatd1d2 * cos(phi) - xhatd2 * sin(phi)
-                           - yhatd1d2 * sin(phi) - yhatd2 * cos(phi);
-                    yd1d2 += xhatd1d2 * sin(phi) + xhatd2 * cos(phi)
-                           + yhatd1d2 * cos(phi) - yhatd2 * sin(phi);
-                    zd1d2 += -get_coeff(2, true , m, i) * (-n*nfp) * (m) * cos(m*theta-n*nfp*phi) - get_coeff(2, false, m, i) * (-n*nfp) * (m) * sin(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 4*M_PI*M_PI*xd1d2;
-            data(k1, k2, 1) = 4*M_PI*M_PI*yd1d2;
-            data(k1, k2, 2) = 4*M_PI*M_PI*zd1d2;
+            int j = k1*numquadpoints_theta + k2;
+            double xd1d2 = xhat[4*size + j] - yhat[2*size + j];
+            double yd1d2 = yhat[4*size + j] + xhat[2*size + j];
+            data(k1, k2, 0) = 4*M_PI*M_PI*(xd1d2 * cosphi - yd1d2 * sinphi);
+            data(k1, k2, 1) = 4*M_PI*M_PI*(xd1d2 * sinphi + yd1d2 * cosphi);
+            data(k1, k2, 2) = 4*M_PI*M_PI*z[4*size + j];
         }
     }
 }
 
 template<class Array>
 void SurfaceXYZFourier<Array>::gammadash2dash2_impl(Array& data) {
-    data *= 0.;
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
+    vector<double> xhat, yhat, z;
+    synthesize_xyz(*basis, 2, xhat, yhat, z);
+    int size = numquadpoints_phi*numquadpoints_theta;
+#pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
-            double xdd = 0;
-            double ydd = 0;
-            double zdd = 0;
-            for (int m = 0; m <= mpol; ++m) {
-                for (int i = 0; i < 2*ntor+1; ++i) {
-                    int n  = i - ntor;
-                    double xhatdd = -get_coeff(0, true, m, i) * (m) * (m) * cos(m*theta-n*nfp*phi) - get_coeff(0, false, m, i) * m * m * sin(m*theta-n*nfp*phi);
-                    double yhatdd = -get_coeff(1, true, m, i) * (m) * (m) * cos(m*theta-n*nfp*phi) - get_coeff(1, false, m, i) * m * m * sin(m*theta-n*nfp*phi);
-                    xdd += xhatdd * cos(phi) - yhatdd * sin(phi);
-                    ydd += xhatdd * sin(phi) + yhatdd * cos(phi);
-                    zdd += -get_coeff(2, true , m, i) * (m) * (m) * cos(m*theta-n*nfp*phi) - get_coeff(2, false, m, i) * m * m * sin(m*theta-n*nfp*phi);
-                }
-            }
-            data(k1, k2, 0) = 4*M_PI*M_PI*xdd;
-            data(k1, k2, 1) = 4*M_PI*M_PI*ydd;
-            data(k1, k2, 2) = 4*M_PI*M_PI*zdd;
+            int j = k1*numquadpoints_theta + k2;
+            double xdd = xhat[5*size + j];
+            double ydd = yhat[5*size + j];
+            data(k1, k2, 0) = 4*M_PI*M_PI*(xdd * cosphi - ydd * sinphi);
+            data(k1, k2, 1) = 4*M_PI*M_PI*(xdd * sinphi + ydd * cosphi);
+            data(k1, k2, 2) = 4*M_PI*M_PI*z[5*size + j];
         }
     }
 }
@@ -213,29 +254,32 @@ void SurfaceXYZFourier<Array>::gammadash2dash2_impl(Array& data) {
 
 template<class Array>
 void SurfaceXYZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int d = 0; d < 3; ++d) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<0) continue;
                         if(d == 0) {
-                            data(k1, k2, 0, counter) = cos(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = cos(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = modes.cos(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = modes.cos(m, n) * sinphi;
                         }else if(d == 1) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = -cos(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) =  cos(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = -modes.cos(m, n) * sinphi;
+                            data(k1, k2, 1, counter) =  modes.cos(m, n) * cosphi;
                         }
                         else if(d == 2) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 2, counter) =  cos(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) =  modes.cos(m, n);
                         }
                         counter++;
                     }
@@ -246,14 +290,14 @@ void SurfaceXYZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
                         if(d == 0) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = sin(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = sin(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = modes.sin(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = modes.sin(m, n) * sinphi;
                         }else if(d == 1) {
-                            data(k1, k2, 0, counter) = -sin(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) =  sin(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = -modes.sin(m, n) * sinphi;
+                            data(k1, k2, 1, counter) =  modes.sin(m, n) * cosphi;
                         }
                         else if(d == 2) {
-                            data(k1, k2, 2, counter) =  sin(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) =  modes.sin(m, n);
                         }
                         counter++;
                     }
@@ -265,29 +309,32 @@ void SurfaceXYZFourier<Array>::dgamma_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceXYZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int d = 0; d < 3; ++d) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<0) continue;
                         if(d == 0) {
-                            data(k1, k2, 0, counter) = (n*nfp)*sin(m*theta-n*nfp*phi) * cos(phi) - cos(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) = (n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) + cos(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = (n*nfp)*modes.sin(m, n) * cosphi - modes.cos(m, n) * sinphi;
+                            data(k1, k2, 1, counter) = (n*nfp)*modes.sin(m, n) * sinphi + modes.cos(m, n) * cosphi;
                         } else if(d == 1) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = -(n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) - cos(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) =  (n*nfp)*sin(m*theta-n*nfp*phi) * cos(phi) - cos(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = -(n*nfp)*modes.sin(m, n) * sinphi - modes.cos(m, n) * cosphi;
+                            data(k1, k2, 1, counter) =  (n*nfp)*modes.sin(m, n) * cosphi - modes.cos(m, n) * sinphi;
                         }
                         else if(d == 2) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 2, counter) =  (n*nfp)*sin(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) =  (n*nfp)*modes.sin(m, n);
                         }
                         counter++;
                     }
@@ -298,14 +345,14 @@ void SurfaceXYZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
                         if(d == 0) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = -(n*nfp)*cos(m*theta-n*nfp*phi) * cos(phi) - sin(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) = -(n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi) + sin(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = -(n*nfp)*modes.cos(m, n) * cosphi - modes.sin(m, n) * sinphi;
+                            data(k1, k2, 1, counter) = -(n*nfp)*modes.cos(m, n) * sinphi + modes.sin(m, n) * cosphi;
                         }else if(d == 1) {
-                            data(k1, k2, 0, counter) = (n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi)  - sin(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = (-n*nfp)*cos(m*theta-n*nfp*phi) * cos(phi) - sin(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = (n*nfp)*modes.cos(m, n) * sinphi  - modes.sin(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = (-n*nfp)*modes.cos(m, n) * cosphi - modes.sin(m, n) * sinphi;
                         }
                         else if(d == 2) {
-                            data(k1, k2, 2, counter) = (-n*nfp)*cos(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = (-n*nfp)*modes.cos(m, n);
                         }
                         counter++;
                     }
@@ -318,29 +365,32 @@ void SurfaceXYZFourier<Array>::dgammadash1_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceXYZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
 #pragma omp parallel for
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int d = 0; d < 3; ++d) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<0) continue;
                         if(d == 0) {
-                            data(k1, k2, 0, counter) = (-m)* sin(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = (-m)* sin(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = (-m)* modes.sin(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = (-m)* modes.sin(m, n) * sinphi;
                         }else if(d == 1) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = (-m)* sin(m*theta-n*nfp*phi) * (-1) * sin(phi);
-                            data(k1, k2, 1, counter) = (-m)* sin(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = (-m)* modes.sin(m, n) * (-1) * sinphi;
+                            data(k1, k2, 1, counter) = (-m)* modes.sin(m, n) * cosphi;
                         }
                         else if(d == 2) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 2, counter) = (-m) * sin(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = (-m) * modes.sin(m, n);
                         }
                         counter++;
                     }
@@ -351,14 +401,14 @@ void SurfaceXYZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
                         if(d == 0) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = m * cos(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = m * cos(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = m * modes.cos(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = m * modes.cos(m, n) * sinphi;
                         }else if(d == 1) {
-                            data(k1, k2, 0, counter) = m * cos(m*theta-n*nfp*phi) * (-1) * sin(phi);
-                            data(k1, k2, 1, counter) = m * cos(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = m * modes.cos(m, n) * (-1) * sinphi;
+                            data(k1, k2, 1, counter) = m * modes.cos(m, n) * cosphi;
                         }
                         else if(d == 2) {
-                            data(k1, k2, 2, counter) = m * cos(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = m * modes.cos(m, n);
                         }
                         counter++;
                     }
@@ -371,36 +421,39 @@ void SurfaceXYZFourier<Array>::dgammadash2_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceXYZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int d = 0; d < 3; ++d) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<0) continue;
                         if(d == 0) {
-                            data(k1, k2, 0, counter) = (n*nfp) * (-n*nfp) * cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                      - 2*(n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                      - cos(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = (n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi)*sin(phi) \
-                                                     + 2*(n*nfp)*sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                     - cos(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = (n*nfp) * (-n*nfp) * modes.cos(m, n) * cosphi \
+                                                      - 2*(n*nfp)*modes.sin(m, n) * sinphi \
+                                                      - modes.cos(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = (n*nfp)*(-n*nfp)*modes.cos(m, n)*sinphi \
+                                                     + 2*(n*nfp)*modes.sin(m, n) * cosphi \
+                                                     - modes.cos(m, n) * sinphi;
                         } else if(d == 1) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = -(n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                       - 2*(n*nfp)*      sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                                 +       cos(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) = (n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi)*cos(phi) \
-                                                     - 2*(n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                     - cos(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = -(n*nfp)*(-n*nfp)*modes.cos(m, n) * sinphi \
+                                                       - 2*(n*nfp)*      modes.sin(m, n) * cosphi \
+                                                                 +       modes.cos(m, n) * sinphi;
+                            data(k1, k2, 1, counter) = (n*nfp)*(-n*nfp)*modes.cos(m, n)*cosphi \
+                                                     - 2*(n*nfp)*modes.sin(m, n) * sinphi \
+                                                     - modes.cos(m, n) * cosphi;
                         }
                         else if (d == 2) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 2, counter) = (n*nfp)*(-n*nfp)*cos(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = (n*nfp)*(-n*nfp)*modes.cos(m, n);
                         }
                         counter++;
                     }
@@ -411,22 +464,22 @@ void SurfaceXYZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
                         if(d == 0) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = (n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                      +       2*(n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                      -                 sin(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = (n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                      - 2*(n*nfp)*cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                      - sin(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = (n*nfp)*(-n*nfp)*modes.sin(m, n) * cosphi \
+                                                      +       2*(n*nfp)*modes.cos(m, n) * sinphi \
+                                                      -                 modes.sin(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = (n*nfp)*(-n*nfp)*modes.sin(m, n) * sinphi \
+                                                      - 2*(n*nfp)*modes.cos(m, n) * cosphi \
+                                                      - modes.sin(m, n) * sinphi;
                         } else if(d == 1) {
-                            data(k1, k2, 0, counter) = -(n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                       + 2*(n*nfp)*cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                       + sin(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) = -(-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                       - 2*(-n*nfp)*cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                       - sin(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = -(n*nfp)*(-n*nfp)*modes.sin(m, n) * sinphi \
+                                                       + 2*(n*nfp)*modes.cos(m, n) * cosphi \
+                                                       + modes.sin(m, n) * sinphi;
+                            data(k1, k2, 1, counter) = -(-n*nfp)*(-n*nfp)*modes.sin(m, n) * cosphi \
+                                                       - 2*(-n*nfp)*modes.cos(m, n) * sinphi \
+                                                       - modes.sin(m, n) * cosphi;
                         }
                         else if(d == 2) {
-                            data(k1, k2, 2, counter) = -(-n*nfp)*(-n*nfp)*sin(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = -(-n*nfp)*(-n*nfp)*modes.sin(m, n);
                         }
                         counter++;
                     }
@@ -439,32 +492,35 @@ void SurfaceXYZFourier<Array>::dgammadash1dash1_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceXYZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int d = 0; d < 3; ++d) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<0) continue;
                         if(d == 0) {
-                            data(k1, k2, 0, counter) = (n*nfp) * m * cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                      + m * sin(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) = (n*nfp)*m*cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                      - m * sin(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = (n*nfp) * m * modes.cos(m, n) * cosphi \
+                                                      + m * modes.sin(m, n) * sinphi;
+                            data(k1, k2, 1, counter) = (n*nfp)*m*modes.cos(m, n) * sinphi \
+                                                      - m * modes.sin(m, n) * cosphi;
                         }else if(d == 1) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = -(n*nfp)*m*cos(m*theta-n*nfp*phi) * sin(phi) \
-                                                       + m * sin(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = (n*nfp)*m*cos(m*theta-n*nfp*phi) * cos(phi) \
-                                                       + m * sin(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = -(n*nfp)*m*modes.cos(m, n) * sinphi \
+                                                       + m * modes.sin(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = (n*nfp)*m*modes.cos(m, n) * cosphi \
+                                                       + m * modes.sin(m, n) * sinphi;
                         }
                         else if(d == 2) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 2, counter) = (n*nfp)*m*cos(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = (n*nfp)*m*modes.cos(m, n);
                         }
                         counter++;
                     }
@@ -475,18 +531,18 @@ void SurfaceXYZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
                         if(d == 0) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = (n*nfp)*m*sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                      - m * cos(m*theta-n*nfp*phi) * sin(phi);
-                            data(k1, k2, 1, counter) = (n*nfp) * m * sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                      + m * cos(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = (n*nfp)*m*modes.sin(m, n) * cosphi \
+                                                      - m * modes.cos(m, n) * sinphi;
+                            data(k1, k2, 1, counter) = (n*nfp) * m * modes.sin(m, n) * sinphi \
+                                                      + m * modes.cos(m, n) * cosphi;
                         }else if(d == 1) {
-                            data(k1, k2, 0, counter) = -(n*nfp)*m*sin(m*theta-n*nfp*phi) * sin(phi) \
-                                                       - m * cos(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = -(-n*nfp)*m*sin(m*theta-n*nfp*phi) * cos(phi) \
-                                                       - m * cos(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = -(n*nfp)*m*modes.sin(m, n) * sinphi \
+                                                       - m * modes.cos(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = -(-n*nfp)*m*modes.sin(m, n) * cosphi \
+                                                       - m * modes.cos(m, n) * sinphi;
                         }
                         else if(d == 2) {
-                            data(k1, k2, 2, counter) = -(-n*nfp)*(m)*sin(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = -(-n*nfp)*(m)*modes.sin(m, n);
                         }
                         counter++;
                     }
@@ -499,28 +555,31 @@ void SurfaceXYZFourier<Array>::dgammadash1dash2_by_dcoeff_impl(Array& data) {
 
 template<class Array>
 void SurfaceXYZFourier<Array>::dgammadash2dash2_by_dcoeff_impl(Array& data) {
+    auto basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
     for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-        double phi  = 2*M_PI*quadpoints_phi[k1];
+        double cosphi = basis->cosphi[k1];
+        double sinphi = basis->sinphi[k1];
+        SurfaceFourierBasis::Modes modes(*basis);
         for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-            double theta  = 2*M_PI*quadpoints_theta[k2];
+            modes.at(k1, k2);
             int counter = 0;
             for (int d = 0; d < 3; ++d) {
                 for (int m = 0; m <= mpol; ++m) {
                     for (int n = -ntor; n <= ntor; ++n) {
                         if(m==0 && n<0) continue;
                         if(d == 0) {
-                            data(k1, k2, 0, counter) = (-m) * m * cos(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = (-m) * m * cos(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = (-m) * m * modes.cos(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = (-m) * m * modes.cos(m, n) * sinphi;
                         }else if(d == 1) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = (-m)* m * cos(m*theta-n*nfp*phi) * (-1) * sin(phi);
-                            data(k1, k2, 1, counter) = (-m) *m * cos(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = (-m)* m * modes.cos(m, n) * (-1) * sinphi;
+                            data(k1, k2, 1, counter) = (-m) *m * modes.cos(m, n) * cosphi;
                         }
                         else if(d == 2) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 2, counter) = (-m) * m * cos(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = (-m) * m * modes.cos(m, n);
                         }
                         counter++;
                     }
@@ -531,14 +590,14 @@ void SurfaceXYZFourier<Array>::dgammadash2dash2_by_dcoeff_impl(Array& data) {
                         if(d == 0) {
                             if(stellsym)
                                 continue;
-                            data(k1, k2, 0, counter) = - m * m * sin(m*theta-n*nfp*phi) * cos(phi);
-                            data(k1, k2, 1, counter) = - m * m * sin(m*theta-n*nfp*phi) * sin(phi);
+                            data(k1, k2, 0, counter) = - m * m * modes.sin(m, n) * cosphi;
+                            data(k1, k2, 1, counter) = - m * m * modes.sin(m, n) * sinphi;
                         }else if(d == 1) {
-                            data(k1, k2, 0, counter) = - m * m * sin(m*theta-n*nfp*phi) * (-1) * sin(phi);
-                            data(k1, k2, 1, counter) = - m * m * sin(m*theta-n*nfp*phi) * cos(phi);
+                            data(k1, k2, 0, counter) = - m * m * modes.sin(m, n) * (-1) * sinphi;
+                            data(k1, k2, 1, counter) = - m * m * modes.sin(m, n) * cosphi;
                         }
                         else if(d == 2) {
-                            data(k1, k2, 2, counter) = - m * m * sin(m*theta-n*nfp*phi);
+                            data(k1, k2, 2, counter) = - m * m * modes.sin(m, n);
                         }
                         counter++;
                     }
@@ -153,5 +153,14 @@ class SurfaceXYZFourier : public Surface<Array> {
         void dgammadash1dash1_by_dcoeff_impl(Array& data) override;
         void dgammadash1dash2_by_dcoeff_impl(Array& data) override;
         void dgammadash2dash2_by_dcoeff_impl(Array& data) override;
-
+        Array dgamma_by_dcoeff_vjp(Array& v) override;
+        Array dgammadash1_by_dcoeff_vjp(Array& v) override;
+        Array dgammadash2_by_dcoeff_vjp(Array& v) override;
+        Array dgammadash1_dgammadash2_by_dcoeff_vjp(Array& v1, Array& v2) override;
+
+    private:
+        // \hat x, \hat y and z and their derivatives up to the given order, see SurfaceFourierBasis::synthesize.
+        void synthesize_xyz(const SurfaceFourierBasis& basis, int order, vector<double>& xhat, vector<double>& yhat, vector<double>& z);
+        // Sum of the vjps of gamma, gammadash1 and gammadash2 with v, vdash1 and vdash2, any of which may be null.
+        Array gamma_vjp(Array* v, Array* vdash1, Array* vdash2);
 };
@@ -38,12 +38,6 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
         Array x;
         Array y;
         Array z;
-        Array cache_basis_fun_phi;
-        Array cache_basis_fun_phi_dash;
-        Array cache_basis_fun_phi_dashdash;
-        Array cache_basis_fun_theta;
-        Array cache_basis_fun_theta_dash;
-        Array cache_basis_fun_theta_dashdash;
         Array cache_enforcer;
         Array cache_enforcer_dphi;
         Array cache_enforcer_dtheta;
@@ -119,6 +113,8 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
         void gamma_impl(Array& data, Array& quadpoints_phi, Array& quadpoints_theta) override {
             int numquadpoints_phi = quadpoints_phi.size();
             int numquadpoints_theta = quadpoints_theta.size();
+            // the cached basis functions are only valid on the surface's own grid
+            bool own_grid = basis->matches(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
             data *= 0.;
 #pragma omp parallel for
             for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
@@ -130,12 +126,15 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
                     double z = 0;
                     for (int m = 0; m <= 2*mpol; ++m) {
                         for (int n = 0; n <= 2*ntor; ++n) {
-                            xhat += get_coeff(0, m, n) * basis_fun(0, n, k1, m, k2);
-                            yhat += get_coeff(1, m, n) * basis_fun(1, n, k1, m, k2);
-                            z += get_coeff(2, m, n) * basis_fun(2, n, k1, m, k2);
-                            //xhat += get_coeff(0, m, n) * basis_fun(0, n, phi, m, theta);
-                            //yhat += get_coeff(1, m, n) * basis_fun(1, n, phi, m, theta);
-                            //z += get_coeff(2, m, n) * basis_fun(2, n, phi, m, theta);
+                            if(own_grid) {
+                                xhat += get_coeff(0, m, n) * basis_fun(0, n, k1, m, k2);
+                                yhat += get_coeff(1, m, n) * basis_fun(1, n, k1, m, k2);
+                                z += get_coeff(2, m, n) * basis_fun(2, n, k1, m, k2);
+                            } else {
+                                xhat += get_coeff(0, m, n) * basis_fun(0, n, phi, m, theta);
+                                yhat += get_coeff(1, m, n) * basis_fun(1, n, phi, m, theta);
+                                z += get_coeff(2, m, n) * basis_fun(2, n, phi, m, theta);
+                            }
                         }
                     }
                     data(k1, k2, 0) = xhat * cos(phi) - yhat * sin(phi);
@@ -597,31 +596,30 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
             }
         }
 
+        Array dgamma_by_dcoeff_vjp(Array& v) override {
+            return gamma_vjp(&v, nullptr, nullptr);
+        }
+
+        Array dgammadash1_by_dcoeff_vjp(Array& v) override {
+            return gamma_vjp(nullptr, &v, nullptr);
+        }
+
+        Array dgammadash2_by_dcoeff_vjp(Array& v) override {
+            return gamma_vjp(nullptr, nullptr, &v);
+        }
+
+        Array dgammadash1_dgammadash2_by_dcoeff_vjp(Array& v1, Array& v2) override {
+            return gamma_vjp(nullptr, &v1, &v2);
+        }
+
     private:
 
+        // cos and sin of n*nfp*phi and m*theta on the quadrature grid, shared
+        // with all other surfaces on the same grid.
+        std::shared_ptr<const SurfaceFourierBasis> basis;
+
         void build_cache() {
-            cache_basis_fun_phi = xt::zeros<double>({numquadpoints_phi, 2*ntor+1});
-            cache_basis_fun_phi_dash = xt::zeros<double>({numquadpoints_phi, 2*ntor+1});
-            cache_basis_fun_phi_dashdash = xt::zeros<double>({numquadpoints_phi, 2*ntor+1});
-            for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
-                double phi  = 2*M_PI*quadpoints_phi[k1];
-                for (int n = 0; n <= 2*ntor; ++n) {
-                    cache_basis_fun_phi(k1, n)= basis_fun_phi(n, phi);
-                    cache_basis_fun_phi_dash(k1, n) = basis_fun_phi_dash(n, phi);
-                    cache_basis_fun_phi_dashdash(k1, n) = basis_fun_phi_dashdash(n, phi);
-                }
-            }
-            cache_basis_fun_theta = xt::zeros<double>({numquadpoints_theta, 2*mpol+1});
-            cache_basis_fun_theta_dash = xt::zeros<double>({numquadpoints_theta, 2*mpol+1});
-            cache_basis_fun_theta_dashdash = xt::zeros<double>({numquadpoints_theta, 2*mpol+1});
-            for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
-                double theta  = 2*M_PI*quadpoints_theta[k2];
-                for (int m = 0; m <= 2*mpol; ++m) {
-                    cache_basis_fun_theta(k2, m) = basis_fun_theta(m, theta);
-                    cache_basis_fun_theta_dash(k2, m) = basis_fun_theta_dash(m, theta);
-                    cache_basis_fun_theta_dashdash(k2, m) = basis_fun_theta_dashdash(m, theta);
-                }
-            }
+            basis = this->fourier_basis(quadpoints_phi, quadpoints_theta, mpol, ntor, nfp);
             cache_enforcer = xt::zeros<double>({numquadpoints_phi, numquadpoints_theta});
             cache_enforcer_dphi = xt::zeros<double>({numquadpoints_phi, numquadpoints_theta});
             cache_enforcer_dtheta = xt::zeros<double>({numquadpoints_phi, numquadpoints_theta});
@@ -641,6 +639,124 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
 
         }
 
+        // Sum of the vjps of gamma, gammadash1 and gammadash2 with v, vdash1
+        // and vdash2, any of which may be null. The weights are rotated back
+        // into the (\hat x, \hat y) frame and then contracted with the basis
+        // functions by basis_vjp, without forming the Jacobian.
+        Array gamma_vjp(Array* v, Array* vdash1, Array* vdash2) {
+            int order = (vdash1 || vdash2) ? 1 : 0;
+            int size = numquadpoints_phi*numquadpoints_theta;
+            vector<vector<double>> w(3, vector<double>((2*order+1)*size, 0.));
+#pragma omp parallel for
+            for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
+                double cosphi = basis->cosphi[k1];
+                double sinphi = basis->sinphi[k1];
+                for (int k2 = 0; k2 < numquadpoints_theta; ++k2) {
+                    int j = k1*numquadpoints_theta + k2;
+                    if(v) {
+                        w[0][j] += (*v)(k1, k2, 0) * cosphi + (*v)(k1, k2, 1) * sinphi;
+                        w[1][j] += (*v)(k1, k2, 1) * cosphi - (*v)(k1, k2, 0) * sinphi;
+                        w[2][j] += (*v)(k1, k2, 2);
+                    }
+                    if(vdash1) {
+                        double a = 2*M_PI*((*vdash1)(k1, k2, 0) * cosphi + (*vdash1)(k1, k2, 1) * sinphi);
+                        double b = 2*M_PI*((*vdash1)(k1, k2, 1) * cosphi - (*vdash1)(k1, k2, 0) * sinphi);
+                        w[0][j] += b;
+                        w[1][j] -= a;
+                        w[0][size + j] += a;
+                        w[1][size + j] += b;
+                        w[2][size + j] += 2*M_PI*(*vdash1)(k1, k2, 2);
+                    }
+                    if(vdash2) {
+                        w[0][2*size + j] += 2*M_PI*((*vdash2)(k1, k2, 0) * cosphi + (*vdash2)(k1, k2, 1) * sinphi);
+                        w[1][2*size + j] += 2*M_PI*((*vdash2)(k1, k2, 1) * cosphi - (*vdash2)(k1, k2, 0) * sinphi);
+                        w[2][2*size + j] += 2*M_PI*(*vdash2)(k1, k2, 2);
+                    }
+                }
+            }
+            Array res = xt::zeros<double>({num_dofs()});
+            vector<double> grad((2*mpol+1)*(2*ntor+1));
+            int counter = 0;
+            for (int d = 0; d < 3; ++d) {
+                basis_vjp(d, w[d].data(), order, grad.data());
+                for (int m = 0; m <= 2*mpol; ++m) {
+                    for (int n = 0; n <= 2*ntor; ++n) {
+                        if(skip(d, m, n)) continue;
+                        res[counter++] = grad[m*(2*ntor+1) + n];
+                    }
+                }
+            }
+            return res;
+        }
+
+        // Given weights w of f (and of f_phi and f_theta if order is 1) on the
+        // grid, where f = \sum_{m,n} c_{mn} basis_fun(dim, n, phi, m, theta),
+        // computes the gradient with respect to c of shape (2*mpol+1, 2*ntor+1).
+        // The basis is separable up to the bc enforcer, so the sum over theta
+        // is done first for each phi.
+        void basis_vjp(int dim, const double* w, int order, double* grad) {
+            int ntheta = numquadpoints_theta;
+            int size = numquadpoints_phi*ntheta;
+            int ncoeff = (2*mpol+1)*(2*ntor+1);
+            bool clamped = clamped_dims[dim];
+            for (int j = 0; j < ncoeff; ++j)
+                grad[j] = 0.;
+#pragma omp parallel
+            {
+                vector<double> grad_private(ncoeff, 0.);
+#pragma omp for
+                for (int k1 = 0; k1 < numquadpoints_phi; ++k1) {
+                    const double* w0 = &w[k1*ntheta];
+                    const double* w_phi = order >= 1 ? &w[size + k1*ntheta] : nullptr;
+                    const double* w_theta = order >= 1 ? &w[2*size + k1*ntheta] : nullptr;
+                    const double* e = &cache_enforcer.data()[k1*ntheta];
+                    const double* e_phi = &cache_enforcer_dphi.data()[k1*ntheta];
+                    const double* e_theta = &cache_enforcer_dtheta.data()[k1*ntheta];
+                    for (int m = 0; m <= 2*mpol; ++m) {
+                        // w_m = wa and w_m' = fb*wb
+                        const double* wa = m <= mpol ? &basis->cosm[m*ntheta] : &basis->sinm[(m-mpol)*ntheta];
+                        const double* wb = m <= mpol ? &basis->sinm[m*ntheta] : &basis->cosm[(m-mpol)*ntheta];
+                        double fb = m <= mpol ? -m : m-mpol;
+                        // the coefficient of v_n is A, and that of v_n' is B
+                        double A = 0., B = 0., A_e = 0., B_e = 0.;
+                        bool enforced = clamped && m <= mpol;
+                        for (int k2 = 0; k2 < ntheta; ++k2)
+                            A += w0[k2]*wa[k2];
+                        if(order >= 1) {
+                            for (int k2 = 0; k2 < ntheta; ++k2) {
+                                A += w_theta[k2]*fb*wb[k2];
+                                B += w_phi[k2]*wa[k2];
+                            }
+                        }
+                        if(enforced) {
+                            for (int k2 = 0; k2 < ntheta; ++k2)
+                                A_e += w0[k2]*e[k2]*wa[k2];
+                            if(order >= 1) {
+                                for (int k2 = 0; k2 < ntheta; ++k2) {
+                                    A_e += (w_phi[k2]*e_phi[k2] + w_theta[k2]*e_theta[k2])*wa[k2] + w_theta[k2]*e[k2]*fb*wb[k2];
+                                    B_e += w_phi[k2]*e[k2]*wa[k2];
+                                }
+                            }
+                        }
+                        for (int n = 0; n <= 2*ntor; ++n) {
+                            bool e_n = enforced && n <= ntor;
+                            double a = e_n ? A_e : A;
+                            double b = e_n ? B_e : B;
+                            double g = a*cached_basis_fun_phi(n, k1);
+                            if(order >= 1)
+                                g += b*cached_basis_fun_phi_dash(n, k1);
+                            grad_private[m*(2*ntor+1) + n] += g;
+                        }
+                    }
+                }
+#pragma omp critical
+                {
+                    for (int j = 0; j < ncoeff; ++j)
+                        grad[j] += grad_private[j];
+                }
+            }
+        }
+
         inline bool apply_bc_enforcer(int dim, int n, int m) {
             return (clamped_dims[dim] && n<=ntor && m<=mpol);
         }
@@ -680,27 +796,72 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
                 return 0;
         }
 
+        inline double cached_basis_fun_phi(int n, int phiidx){
+            if(n <= ntor)
+                return basis->cosn[phiidx*(ntor+1) + n];
+            else
+                return basis->sinn[phiidx*(ntor+1) + n-ntor];
+        }
+
+        inline double cached_basis_fun_phi_dash(int n, int phiidx){
+            if(n <= ntor)
+                return -nfp*n*basis->sinn[phiidx*(ntor+1) + n];
+            else
+                return nfp*(n-ntor)*basis->cosn[phiidx*(ntor+1) + n-ntor];
+        }
+
+        inline double cached_basis_fun_phi_dashdash(int n, int phiidx){
+            if(n <= ntor)
+                return -nfp*n*nfp*n*basis->cosn[phiidx*(ntor+1) + n];
+            else
+                return -nfp*(n-ntor)*nfp*(n-ntor)*basis->sinn[phiidx*(ntor+1) + n-ntor];
+        }
+
+        inline double cached_basis_fun_theta(int m, int thetaidx){
+            int ntheta = basis->ntheta;
+            if(m <= mpol)
+                return basis->cosm[m*ntheta + thetaidx];
+            else
+                return basis->sinm[(m-mpol)*ntheta + thetaidx];
+        }
+
+        inline double cached_basis_fun_theta_dash(int m, int thetaidx){
+            int ntheta = basis->ntheta;
+            if(m <= mpol)
+                return -m*basis->sinm[m*ntheta + thetaidx];
+            else
+                return (m-mpol)*basis->cosm[(m-mpol)*ntheta + thetaidx];
+        }
+
+        inline double cached_basis_fun_theta_dashdash(int m, int thetaidx){
+            int ntheta = basis->ntheta;
+            if(m <= mpol)
+                return -m*m*basis->cosm[m*ntheta + thetaidx];
+            else
+                return -(m-mpol)*(m-mpol)*basis->sinm[(m-mpol)*ntheta + thetaidx];
+        }
+
         inline double basis_fun(int dim, int n, int phiidx, int m, int thetaidx){
-            double fun = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+            double fun = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
             if(apply_bc_enforcer(dim, n, m))
                 fun *= cache_enforcer(phiidx, thetaidx);
             return fun;
         }
 
         inline double basis_fun_dphi(int dim, int n, int phiidx, int m, int thetaidx){
-            double fun_dphi = cache_basis_fun_phi_dash(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+            double fun_dphi = cached_basis_fun_phi_dash(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
             if(apply_bc_enforcer(dim, n, m)){
-                double fun = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+                double fun = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
                 fun_dphi = fun_dphi*cache_enforcer(phiidx, thetaidx) + fun*cache_enforcer_dphi(phiidx, thetaidx);
             }
             return fun_dphi;
         }
 
         inline double basis_fun_dphidphi(int dim, int n, int phiidx, int m, int thetaidx){
-            double fun_dphidphi = cache_basis_fun_phi_dashdash(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+            double fun_dphidphi = cached_basis_fun_phi_dashdash(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
             if(apply_bc_enforcer(dim, n, m)){
-                double fun_dphi = cache_basis_fun_phi_dash(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
-                double fun = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+                double fun_dphi = cached_basis_fun_phi_dash(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
+                double fun = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
                 fun_dphidphi = fun_dphidphi*cache_enforcer(phiidx, thetaidx) + 2*fun_dphi*cache_enforcer_dphi(phiidx, thetaidx) \
                             +  fun*cache_enforcer_dphidphi(phiidx, thetaidx);
             }
@@ -708,19 +869,19 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
         }
 
         inline double basis_fun_dtheta(int dim, int n, int phiidx, int m, int thetaidx){
-            double fun_dtheta = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta_dash(thetaidx, m);
+            double fun_dtheta = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta_dash(m, thetaidx);
             if(apply_bc_enforcer(dim, n, m)){
-                double fun = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+                double fun = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
                 fun_dtheta = fun_dtheta*cache_enforcer(phiidx, thetaidx) + fun*cache_enforcer_dtheta(phiidx, thetaidx);
             }
             return fun_dtheta;
         }
 
         inline double basis_fun_dthetadphi(int dim, int n, int phiidx, int m, int thetaidx){
-            double fun_dthetadphi = cache_basis_fun_phi_dash(phiidx, n)*cache_basis_fun_theta_dash(thetaidx, m);
+            double fun_dthetadphi = cached_basis_fun_phi_dash(n, phiidx)*cached_basis_fun_theta_dash(m, thetaidx);
             if(apply_bc_enforcer(dim, n, m)){
-                double fun_dtheta = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta_dash(thetaidx, m);
-                double fun_dphi = cache_basis_fun_phi_dash(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
+                double fun_dtheta = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta_dash(m, thetaidx);
+                double fun_dphi = cached_basis_fun_phi_dash(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
                 fun_dthetadphi = fun_dthetadphi*cache_enforcer(phiidx, thetaidx) \
                                 + fun_dtheta*cache_enforcer_dphi(phiidx, thetaidx) \
                                 + fun_dphi*cache_enforcer_dtheta(phiidx, thetaidx);
@@ -729,10 +890,10 @@ class SurfaceXYZTensorFourier : public Surface<Array> {
         }
 
         inline double basis_fun_dthetadtheta(int dim, int n, int phiidx, int m, int thetaidx){
-          double fun_dthetadtheta = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta_dashdash(thetaidx, m);
+          double fun_dthetadtheta = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta_dashdash(m, thetaidx);
           if(apply_bc_enforcer(dim, n, m)){
-              double fun = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta(thetaidx, m);
-              double fun_dtheta = cache_basis_fun_phi(phiidx, n)*cache_basis_fun_theta_dash(thetaidx, m);
+              double fun = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta(m, thetaidx);
+              double fun_dtheta = cached_basis_fun_phi(n, phiidx)*cached_basis_fun_theta_dash(m, thetaidx);
               fun_dthetadtheta = fun_dthetadtheta*cache_enforcer(phiidx, thetaidx) \
                               + 2*fun_dtheta*cache_enforcer_dtheta(phiidx, thetaidx) \
                               + fun*cache_enforcer_dthetadtheta(phiidx, thetaidx);
@@ -1,9 +1,12 @@
 #include <memory>
 #include <vector>
 #include <functional>
+#include <algorithm>
 #include "magneticfield.h"
 #include "boozermagneticfield.h"
+#include "simdhelpers.h"
 #include <cassert>
+#include <exception>
 #include <stdexcept>
 #include "tracing.h"
 using std::shared_ptr;
@@ -12,9 +15,15 @@ using std::tuple;
 using std::pair;
 using std::function;
 
+#include "pybind11/pybind11.h"
 #include "xtensor-python/pyarray.hpp"     // Numpy bindings
 #include "xtensor-python/pytensor.hpp"     // Numpy bindings
 typedef xt::pyarray<double> Array;
+namespace py = pybind11;
+
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 #include <boost/math/tools/roots.hpp>
 #include <boost/numeric/odeint.hpp>
@@ -47,6 +56,10 @@ class GuidingCenterVacuumRHS {
 
             }
 
+        void set_mu(double mu_) {
+            mu = mu_;
+        }
+
         void operator()(const State &ys, array<double, 4> &dydt,
                 const double t) {
             double x = ys[0];
@@ -77,6 +90,127 @@ class GuidingCenterVacuumRHS {
         }
 };
 
+template<template<class, std::size_t, xt::layout_type> class T>
+class GuidingCenterVacuumBatchRHS {
+    /*
+     * Same right hand side as GuidingCenterVacuumRHS, but evaluated for a
+     * whole batch of particles at once: the field is evaluated at all
+     * particle positions in a single call to `set_points_cyl` and the right
+     * hand side is then vectorized across particles. The states and
+     * derivatives are passed as structure of arrays, i.e. x, y, z, v_par and
+     * mu are each arrays of length n (padded to the simd width).
+     */
+    private:
+        typename MagneticField<T>::Tensor2 rphiz = xt::zeros<double>({1, 3});
+        shared_ptr<MagneticField<T>> field;
+        double m, q;
+        AlignedPaddedVec Bx, By, Bz, GradAbsBx, GradAbsBy, GradAbsBz, AbsB;
+    public:
+        static constexpr int Size = 4;
+
+        GuidingCenterVacuumBatchRHS(shared_ptr<MagneticField<T>> field, double m, double q, int nmax)
+            : field(field), m(m), q(q),
+            Bx(nmax, 0.), By(nmax, 0.), Bz(nmax, 0.),
+            GradAbsBx(nmax, 0.), GradAbsBy(nmax, 0.), GradAbsBz(nmax, 0.), AbsB(nmax, 0.) {
+            }
+
+        void operator()(int n, AlignedPaddedVec* ys, AlignedPaddedVec& mu, AlignedPaddedVec* dydt) {
+            if(rphiz.shape(0) != n)
+                rphiz = xt::zeros<double>({n, 3});
+            for (int i = 0; i < n; ++i) {
+                double x = ys[0][i];
+                double y = ys[1][i];
+                rphiz(i, 0) = std::sqrt(x*x+y*y);
+                rphiz(i, 1) = std::atan2(y, x);
+                if(rphiz(i, 1) < 0)
+                    rphiz(i, 1) += 2*M_PI;
+                rphiz(i, 2) = ys[2][i];
+            }
+            field->set_points_cyl(rphiz);
+            auto& GradAbsB = field->GradAbsB_ref();
+            auto& B = field->B_ref();
+            auto& modB = field->AbsB_ref();
+            for (int i = 0; i < n; ++i) {
+                Bx[i] = B(i, 0);
+                By[i] = B(i, 1);
+                Bz[i] = B(i, 2);
+                GradAbsBx[i] = GradAbsB(i, 0);
+                GradAbsBy[i] = GradAbsB(i, 1);
+                GradAbsBz[i] = GradAbsB(i, 2);
+                AbsB[i] = modB(i, 0);
+            }
+            double moverq = m/q;
+#if defined(USE_XSIMD)
+            constexpr int simd_size = xsimd::simd_type<double>::size;
+            // the vectors are padded, so we can always work on full simd
+            // vectors and simply ignore the superfluous entries at the end.
+            for (int i = 0; i < n; i += simd_size) {
+                simd_t bx = xs::load_aligned(&Bx[i]);
+                simd_t by = xs::load_aligned(&By[i]);
+                simd_t bz = xs::load_aligned(&Bz[i]);
+                simd_t gx = xs::load_aligned(&GradAbsBx[i]);
+                simd_t gy = xs::load_aligned(&GradAbsBy[i]);
+                simd_t gz = xs::load_aligned(&GradAbsBz[i]);
+                simd_t absb = xs::load_aligned(&AbsB[i]);
+                simd_t v_par = xs::load_aligned(&ys[3][i]);
+                simd_t mu_i = xs::load_aligned(&mu[i]);
+                simd_t absb_inv = 1./absb;
+                simd_t fak1 = v_par*absb_inv;
+                simd_t fak2 = moverq*absb_inv*absb_inv*absb_inv*xsimd::fma(mu_i, absb, v_par*v_par);
+                simd_t bcrossgx = xsimd::fms(by, gz, bz*gy);
+                simd_t bcrossgy = xsimd::fms(bz, gx, bx*gz);
+                simd_t bcrossgz = xsimd::fms(bx, gy, by*gx);
+                xsimd::fma(fak1, bx, fak2*bcrossgx).store_aligned(&dydt[0][i]);
+                xsimd::fma(fak1, by, fak2*bcrossgy).store_aligned(&dydt[1][i]);
+                xsimd::fma(fak1, bz, fak2*bcrossgz).store_aligned(&dydt[2][i]);
+                simd_t bdotg = xsimd::fma(bx, gx, xsimd::fma(by, gy, bz*gz));
+                (-mu_i*bdotg*absb_inv).store_aligned(&dydt[3][i]);
+            }
+#else
+            for (int i = 0; i < n; ++i) {
+                double absb_inv = 1./AbsB[i];
+                double fak1 = ys[3][i]*absb_inv;
+                double fak2 = moverq*absb_inv*absb_inv*absb_inv*(mu[i]*AbsB[i] + ys[3][i]*ys[3][i]);
+                dydt[0][i] = fak1*Bx[i] + fak2*(By[i]*GradAbsBz[i] - Bz[i]*GradAbsBy[i]);
+                dydt[1][i] = fak1*By[i] + fak2*(Bz[i]*GradAbsBx[i] - Bx[i]*GradAbsBz[i]);
+                dydt[2][i] = fak1*Bz[i] + fak2*(Bx[i]*GradAbsBy[i] - By[i]*GradAbsBx[i]);
+                dydt[3][i] = -mu[i]*(Bx[i]*GradAbsBx[i] + By[i]*GradAbsBy[i] + Bz[i]*GradAbsBz[i])*absb_inv;
+            }
+#endif
+        }
+};
+
+// Evaluate the first n columns of gc_quantities (see BoozerGCQuantity) at the
+// current point of the field. Fields with fused_gc_quantities() provide them
+// with a single lookup, for all other fields only the quantities needed are
+// evaluated.
+template<template<class, std::size_t, xt::layout_type> class T>
+void boozer_gc_quantities(BoozerMagneticField<T>& field, int n, array<double, GC_SIZE>& gc) {
+    if(field.fused_gc_quantities()) {
+        auto& q = field.gc_quantities_ref();
+        std::copy(q.data(), q.data() + n, gc.begin());
+        return;
+    }
+    auto& modB_derivs = field.modB_derivs_ref();
+    gc[GC_MODB] = field.modB_ref()(0);
+    gc[GC_DMODBDS] = modB_derivs(0);
+    gc[GC_DMODBDTHETA] = modB_derivs(1);
+    gc[GC_DMODBDZETA] = modB_derivs(2);
+    gc[GC_G] = field.G_ref()(0);
+    gc[GC_IOTA] = field.iota_ref()(0);
+    if(n > GC_SIZE_VACUUM) {
+        gc[GC_I] = field.I_ref()(0);
+        gc[GC_DGDS] = field.dGds_ref()(0);
+        gc[GC_DIDS] = field.dIds_ref()(0);
+    }
+    if(n > GC_SIZE_NOK) {
+        auto& K_derivs = field.K_derivs_ref();
+        gc[GC_K] = field.K_ref()(0);
+        gc[GC_DKDTHETA] = K_derivs(0);
+        gc[GC_DKDZETA] = K_derivs(1);
+    }
+}
+
 template<template<class, std::size_t, xt::layout_type> class T>
 class GuidingCenterVacuumBoozerRHS {
     /*
@@ -93,6 +227,7 @@ class GuidingCenterVacuumBoozerRHS {
     private:
         typename BoozerMagneticField<T>::Tensor2 stz = xt::zeros<double>({1, 3});
         shared_ptr<BoozerMagneticField<T>> field;
+        array<double, GC_SIZE> gc;
         double m, q, mu;
     public:
         static constexpr int Size = 4;
@@ -112,13 +247,14 @@ class GuidingCenterVacuumBoozerRHS {
             stz(0, 2) = ys[2];
 
             field->set_points(stz);
+            boozer_gc_quantities(*field, GC_SIZE_VACUUM, gc);
             auto psi0 = field->psi0;
-            double modB = field->modB_ref()(0);
-            double G = field->G_ref()(0);
-            double iota = field->iota_ref()(0);
-            double dmodBds = field->modB_derivs_ref()(0);
-            double dmodBdtheta = field->modB_derivs_ref()(1);
-            double dmodBdzeta = field->modB_derivs_ref()(2);
+            double modB = gc[GC_MODB];
+            double G = gc[GC_G];
+            double iota = gc[GC_IOTA];
+            double dmodBds = gc[GC_DMODBDS];
+            double dmodBdtheta = gc[GC_DMODBDTHETA];
+            double dmodBdzeta = gc[GC_DMODBDZETA];
             double v_perp2 = 2*mu*modB;
             double fak1 = m*v_par*v_par/modB + m*mu;
 
@@ -147,6 +283,7 @@ class GuidingCenterNoKBoozerRHS {
     private:
         typename BoozerMagneticField<T>::Tensor2 stz = xt::zeros<double>({1, 3});
         shared_ptr<BoozerMagneticField<T>> field;
+        array<double, GC_SIZE> gc;
         double m, q, mu;
     public:
         static constexpr int Size = 4;
@@ -166,16 +303,17 @@ class GuidingCenterNoKBoozerRHS {
             stz(0, 2) = ys[2];
 
             field->set_points(stz);
+            boozer_gc_quantities(*field, GC_SIZE_NOK, gc);
             auto psi0 = field->psi0;
-            double modB = field->modB_ref()(0);
-            double G = field->G_ref()(0);
-            double I = field->I_ref()(0);
-            double dGdpsi = field->dGds_ref()(0)/psi0;
-            double dIdpsi = field->dIds_ref()(0)/psi0;
-            double iota = field->iota_ref()(0);
-            double dmodBdpsi = field->modB_derivs_ref()(0)/psi0;
-            double dmodBdtheta = field->modB_derivs_ref()(1);
-            double dmodBdzeta = field->modB_derivs_ref()(2);
+            double modB = gc[GC_MODB];
+            double G = gc[GC_G];
+            double I = gc[GC_I];
+            double dGdpsi = gc[GC_DGDS]/psi0;
+            double dIdpsi = gc[GC_DIDS]/psi0;
+            double iota = gc[GC_IOTA];
+            double dmodBdpsi = gc[GC_DMODBDS]/psi0;
+            double dmodBdtheta = gc[GC_DMODBDTHETA];
+            double dmodBdzeta = gc[GC_DMODBDZETA];
             double v_perp2 = 2*mu*modB;
             double fak1 = m*v_par*v_par/modB + m*mu;
             double D = ((q + m*v_par*dIdpsi/modB)*G - (-q*iota + m*v_par*dGdpsi/modB)*I)/iota;
@@ -206,6 +344,7 @@ class GuidingCenterBoozerRHS {
     private:
         typename BoozerMagneticField<T>::Tensor2 stz = xt::zeros<double>({1, 3});
         shared_ptr<BoozerMagneticField<T>> field;
+        array<double, GC_SIZE> gc;
         double m, q, mu;
     public:
         static constexpr int Size = 4;
@@ -226,20 +365,21 @@ class GuidingCenterBoozerRHS {
             assert(ys[0]>0);
 
             field->set_points(stz);
+            boozer_gc_quantities(*field, GC_SIZE, gc);
             auto psi0 = field->psi0;
-            double modB = field->modB_ref()(0);
-            double K = field->K_ref()(0);
-            double dKdtheta = field->K_derivs_ref()(0);
-            double dKdzeta = field->K_derivs_ref()(1);
-
-            double G = field->G_ref()(0);
-            double I = field->I_ref()(0);
-            double dGdpsi = field->dGds_ref()(0)/psi0;
-            double dIdpsi = field->dIds_ref()(0)/psi0;
-            double iota = field->iota_ref()(0);
-            double dmodBdpsi = field->modB_derivs_ref()(0)/psi0;
-            double dmodBdtheta = field->modB_derivs_ref()(1);
-            double dmodBdzeta = field->modB_derivs_ref()(2);
+            double modB = gc[GC_MODB];
+            double K = gc[GC_K];
+            double dKdtheta = gc[GC_DKDTHETA];
+            double dKdzeta = gc[GC_DKDZETA];
+
+            double G = gc[GC_G];
+            double I = gc[GC_I];
+            double dGdpsi = gc[GC_DGDS]/psi0;
+            double dIdpsi = gc[GC_DIDS]/psi0;
+            double iota = gc[GC_IOTA];
+            double dmodBdpsi = gc[GC_DMODBDS]/psi0;
+            double dmodBdtheta = gc[GC_DMODBDTHETA];
+            double dmodBdzeta = gc[GC_DMODBDZETA];
             double v_perp2 = 2*mu*modB;
             double fak1 = m*v_par*v_par/modB + m*mu; // dHdB
             double C = -m*v_par*(dKdzeta-dGdpsi)/modB - q*iota;
@@ -363,12 +503,79 @@ std::array<double, m+n> join(const std::array<double, m>& a, const std::array<do
 }
 
 
+// Stores the rows [t, state] of a trajectory. Of all the rows passed to
+// record(), only every save_every-th one (save_every=0 meaning only the first
+// one) and the last one are kept. If a sink is given, the kept rows are passed
+// to the sink in chunks of chunk_size rows and only the first and last row are
+// returned, so that the memory used does not depend on the length of the
+// trajectory.
+template<std::size_t Cols>
+class TrajectoryRecorder {
+    private:
+        static constexpr int chunk_size = 4096;
+        int save_every;
+        shared_ptr<TrajectorySink> sink;
+        int sink_id;
+        vector<array<double, Cols>> res = {};
+        vector<array<double, Cols>> chunk = {};
+        array<double, Cols> last;
+        long count = 0;
+        bool last_kept = false;
+
+        void write_chunk() {
+            if(chunk.size() > 0)
+                sink->write(sink_id, chunk[0].data(), chunk.size(), Cols);
+            chunk.clear();
+        }
+
+        void keep(const array<double, Cols>& row) {
+            if(!sink) {
+                res.push_back(row);
+                return;
+            }
+            chunk.push_back(row);
+            if(chunk.size() == chunk_size)
+                write_chunk();
+        }
+
+    public:
+        TrajectoryRecorder(int save_every, shared_ptr<TrajectorySink> sink, int sink_id)
+            : save_every(save_every), sink(sink), sink_id(sink_id) {
+            if(save_every < 0)
+                throw std::invalid_argument("save_every has to be non-negative.");
+            if(sink)
+                chunk.reserve(chunk_size);
+        }
+
+        void record(const array<double, Cols>& row) {
+            if(sink && count == 0)
+                res.push_back(row);
+            last_kept = count == 0 || (save_every > 0 && count % save_every == 0);
+            count++;
+            last = row;
+            if(last_kept)
+                keep(row);
+        }
+
+        vector<array<double, Cols>> result() {
+            if(count > 0 && !last_kept)
+                keep(last);
+            if(sink) {
+                write_chunk();
+                sink->flush();
+                if(count > 1)
+                    res.push_back(last);
+            }
+            return std::move(res);
+        }
+};
 
 template<class RHS>
 tuple<vector<array<double, RHS::Size+1>>, vector<array<double, RHS::Size+2>>>
-solve(RHS rhs, typename RHS::State y, double tmax, double dt, double dtmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria, bool flux=false)
+solve(RHS& rhs, typename RHS::State y, double tmax, double dt, double dtmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria, bool flux=false,
+        int save_every=1, shared_ptr<TrajectorySink> sink=nullptr, int sink_id=0)
 {
-    vector<array<double, RHS::Size+1>> res = {};
+    TrajectoryRecorder<RHS::Size+1> res(save_every, sink, sink_id);
     vector<array<double, RHS::Size+2>> res_phi_hits = {};
     typedef typename RHS::State State;
     typedef typename boost::numeric::odeint::result_of::make_dense_output<runge_kutta_dopri5<State>>::type dense_stepper_type;
@@ -383,11 +590,12 @@ solve(RHS rhs, typename RHS::State y, double tmax, double dt, double dtmax, doub
     }
     double phi_current;
     boost::math::tools::eps_tolerance<double> roottol(-int(std::log2(tol)));
-    uintmax_t rootmaxit = 200;
+    const uintmax_t rootmaxit = 200;
     State temp;
     do {
-        res.push_back(join<1, RHS::Size>({t}, y));
-        tuple<double, double> step = dense.do_step(rhs);
+        res.record(join<1, RHS::Size>({t}, y));
+        // pass the right hand side by reference, odeint would otherwise copy it (and its buffers) in every step
+        tuple<double, double> step = dense.do_step(std::ref(rhs));
         iter++;
         t = dense.current_time();
         y = dense.current_state();
@@ -413,7 +621,8 @@ solve(RHS rhs, typename RHS::State y, double tmax, double dt, double dtmax, doub
                     }
                     return diff;
                 };
-                auto root = toms748_solve(rootfun, tlast, tcurrent, phi_last - phi_shift, phi_current - phi_shift, roottol, rootmaxit);
+                uintmax_t maxit = rootmaxit; // toms748_solve overwrites this with the number of iterations used
+                auto root = toms748_solve(rootfun, tlast, tcurrent, phi_last - phi_shift, phi_current - phi_shift, roottol, maxit);
                 double f0 = rootfun(root.first);
                 double f1 = rootfun(root.second);
                 double troot = std::abs(f0) < std::abs(f1) ? root.first : root.second;
@@ -438,9 +647,159 @@ solve(RHS rhs, typename RHS::State y, double tmax, double dt, double dtmax, doub
         }
         phi_last = phi_current;
     } while(t < tmax && !stop);
+    if(!stop){
+        dense.calc_state(tmax, y);
+        res.record(join<1, RHS::Size>({tmax}, y));
+    }
+    return std::make_tuple(res.result(), res_phi_hits);
+}
+
+// The planes phis[i] + 2*pi*k for all integers k, numbered in increasing
+// order of the angle. We keep track of the first plane above the current
+// angle, so that the planes crossed in a step are found in O(1) plus the
+// number of crossings, independently of the number of planes.
+class PoincarePlanes {
+    private:
+        vector<double> angles; // phis reduced to [0, 2pi) and sorted
+        vector<int> idxs; // index of angles[j] in the original phis
+        long next = 0; // number of the first plane strictly above the current angle
+
+        // plane n is angles[j] + 2*pi*k with n = k*size() + j
+        long turn(long n) const {
+            long m = angles.size();
+            return n >= 0 ? n/m : -((-n-1)/m) - 1;
+        }
+
+    public:
+        PoincarePlanes(const vector<double>& phis) {
+            vector<pair<double, int>> sorted(phis.size());
+            for (int i = 0; i < phis.size(); ++i) {
+                double phi = std::fmod(phis[i], 2*M_PI);
+                if(phi < 0)
+                    phi += 2*M_PI;
+                sorted[i] = {phi, i};
+            }
+            std::sort(sorted.begin(), sorted.end());
+            for (auto& s : sorted) {
+                angles.push_back(s.first);
+                idxs.push_back(s.second);
+            }
+        }
+
+        int size() const { return angles.size(); }
+
+        double angle(long n) const {
+            long k = turn(n);
+            return angles[n - k*size()] + 2*M_PI*k;
+        }
+
+        int index(long n) const {
+            return idxs[n - turn(n)*size()];
+        }
+
+        void init(double phi) {
+            if(size() == 0)
+                return;
+            next = size() * long(std::floor((phi - angles[0])/(2*M_PI)));
+            while(angle(next) <= phi) ++next;
+            while(angle(next-1) > phi) --next;
+        }
+
+        // Calls f(i, phi_shift) for every plane phi_shift = phis[i] + 2*pi*k in
+        // (phi_last, phi_current] (or [phi_current, phi_last) if the angle
+        // decreases), in the order in which they are crossed. This matches the
+        // crossing test in solve().
+        template<class F>
+        void crossings(double phi_last, double phi_current, F&& f) {
+            if(size() == 0)
+                return;
+            if(phi_current >= phi_last) {
+                for (; angle(next) <= phi_current; ++next)
+                    f(index(next), angle(next));
+            } else {
+                while(angle(next-1) > phi_current) {
+                    --next;
+                    f(index(next), angle(next));
+                }
+            }
+        }
+};
+
+// Same as solve(), but specialised for Poincare plots: the planes crossed in a
+// step are found via PoincarePlanes instead of testing every plane, and the
+// crossing time is found with a few Illinois (modified regula falsi) steps on
+// the dense output of the stepper instead of toms748_solve. Only the initial
+// and final state of the trajectory are returned, and the hits are written to a
+// vector that is reserved for `hits_hint` entries up front.
+template<class RHS>
+tuple<vector<array<double, RHS::Size+1>>, vector<array<double, RHS::Size+2>>>
+solve_poincare(RHS& rhs, typename RHS::State y, double tmax, double dt, double dtmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria, bool flux=false, size_t hits_hint=0)
+{
+    vector<array<double, RHS::Size+1>> res = {};
+    vector<array<double, RHS::Size+2>> res_phi_hits = {};
+    res_phi_hits.reserve(hits_hint + stopping_criteria.size());
+    typedef typename RHS::State State;
+    typedef typename boost::numeric::odeint::result_of::make_dense_output<runge_kutta_dopri5<State>>::type dense_stepper_type;
+    dense_stepper_type dense = make_dense_output(tol, tol, dtmax, runge_kutta_dopri5<State>());
+    double t = 0;
+    dense.initialize(y, t, dt);
+    res.push_back(join<1, RHS::Size>({t}, y));
+    int iter = 0;
+    bool stop = false;
+    double phi_last = flux ? y[2] : get_phi(y[0], y[1], M_PI);
+    double phi_current;
+    PoincarePlanes planes(phis);
+    planes.init(phi_last);
+    const int rootmaxit = 50;
+    State temp;
+    do {
+        tuple<double, double> step = dense.do_step(std::ref(rhs));
+        iter++;
+        t = dense.current_time();
+        y = dense.current_state();
+        phi_current = flux ? y[2] : get_phi(y[0], y[1], phi_last);
+        double tlast = std::get<0>(step);
+        double tcurrent = std::get<1>(step);
+        planes.crossings(phi_last, phi_current, [&](int i, double phi_shift) {
+            double phitol = 1e-3*tol*std::max(1., std::abs(phi_shift));
+            double a = tlast, fa = phi_last - phi_shift;
+            double b = tcurrent, fb = phi_current - phi_shift;
+            double troot = std::abs(fa) < std::abs(fb) ? a : b;
+            double froot = std::min(std::abs(fa), std::abs(fb));
+            for (int it = 0; it < rootmaxit && froot > phitol && fa != fb; ++it) {
+                double tnew = b - fb*(b-a)/(fb-fa);
+                dense.calc_state(tnew, temp);
+                double fnew = (flux ? temp[2] : get_phi(temp[0], temp[1], phi_last)) - phi_shift;
+                if((fnew < 0) != (fb < 0)) {
+                    a = b;
+                    fa = fb;
+                } else {
+                    fa *= 0.5;
+                }
+                b = tnew;
+                fb = fnew;
+                if(std::abs(fnew) < froot) {
+                    troot = tnew;
+                    froot = std::abs(fnew);
+                }
+            }
+            dense.calc_state(troot, temp);
+            res_phi_hits.push_back(join<2, RHS::Size>({troot, double(i)}, temp));
+        });
+        for (int i = 0; i < stopping_criteria.size(); ++i) {
+            if(stopping_criteria[i] && (*stopping_criteria[i])(iter, t, y[0], y[1], y[2])){
+                stop = true;
+                res_phi_hits.push_back(join<2, RHS::Size>({t, -1-double(i)}, y));
+                break;
+            }
+        }
+        phi_last = phi_current;
+    } while(t < tmax && !stop);
     if(!stop){
         dense.calc_state(tmax, y);
         res.push_back(join<1, RHS::Size>({tmax}, y));
+    } else {
+        res.push_back(join<1, RHS::Size>({t}, y));
     }
     return std::make_tuple(res, res_phi_hits);
 }
@@ -449,7 +808,8 @@ template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 5>>, vector<array<double, 6>>>
 particle_guiding_center_tracing(
         shared_ptr<MagneticField<T>> field, array<double, 3> xyz_init,
-        double m, double q, double vtotal, double vtang, double tmax, double tol, bool vacuum, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+        double m, double q, double vtotal, double vtang, double tmax, double tol, bool vacuum, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every, shared_ptr<TrajectorySink> sink, int sink_id)
 {
     typename MagneticField<T>::Tensor2 xyz({{xyz_init[0], xyz_init[1], xyz_init[2]}});
     field->set_points(xyz);
@@ -464,18 +824,376 @@ particle_guiding_center_tracing(
 
     if(vacuum){
         auto rhs_class = GuidingCenterVacuumRHS<T>(field, m, q, mu);
-        return solve(rhs_class, y, tmax, dt, dtmax, tol, phis, stopping_criteria);
+        return solve(rhs_class, y, tmax, dt, dtmax, tol, phis, stopping_criteria, false, save_every, sink, sink_id);
     }
     else
         throw std::logic_error("Guiding center right hand side currently only implemented for vacuum fields.");
 }
 
+template<template<class, std::size_t, xt::layout_type> class T>
+tuple<vector<vector<array<double, 5>>>, vector<vector<array<double, 6>>>>
+particle_guiding_center_tracing_parallel(
+        vector<shared_ptr<MagneticField<T>>> fields, vector<array<double, 3>> xyz_inits,
+        double m, double q, double vtotal, vector<double> vtangs, double tmax, double tol, bool vacuum,
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+{
+    /*
+     * Traces the particles on a pool of `fields.size()` threads. Every thread
+     * works on its own field object (since the fields cache the results of
+     * the last evaluation, they cannot be shared between threads). The
+     * particles are handed out dynamically, as some particles are lost early
+     * and finish much faster than others.
+     */
+    if(!vacuum)
+        throw std::logic_error("Guiding center right hand side currently only implemented for vacuum fields.");
+    if(xyz_inits.size() != vtangs.size())
+        throw std::invalid_argument("xyz_inits and vtangs need to have the same length.");
+    if(fields.size() == 0)
+        throw std::invalid_argument("Need at least one field.");
+    for (int i = 0; i < stopping_criteria.size(); ++i) {
+        // this criterion stores the history of a single particle and hence
+        // cannot be shared between particles that are traced simultaneously.
+        if(std::dynamic_pointer_cast<ToroidalTransitStoppingCriterion>(stopping_criteria[i]))
+            throw std::invalid_argument("ToroidalTransitStoppingCriterion is not supported for parallel tracing.");
+    }
+    int nparticles = xyz_inits.size();
+    int nthreads = fields.size();
+    vector<vector<array<double, 5>>> res_tys(nparticles);
+    vector<vector<array<double, 6>>> res_phi_hits(nparticles);
+    if(nparticles == 0)
+        return std::make_tuple(res_tys, res_phi_hits);
+
+    // The tensors used by the fields are numpy arrays, which may only be
+    // created and destroyed while holding the GIL. Hence we create all
+    // per thread objects here and evaluate the right hand side once, so that
+    // all caches of the fields have the right shape and are not reallocated
+    // while tracing.
+    vector<typename MagneticField<T>::Tensor2> xyzs;
+    vector<GuidingCenterVacuumRHS<T>> rhss;
+    xyzs.reserve(nthreads);
+    rhss.reserve(nthreads);
+    for (int i = 0; i < nthreads; ++i) {
+        xyzs.push_back(xt::zeros<double>({1, 3}));
+        for (int l = 0; l < 3; ++l)
+            xyzs[i](0, l) = xyz_inits[0][l];
+        fields[i]->set_points(xyzs[i]);
+        fields[i]->AbsB_ref();
+        rhss.emplace_back(fields[i], m, q, 0.);
+        array<double, 4> y = {xyz_inits[0][0], xyz_inits[0][1], xyz_inits[0][2], vtangs[0]};
+        array<double, 4> dydt;
+        rhss[i](y, dydt, 0.);
+    }
+
+    std::exception_ptr eptr = nullptr;
+    {
+        py::gil_scoped_release release;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (int p = 0; p < nparticles; ++p) {
+#if defined(_OPENMP)
+            int tid = omp_get_thread_num();
+#else
+            int tid = 0;
+#endif
+            try {
+                auto& field = fields[tid];
+                auto& xyz = xyzs[tid];
+                for (int l = 0; l < 3; ++l)
+                    xyz(0, l) = xyz_inits[p][l];
+                field->set_points(xyz);
+                double AbsB = field->AbsB_ref()(0);
+                double vperp2 = vtotal*vtotal - vtangs[p]*vtangs[p];
+                rhss[tid].set_mu(vperp2/(2*AbsB));
+
+                array<double, 4> y = {xyz_inits[p][0], xyz_inits[p][1], xyz_inits[p][2], vtangs[p]};
+                double r0 = std::sqrt(xyz_inits[p][0]*xyz_inits[p][0] + xyz_inits[p][1]*xyz_inits[p][1]);
+                double dtmax = r0*0.5*M_PI/vtotal; // can at most do quarter of a revolution per step
+                double dt = 1e-3 * dtmax; // initial guess for first timestep, will be adjusted by adaptive timestepper
+                auto res = solve(rhss[tid], y, tmax, dt, dtmax, tol, phis, stopping_criteria);
+                res_tys[p] = std::move(std::get<0>(res));
+                res_phi_hits[p] = std::move(std::get<1>(res));
+            } catch (...) {
+#pragma omp critical
+                eptr = std::current_exception();
+            }
+        }
+    }
+    if(eptr)
+        std::rethrow_exception(eptr);
+    return std::make_tuple(res_tys, res_phi_hits);
+}
+
+template
+tuple<vector<vector<array<double, 5>>>, vector<vector<array<double, 6>>>> particle_guiding_center_tracing_parallel<xt::pytensor>(
+        vector<shared_ptr<MagneticField<xt::pytensor>>> fields, vector<array<double, 3>> xyz_inits,
+        double m, double q, double vtotal, vector<double> vtangs, double tmax, double tol, bool vacuum,
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+
+// Coefficients of the Dormand-Prince 5(4) method, see Hairer, Norsett,
+// Wanner: Solving Ordinary Differential Equations I, Table 5.2. These match
+// the `runge_kutta_dopri5` stepper used by `solve`.
+namespace dopri5 {
+    constexpr double a[7][6] = {
+        {0., 0., 0., 0., 0., 0.},
+        {1./5, 0., 0., 0., 0., 0.},
+        {3./40, 9./40, 0., 0., 0., 0.},
+        {44./45, -56./15, 32./9, 0., 0., 0.},
+        {19372./6561, -25360./2187, 64448./6561, -212./729, 0., 0.},
+        {9017./3168, -355./33, 46732./5247, 49./176, -5103./18656, 0.},
+        {35./384, 0., 500./1113, 125./192, -2187./6784, 11./84}
+    };
+    // difference between the fifth and the embedded fourth order solution
+    constexpr double e[7] = {
+        35./384 - 5179./57600, 0., 500./1113 - 7571./16695, 125./192 - 393./640,
+        -2187./6784 + 92097./339200, 11./84 - 187./2100, -1./40
+    };
+}
+
+template<int Size>
+struct BatchParticle {
+    using State = std::array<double, Size>;
+    State y, y_old;
+    std::array<State, 7> k;
+    double t = 0., t_old = 0., dt, dtmax, mu, phi_last;
+    int iter = 0;
+    bool done = false;
+    vector<array<double, Size+1>> res;
+    vector<array<double, Size+2>> res_phi_hits;
+
+    // Continuous extension of the last accepted step (same interpolant as
+    // boost's `runge_kutta_dopri5::calc_state`).
+    void calc_state(double tau, State& out) const {
+        const double b1 = 35./384, b3 = 500./1113, b4 = 125./192, b5 = -2187./6784, b6 = 11./84;
+        double h = t - t_old;
+        double theta = (tau - t_old)/h;
+        double X1 = 5.*(2558722523. - 31403016.*theta)/11282082432.;
+        double X3 = 100.*(882725551. - 15701508.*theta)/32700410799.;
+        double X4 = 25.*(443332067. - 31403016.*theta)/1880347072.;
+        double X5 = 32805.*(23143187. - 3489224.*theta)/199316789632.;
+        double X6 = 55.*(29972135. - 7076736.*theta)/822651844.;
+        double X7 = 10.*(7414447. - 829305.*theta)/29380423.;
+        double theta_m_1 = theta - 1;
+        double theta_sq = theta*theta;
+        double A = theta_sq*(3 - 2*theta);
+        double B = theta_sq*theta_m_1;
+        double C = theta_sq*theta_m_1*theta_m_1;
+        double D = theta*theta_m_1*theta_m_1;
+        double b1_theta = A*b1 - C*X1 + D;
+        double b3_theta = A*b3 + C*X3;
+        double b4_theta = A*b4 - C*X4;
+        double b5_theta = A*b5 + C*X5;
+        double b6_theta = A*b6 - C*X6;
+        double b7_theta = B + C*X7;
+        for (int l = 0; l < Size; ++l) {
+            out[l] = y_old[l] + h*(b1_theta*k[0][l] + b3_theta*k[2][l] + b4_theta*k[3][l]
+                    + b5_theta*k[4][l] + b6_theta*k[5][l] + b7_theta*k[6][l]);
+        }
+    }
+};
+
+template<class RHS>
+vector<BatchParticle<RHS::Size>>
+solve_batch(RHS& rhs, vector<typename BatchParticle<RHS::Size>::State> ys, vector<double> mus, vector<double> dts, vector<double> dtmaxs,
+        double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+{
+    /*
+     * Integrates all particles simultaneously using the Dormand-Prince 5(4)
+     * method with the same adaptive step size control as `solve`. All
+     * particles that are still being traced take a step at the same time,
+     * but each particle has its own time and step size: particles whose
+     * step is rejected simply retry with a smaller step in the next sweep,
+     * and particles that are lost or reach tmax are removed from the batch.
+     * This way each stage of the Runge-Kutta method requires only a single
+     * evaluation of the field for the whole batch.
+     */
+    constexpr int Size = RHS::Size;
+    using State = typename BatchParticle<Size>::State;
+    int nparticles = ys.size();
+    vector<BatchParticle<Size>> particles(nparticles);
+    vector<int> active(nparticles);
+    for (int p = 0; p < nparticles; ++p) {
+        particles[p].y = ys[p];
+        particles[p].mu = mus[p];
+        particles[p].dt = dts[p];
+        particles[p].dtmax = dtmaxs[p];
+        particles[p].phi_last = get_phi(ys[p][0], ys[p][1], M_PI);
+        active[p] = p;
+    }
+    vector<AlignedPaddedVec> stage(Size, AlignedPaddedVec(nparticles, 0.));
+    vector<AlignedPaddedVec> dstage(Size, AlignedPaddedVec(nparticles, 0.));
+    AlignedPaddedVec mu(nparticles, 0.);
+    auto eval = [&](int s) {
+        // evaluate the right hand side at the s-th stage for all active particles
+        int n = active.size();
+        for (int a = 0; a < n; ++a) {
+            auto& P = particles[active[a]];
+            for (int l = 0; l < Size; ++l) {
+                double yl = P.y[l];
+                for (int j = 0; j < s; ++j)
+                    yl += P.dt * dopri5::a[s][j] * P.k[j][l];
+                stage[l][a] = yl;
+            }
+            mu[a] = P.mu;
+        }
+        rhs(n, stage.data(), mu, dstage.data());
+        for (int a = 0; a < n; ++a) {
+            auto& P = particles[active[a]];
+            for (int l = 0; l < Size; ++l)
+                P.k[s][l] = dstage[l][a];
+        }
+    };
+
+    boost::math::tools::eps_tolerance<double> roottol(-int(std::log2(tol)));
+    const uintmax_t rootmaxit = 200;
+    eval(0);
+    while(active.size() > 0) {
+        for(int p : active) {
+            particles[p].dt = std::min(particles[p].dt, particles[p].dtmax);
+            if(particles[p].iter == 0 && particles[p].res.size() == 0)
+                particles[p].res.push_back(join<1, Size>({particles[p].t}, particles[p].y));
+        }
+        for (int s = 1; s < 7; ++s)
+            eval(s);
+        vector<int> still_active;
+        for(int p : active) {
+            auto& P = particles[p];
+            // the seventh stage is evaluated at the new (fifth order) state
+            State ynew;
+            double err = 0.;
+            for (int l = 0; l < Size; ++l) {
+                ynew[l] = P.y[l];
+                double xerr = 0.;
+                for (int j = 0; j < 6; ++j)
+                    ynew[l] += P.dt * dopri5::a[6][j] * P.k[j][l];
+                for (int j = 0; j < 7; ++j)
+                    xerr += P.dt * dopri5::e[j] * P.k[j][l];
+                err = std::max(err, std::abs(xerr)/(tol + tol*(std::abs(P.y[l]) + std::abs(P.dt)*std::abs(P.k[0][l]))));
+            }
+            if(err > 1.) {
+                P.dt *= std::max(0.9*std::pow(err, -1./3.), 0.2);
+                still_active.push_back(p);
+                continue;
+            }
+            P.y_old = P.y;
+            P.t_old = P.t;
+            P.y = ynew;
+            P.t += P.dt;
+            if(err < 0.5) {
+                err = std::max(std::pow(5.0, -5.), err);
+                P.dt *= 0.9*std::pow(err, -1./5.);
+            }
+            P.iter++;
+            State k7 = P.k[6];
+            bool stop = false;
+            double phi_current = get_phi(P.y[0], P.y[1], P.phi_last);
+            double phi_last = P.phi_last;
+            State temp;
+            for (int i = 0; i < phis.size(); ++i) {
+                double phi = phis[i];
+                if(std::floor((phi_last-phi)/(2*M_PI)) != std::floor((phi_current-phi)/(2*M_PI))){
+                    int fak = std::round(((phi_last+phi_current)/2-phi)/(2*M_PI));
+                    double phi_shift = fak*2*M_PI + phi;
+                    std::function<double(double)> rootfun = [&P, &phi_shift, &temp, &phi_last](double t){
+                        P.calc_state(t, temp);
+                        return get_phi(temp[0], temp[1], phi_last)-phi_shift;
+                    };
+                    uintmax_t maxit = rootmaxit;
+                    auto root = toms748_solve(rootfun, P.t_old, P.t, phi_last - phi_shift, phi_current - phi_shift, roottol, maxit);
+                    double f0 = rootfun(root.first);
+                    double f1 = rootfun(root.second);
+                    double troot = std::abs(f0) < std::abs(f1) ? root.first : root.second;
+                    P.calc_state(troot, temp);
+                    P.res_phi_hits.push_back(join<2, Size>({troot, double(i)}, temp));
+                }
+            }
+            for (int i = 0; i < stopping_criteria.size(); ++i) {
+                if(stopping_criteria[i] && (*stopping_criteria[i])(P.iter, P.t, P.y[0], P.y[1], P.y[2])){
+                    stop = true;
+                    P.res_phi_hits.push_back(join<2, Size>({P.t, -1-double(i)}, P.y));
+                    break;
+                }
+            }
+            P.phi_last = phi_current;
+            if(stop) {
+                P.done = true;
+            } else if(P.t >= tmax) {
+                P.calc_state(tmax, temp);
+                P.res.push_back(join<1, Size>({tmax}, temp));
+                P.done = true;
+            } else {
+                P.res.push_back(join<1, Size>({P.t}, P.y));
+                // first same as last: the derivative at the new state is already known
+                P.k[0] = k7;
+                still_active.push_back(p);
+            }
+        }
+        active = still_active;
+    }
+    return particles;
+}
+
+template<template<class, std::size_t, xt::layout_type> class T>
+tuple<vector<vector<array<double, 5>>>, vector<vector<array<double, 6>>>>
+particle_guiding_center_tracing_batch(
+        shared_ptr<MagneticField<T>> field, vector<array<double, 3>> xyz_inits,
+        double m, double q, double vtotal, vector<double> vtangs, double tmax, double tol, bool vacuum,
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+{
+    if(!vacuum)
+        throw std::logic_error("Guiding center right hand side currently only implemented for vacuum fields.");
+    if(xyz_inits.size() != vtangs.size())
+        throw std::invalid_argument("xyz_inits and vtangs need to have the same length.");
+    for (int i = 0; i < stopping_criteria.size(); ++i) {
+        // this criterion stores the history of a single particle and hence
+        // cannot be shared between particles that are traced simultaneously.
+        if(std::dynamic_pointer_cast<ToroidalTransitStoppingCriterion>(stopping_criteria[i]))
+            throw std::invalid_argument("ToroidalTransitStoppingCriterion is not supported for batched tracing.");
+    }
+    int nparticles = xyz_inits.size();
+    if(nparticles == 0)
+        return std::make_tuple(vector<vector<array<double, 5>>>(), vector<vector<array<double, 6>>>());
+
+    typename MagneticField<T>::Tensor2 xyz = xt::zeros<double>({nparticles, 3});
+    for (int p = 0; p < nparticles; ++p) {
+        for (int l = 0; l < 3; ++l)
+            xyz(p, l) = xyz_inits[p][l];
+    }
+    field->set_points(xyz);
+    auto& AbsB = field->AbsB_ref();
+    vector<array<double, 4>> ys(nparticles);
+    vector<double> mus(nparticles), dts(nparticles), dtmaxs(nparticles);
+    for (int p = 0; p < nparticles; ++p) {
+        double vperp2 = vtotal*vtotal - vtangs[p]*vtangs[p];
+        mus[p] = vperp2/(2*AbsB(p, 0));
+        ys[p] = {xyz_inits[p][0], xyz_inits[p][1], xyz_inits[p][2], vtangs[p]};
+        double r0 = std::sqrt(xyz_inits[p][0]*xyz_inits[p][0] + xyz_inits[p][1]*xyz_inits[p][1]);
+        dtmaxs[p] = r0*0.5*M_PI/vtotal; // can at most do quarter of a revolution per step
+        dts[p] = 1e-3 * dtmaxs[p]; // initial guess for first timestep, will be adjusted by adaptive timestepper
+    }
+
+    auto rhs_class = GuidingCenterVacuumBatchRHS<T>(field, m, q, nparticles);
+    auto particles = solve_batch(rhs_class, ys, mus, dts, dtmaxs, tmax, tol, phis, stopping_criteria);
+    vector<vector<array<double, 5>>> res_tys(nparticles);
+    vector<vector<array<double, 6>>> res_phi_hits(nparticles);
+    for (int p = 0; p < nparticles; ++p) {
+        res_tys[p] = std::move(particles[p].res);
+        res_phi_hits[p] = std::move(particles[p].res_phi_hits);
+    }
+    return std::make_tuple(res_tys, res_phi_hits);
+}
+
+template
+tuple<vector<vector<array<double, 5>>>, vector<vector<array<double, 6>>>> particle_guiding_center_tracing_batch<xt::pytensor>(
+        shared_ptr<MagneticField<xt::pytensor>> field, vector<array<double, 3>> xyz_inits,
+        double m, double q, double vtotal, vector<double> vtangs, double tmax, double tol, bool vacuum,
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 5>>, vector<array<double, 6>>>
 particle_guiding_center_boozer_tracing(
         shared_ptr<BoozerMagneticField<T>> field, array<double, 3> stz_init,
         double m, double q, double vtotal, double vtang, double tmax, double tol,
-        bool vacuum, bool noK, vector<double> zetas, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+        bool vacuum, bool noK, vector<double> zetas, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every, shared_ptr<TrajectorySink> sink, int sink_id)
 {
     typename BoozerMagneticField<T>::Tensor2 stz({{stz_init[0], stz_init[1], stz_init[2]}});
     field->set_points(stz);
@@ -491,13 +1209,13 @@ particle_guiding_center_boozer_tracing(
 
     if (vacuum) {
       auto rhs_class = GuidingCenterVacuumBoozerRHS<T>(field, m, q, mu);
-      return solve(rhs_class, y, tmax, dt, dtmax, tol, zetas, stopping_criteria, true);
+      return solve(rhs_class, y, tmax, dt, dtmax, tol, zetas, stopping_criteria, true, save_every, sink, sink_id);
     } else if (noK) {
       auto rhs_class = GuidingCenterNoKBoozerRHS<T>(field, m, q, mu);
-      return solve(rhs_class, y, tmax, dt, dtmax, tol, zetas, stopping_criteria, true);
+      return solve(rhs_class, y, tmax, dt, dtmax, tol, zetas, stopping_criteria, true, save_every, sink, sink_id);
     } else {
       auto rhs_class = GuidingCenterBoozerRHS<T>(field, m, q, mu);
-      return solve(rhs_class, y, tmax, dt, dtmax, tol, zetas, stopping_criteria, true);
+      return solve(rhs_class, y, tmax, dt, dtmax, tol, zetas, stopping_criteria, true, save_every, sink, sink_id);
     }
 }
 
@@ -505,20 +1223,23 @@ template
 tuple<vector<array<double, 5>>, vector<array<double, 6>>> particle_guiding_center_boozer_tracing<xt::pytensor>(
         shared_ptr<BoozerMagneticField<xt::pytensor>> field, array<double, 3> stz_init,
         double m, double q, double vtotal, double vtang, double tmax, double tol,
-        bool vacuum, bool noK, vector<double> zetas, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+        bool vacuum, bool noK, vector<double> zetas, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every, shared_ptr<TrajectorySink> sink, int sink_id);
 
 template
 tuple<vector<array<double, 5>>, vector<array<double, 6>>> particle_guiding_center_tracing<xt::pytensor>(
         shared_ptr<MagneticField<xt::pytensor>> field, array<double, 3> xyz_init,
         double m, double q, double vtotal, double vtang, double tmax, double tol, bool vacuum,
-        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every, shared_ptr<TrajectorySink> sink, int sink_id);
 
 
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 7>>, vector<array<double, 8>>>
 particle_fullorbit_tracing(
         shared_ptr<MagneticField<T>> field, array<double, 3> xyz_init, array<double, 3> v_init,
-        double m, double q, double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+        double m, double q, double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every, shared_ptr<TrajectorySink> sink, int sink_id)
 {
 
     auto rhs_class = FullorbitRHS<T>(field, m, q);
@@ -529,20 +1250,24 @@ particle_fullorbit_tracing(
     double dtmax = r0*0.5*M_PI/vtotal; // can at most do quarter of a revolution per step
     double dt = 1e-3 * dtmax; // initial guess for first timestep, will be adjusted by adaptive timestepper
 
-    return solve(rhs_class, y, tmax, dt, dtmax, tol, phis, stopping_criteria);
+    return solve(rhs_class, y, tmax, dt, dtmax, tol, phis, stopping_criteria, false, save_every, sink, sink_id);
 }
 
 template
 tuple<vector<array<double, 7>>, vector<array<double, 8>>> particle_fullorbit_tracing<xt::pytensor>(
         shared_ptr<MagneticField<xt::pytensor>> field, array<double, 3> xyz_init, array<double, 3> v_init,
-        double m, double q, double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+        double m, double q, double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every, shared_ptr<TrajectorySink> sink, int sink_id);
 
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 4>>, vector<array<double, 5>>>
 fieldline_tracing(
     shared_ptr<MagneticField<T>> field, array<double, 3> xyz_init,
-    double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria)
+    double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria, bool poincare,
+    int save_every, shared_ptr<TrajectorySink> sink, int sink_id)
 {
+    if(poincare && (save_every != 1 || sink))
+        throw std::invalid_argument("save_every and sink cannot be used with poincare=true, since no trajectory is recorded.");
     auto rhs_class = FieldlineRHS<T>(field);
     double r0 = std::sqrt(xyz_init[0]*xyz_init[0] + xyz_init[1]*xyz_init[1]);
     typename MagneticField<T>::Tensor2 xyz({{xyz_init[0], xyz_init[1], xyz_init[2]}});
@@ -550,11 +1275,19 @@ fieldline_tracing(
     double AbsB = field->AbsB_ref()(0);
     double dtmax = r0*0.5*M_PI/AbsB; // can at most do quarter of a revolution per step
     double dt = 1e-5 * dtmax; // initial guess for first timestep, will be adjusted by adaptive timestepper
-    return solve(rhs_class, xyz_init, tmax, dt, dtmax, tol, phis, stopping_criteria);
+    if(poincare){
+        // the field line does roughly |B|*tmax/(2*pi*r0) revolutions, reserve
+        // space for the hits accordingly (but don't go overboard)
+        double revolutions = AbsB*tmax/(2*M_PI*r0);
+        size_t hits_hint = std::min(1.1*phis.size()*(revolutions + 1), 1e7);
+        return solve_poincare(rhs_class, xyz_init, tmax, dt, dtmax, tol, phis, stopping_criteria, false, hits_hint);
+    }
+    return solve(rhs_class, xyz_init, tmax, dt, dtmax, tol, phis, stopping_criteria, false, save_every, sink, sink_id);
 }
 
 template
 tuple<vector<array<double, 4>>, vector<array<double, 5>>>
 fieldline_tracing(
     shared_ptr<MagneticField<xt::pytensor>> field, array<double, 3> xyz_init,
-    double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+    double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria, bool poincare,
+    int save_every, shared_ptr<TrajectorySink> sink, int sink_id);
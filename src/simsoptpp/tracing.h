@@ -1,6 +1,12 @@
 #pragma once
 #include <memory>
 #include <vector>
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <functional>
+#include <stdexcept>
+#include <cstdint>
 #include "magneticfield.h"
 #include "boozermagneticfield.h"
 #include "regular_grid_interpolant_3d.h"
@@ -91,28 +97,101 @@ class LevelsetStoppingCriterion : public StoppingCriterion{
         };
 };
 
+// Receives the stored states of a trajectory in chunks, see the `save_every`
+// and `sink` arguments of the tracing functions. Each row of a chunk contains
+// the time followed by the state.
+class TrajectorySink {
+    public:
+        // `data` contains `nrows` rows of `ncols` doubles of the trajectory with the given id.
+        virtual void write(int id, const double* data, int nrows, int ncols) = 0;
+        virtual void flush() {}
+        virtual ~TrajectorySink() {}
+};
+
+// Appends the chunks to a binary file. Each chunk is stored as three int64
+// (id, nrows, ncols) followed by the nrows*ncols doubles in row major order.
+class BinaryFileTrajectorySink : public TrajectorySink {
+    private:
+        std::ofstream file;
+        std::mutex mutex;
+    public:
+        BinaryFileTrajectorySink(std::string filename, bool append=false)
+            : file(filename, std::ios::binary | (append ? std::ios::app : std::ios::trunc)) {
+            if(!file)
+                throw std::runtime_error("Could not open " + filename + " for writing.");
+        }
+        void write(int id, const double* data, int nrows, int ncols) override {
+            std::lock_guard<std::mutex> lock(mutex);
+            int64_t header[3] = {id, nrows, ncols};
+            file.write(reinterpret_cast<const char*>(header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data), sizeof(double)*nrows*ncols);
+            if(!file)
+                throw std::runtime_error("Writing the trajectory failed.");
+        }
+        void flush() override {
+            std::lock_guard<std::mutex> lock(mutex);
+            file.flush();
+        }
+        void close() {
+            std::lock_guard<std::mutex> lock(mutex);
+            file.close();
+        }
+};
+
+// Passes each chunk as a (nrows, ncols) array to a callback.
+template<class Array>
+class CallbackTrajectorySink : public TrajectorySink {
+    private:
+        std::function<void(int, Array&)> callback;
+    public:
+        CallbackTrajectorySink(std::function<void(int, Array&)> callback) : callback(callback) { };
+        void write(int id, const double* data, int nrows, int ncols) override {
+            Array chunk = xt::zeros<double>({nrows, ncols});
+            std::copy(data, data + nrows*ncols, chunk.data());
+            callback(id, chunk);
+        }
+};
+
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 5>>, vector<array<double, 6>>>
 particle_guiding_center_boozer_tracing(
         shared_ptr<BoozerMagneticField<T>> field, array<double, 3> stz_init,
         double m, double q, double vtotal, double vtang, double tmax, double tol,
-        bool vacuum, bool noK, vector<double> zetas, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+        bool vacuum, bool noK, vector<double> zetas, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every=1, shared_ptr<TrajectorySink> sink=nullptr, int sink_id=0);
 
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 5>>, vector<array<double, 6>>>
 particle_guiding_center_tracing(
         shared_ptr<MagneticField<T>> field, array<double, 3> xyz_init,
         double m, double q, double vtotal, double vtang, double tmax, double tol, bool vacuum,
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every=1, shared_ptr<TrajectorySink> sink=nullptr, int sink_id=0);
+
+template<template<class, std::size_t, xt::layout_type> class T>
+tuple<vector<vector<array<double, 5>>>, vector<vector<array<double, 6>>>>
+particle_guiding_center_tracing_parallel(
+        vector<shared_ptr<MagneticField<T>>> fields, vector<array<double, 3>> xyz_inits,
+        double m, double q, double vtotal, vector<double> vtangs, double tmax, double tol, bool vacuum,
+        vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+
+template<template<class, std::size_t, xt::layout_type> class T>
+tuple<vector<vector<array<double, 5>>>, vector<vector<array<double, 6>>>>
+particle_guiding_center_tracing_batch(
+        shared_ptr<MagneticField<T>> field, vector<array<double, 3>> xyz_inits,
+        double m, double q, double vtotal, vector<double> vtangs, double tmax, double tol, bool vacuum,
         vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
 
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 7>>, vector<array<double, 8>>>
 particle_fullorbit_tracing(
         shared_ptr<MagneticField<T>> field, array<double, 3> xyz_init, array<double, 3> v_init,
-        double m, double q, double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+        double m, double q, double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria,
+        int save_every=1, shared_ptr<TrajectorySink> sink=nullptr, int sink_id=0);
 
 template<template<class, std::size_t, xt::layout_type> class T>
 tuple<vector<array<double, 4>>, vector<array<double, 5>>>
 fieldline_tracing(
         shared_ptr<MagneticField<T>> field, array<double, 3> xyz_init,
-        double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria);
+        double tmax, double tol, vector<double> phis, vector<shared_ptr<StoppingCriterion>> stopping_criteria, bool poincare=false,
+        int save_every=1, shared_ptr<TrajectorySink> sink=nullptr, int sink_id=0);
@@ -4,7 +4,9 @@ import numpy as np
 
 from simsopt.geo.curvexyzfourier import CurveXYZFourier
 from simsopt.field.biotsavart import BiotSavart
-from simsopt.field.coil import Coil, Current, ScaledCurrent
+from simsopt.field.coil import Coil, Current, ScaledCurrent, coils_via_symmetries
+from simsopt.geo.surfacerzfourier import SurfaceRZFourier
+from simsopt.configs import get_ncsx_data
 
 
 def get_curve(num_quadrature_points=200, perturb=False):
@@ -438,6 +440,184 @@ class Testing(unittest.TestCase):
         assert np.linalg.norm(dJ[0]-dJ_approx) < 1e-15
         assert np.linalg.norm(dH[0]-dH_approx) < 1e-15
 
+    def test_biotsavart_tree_evaluation(self):
+        np.random.seed(1)
+        coils = [Coil(get_curve(perturb=True), Current(1e4)) for i in range(4)]
+        bs = BiotSavart(coils)
+        points = np.random.uniform(low=-3, high=3, size=(200, 3))
+        bs.set_points(points)
+        B, dB, ddB = bs.B(), bs.dB_by_dX(), bs.d2B_by_dXdX()
+        A, dA, ddA = bs.A(), bs.dA_by_dX(), bs.d2A_by_dXdX()
+        errs = []
+        for theta in [0.5, 0.3]:
+            bs.set_tree_evaluation(theta, 4)
+            assert bs.get_tree_theta() == theta
+            Btree = bs.B()
+            errs.append(np.linalg.norm(B-Btree)/np.linalg.norm(B))
+            assert errs[-1] < 1e-2
+            assert np.linalg.norm(dB-bs.dB_by_dX()) < 1e-2 * np.linalg.norm(dB)
+            assert np.linalg.norm(ddB-bs.d2B_by_dXdX()) < 1e-2 * np.linalg.norm(ddB)
+            assert np.linalg.norm(A-bs.A()) < 1e-2 * np.linalg.norm(A)
+            assert np.linalg.norm(dA-bs.dA_by_dX()) < 1e-2 * np.linalg.norm(dA)
+            assert np.linalg.norm(ddA-bs.d2A_by_dXdX()) < 1e-2 * np.linalg.norm(ddA)
+        # smaller opening angles are more accurate
+        assert errs[1] < errs[0]
+        # the tree field is still the curl of the tree vector potential
+        dA_tree = bs.dA_by_dX()
+        curlA = np.stack((dA_tree[:, 1, 2] - dA_tree[:, 2, 1],
+                          dA_tree[:, 2, 0] - dA_tree[:, 0, 2],
+                          dA_tree[:, 0, 1] - dA_tree[:, 1, 0]), axis=1)
+        assert np.allclose(curlA, bs.B(), rtol=1e-2, atol=1e-2*np.max(np.abs(B)))
+        bs.set_tree_evaluation(0.)
+        assert np.allclose(bs.B(), B)
+
+    def test_biotsavart_incremental_recompute(self):
+        """
+        Only the fields of coils that changed are recomputed; check that the
+        result always agrees with a fresh BiotSavart object.
+        """
+        np.random.seed(1)
+        coils = [Coil(get_curve(perturb=True), Current(1e4)) for i in range(4)]
+        bs = BiotSavart(coils)
+        points = np.random.uniform(low=-3, high=3, size=(50, 3))
+        bs.set_points(points)
+
+        def check():
+            bs_ref = BiotSavart(coils).set_points(points)
+            assert np.allclose(bs.B(), bs_ref.B(), rtol=1e-14, atol=1e-14)
+            assert np.allclose(bs.dB_by_dX(), bs_ref.dB_by_dX(), rtol=1e-14, atol=1e-14)
+            assert np.allclose(bs.A(), bs_ref.A(), rtol=1e-14, atol=1e-14)
+            for B_i, B_i_ref in zip(bs.dB_by_dcoilcurrents(), bs_ref.dB_by_dcoilcurrents()):
+                assert np.allclose(B_i, B_i_ref, rtol=1e-14, atol=1e-14)
+
+        check()
+        # change the shape of a single coil
+        coils[2].curve.x = coils[2].curve.x + 0.01 * np.random.uniform(size=coils[2].curve.x.shape)
+        check()
+        # change only a current
+        coils[1].current.x = coils[1].current.x * 2
+        check()
+        # change the points
+        points = np.random.uniform(low=-3, high=3, size=(50, 3))
+        bs.set_points(points)
+        check()
+
+    def test_biotsavart_symmetry_evaluation(self):
+        """
+        Check that computing the field of each coil from its base curve gives
+        the same field and derivatives, both on points that are invariant under
+        the symmetries and on random points.
+        """
+        np.random.seed(1)
+        base_curves, base_currents, _ = get_ncsx_data(Nt_coils=5)
+        nfp = 3
+        coils = coils_via_symmetries(base_curves, base_currents, nfp, True)
+        s = SurfaceRZFourier.from_nphi_ntheta(nphi=24, ntheta=8, range="full torus", nfp=nfp, stellsym=True)
+        s.set_rc(0, 0, 1.55)
+        s.set_rc(1, 0, 0.2)
+        s.set_zs(1, 0, 0.2)
+        symmetric_points = s.gamma().reshape((-1, 3))
+        random_points = np.random.uniform(low=-1.5, high=1.5, size=(40, 3))
+        for points in [symmetric_points, random_points]:
+            bs = BiotSavart(coils).set_points(points)
+            bs_sym = BiotSavart(coils).set_points(points)
+            bs_sym.set_symmetry_evaluation(True)
+            assert np.allclose(bs.B(), bs_sym.B(), rtol=1e-12, atol=1e-14)
+            assert np.allclose(bs.dB_by_dX(), bs_sym.dB_by_dX(), rtol=1e-12, atol=1e-12)
+            assert np.allclose(bs.d2B_by_dXdX(), bs_sym.d2B_by_dXdX(), rtol=1e-12, atol=1e-10)
+            assert np.allclose(bs.A(), bs_sym.A(), rtol=1e-12, atol=1e-14)
+            assert np.allclose(bs.dA_by_dX(), bs_sym.dA_by_dX(), rtol=1e-12, atol=1e-12)
+
+            v = np.random.standard_normal(size=(len(points), 3))
+            vgrad = np.random.standard_normal(size=(len(points), 3, 3))
+            assert np.allclose(bs.B_vjp(v)(bs), bs_sym.B_vjp(v)(bs), rtol=1e-10, atol=1e-14)
+            for d, d_sym in zip(bs.B_and_dB_vjp(v, vgrad), bs_sym.B_and_dB_vjp(v, vgrad)):
+                assert np.allclose(d(bs), d_sym(bs), rtol=1e-10, atol=1e-14)
+            assert np.allclose(bs.A_vjp(v)(bs), bs_sym.A_vjp(v)(bs), rtol=1e-10, atol=1e-14)
+
+            # the field follows changes of the base curves
+            base_curves[0].x = base_curves[0].x + 1e-3
+            assert np.allclose(bs.B(), bs_sym.B(), rtol=1e-12, atol=1e-14)
+            bs_sym.set_symmetry_evaluation(False)
+            assert np.allclose(bs.B(), bs_sym.B(), rtol=1e-12, atol=1e-14)
+
+    def test_biotsavart_precision(self):
+        np.random.seed(1)
+        coils = [Coil(get_curve(perturb=True), Current(1e4)) for i in range(4)]
+        points = np.random.uniform(low=-3, high=3, size=(201, 3))
+        bs = BiotSavart(coils).set_points(points)
+        assert bs.get_precision() == "double"
+        B, dB, ddB = bs.B(), bs.dB_by_dX(), bs.d2B_by_dXdX()
+        from simsoptpp import biot_savart_B
+        gammas = [c.curve.gamma() for c in coils]
+        gammadashs = [c.curve.gammadash() for c in coils]
+        currents = [c.current.get_value() for c in coils]
+        for precision in ["mixed", "single"]:
+            bs_prec = BiotSavart(coils).set_points(points)
+            bs_prec.set_precision(precision)
+            assert bs_prec.get_precision() == precision
+            assert np.linalg.norm(bs_prec.B()-B) < 1e-5 * np.linalg.norm(B)
+            assert np.linalg.norm(bs_prec.dB_by_dX()-dB) < 1e-5 * np.linalg.norm(dB)
+            assert not np.array_equal(bs_prec.B(), B)
+            # second derivatives are always computed in double precision
+            assert np.allclose(bs_prec.d2B_by_dXdX(), ddB, rtol=1e-5, atol=1e-5*np.max(np.abs(ddB)))
+            B2 = biot_savart_B(points, gammas, gammadashs, currents, precision=precision)
+            assert np.linalg.norm(B2-B) < 1e-5 * np.linalg.norm(B)
+        bs.set_precision("single")
+        bs.set_precision("double")
+        assert np.allclose(bs.B(), B, rtol=1e-14, atol=1e-14)
+        with self.assertRaises(RuntimeError):
+            bs.set_precision("half")
+
+    def test_biotsavart_fused_evaluation(self):
+        np.random.seed(1)
+        coils = [Coil(get_curve(perturb=True), Current(1e4)) for i in range(3)]
+        # not a multiple of the tile size
+        points = np.random.uniform(low=-3, high=3, size=(601, 3))
+        bs = BiotSavart(coils).set_points(points)
+        bs_fused = BiotSavart(coils).set_points(points)
+        bs_fused.set_fused_evaluation(True)
+        assert bs_fused.get_fused_evaluation()
+        assert np.allclose(bs.B(), bs_fused.B(), rtol=1e-13, atol=1e-14)
+        assert np.allclose(bs.dB_by_dX(), bs_fused.dB_by_dX(), rtol=1e-13, atol=1e-13)
+        assert np.allclose(bs.d2B_by_dXdX(), bs_fused.d2B_by_dXdX(), rtol=1e-13, atol=1e-12)
+        assert np.allclose(bs.A(), bs_fused.A(), rtol=1e-13, atol=1e-14)
+        assert np.allclose(bs.dA_by_dX(), bs_fused.dA_by_dX(), rtol=1e-13, atol=1e-13)
+        # the per coil fields are still available
+        for B_i, B_i_fused in zip(bs.dB_by_dcoilcurrents(), bs_fused.dB_by_dcoilcurrents()):
+            assert np.allclose(B_i, B_i_fused, rtol=1e-14, atol=1e-14)
+        # changes of the currents and coils are picked up
+        coils[1].current.x = coils[1].current.x * 2
+        coils[2].curve.x = coils[2].curve.x + 0.01
+        assert np.allclose(bs.B(), bs_fused.B(), rtol=1e-13, atol=1e-14)
+        bs_fused.set_fused_evaluation(False)
+        assert np.allclose(bs.B(), bs_fused.B(), rtol=1e-13, atol=1e-14)
+
+    def test_biotsavart_vjp(self):
+        """
+        simsoptpp.biot_savart_vjp contracts with the curve dofs directly and
+        agrees with the derivatives computed via B_vjp and B_and_dB_vjp.
+        """
+        from simsoptpp import biot_savart_vjp
+        np.random.seed(1)
+        coils = [Coil(get_curve(perturb=True), Current(1e4)) for i in range(3)]
+        points = np.random.uniform(low=-3, high=3, size=(40, 3))
+        bs = BiotSavart(coils).set_points(points)
+        v = np.random.standard_normal(size=(len(points), 3))
+        vgrad = np.random.standard_normal(size=(len(points), 3, 3))
+        curves = [c.curve for c in coils]
+        currents = [c.current.get_value() for c in coils]
+        res_B = [np.zeros(len(c.x)) for c in curves]
+        res_dB = [np.zeros(len(c.x)) for c in curves]
+        biot_savart_vjp(points, curves, currents, v, vgrad, res_B, res_dB)
+        dB, ddB = bs.B_and_dB_vjp(v, vgrad)
+        for c, r, rd in zip(curves, res_B, res_dB):
+            assert np.allclose(r, dB(c), rtol=1e-12, atol=1e-14)
+            assert np.allclose(rd, ddB(c), rtol=1e-12, atol=1e-14)
+        res_B = [np.zeros(len(c.x)) for c in curves]
+        biot_savart_vjp(points, curves, currents, v, vgrad, res_B, [])
+        for c, r in zip(curves, res_B):
+            assert np.allclose(r, bs.B_vjp(v)(c), rtol=1e-12, atol=1e-14)
 
 if __name__ == "__main__":
     unittest.main()
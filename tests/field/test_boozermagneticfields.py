@@ -115,6 +115,94 @@ class TestingAnalytic(unittest.TestCase):
         ba.set_K1(3.7)
         assert (ba.K1 == 3.7)
 
+    def test_interpolatedboozerfield_lazy(self):
+        """
+        A lazy InterpolatedBoozerField only computes the cells that are
+        visited, and agrees with the interpolant that is built on the whole
+        grid at once.
+        """
+        ba = BoozerAnalytic(1.1, 1.0, 0, 1.1, 0.8, 0.4, 1.8)
+        n = 8
+        args = (ba, 3, [0.1, 0.9, n], [0, 2*np.pi, n], [0, 2*np.pi, n])
+        bsh = InterpolatedBoozerField(*args, stellsym=False)
+        bsh_lazy = InterpolatedBoozerField(*args, stellsym=False, lazy=True)
+        self.assertEqual(bsh_lazy.cells_total(), 0)
+
+        # points in a thin band of s only visit a fraction of the cells
+        np.random.seed(1)
+        points = np.random.uniform(size=(50, 3))
+        points[:, 0] = 0.45 + 0.04*points[:, 0]
+        points[:, 1:] *= 2*np.pi
+        bsh.set_points(points)
+        bsh_lazy.set_points(points)
+        np.testing.assert_allclose(bsh_lazy.modB(), bsh.modB(), rtol=1e-14, atol=1e-14)
+        np.testing.assert_allclose(bsh_lazy.K_derivs(), bsh.K_derivs(), rtol=1e-14, atol=1e-14)
+        np.testing.assert_allclose(bsh_lazy.G(), bsh.G(), rtol=1e-14, atol=1e-14)
+        self.assertEqual(bsh.cells_filled(), bsh.cells_total())
+        self.assertEqual(bsh_lazy.cells_total(), bsh.cells_total())
+        filled = bsh_lazy.cells_filled()
+        self.assertGreater(filled, 0)
+        self.assertLess(filled, bsh_lazy.cells_total())
+
+        # only the values at the nodes of the visited cells are kept, so the
+        # memory scales with the band rather than with the whole grid
+        self.assertEqual(bsh.dofs_stored(), 0)
+        stored = bsh_lazy.dofs_stored()
+        self.assertGreater(stored, 0)
+        self.assertLessEqual(stored, 4**3 * filled)
+        bsh_full = InterpolatedBoozerField(*args, stellsym=False, lazy=True)
+        grid = (np.arange(n) + 0.5)/n
+        s, theta, zeta = np.meshgrid(0.1 + 0.8*grid, 2*np.pi*grid, 2*np.pi*grid, indexing='ij')
+        bsh_full.set_points(np.stack([s.flatten(), theta.flatten(), zeta.flatten()], axis=1))
+        bsh_full.modB()
+        bsh_full.K_derivs()
+        bsh_full.G()
+        self.assertEqual(bsh_full.cells_filled(), bsh_full.cells_total())
+        self.assertLess(stored, 0.5 * bsh_full.dofs_stored())
+
+        # evaluating at the same points again does not fill any more cells,
+        # other points fill the cells they land in
+        bsh_lazy.set_points(points)
+        bsh_lazy.modB()
+        self.assertEqual(bsh_lazy.cells_filled(), filled)
+        points[:, 0] = 0.85
+        bsh.set_points(points)
+        bsh_lazy.set_points(points)
+        np.testing.assert_allclose(bsh_lazy.modB(), bsh.modB(), rtol=1e-14, atol=1e-14)
+        self.assertGreater(bsh_lazy.cells_filled(), filled)
+
+    def test_interpolatedboozerfield_fused(self):
+        """
+        The fused interpolant returns the same guiding center quantities as
+        the individual interpolants, also when symmetries are exploited.
+        """
+        ba = BoozerAnalytic(1.1, 1.0, 2, 1.1, 0.8, 0.4, K1=1.8)
+        ba.set_I0(0.3)
+        ba.set_I1(0.2)
+        ba.set_G1(0.1)
+        nfp = 2
+        for stellsym in [True, False]:
+            thetamax = np.pi if stellsym else 2*np.pi
+            args = (ba, 3, [0.1, 0.9, 6], [0, thetamax, 8], [0, 2*np.pi/nfp, 8])
+            bsh = InterpolatedBoozerField(*args, nfp=nfp, stellsym=stellsym)
+            bsh_fused = InterpolatedBoozerField(*args, nfp=nfp, stellsym=stellsym, fused=True)
+            self.assertFalse(bsh.fused_gc_quantities())
+            self.assertTrue(bsh_fused.fused_gc_quantities())
+
+            np.random.seed(1)
+            points = np.random.uniform(size=(100, 3))
+            points[:, 0] = 0.1 + 0.8*points[:, 0]
+            points[:, 1:] *= 2*np.pi
+            bsh.set_points(points)
+            bsh_fused.set_points(points)
+            gc = bsh.gc_quantities()
+            gc_fused = bsh_fused.gc_quantities()
+            self.assertEqual(gc_fused.shape, (100, 12))
+            np.testing.assert_allclose(gc[:, 0], bsh.modB()[:, 0])
+            np.testing.assert_allclose(gc[:, 1:4], bsh.modB_derivs())
+            np.testing.assert_allclose(gc[:, 9], bsh.K()[:, 0])
+            np.testing.assert_allclose(gc_fused, gc, rtol=1e-10, atol=1e-10)
+
 
 @unittest.skipIf(vmec is None, "vmec python package is not found")
 class TestingVmec(unittest.TestCase):
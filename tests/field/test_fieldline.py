@@ -75,6 +75,34 @@ class FieldlineTesting(unittest.TestCase):
         rtest = [[np.sqrt((np.sqrt(res_tys[i][j][1]**2+res_tys[i][j][2]**2)-R0test)**2+res_tys[i][j][3]**2)-R0[i]+R0test for j in range(len(res_tys[i]))] for i in range(len(res_tys))]
         assert [np.allclose(rtest[i], 0., rtol=1e-5, atol=1e-5) for i in range(nlines)]
 
+    def test_poincare_mode(self):
+        # The dedicated poincare mode should find the same plane crossings as
+        # the regular tracing, including for unsorted and negative angles.
+        Bfield = ToroidalField(1.0, 1.0)+PoloidalField(1.0, 1.0, 3.2)
+        nlines = 3
+        R0 = [1.05 + i*0.02 for i in range(nlines)]
+        Z0 = [0.01 for i in range(nlines)]
+        phis = [0.3, -0.2, 2.0, 0.0, 4.5]
+        res_tys, res_phi_hits = compute_fieldlines(
+            Bfield, R0, Z0, tmax=40, tol=1e-10, phis=phis, stopping_criteria=[])
+        res_tys_p, res_phi_hits_p = compute_fieldlines(
+            Bfield, R0, Z0, tmax=40, tol=1e-10, phis=phis, stopping_criteria=[], poincare=True)
+        for i in range(nlines):
+            assert len(res_tys_p[i]) == 2
+            assert np.allclose(res_tys_p[i][[0, -1], :], res_tys[i][[0, -1], :])
+            # the regular tracing reports the planes crossed in a single step
+            # in the order of phis, the poincare mode in the order of crossing
+            hits = res_phi_hits[i][np.argsort(res_phi_hits[i][:, 0], kind='stable')]
+            hits_p = res_phi_hits_p[i]
+            assert np.all(np.diff(hits_p[:, 0]) >= 0)
+            assert hits_p.shape == hits.shape
+            assert np.all(hits_p[:, 1] == hits[:, 1])
+            assert np.allclose(hits_p, hits, atol=1e-8)
+        # no trajectory is recorded in poincare mode, so there is nothing to
+        # decimate or stream
+        with self.assertRaises(ValueError):
+            compute_fieldlines(Bfield, R0, Z0, tmax=40, phis=phis, poincare=True, save_every=10)
+
     def test_poincare_plot(self):
         curves, currents, ma = get_ncsx_data()
         nfp = 3
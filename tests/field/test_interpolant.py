@@ -1,3 +1,5 @@
+import os
+import tempfile
 import numpy as np
 import unittest
 import simsoptpp as sopp
@@ -147,6 +149,94 @@ class Testing(unittest.TestCase):
         assert np.allclose(fhxyz[:3, :], fxyz[:3, :], atol=1e-12, rtol=1e-12)
         assert np.allclose(fhxyz[3:, :], 100, atol=1e-12, rtol=1e-12)
 
+    def test_evaluate_batch_matches_evaluate(self):
+        """
+        Check that evaluating the interpolant at many points at once (which
+        groups the points by cell) gives the same results as evaluating it at
+        one point at a time, also when some of the points are skipped or out
+        of bounds.
+        """
+        np.random.seed(0)
+        xran = (1.0, 4.0, 10)
+        yran = (1.1, 3.9, 8)
+        zran = (1.2, 3.8, 6)
+
+        def skip(xs, ys, zs):
+            return np.asarray(xs) > 3.5
+
+        for dim in [1, 3, 5]:
+            for degree in [1, 3]:
+                fun = get_random_polynomial(dim, degree)
+                rule = sopp.UniformInterpolationRule(degree)
+                interpolant = sopp.RegularGridInterpolant3D(rule, xran, yran, zran, dim, True, skip)
+                interpolant.interpolate_batch(fun)
+
+                nsamples = 1000
+                xyz = np.asarray([
+                    np.random.uniform(low=0.9, high=4.1, size=(nsamples, )),
+                    np.random.uniform(low=yran[0], high=yran[1], size=(nsamples, )),
+                    np.random.uniform(low=zran[0], high=zran[1], size=(nsamples, ))]).T.copy()
+                fhxyz = 100*np.ones((nsamples, dim))
+                interpolant.evaluate_batch(xyz, fhxyz)
+                for i in range(nsamples):
+                    fhxyz_single = 100*np.ones((1, dim))
+                    interpolant.evaluate_batch(xyz[i:i+1, :], fhxyz_single)
+                    assert np.allclose(fhxyz[i, :], fhxyz_single[0, :], atol=1e-14, rtol=1e-14)
+
+    def test_save_load_cell_values(self):
+        """
+        Check that an interpolant that is loaded from file (either copied or
+        memory mapped) gives the same results as the original one.
+        """
+        np.random.seed(0)
+        xran = (1.0, 4.0, 10)
+        yran = (1.1, 3.9, 8)
+        zran = (1.2, 3.8, 6)
+
+        def skip(xs, ys, zs):
+            return np.asarray(xs) > 3.5
+
+        dim = 3
+        degree = 3
+        fun = get_random_polynomial(dim, degree)
+        rule = sopp.UniformInterpolationRule(degree)
+        interpolant = sopp.RegularGridInterpolant3D(rule, xran, yran, zran, dim, True, skip)
+        interpolant.interpolate_batch(fun)
+
+        nsamples = 100
+        xyz = np.asarray([
+            np.random.uniform(low=xran[0], high=3.4, size=(nsamples, )),
+            np.random.uniform(low=yran[0], high=yran[1], size=(nsamples, )),
+            np.random.uniform(low=zran[0], high=zran[1], size=(nsamples, ))]).T.copy()
+        fhxyz = np.zeros((nsamples, dim))
+        interpolant.evaluate_batch(xyz, fhxyz)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            filename = os.path.join(tmpdir, "cells.bin")
+            interpolant.save_cell_values(filename, dof_hash=42)
+            for mmap in [True, False]:
+                loaded = sopp.RegularGridInterpolant3D(rule, xran, yran, zran, dim, True, skip)
+                loaded.load_cell_values(filename, mmap=mmap, dof_hash=42)
+                fhxyz_loaded = np.zeros((nsamples, dim))
+                loaded.evaluate_batch(xyz, fhxyz_loaded)
+                assert np.array_equal(fhxyz, fhxyz_loaded)
+
+            # the file can only be loaded by an interpolant on the same grid
+            other = sopp.RegularGridInterpolant3D(rule, xran, yran, (1.2, 3.8, 7), dim, True, skip)
+            with assert_raises(RuntimeError):
+                other.load_cell_values(filename)
+            other = sopp.RegularGridInterpolant3D(rule, xran, yran, zran, dim, True)
+            with assert_raises(RuntimeError):
+                other.load_cell_values(filename, dof_hash=42)
+            # ... with the same interpolation rule ...
+            other = sopp.RegularGridInterpolant3D(sopp.ChebyshevInterpolationRule(degree), xran, yran, zran, dim, True, skip)
+            with assert_raises(RuntimeError):
+                other.load_cell_values(filename, dof_hash=42)
+            # ... and for the same underlying data
+            other = sopp.RegularGridInterpolant3D(rule, xran, yran, zran, dim, True, skip)
+            with assert_raises(RuntimeError):
+                other.load_cell_values(filename, dof_hash=43)
+
     def test_convergence_order(self):
         for dim in [1, 4, 6]:
             for degree in [1, 3]:
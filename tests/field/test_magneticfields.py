@@ -935,6 +935,39 @@ class Testing(unittest.TestCase):
         assert np.allclose(Bc, Bhc, rtol=1e-2)
         assert np.allclose(dBc, dBhc, rtol=1e-2, atol=1e-5)
 
+    def test_interpolated_field_save_load(self):
+        curves, currents, ma = get_ncsx_data()
+        nfp = 3
+        coils = coils_via_symmetries(curves, currents, nfp, True)
+        bs = BiotSavart(coils)
+        n = 4
+        rrange = [1.5, 1.7, n]
+        phirange = [0, 2*np.pi/nfp, n*4]
+        zrange = [0, 0.1, n]
+        bsh = InterpolatedField(bs, 3, rrange, phirange, zrange, True, nfp=nfp, stellsym=True)
+        N = 100
+        points = np.random.uniform(size=(N, 3))
+        points[:, 0] = points[:, 0]*(rrange[1]-rrange[0]) + rrange[0]
+        points[:, 1] = points[:, 1]*2*np.pi
+        points[:, 2] = points[:, 2]*0.2 - 0.1
+        bsh.set_points_cyl(points)
+        B = bsh.B()
+        dB = bsh.GradAbsB()
+        with tempfile.TemporaryDirectory() as tmpdir:
+            filename = str(Path(tmpdir) / "interpolants.bin")
+            bsh.save_interpolants(filename)
+            for mmap in [True, False]:
+                bsh_loaded = InterpolatedField(bs, 3, rrange, phirange, zrange, True, nfp=nfp, stellsym=True)
+                bsh_loaded.load_interpolants(filename, mmap=mmap)
+                bsh_loaded.set_points_cyl(points)
+                assert np.array_equal(B, bsh_loaded.B())
+                assert np.array_equal(dB, bsh_loaded.GradAbsB())
+            # once the coils change, the file is out of date
+            coils[0].current.x = coils[0].current.x * 1.01
+            bsh_loaded = InterpolatedField(bs, 3, rrange, phirange, zrange, True, nfp=nfp, stellsym=True)
+            with self.assertRaises(RuntimeError):
+                bsh_loaded.load_interpolants(filename)
+
     def test_interpolated_field_convergence_rate(self):
         R0test = 1.5
         B0test = 0.8
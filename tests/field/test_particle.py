@@ -1,5 +1,7 @@
 import unittest
 import logging
+import os
+import tempfile
 
 logging.basicConfig()
 
@@ -13,7 +15,8 @@ from simsopt.field.tracing import trace_particles_starting_on_curve, SurfaceClas
     particles_to_vtk, LevelsetStoppingCriterion, compute_gc_radius, gc_to_fullorbit_initial_guesses, \
     IterationStoppingCriterion, trace_particles_starting_on_surface, trace_particles_boozer, \
     MinToroidalFluxStoppingCriterion, MaxToroidalFluxStoppingCriterion, ToroidalTransitStoppingCriterion, \
-    compute_poloidal_transits, compute_toroidal_transits, trace_particles, compute_resonances
+    compute_poloidal_transits, compute_toroidal_transits, trace_particles, compute_resonances, \
+    BinaryFileTrajectorySink, CallbackTrajectorySink, load_trajectories
 from simsopt.geo.surfacerzfourier import SurfaceRZFourier
 from simsopt.field.boozermagneticfield import BoozerAnalytic
 from simsopt.field.magneticfieldclasses import InterpolatedField, UniformInterpolationRule, ToroidalField, PoloidalField
@@ -183,6 +186,65 @@ class ParticleTracingTesting(unittest.TestCase):
             assert gc_tys[i].shape[0] == 2
             assert validate_phi_hits(gc_phi_hits[i], bsh, nphis)
 
+    def test_guidingcenter_batched(self):
+        bsh = self.bsh
+        ma = self.ma
+        nparticles = 5
+        m = PROTON_MASS
+        q = ELEMENTARY_CHARGE
+        Ekin = 9000 * ONE_EV
+        speed_total = np.sqrt(2*Ekin/m)
+        nphis = 4
+        phis = np.linspace(0, 2*np.pi, nphis, endpoint=False)
+        xyz_inits = ma.gamma()[:nparticles, :]
+        vpar_inits = speed_total * np.linspace(-0.8, 0.8, nparticles)
+        kwargs = dict(tmax=1e-5, mass=m, charge=q, Ekin=Ekin, tol=1e-10, phis=phis, mode='gc_vac')
+        gc_tys, gc_phi_hits = trace_particles(bsh, xyz_inits, vpar_inits, **kwargs)
+        gc_tys_batch, gc_phi_hits_batch = trace_particles(bsh, xyz_inits, vpar_inits, batched=True, **kwargs)
+        for i in range(nparticles):
+            # each particle is integrated with the same adaptive scheme as in
+            # the serial code, so the results only differ by round-off
+            assert abs(len(gc_tys[i]) - len(gc_tys_batch[i])) <= 2
+            np.testing.assert_allclose(gc_tys[i][0], gc_tys_batch[i][0])
+            np.testing.assert_allclose(gc_tys[i][-1], gc_tys_batch[i][-1], rtol=1e-5, atol=1e-8)
+            assert gc_phi_hits[i].shape == gc_phi_hits_batch[i].shape
+            np.testing.assert_allclose(gc_phi_hits[i], gc_phi_hits_batch[i], rtol=1e-5, atol=1e-8)
+            assert validate_phi_hits(gc_phi_hits_batch[i], bsh, nphis)
+
+        with self.assertRaises(ValueError):
+            trace_particles(bsh, xyz_inits, vpar_inits, batched=True, tmax=1e-5, mass=m, charge=q, Ekin=Ekin,
+                            mode='gc_vac', stopping_criteria=[ToroidalTransitStoppingCriterion(1, False)])
+        with self.assertRaises(ValueError):
+            trace_particles(bsh, xyz_inits, vpar_inits, batched=True, tmax=1e-5, mass=m, charge=q, Ekin=Ekin,
+                            mode='gc')
+
+    def test_guidingcenter_multithreaded(self):
+        bsh = self.bsh
+        ma = self.ma
+        nparticles = 6
+        m = PROTON_MASS
+        q = ELEMENTARY_CHARGE
+        Ekin = 9000 * ONE_EV
+        speed_total = np.sqrt(2*Ekin/m)
+        nphis = 4
+        phis = np.linspace(0, 2*np.pi, nphis, endpoint=False)
+        xyz_inits = ma.gamma()[:nparticles, :]
+        vpar_inits = speed_total * np.linspace(-0.8, 0.8, nparticles)
+        kwargs = dict(tmax=1e-5, mass=m, charge=q, Ekin=Ekin, tol=1e-10, phis=phis, mode='gc_vac',
+                      stopping_criteria=[IterationStoppingCriterion(300)])
+        gc_tys, gc_phi_hits = trace_particles(bsh, xyz_inits, vpar_inits, **kwargs)
+        # the threads trace the particles independently, so the results
+        # agree exactly with the serial ones
+        for factory in [None, bsh.clone]:
+            gc_tys_mt, gc_phi_hits_mt = trace_particles(
+                bsh, xyz_inits, vpar_inits, nthreads=3, field_factory=factory, **kwargs)
+            for i in range(nparticles):
+                np.testing.assert_array_equal(gc_tys[i], gc_tys_mt[i])
+                np.testing.assert_array_equal(gc_phi_hits[i], gc_phi_hits_mt[i])
+
+        with self.assertRaises(ValueError):
+            trace_particles(bsh, xyz_inits, vpar_inits, nthreads=3, **dict(kwargs, mode='gc'))
+
     def test_gc_to_full(self):
         N = 100
         etas = np.linspace(0, 2*np.pi, N, endpoint=False)
@@ -747,6 +809,54 @@ class BoozerGuidingCenterTracingTesting(unittest.TestCase):
             assert np.all(gc_tys[i][:, 1] > 0.4)
             assert np.all(gc_tys[i][:, 1] < 0.6)
 
+    def test_trajectory_output(self):
+        """
+        Check that decimated and streamed trajectories agree with the full
+        trajectories, for particles that are lost and for ones that are not.
+        """
+        bsh = BoozerAnalytic(1.2, 1.0, 4, 1.1, 0.8, 1.0)
+        m = PROTON_MASS
+        q = ELEMENTARY_CHARGE
+        Ekin = 100000.*ONE_EV
+        vpar = np.sqrt(2*Ekin/m)
+        Nparticles = 6
+        np.random.seed(1)
+        stz_inits = np.random.uniform(size=(Nparticles, 3))
+        stz_inits[:, 0] = 0.45 + 0.1*stz_inits[:, 0]
+        vpar_inits = vpar*np.random.uniform(-1, 1, size=(Nparticles, 1))
+        kwargs = dict(tmax=1e-4, mass=m, charge=q, Ekin=Ekin, zetas=[0.], mode='gc_vac', tol=1e-10,
+                      stopping_criteria=[MaxToroidalFluxStoppingCriterion(0.55)])
+        gc_tys, gc_hits = trace_particles_boozer(bsh, stz_inits, vpar_inits, **kwargs)
+
+        def decimate(ty, save_every):
+            idx = list(range(0, len(ty), save_every)) if save_every > 0 else [0]
+            if idx[-1] != len(ty)-1:
+                idx.append(len(ty)-1)
+            return ty[idx]
+
+        for save_every in [0, 1, 7]:
+            tys, hits = trace_particles_boozer(bsh, stz_inits, vpar_inits, save_every=save_every, **kwargs)
+            for i in range(Nparticles):
+                np.testing.assert_array_equal(tys[i], decimate(gc_tys[i], save_every))
+                np.testing.assert_array_equal(hits[i], gc_hits[i])
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            filename = os.path.join(tmpdir, 'trajectories.bin')
+            sink = BinaryFileTrajectorySink(filename)
+            tys, hits = trace_particles_boozer(bsh, stz_inits, vpar_inits, save_every=3, sink=sink, **kwargs)
+            sink.close()
+            streamed = load_trajectories(filename)
+        chunks = {}
+        tys_cb, _ = trace_particles_boozer(
+            bsh, stz_inits, vpar_inits, save_every=3,
+            sink=CallbackTrajectorySink(lambda i, chunk: chunks.setdefault(i, []).append(chunk.copy())), **kwargs)
+        for i in range(Nparticles):
+            np.testing.assert_array_equal(streamed[i], decimate(gc_tys[i], 3))
+            np.testing.assert_array_equal(np.concatenate(chunks[i]), decimate(gc_tys[i], 3))
+            np.testing.assert_array_equal(tys[i], decimate(gc_tys[i], 0))
+            np.testing.assert_array_equal(tys_cb[i], decimate(gc_tys[i], 0))
+            np.testing.assert_array_equal(hits[i], gc_hits[i])
+
     def test_compute_resonances(self):
         """
         Compute particle resonances for low energy particles in a BoozerAnalytic
@@ -454,6 +454,42 @@ class Testing(unittest.TestCase):
         rc.gamma_impl(tmp, quadpoints[:10])
         assert np.allclose(cg[:10, :]@mat, tmp)
 
+    def test_fourier_curve_derivatives_on_grids(self):
+        # gamma and its derivatives are evaluated from a trig table, which is
+        # compressed on uniform grids. Since the curves are linear in the dofs,
+        # the result has to agree with the (directly evaluated) derivatives
+        # with respect to the dofs applied to the dofs.
+        grids = [np.linspace(0, 1, 40, endpoint=False),
+                 np.linspace(0, 1/3, 15, endpoint=False),
+                 np.linspace(0.25, 1.25, 24, endpoint=False),
+                 np.sort(np.random.uniform(size=(20, )))]
+        for x in grids:
+            for curvetype in ["CurveXYZFourier", "CurveRZFourier"]:
+                with self.subTest(curvetype=curvetype, n=len(x)):
+                    curve = get_curve(curvetype, False, x)
+                    for _ in range(2):
+                        dofs = curve.x
+                        assert np.allclose(curve.gamma(), curve.dgamma_by_dcoeff() @ dofs)
+                        assert np.allclose(curve.gammadash(), curve.dgammadash_by_dcoeff() @ dofs)
+                        assert np.allclose(curve.gammadashdash(), curve.dgammadashdash_by_dcoeff() @ dofs)
+                        assert np.allclose(curve.gammadashdashdash(), curve.dgammadashdashdash_by_dcoeff() @ dofs)
+                        # evaluation on points passed explicitly does not use the table
+                        tmp = np.zeros((len(x), 3))
+                        curve.gamma_impl(tmp, x)
+                        assert np.allclose(curve.gamma(), tmp)
+                        curve.x = dofs + 0.01 * np.random.standard_normal(size=dofs.shape)
+
+    def test_curve_dcoeff_vjp(self):
+        # the vector Jacobian products agree with contracting with the
+        # (dense) derivatives of gamma and gammadash
+        x = np.linspace(0, 1, 30, endpoint=False)
+        for curvetype in ["CurveXYZFourier", "JaxCurveXYZFourier"]:
+            with self.subTest(curvetype=curvetype):
+                curve = get_curve(curvetype, False, x)
+                v = np.random.standard_normal(size=(len(x), 3))
+                assert np.allclose(curve.dgamma_by_dcoeff_vjp_impl(v), np.einsum('ij,ijk->k', v, curve.dgamma_by_dcoeff()))
+                assert np.allclose(curve.dgammadash_by_dcoeff_vjp_impl(v), np.einsum('ij,ijk->k', v, curve.dgammadash_by_dcoeff()))
+
     def subtest_serialization(self, curvetype, rotated):
         epss = [0.5**i for i in range(10, 15)]
         x = np.asarray([0.6] + [0.6 + eps for eps in epss])
@@ -293,6 +293,80 @@ class Testing(unittest.TestCase):
         candidates = sopp.get_pointclouds_closer_than_threshold_between_two_collections(pointCloudsA, pointCloudsB, threshold)
         assert len(candidates) == 1
 
+    def test_closest_points(self):
+        from scipy.spatial.distance import cdist
+        np.random.seed(0)
+        n_clouds = 5
+        pointClouds = [np.random.uniform(low=-1.0, high=+1.0, size=(7, 3)) for _ in range(n_clouds)]
+        pointCloudsB = [np.random.uniform(low=-1.0, high=+1.0, size=(9, 3)) for _ in range(2)]
+        for threshold in [0.1, 0.3, 1.0]:
+            closest = sopp.get_closest_points_within_collection(pointClouds, threshold, 3)
+            expected = []
+            for i in range(n_clouds):
+                for j in range(min(i, 3)):
+                    dists = cdist(pointClouds[i], pointClouds[j])
+                    if np.min(dists) < threshold:
+                        k, l = np.unravel_index(np.argmin(dists), dists.shape)
+                        expected.append((i, j, np.min(dists), k, l))
+            assert [c[:2] for c in closest] == [e[:2] for e in expected]
+            assert [c[3:] for c in closest] == [e[3:] for e in expected]
+            np.testing.assert_allclose([c[2] for c in closest], [e[2] for e in expected], rtol=1e-14)
+
+            closest = sopp.get_closest_points_between_two_collections(pointClouds, pointCloudsB, threshold)
+            expected = []
+            for i in range(n_clouds):
+                for j in range(2):
+                    dists = cdist(pointClouds[i], pointCloudsB[j])
+                    if np.min(dists) < threshold:
+                        k, l = np.unravel_index(np.argmin(dists), dists.shape)
+                        expected.append((i, j, np.min(dists), k, l))
+            assert [c[:2] for c in closest] == [e[:2] for e in expected]
+            assert [c[3:] for c in closest] == [e[3:] for e in expected]
+            np.testing.assert_allclose([c[2] for c in closest], [e[2] for e in expected], rtol=1e-14)
+
+        # with a threshold of zero no two clouds are close
+        assert sopp.get_closest_points_within_collection(pointClouds, 0., 3) == []
+        assert sopp.get_closest_points_between_two_collections(pointClouds, pointCloudsB, 0.) == []
+
+    def test_curve_curve_distance_penalty(self):
+        from jax import grad
+        from simsopt.geo.curveobjectives import cc_distance_pure
+        np.random.seed(0)
+        gammas = [np.random.uniform(low=-1.0, high=+1.0, size=(7+i, 3)) for i in range(5)]
+        gammadashs = [np.random.uniform(low=-1.0, high=+1.0, size=(7+i, 3)) for i in range(5)]
+        for minimum_distance in [0.1, 0.5, 4.0]:
+            J = 0
+            dgammas = [np.zeros_like(g) for g in gammas]
+            dgammadashs = [np.zeros_like(g) for g in gammadashs]
+            for i in range(5):
+                for j in range(min(i, 3)):
+                    args = (gammas[i], gammadashs[i], gammas[j], gammadashs[j], minimum_distance)
+                    J += cc_distance_pure(*args)
+                    dgammas[i] += grad(cc_distance_pure, argnums=0)(*args)
+                    dgammadashs[i] += grad(cc_distance_pure, argnums=1)(*args)
+                    dgammas[j] += grad(cc_distance_pure, argnums=2)(*args)
+                    dgammadashs[j] += grad(cc_distance_pure, argnums=3)(*args)
+            dJ_by_dgammas = [np.zeros_like(g) for g in gammas]
+            dJ_by_dgammadashs = [np.zeros_like(g) for g in gammadashs]
+            Jsopp = sopp.curve_curve_distance_penalty(gammas, gammadashs, minimum_distance, 3, [], [])
+            assert abs(Jsopp - J) <= 1e-13 * abs(J)
+            sopp.curve_curve_distance_penalty(gammas, gammadashs, minimum_distance, 3, dJ_by_dgammas, dJ_by_dgammadashs)
+            for i in range(5):
+                np.testing.assert_allclose(dJ_by_dgammas[i], dgammas[i], rtol=1e-12, atol=1e-14)
+                np.testing.assert_allclose(dJ_by_dgammadashs[i], dgammadashs[i], rtol=1e-12, atol=1e-14)
+
+        # a minimum distance of zero is never violated
+        dJ_by_dgammas = [np.ones_like(g) for g in gammas]
+        dJ_by_dgammadashs = [np.ones_like(g) for g in gammadashs]
+        assert sopp.curve_curve_distance_penalty(gammas, gammadashs, 0., 3, dJ_by_dgammas, dJ_by_dgammadashs) == 0
+        assert all(np.all(g == 0) for g in dJ_by_dgammas + dJ_by_dgammadashs)
+        base_curves, base_currents, _ = get_ncsx_data(Nt_coils=10)
+        curves = [c.curve for c in coils_via_symmetries(base_curves, base_currents, 3, True)]
+        J = CurveCurveDistance(curves, 0)
+        assert J.J() == 0
+        assert np.all(J.dJ() == 0)
+        assert J.shortest_distance() > 0
+
     def test_minimum_distance_candidates_symmetry(self):
         from scipy.spatial.distance import cdist
         base_curves, base_currents, _ = get_ncsx_data(Nt_coils=10)
@@ -336,6 +410,13 @@ class Testing(unittest.TestCase):
                 assert J.shortest_distance() == J.shortest_distance_among_candidates()
 
         assert last_num_candidates == len(curves)
+
+        # a minimum distance of zero is never violated
+        J = CurveSurfaceDistance(curves, surface, 0)
+        assert J.J() == 0
+        assert np.all(J.dJ() == 0)
+        assert J.shortest_distance() > 0
+
         threshold = 1.0
         J = CurveSurfaceDistance(curves, surface, threshold)
 
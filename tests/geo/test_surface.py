@@ -369,6 +369,66 @@ class CurvatureTests(unittest.TestCase):
                     assert np.abs(np.sum(K*N)) < 1e-12
 
 
+class FourierBasisTests(unittest.TestCase):
+    surfacetypes = ["SurfaceRZFourier", "SurfaceXYZFourier",
+                    "SurfaceXYZTensorFourier"]
+
+    def test_shared_tables(self):
+        """
+        The Fourier surfaces evaluate sin and cos from tables that are shared
+        between surfaces on the same grid. Since the surfaces are linear in
+        their dofs, gamma and its derivatives have to agree with the
+        derivatives with respect to the dofs applied to the dofs, on uniform
+        and non-uniform grids, and for surfaces sharing a grid.
+        """
+        np.random.seed(1)
+        grids = [(None, None),
+                 (np.sort(np.random.uniform(size=(9, ))), np.sort(np.random.uniform(size=(8, ))))]
+        for surfacetype in self.surfacetypes:
+            for stellsym in [True, False]:
+                for phis, thetas in grids:
+                    with self.subTest(surfacetype=surfacetype, stellsym=stellsym, uniform=phis is None):
+                        surfs = [get_surface(surfacetype, stellsym, phis=phis, thetas=thetas, mpol=3, ntor=2)
+                                 for _ in range(2)]
+                        for s in surfs:
+                            s.x = s.x + 0.1 * np.random.standard_normal(size=s.x.shape)
+                        for s in surfs:
+                            x = s.x
+                            np.testing.assert_allclose(s.gamma(), s.dgamma_by_dcoeff() @ x, atol=1e-13)
+                            np.testing.assert_allclose(s.gammadash1(), s.dgammadash1_by_dcoeff() @ x, atol=1e-12)
+                            np.testing.assert_allclose(s.gammadash2(), s.dgammadash2_by_dcoeff() @ x, atol=1e-12)
+                            np.testing.assert_allclose(s.gammadash1dash1(), s.dgammadash1dash1_by_dcoeff() @ x, atol=1e-11)
+                            np.testing.assert_allclose(s.gammadash1dash2(), s.dgammadash1dash2_by_dcoeff() @ x, atol=1e-11)
+                            np.testing.assert_allclose(s.gammadash2dash2(), s.dgammadash2dash2_by_dcoeff() @ x, atol=1e-11)
+
+    def test_vjps(self):
+        """
+        The vjps are computed without forming the derivatives with respect to
+        the dofs, check them against the contraction with those derivatives.
+        """
+        np.random.seed(1)
+        surfaces = []
+        for stellsym in [True, False]:
+            for surfacetype in self.surfacetypes:
+                surfaces.append((surfacetype, stellsym, get_surface(surfacetype, stellsym, mpol=4, ntor=3)))
+            # the clamped dimensions go through the enforcer in SurfaceXYZTensorFourier
+            surfaces.append(("SurfaceXYZTensorFourier clamped", stellsym, SurfaceXYZTensorFourier(
+                nfp=3, stellsym=stellsym, mpol=4, ntor=3, clamped_dims=[True, False, True],
+                quadpoints_phi=np.linspace(0, 1/3, 11, endpoint=False),
+                quadpoints_theta=np.linspace(0, 1, 11, endpoint=False))))
+        for surfacetype, stellsym, s in surfaces:
+            with self.subTest(surfacetype=surfacetype, stellsym=stellsym):
+                s.x = s.x + 0.1 * np.random.standard_normal(size=s.x.shape)
+                h = np.random.standard_normal(size=s.gamma().shape)
+                for vjp, jac in [(s.dgamma_by_dcoeff_vjp, s.dgamma_by_dcoeff),
+                                 (s.dgammadash1_by_dcoeff_vjp, s.dgammadash1_by_dcoeff),
+                                 (s.dgammadash2_by_dcoeff_vjp, s.dgammadash2_by_dcoeff),
+                                 (s.dnormal_by_dcoeff_vjp, s.dnormal_by_dcoeff)]:
+                    via_vjp = vjp(h)
+                    via_matvec = np.sum(jac()*h[..., None], axis=(0, 1, 2))
+                    assert np.linalg.norm(via_vjp-via_matvec)/np.linalg.norm(via_vjp) < 1e-13
+
+
 class UtilTests(unittest.TestCase):
     def test_extend_via_normal(self):
         """
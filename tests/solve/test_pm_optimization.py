@@ -51,6 +51,130 @@ class Testing(unittest.TestCase):
             assert dipoles.shape == (ndipoles, 3)
             assert m_hist.shape == (ndipoles, 3, 21)
 
+    def test_MwPGP_matrix_free(self):
+        """
+            Test that the matrix-free DipoleFieldOperator reproduces the
+            rescaled dipole_field_Bn matrix, and that MwPGP gives the
+            same result with the operator as with the dense matrix.
+        """
+        np.random.seed(1)
+        ndipoles = 20
+        nquad = 100
+        nfp = 2
+        points = np.random.rand(nquad, 3) + np.array([1.0, 0.5, 0.0])
+        m_points = 0.5 * np.random.rand(ndipoles, 3) + np.array([1.5, 1.0, 0.5])
+        unitnormal = np.random.rand(nquad, 3)
+        unitnormal /= np.linalg.norm(unitnormal, axis=-1)[:, None]
+        weights = np.random.rand(nquad)
+        b = np.random.rand(nquad)
+        for coordinate_flag in ['cartesian', 'cylindrical', 'toroidal']:
+            for stellsym in [0, 1]:
+                A = sopp.dipole_field_Bn(points, m_points, unitnormal, nfp, stellsym, b, coordinate_flag, 1.0)
+                A = A.reshape(nquad, 3 * ndipoles) * weights[:, None]
+                A_op = sopp.DipoleFieldOperator(points, m_points, unitnormal, nfp, stellsym, weights, coordinate_flag, 1.0)
+                assert np.allclose(A_op.dense(), A, rtol=1e-12, atol=0)
+                m = np.random.rand(3 * ndipoles)
+                tol = 1e-12 * np.max(np.abs(A))
+                assert np.allclose(A_op.matvec(m), A @ m, atol=tol * 3 * ndipoles)
+                assert np.allclose(A_op.rmatvec(b), A.T @ b, atol=tol * nquad)
+                ATAm = A.T @ (A @ m)
+                assert np.allclose(A_op.normal_matvec(m), ATAm, rtol=0, atol=1e-12 * np.max(np.abs(ATAm)))
+                A_op.cache_gram()
+                assert A_op.has_gram()
+                assert np.allclose(A_op.normal_matvec(m), ATAm, rtol=0, atol=1e-12 * np.max(np.abs(ATAm)))
+
+        m_maxima = np.random.rand(ndipoles) * 10
+        m0 = np.zeros((ndipoles, 3))
+        ATb = np.ascontiguousarray((A.T @ b).reshape(ndipoles, 3))
+        alpha = 2.0 / np.linalg.norm(A, ord=2) ** 2
+        kwargs = dict(b_obj=b, ATb=ATb, m_proxy=m0, m0=m0, m_maxima=m_maxima,
+                      alpha=alpha, nu=1e100, epsilon=0.0, max_iter=100,
+                      reg_l0=0.0, reg_l1=0.0, reg_l2=0.0)
+        _, _, _, dipoles = sopp.MwPGP_algorithm(A_obj=np.ascontiguousarray(A), **kwargs)
+        for use_gram in [False, True]:
+            if not use_gram:
+                A_op.clear_gram()
+            else:
+                A_op.cache_gram()
+            _, _, _, dipoles_op = sopp.MwPGP_algorithm_matrix_free(A_op=A_op, **kwargs)
+            assert np.allclose(dipoles, dipoles_op, rtol=1e-8, atol=1e-12)
+
+    def test_GPMO_incremental(self):
+        """
+            Check that GPMO_baseline, which updates the candidate scores
+            incrementally, picks the same magnets as a brute force search
+            over ||A m - b||^2 for every candidate.
+        """
+        np.random.seed(2)
+        ndipoles = 30
+        nquad = 200
+        K = 20
+        A = np.random.randn(3 * ndipoles, nquad)
+        b = 5 * np.random.randn(nquad)
+        mmax = 0.1 * np.random.rand(3 * ndipoles)
+        Nnorms = np.ones(nquad)
+        _, _, _, m = sopp.GPMO_baseline(A_obj=A, b_obj=b, mmax=mmax, normal_norms=Nnorms,
+                                        K=K, verbose=False, nhistory=10, single_direction=-1)
+
+        r = -b
+        available = np.ones(3 * ndipoles, dtype=bool)
+        m_ref = np.zeros((ndipoles, 3))
+        for k in range(K):
+            R2s = np.full(6 * ndipoles, 1e50)
+            R2s[:3 * ndipoles][available] = (np.sum((r + A) ** 2, axis=1) + mmax ** 2)[available]
+            R2s[3 * ndipoles:][available] = (np.sum((r - A) ** 2, axis=1) + mmax ** 2)[available]
+            ind = np.argmin(R2s)
+            sign = 1.0 if ind < 3 * ndipoles else -1.0
+            j = ind % (3 * ndipoles)
+            m_ref[j // 3, j % 3] = sign
+            r = r + sign * A[j]
+            available[3 * (j // 3):3 * (j // 3) + 3] = False
+        assert np.allclose(m, m_ref)
+
+    def test_hmatrix(self):
+        """
+            Test that DipoleFieldHMatrix approximates the matrix of
+            DipoleFieldOperator to the requested accuracy, and that GPMO
+            gives the same magnets with both operators as with the dense matrix.
+        """
+        np.random.seed(3)
+        nfp = 2
+        nphi, ntheta = 24, 24
+        phi, theta = np.meshgrid((np.arange(nphi) + 0.5) / nphi * np.pi / nfp,
+                                 np.arange(ntheta) / ntheta * 2 * np.pi, indexing='ij')
+        R = 1 + 0.3 * np.cos(theta)
+        points = np.stack([R * np.cos(phi), R * np.sin(phi), 0.3 * np.sin(theta)], axis=-1).reshape(-1, 3)
+        unitnormal = np.stack([np.cos(theta) * np.cos(phi), np.cos(theta) * np.sin(phi), np.sin(theta)], axis=-1).reshape(-1, 3)
+        R = 1 + 0.45 * np.cos(theta[::2, ::2])
+        m_points = np.stack([R * np.cos(phi[::2, ::2]), R * np.sin(phi[::2, ::2]), 0.45 * np.sin(theta[::2, ::2])], axis=-1).reshape(-1, 3)
+        points, unitnormal, m_points = [np.ascontiguousarray(x) for x in [points, unitnormal, m_points]]
+        ndipoles = m_points.shape[0]
+        weights = np.random.rand(nphi * ntheta)
+        for coordinate_flag in ['cartesian', 'cylindrical', 'toroidal']:
+            A_op = sopp.DipoleFieldOperator(points, m_points, unitnormal, nfp, 1, weights, coordinate_flag, 1.0)
+            A = A_op.dense()
+            for tol in [1e-4, 1e-8]:
+                H = sopp.DipoleFieldHMatrix(points, m_points, unitnormal, nfp, 1, weights, coordinate_flag, 1.0, tol=tol, leaf_size=16)
+                assert H.compression_ratio <= 1
+                # at the lower accuracy, some of the blocks are low rank
+                assert H.nlowrank > 0 or tol < 1e-6
+                m = np.random.randn(3 * ndipoles)
+                y = np.random.randn(nphi * ntheta)
+                assert np.linalg.norm(H.matvec(m) - A @ m) < 10 * tol * np.linalg.norm(A @ m)
+                assert np.linalg.norm(H.rmatvec(y) - A.T @ y) < 10 * tol * np.linalg.norm(A.T @ y)
+                for j in [0, 7, 3 * ndipoles - 1]:
+                    assert np.allclose(A_op.get_column(j), A[:, j])
+                    assert np.linalg.norm(H.get_column(j) - A[:, j]) < 10 * tol * np.linalg.norm(A[:, j])
+
+        b = 1e-3 * np.cos(theta).ravel()
+        mmax = np.random.rand(3 * ndipoles) + 0.5
+        kwargs = dict(b_obj=b, mmax=np.zeros(3 * ndipoles), normal_norms=np.ones(nphi * ntheta),
+                      K=50, verbose=False, nhistory=10, single_direction=-1)
+        _, _, _, m = sopp.GPMO_baseline(A_obj=np.ascontiguousarray((A * mmax).T), **kwargs)
+        for A_op in [A_op, H]:
+            _, _, _, m_op = sopp.GPMO_baseline_matrix_free(A_op=A_op, column_scaling=mmax, **kwargs)
+            assert np.allclose(m, m_op)
+
     def test_algorithms(self):
         """ 
             Test the relax and split algorithm for solving